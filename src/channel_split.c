@@ -0,0 +1,168 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#include <string.h>
+#include "channel_split.h"
+#include "common.h"
+#include "upsampling.h"
+#include "transmit_to_dac.h"
+#include "scheduler.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+// チャンネル分割モード
+// Core1がCore0→Core1のリングバッファから1ブロック分の入力(入力レートのLch/Rch)を読み出し、
+// Lchの処理をCore0に依頼してから自分はRchを処理する。各コアは1ch分の全段のアップサンプリングと
+// フェードを行い、I2S送信バッファの偶数スロット(Lch)・奇数スロット(Rch)に直接書き込む。
+// Core1はCore0の完了を待ってからDMAに渡す(ブロック毎に同期する)。
+// 各コアの処理量は同じになるが、Core0はUSB受信と入力の変換の分だけ多くなる。
+// 段の分割(stage_partition.c)との比較のため、各コアの処理時間と待ち時間を記録する。
+
+typedef struct
+{
+	float *in;
+	int32_t *out;
+	uint32_t length;
+	float gain_start;
+	float gain_step;
+	uint32_t elapsed_us;
+} SPLIT_REQUEST;
+
+static SPLIT_REQUEST split_request;
+static volatile uint32_t split_seq_request = 0;
+static volatile uint32_t split_seq_done = 0;
+static CHANNEL_SPLIT_STAT split_stat;
+
+// アップサンプリング後の1ch分のデータ
+static float split_upsr_L[SIZE_DMA_TX_BUF / 2];
+static float split_upsr_R[SIZE_DMA_TX_BUF / 2];
+
+// 1ch分をアップサンプリングし、フェードをかけながらI2S送信バッファの1スロットおきに書き込む
+// Q31のフィルタ(Q31_PIPELINE_MODE): 入力はint32のまま(音量はCore0で入力にかけてある) フェードはQ31の整数乗算でかける(ゲイン1ではそのままコピー)
+// 演算は折り返すのでクリップは数えない
+static uint32_t __not_in_flash_func(split_process_channel_q31)(uint ch, const int32_t *in, int32_t *work, int32_t *out, uint32_t length, float gain, float step)
+{
+	uint32_t len = upsampling_process_channel_q31(ch, in, work, length);
+
+	out += ch;
+	if ((step == 0.f) && (gain >= 1.f))
+	{
+		for (uint32_t i = 0; i < len; i++)
+			out[i << 1] = work[i];
+		return len;
+	}
+
+	// 始点と終点を1以下に制限し、0方向に丸めてQ31にする(途中で1を超えない)
+	double start = fmin((double)gain, 1.);
+	double end = fmin((double)gain + (double)step * len, 1.);
+	int32_t gain_q31 = (int32_t)(start * 2147483647.);
+	int32_t step_q31 = (len > 0) ? (int32_t)((end - start) * 2147483647. / len) : 0;
+	for (uint32_t i = 0; i < len; i++)
+	{
+		gain_q31 += step_q31;
+		out[i << 1] = (int32_t)(((int64_t)work[i] * gain_q31) >> 31);
+	}
+	return len;
+}
+
+static uint32_t __not_in_flash_func(split_process_channel)(uint ch, float *in, float *work, int32_t *out, uint32_t length, float gain, float step)
+{
+	if (Q31_PIPELINE_MODE)
+		return split_process_channel_q31(ch, (const int32_t *)in, (int32_t *)work, out, length, gain, step);
+
+	uint32_t len = upsampling_process_channel(ch, in, work, length);
+	uint32_t clip = 0;
+
+	out += ch;
+	for (uint32_t i = 0; i < len; i++)
+	{
+		gain += step;
+		float data = work[i] * gain;
+		if (TELEMETRY_ENABLE)
+			clip += (fabsf(data) >= TELEMETRY_CLIP_LEVEL);
+		out[i << 1] = (int32_t)data;
+	}
+	// カウンタはコア毎に分ける(Lch:Core0, Rch:Core1)
+	telemetry_count((ch == 0) ? TELEMETRY_COUNTER_CLIP_CORE0 : TELEMETRY_COUNTER_CLIP, clip);
+	return len;
+}
+
+// Core1からの依頼でLchを処理する(Core0)
+static void __not_in_flash_func(channel_split_core0_handler)(void)
+{
+	uint32_t seq = split_seq_request;
+	if (seq == split_seq_done)
+		return;
+	__dmb();
+
+	uint32_t start_us = time_us_32();
+	trace_event(TRACE_ID_SPLIT_BEGIN, split_request.length);
+	split_process_channel(0, split_request.in, split_upsr_L, split_request.out, split_request.length, split_request.gain_start, split_request.gain_step);
+	trace_event(TRACE_ID_SPLIT_END, 0);
+	split_request.elapsed_us = time_us_32() - start_us;
+
+	__dmb();
+	split_seq_done = seq;
+	__sev();
+}
+
+void init_channel_split(void)
+{
+	split_seq_request = 0;
+	split_seq_done = 0;
+	clear_channel_split_stat();
+	sched_register(0, SCHED_EVENT_SPLIT_BLOCK, channel_split_core0_handler);
+}
+
+// 1ブロック分をCore0(Lch)とCore1(Rch)で並列に処理する(Core1から呼ぶ) 戻り値はI2S送信バッファのワード数
+uint32_t __not_in_flash_func(channel_split_process)(float *in_L, float *in_R, int32_t *out, uint32_t length, float gain_start, float gain_step)
+{
+	split_request.in = in_L;
+	split_request.out = out;
+	split_request.length = length;
+	split_request.gain_start = gain_start;
+	split_request.gain_step = gain_step;
+	__dmb();
+	uint32_t seq = split_seq_request + 1;
+	split_seq_request = seq;
+	sched_post(0, SCHED_EVENT_SPLIT_BLOCK);
+
+	uint32_t start_us = time_us_32();
+	uint32_t len = split_process_channel(1, in_R, split_upsr_R, out, length, gain_start, gain_step);
+	uint32_t core1_us = time_us_32() - start_us;
+
+	// Core0のLch処理の完了を待つ(完了時にSEVで起こされる)
+	while (split_seq_done != seq)
+		__wfe();
+	__dmb();
+	uint32_t wait_us = time_us_32() - start_us - core1_us;
+
+	split_stat.count++;
+	split_stat.sum_core0_us += split_request.elapsed_us;
+	split_stat.sum_core1_us += core1_us;
+	split_stat.sum_wait_us += wait_us;
+	if (split_request.elapsed_us > split_stat.max_core0_us)
+		split_stat.max_core0_us = split_request.elapsed_us;
+	if (core1_us > split_stat.max_core1_us)
+		split_stat.max_core1_us = core1_us;
+	if (wait_us > split_stat.max_wait_us)
+		split_stat.max_wait_us = wait_us;
+
+	return len << 1;
+}
+
+void get_channel_split_stat(CHANNEL_SPLIT_STAT *stat)
+{
+	*stat = split_stat;
+}
+
+void clear_channel_split_stat(void)
+{
+	memset(&split_stat, 0, sizeof(split_stat));
+}
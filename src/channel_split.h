@@ -0,0 +1,30 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _CHANNEL_SPLIT_H_
+#define _CHANNEL_SPLIT_H_
+
+#include "pico/stdlib.h"
+
+// 処理時間の計測結果(us 1ブロックあたり)
+typedef struct
+{
+	uint32_t count;
+	uint32_t max_core0_us; // Core0のLch処理時間
+	uint32_t max_core1_us; // Core1のRch処理時間
+	uint32_t max_wait_us;  // Core1がCore0の完了を待った時間
+	uint64_t sum_core0_us;
+	uint64_t sum_core1_us;
+	uint64_t sum_wait_us;
+} CHANNEL_SPLIT_STAT;
+
+extern void init_channel_split(void);
+extern uint32_t __not_in_flash_func(channel_split_process)(float *in_L, float *in_R, int32_t *out, uint32_t length, float gain_start, float gain_step);
+extern void get_channel_split_stat(CHANNEL_SPLIT_STAT *stat);
+extern void clear_channel_split_stat(void);
+
+#endif /* _CHANNEL_SPLIT_H_ */
@@ -44,6 +44,98 @@
 #define CORE0_UPSAMPLING_192K (false)
 #define DEFAULT_GAIN_RATIO (0.6) // Adjust this according to your filter to avoid clipping.
 
+// 音量・ミュートが変わったときに入力にかけるゲインのランプの長さ(ms 直線) 段差によるクリックを防ぐ
+#define VOLUME_RAMP_MS (10)
+
+// フィルタプロファイル(0:最小位相 1:直線位相 2:アポダイジング 3:短遅延 係数表はupsampling_coef.c)
+// USBのベンダーリクエスト(デバイス宛て bRequest=FILTER_PROFILE_REQ_SET, wValue=番号)で切り替えられる
+#define FILTER_PROFILE_DEFAULT (0)
+#define FILTER_PROFILE_XFADE_MS (5) // 切り替え時に新旧のFIRを並列に実行してクロスフェードする時間
+#define FILTER_PROFILE_LOAD_LIMIT (900) // 切り替え中のコア負荷(‰ 見積もり)がこれを超えるプロファイルは受け付けない
+
+// 48kHz系のFIR 4xを長いタップ数(DSP_LONG_FIR_TAPS 直線位相)のFIRに置き換える(dsp_long_fir.c)
+// 分割FFT畳み込みで処理するため、DSP_LONG_FIR_PARTITION入力サンプル + フィルタの群遅延(タップ数/2)の遅延が増える
+#define LONG_FIR_ENABLE (false)
+
+// パラメトリックEQ(入力レートで最初の補間段の前に実行する 1chあたり最大16段 dsp_peq.c)
+// USBのベンダーリクエスト(PEQ_REQ_xxx peq_control.h)で設定する 既定は0段(EQなし)
+// 全レート・パワーモードで負荷の見積もりがFILTER_PROFILE_LOAD_LIMITを超える設定は受け付けない
+#define PEQ_ENABLE (true)
+
+// ヘッドホン用クロスフィード(入力レートでint32→float変換・ゲインと同じループで行う bs2bと同じ設計 dsp_crossfeed.c)
+// 例 bs2b既定:700Hz/4.5dB Chu Moy:700Hz/6.0dB Jan Meier:650Hz/9.5dB
+#define CROSSFEED_ENABLE (false)
+#define CROSSFEED_CUT_FREQ (700.f) // 反対chのローパスの遮断周波数(Hz)
+#define CROSSFEED_LEVEL_DB (4.5f)  // 低域での自chと反対chのレベル差(dB)
+#define CROSSFEED_DELAY_US (0.f)   // 反対chに加える遅延(us 0でbs2bと同じ ローパス自体にも低域で約230usの群遅延がある)
+
+// ルーム補正FIR(入力レートでEQの後に実行する 1chあたり最大DSP_ROOM_FIR_MAX_TAPSタップ dsp_room_fir.c)
+// インパルス応答はUSBのベンダーリクエスト(ROOM_FIR_REQ_xxx room_fir_control.h)で書き込み、出力をフェードアウトして入れ替える
+// 書き込んだサンプルレートの入力にだけ適用する 分割FFT畳み込みのためDSP_ROOM_FIR_PARTITIONサンプルの遅延が増える
+// RAMを約160KB使う(既定で無効)
+#define ROOM_FIR_ENABLE (false)
+
+// 最終段(Core1)のBiQuad-IIR(BiQuad-IIR 2x LowPowerMode / 4x HiPowerMode)の状態と累算を倍精度にする(dsp_bq_f64.c サンプルはfloatのまま)
+// 倍精度の演算はPico SDK(pico_double)経由でDCP(倍精度コプロセッサ)を使う 極が単位円に近い段の丸め雑音が下がるが、処理量はfloatの数倍になる
+// 起動時の処理段の計測(STAGE_PARTITION_MEASURE=trueの場合)は倍精度で行うので、段の分割・負荷の見積もりにも反映される
+#define BQ_F64_ENABLE (false)
+
+// Core0/Core1の処理段の分割(各段の処理サイクル数から、レート・パワーモード毎に両コアの負荷が釣り合う位置で分割する 既定で無効)
+// STAGE_PARTITION_MEASURE=trueでは起動時に各段を計測する(EQ・ルーム補正FIR・プロファイルの負荷の見積もりにも使う)
+#define STAGE_PARTITION_ENABLE (false)
+#define STAGE_PARTITION_MEASURE (false) // false:計測せず見積もり値(stage_partition.c)を使う
+
+// チャンネル分割モード(LchをCore0、RchをCore1で全段アップサンプリングし、I2S送信バッファの偶数/奇数スロットに並列に書き込む)
+// Core0→Core1のリングバッファが入力レートになるので遅延が大きくなる 1bit出力時は使用できない
+#define CHANNEL_SPLIT_ENABLE (false)
+
+// Q31固定小数点のフィルタ(チャンネル分割モードのときだけ使える CHANNEL_SPLIT_ENABLEもtrueにすること FIRは64bit累算、BiQuad-IIRは32x64 dsp_q31.c)
+// 入力のint32をfloatに変換せずにそのまま処理し、音量はCore0で入力のint32に、フェードは出力で整数の乗算としてかける
+// パラメトリックEQ・ルーム補正FIR・長いFIR・クロスフィードは使えず、プロファイルの切り替えはクロスフェードの代わりにフェードアウトして行う
+#define Q31_PIPELINE_ENABLE (false)
+
+// 処理段毎のサイクル数計測(DWT CYCCNT 最小/平均/最大とヒストグラムを定期的にUARTに出力する) falseの場合は計測処理ごと消える
+#define PROFILE_ENABLE (false)
+#define PROFILE_REPORT_INTERVAL_MS (2000)
+
+// USBテレメトリ(ベンダー固有インターフェイスのバルクINでバッファ水位・フィードバック値・負荷・アンダーラン数などを送る)
+// ホスト側はtools/telemetry/ddc_telemetry.cで読み出す Windowsではこのインターフェイスに WinUSB を割り当てる必要がある
+#define TELEMETRY_ENABLE (false)
+
+// トレース(処理の流れを時刻付きのバイナリイベントとしてコア毎のバッファに記録する 割り込みは止めない)
+// 読み出しはUART(TRACE_OUTPUT_UART)またはUSBテレメトリのインターフェイス(TELEMETRY_ENABLE) ホスト側はtools/trace/ddc_trace.cでタイムラインにする
+#define TRACE_ENABLE (false)
+#define TRACE_OUTPUT_UART (false)
+#define TRACE_UART_BAUDRATE (921600) // 115200bpsではイベントを送りきれない
+#define TRACE_IDLE_DISCARD_MS (1000) // この時間読み出されなければ古いイベントを捨てる
+
+// S/PDIF Output (I2Sと同時出力)
+#define SPDIF_OUTPUT_ENABLE (false)
+#define SPDIF_OUT_PIN (16)
+#define SPDIF_OUTPUT_RATIO (1) // 1:入力周波数で出力, 2:入力周波数の2倍で出力(最大192kHz)
+
+// MCLK出力(I2Sと同じPIO分周率で生成し位相を揃える DACのDPLLバンド幅を狭くできる)
+// MCLK_RATIOはDACに出力するI2SのLRCK(I2S出力周波数)に対する倍率
+// I2SのPIOは1サンプル128サイクルなので、MCLKは最大64倍(=BCLK 半周期1サイクル) BCLKより遅いMCLKはDACが受け付けない
+#define MCLK_OUTPUT_ENABLE (false)
+#define MCLK_PIN (19)
+#define MCLK_RATIO (64) // 64(=BCLK), 32, 16, 8, 4
+
+// Delta-Sigma直接出力(DAC不要 I2Sの代わりにL/Rの1bitストリームを出力する 出力ピンにはアナログLPFが必要)
+// Core1の処理時間を確保するためHiPowerModeのクロックで動作し、Core1のアップサンプリングは行わない
+#define SDM_OUTPUT_ENABLE (false)
+#define SDM_OUT_PIN_BASE (20) // Lch:SDM_OUT_PIN_BASE, Rch:SDM_OUT_PIN_BASE+1
+#define SDM_ORDER (4)		  // 変調器の次数(2~7 Core1の予算に収まるのはOSR16で4次まで・OSR32で2次まで 超えるとビルドエラー)
+#define SDM_OVERSAMPLING (16) // I2S出力周波数に対する倍率(16 or 32) 16:352.8kHz*16=5.6448MHz
+
+// DSD出力(DSD入力対応DAC向け Core1でDelta-Sigma変調してDSDで出力する SDM_OUTPUT_ENABLEとは排他)
+// Core0のアップサンプリング倍率が8倍(CORE0_UPSAMPLING_192K=false)のときのみ使用可能
+#define DSD_OUTPUT_ENABLE (false)
+#define DSD_DATA_PIN_BASE (20) // DSD L:DSD_DATA_PIN_BASE, DSD R:DSD_DATA_PIN_BASE+1
+#define DSD_CLK_PIN (22)
+#define DSD_RATE (128)		   // 128:DSD128(5.6448MHz/6.144MHz), 256:DSD256(11.2896MHz/12.288MHz)
+#define DSD_ORDER (4)		   // 変調器の次数(2~7 DSD128の変調でCore1の予算に収まるのは4次まで 超えるとビルドエラー)
+
 // ESS DAC Specific
 #define USE_ESS_DAC (false)
 #define KIND_ESS_DAC (ESS_DAC_NONE)
@@ -75,6 +167,20 @@
 // DCDC Control
 #define DCDC_MODE_PIN (23)
 
+// 1bit出力(Delta-Sigma直接出力 / DSD出力)時はCore1でアップサンプリングの代わりに変調を行う
+#define ONEBIT_OUTPUT_ENABLE (SDM_OUTPUT_ENABLE || DSD_OUTPUT_ENABLE)
+
+// チャンネル分割モード(1bit出力時はCore1が変調で埋まるので使わない)
+#define CHANNEL_SPLIT_MODE (CHANNEL_SPLIT_ENABLE && !ONEBIT_OUTPUT_ENABLE)
+
+// Q31固定小数点のフィルタ(チャンネル分割モードのときだけ)
+#define Q31_PIPELINE_MODE (Q31_PIPELINE_ENABLE && CHANNEL_SPLIT_MODE)
+
+// Q31のフィルタは2コアで分割する処理(チャンネル分割モード)にしかないので、それ以外の構成で黙ってfloatにしない
+#if Q31_PIPELINE_ENABLE && !CHANNEL_SPLIT_MODE
+#error "Q31_PIPELINE_ENABLE requires CHANNEL_SPLIT_ENABLE (and no SDM/DSD output)"
+#endif
+
 // LED
 #define ONBOARD_LED_PIN (25)
 
@@ -101,12 +207,42 @@
 // アップサンプリング時のデータサイズ増減幅
 #define OSR_ADJ_SIZE (1)
 
+// サンプルレート・パワーモード切り替え時のフェード長(Core1の処理ブロック数 1ブロック=TIMER_US_CORE1)
+#define SWITCH_FADE_BLOCKS (8)
+
+// サンプルレート・パワーモード切り替え後の出力再開水位(FB水位まで待たずに出力を再開する)
+#define SWITCH_RESTART_THRESHOLD (SIZE_UPSAMPLE_CORE0 / 16)
+
+// フェードアウト完了待ちのタイムアウト(us)
+#define SWITCH_FADE_TIMEOUT_US (20000)
+
 // ボリューム管理
 #define VOLUME_RESOLUTION (256)
 #define MIN_VOLUME (-64 * VOLUME_RESOLUTION)
 #define MAX_VOLUME (0 * VOLUME_RESOLUTION)
 #define DEFAULT_VOLUME (0 * VOLUME_RESOLUTION)
 
+// サンプルレート系列
+#define RATE_FAMILY_44K (0)
+#define RATE_FAMILY_48K (1)
+#define NUM_OF_RATE_FAMILY (2)
+
+// パワーモード
+#define POWER_MODE_LOW (0)
+#define POWER_MODE_HIGH (1)
+#define NUM_OF_POWER_MODE (2)
+
+// サンプルレート系列・パワーモード毎のクロック設定
+typedef struct
+{
+	uint32_t sys_clock_khz;
+	uint32_t vreg_voltage;
+	uint16_t i2s_clkdiv_int;	// PIO分周率 整数部
+	uint8_t i2s_clkdiv_frac;	// PIO分周率 小数部(1/256単位)
+	uint32_t i2s_freq;			// I2S出力サンプル周波数
+	uint8_t mclk_half_period;	// MCLK半周期のPIOサイクル数(I2Sと同じ分周率で1~16)
+} CLOCK_CONFIG;
+
 typedef struct
 {
 	uint32_t freq;		// 周波数系列軸・倍率軸用(既存)
@@ -135,11 +271,15 @@ extern inline void int32_to_float_array(int32_t *input, float *output, uint32_t
 extern inline void float_to_int32_array(float *input, int32_t *output, uint32_t length);
 extern inline uint16_t get_ratio_upsampling_core0(uint32_t freq);
 extern inline uint16_t get_ratio_upsampling_core1(void);
+extern uint16_t get_ratio_upsampling_core1_mode(bool is_high_power);
 inline uint16_t ratio_to_bitshift(uint16_t ratio);
 extern uint32_t calc_pwm_period_us(float period_us, uint16_t prescale);
 extern void setup_I2C(void);
 extern void volume_control(void);
 
+extern void init_clock_config_table(void);
+extern const CLOCK_CONFIG *get_clock_config(uint32_t freq, bool is_high_power);
+extern bool is_clock_config_changed(uint32_t freq, bool is_high_power);
 extern void renew_clock(bool is_high_power);
 extern void cancel_timer0(void);
 extern void restart_timer0(void);
@@ -22,16 +22,21 @@
 #include "transmit_to_dac.h"
 #include "upsampling.h"
 #include "ringbuffer.h"
-#include "debug_with_gpio.h"
+#include "scheduler.h"
+#include "profiler.h"
 
 void core1_main()
 {
 	// I2S初期化
 	init_i2s_interface();
 
-	while (true)
-	{
-		dma_tx_start();
-		sleep_us(1);
-	}
+	// Core1のサイクルカウンタを有効にする
+	if (PROFILE_ENABLE)
+		init_profiler();
+
+	// DMA転送完了・Core0からのデータ書き込み・周期タイマーでDMA送信バッファを補充する
+	sched_register(1, SCHED_EVENT_TIMER, dma_tx_start);
+	sched_register(1, SCHED_EVENT_DMA_DONE, dma_tx_start);
+	sched_register(1, SCHED_EVENT_DATA_READY, dma_tx_start);
+	sched_run();
 }
\ No newline at end of file
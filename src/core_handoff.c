@@ -0,0 +1,178 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#include <string.h>
+#include "core_handoff.h"
+#include "common.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+
+// Core0(アップサンプリング) -> Core1(DMA送信) のデータ受け渡しをSIO FIFOで通知する
+//   Core0 -> Core1 : 書き込んだブロックの記述子(先頭位置, サンプル数, シーケンス番号)
+//   Core1 -> Core0 : 読み出したブロックの解放通知(同じ形式)
+// データ本体はこれまでどおりリングバッファに置き、Core1は通知済みの分だけを読む。
+// FIFOが満杯のときは送信を保留し、連続するブロックをまとめて次の機会に送る。
+
+typedef struct
+{
+	uint32_t seq_tx;		// 次に送る記述子のシーケンス番号
+	uint32_t offset_tx;		// 保留中ブロックの先頭位置
+	uint32_t pending;		// FIFOが満杯で送れていないサンプル数
+	bool reset_pending;		// 送れていないリセット通知
+	uint32_t seq_rx;		// 次に受け取るはずのシーケンス番号
+	uint32_t offset_rx;		// 次に受け取るはずのブロック先頭位置
+	bool offset_rx_valid;
+	int32_t count;			// Core0: Core1が解放していないサンプル数, Core1: 通知済みで未読のサンプル数
+	HANDOFF_STAT stat;
+} HANDOFF_STATE;
+
+static HANDOFF_STATE handoff_state[2];
+
+static inline uint32_t handoff_pack(uint32_t seq, uint32_t length, uint32_t offset)
+{
+	return ((seq & HANDOFF_SEQ_MASK) << (HANDOFF_LENGTH_BITS + HANDOFF_OFFSET_BITS)) | (length << HANDOFF_OFFSET_BITS) | (offset & HANDOFF_OFFSET_MASK);
+}
+
+void init_core_handoff(void)
+{
+	memset(handoff_state, 0, sizeof(handoff_state));
+}
+
+// 保留中の記述子を送れるだけ送る
+static void __not_in_flash_func(handoff_flush)(HANDOFF_STATE *state)
+{
+	// リングバッファへの書き込みを、記述子より先に相手コアから見えるようにする
+	__dmb();
+
+	if (state->reset_pending)
+	{
+		if (!multicore_fifo_wready())
+			return;
+		multicore_fifo_push_blocking(handoff_pack(state->seq_tx++, 0, 0));
+		state->stat.sent++;
+		state->reset_pending = false;
+	}
+
+	while ((state->pending > 0) && multicore_fifo_wready())
+	{
+		uint32_t length = (state->pending > HANDOFF_LENGTH_MAX) ? HANDOFF_LENGTH_MAX : state->pending;
+		multicore_fifo_push_blocking(handoff_pack(state->seq_tx++, length, state->offset_tx));
+		state->stat.sent++;
+		state->offset_tx = (state->offset_tx + length) % SIZE_UPSAMPLE_CORE0;
+		state->pending -= length;
+	}
+
+	if ((state->pending > 0) || state->reset_pending)
+		state->stat.fifo_full++;
+}
+
+static void __not_in_flash_func(handoff_push)(HANDOFF_STATE *state, uint32_t offset, uint32_t length)
+{
+	// 保留が無ければ新しいブロックから、あれば後ろにつなげる(連続していることが前提)
+	if (state->pending == 0)
+		state->offset_tx = offset;
+	state->pending += length;
+	handoff_flush(state);
+}
+
+// 自コア宛ての記述子をすべて取り込む
+void __not_in_flash_func(handoff_poll)(void)
+{
+	uint core = get_core_num();
+	HANDOFF_STATE *state = &handoff_state[core];
+	uint32_t save = save_and_disable_interrupts();
+
+	while (multicore_fifo_rvalid())
+	{
+		uint32_t desc = multicore_fifo_pop_blocking();
+		uint32_t seq = desc >> (HANDOFF_LENGTH_BITS + HANDOFF_OFFSET_BITS);
+		uint32_t length = (desc >> HANDOFF_OFFSET_BITS) & HANDOFF_LENGTH_MAX;
+		uint32_t offset = desc & HANDOFF_OFFSET_MASK;
+
+		state->stat.received++;
+		if (seq != (state->seq_rx & HANDOFF_SEQ_MASK))
+			state->stat.seq_gap++;
+		state->seq_rx = seq + 1;
+
+		// リセット通知: リングバッファがクリアされたので未読分を捨てる
+		if (length == 0)
+		{
+			if (core == 1)
+				state->count = 0;
+			state->offset_rx_valid = false;
+			continue;
+		}
+
+		if (state->offset_rx_valid && (offset != state->offset_rx))
+			state->stat.offset_mismatch++;
+		state->offset_rx = (offset + length) % SIZE_UPSAMPLE_CORE0;
+		state->offset_rx_valid = true;
+
+		if (core == 1)
+			state->count += length; // 書き込み通知
+		else
+			state->count -= length; // 解放通知
+
+		// リセット前のブロックの解放通知が後から届くことがある
+		if (state->count < 0)
+			state->count = 0;
+	}
+
+	// 前回送れなかった分を送る
+	handoff_flush(state);
+	restore_interrupts(save);
+}
+
+// Core0: リングバッファに書き込んだブロックをCore1に通知する
+void __not_in_flash_func(handoff_send_block)(uint32_t offset, uint32_t length)
+{
+	HANDOFF_STATE *state = &handoff_state[0];
+	uint32_t save = save_and_disable_interrupts();
+	state->count += length;
+	handoff_push(state, offset, length);
+	restore_interrupts(save);
+}
+
+// Core1: 通知済みで、まだ読んでいないサンプル数
+int32_t __not_in_flash_func(handoff_get_available)(void)
+{
+	return handoff_state[1].count;
+}
+
+// Core1: 読み出したブロックを解放してCore0に通知する
+void __not_in_flash_func(handoff_release)(uint32_t offset, uint32_t length)
+{
+	HANDOFF_STATE *state = &handoff_state[1];
+	uint32_t save = save_and_disable_interrupts();
+	state->count -= length;
+	handoff_push(state, offset, length);
+	restore_interrupts(save);
+}
+
+// Core0: Core1がまだ解放していないサンプル数
+int32_t handoff_get_in_flight(void)
+{
+	return handoff_state[0].count;
+}
+
+// Core0: リングバッファをクリアしたときに呼び、Core1の未読分を捨てさせる
+void handoff_reset(void)
+{
+	HANDOFF_STATE *state = &handoff_state[0];
+	uint32_t save = save_and_disable_interrupts();
+	state->pending = 0;
+	state->count = 0;
+	state->offset_rx_valid = false;
+	state->reset_pending = true;
+	handoff_flush(state);
+	restore_interrupts(save);
+}
+
+void handoff_get_stat(uint core, HANDOFF_STAT *stat)
+{
+	*stat = handoff_state[core].stat;
+}
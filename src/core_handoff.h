@@ -0,0 +1,40 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _CORE_HANDOFF_H_
+#define _CORE_HANDOFF_H_
+
+#include "pico/stdlib.h"
+
+// SIO FIFOで送るブロック記述子(32bit)
+// [31:25] シーケンス番号, [24:13] サンプル数(0はリセット通知), [12:0] リングバッファ上の先頭位置
+#define HANDOFF_SEQ_BITS (7)
+#define HANDOFF_LENGTH_BITS (12)
+#define HANDOFF_OFFSET_BITS (13) // SIZE_UPSAMPLE_CORE0(8192)まで
+#define HANDOFF_SEQ_MASK ((1u << HANDOFF_SEQ_BITS) - 1)
+#define HANDOFF_LENGTH_MAX ((1u << HANDOFF_LENGTH_BITS) - 1)
+#define HANDOFF_OFFSET_MASK ((1u << HANDOFF_OFFSET_BITS) - 1)
+
+typedef struct
+{
+	uint32_t sent;			  // 送った記述子の数
+	uint32_t received;		  // 受け取った記述子の数
+	uint32_t seq_gap;		  // シーケンス番号の抜け
+	uint32_t offset_mismatch; // ブロック先頭位置の不連続
+	uint32_t fifo_full;		  // FIFOが満杯で送信を保留した回数
+} HANDOFF_STAT;
+
+extern void init_core_handoff(void);
+extern void __not_in_flash_func(handoff_poll)(void);
+extern void __not_in_flash_func(handoff_send_block)(uint32_t offset, uint32_t length);
+extern int32_t __not_in_flash_func(handoff_get_available)(void);
+extern void __not_in_flash_func(handoff_release)(uint32_t offset, uint32_t length);
+extern int32_t handoff_get_in_flight(void);
+extern void handoff_reset(void);
+extern void handoff_get_stat(uint core, HANDOFF_STAT *stat);
+
+#endif /* _CORE_HANDOFF_H_ */
@@ -0,0 +1,167 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#include <string.h>
+#include "deferred_work.h"
+#include "common.h"
+#include "scheduler.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+// 割り込みの中で時間のかかる処理(PLL再設定、pow()、バッファクリア、S/PDIF符号化など)をせず、
+// キューに積んでCore0のスレッド側(スケジューラのイベントループ)で優先度順に実行する。
+// 割り込み処理は予算内で終わっているかを計測し、タイマー割り込みの遅れの最大値を
+// 割り込みレイテンシの上限として記録する。1周期以上遅れて抜けた周期は別に数える。
+
+typedef struct
+{
+	DEFERRED_FUNC func[SIZE_DEFERRED_QUEUE];
+	uint32_t wp;
+	uint32_t rp;
+} DEFERRED_QUEUE;
+
+static DEFERRED_QUEUE deferred_queue[NUM_OF_DEFERRED_PRIORITY];
+
+static IRQ_STAT irq_stat[NUM_OF_IRQ_ID];
+static const uint32_t irq_budget_us[NUM_OF_IRQ_ID] = {
+	IRQ_BUDGET_US_TIMER0,
+	IRQ_BUDGET_US_USB_RX,
+	IRQ_BUDGET_US_DMA_I2S,
+	IRQ_BUDGET_US_DMA_SPDIF,
+};
+static uint32_t timer0_prev_us = 0;
+static uint32_t timer0_max_lateness_us = 0;
+static uint32_t timer0_missed_periods = 0;
+static volatile bool timer0_restarted = true;
+
+void init_deferred_work(void)
+{
+	memset(deferred_queue, 0, sizeof(deferred_queue));
+	clear_irq_stat();
+	sched_register(0, SCHED_EVENT_DEFERRED, run_deferred_work);
+}
+
+// 処理をキューに積む(Core0の割り込みから呼ぶ) 同じ処理が既に積まれていれば何もしない
+bool __not_in_flash_func(defer_work)(DEFERRED_FUNC func, uint priority)
+{
+	DEFERRED_QUEUE *queue = &deferred_queue[priority];
+	bool result = true;
+	uint32_t save = save_and_disable_interrupts();
+
+	for (uint32_t i = queue->rp; i != queue->wp; i = (i + 1) % SIZE_DEFERRED_QUEUE)
+	{
+		if (queue->func[i] == func)
+		{
+			restore_interrupts(save);
+			return true;
+		}
+	}
+
+	uint32_t next = (queue->wp + 1) % SIZE_DEFERRED_QUEUE;
+	if (next == queue->rp)
+	{
+		result = false; // queue is full
+	}
+	else
+	{
+		queue->func[queue->wp] = func;
+		queue->wp = next;
+	}
+	restore_interrupts(save);
+
+	sched_post(0, SCHED_EVENT_DEFERRED);
+	return result;
+}
+
+// 優先度の高いキューから1つずつ取り出して実行する(高優先度の処理が途中で積まれたらそちらを先にする)
+void __not_in_flash_func(run_deferred_work)(void)
+{
+	while (true)
+	{
+		DEFERRED_FUNC func = NULL;
+		uint32_t save = save_and_disable_interrupts();
+		for (uint priority = 0; priority < NUM_OF_DEFERRED_PRIORITY; priority++)
+		{
+			DEFERRED_QUEUE *queue = &deferred_queue[priority];
+			if (queue->rp != queue->wp)
+			{
+				func = queue->func[queue->rp];
+				queue->rp = (queue->rp + 1) % SIZE_DEFERRED_QUEUE;
+				break;
+			}
+		}
+		restore_interrupts(save);
+
+		if (func == NULL)
+			return;
+		func();
+	}
+}
+
+// 割り込み処理の最後に呼び、実行時間を記録する
+void __not_in_flash_func(irq_stat_record)(uint id, uint32_t start_us)
+{
+	IRQ_STAT *stat = &irq_stat[id];
+	uint32_t elapsed = time_us_32() - start_us;
+
+	if (elapsed > stat->max_us)
+		stat->max_us = elapsed;
+	if (elapsed > irq_budget_us[id])
+		stat->over_budget++;
+	stat->count++;
+}
+
+// タイマー割り込みの先頭で呼び、周期からの遅れ(=他の割り込みによるレイテンシ)を記録する
+void __not_in_flash_func(irq_stat_record_timer_period)(void)
+{
+	uint32_t now_us = time_us_32();
+	uint32_t period = now_us - timer0_prev_us;
+	timer0_prev_us = now_us;
+
+	// 再起動直後の1回目は前回の時刻が無効なので除く
+	if (timer0_restarted)
+	{
+		timer0_restarted = false;
+		return;
+	}
+
+	if (period > TIMER0_US)
+	{
+		if (period - TIMER0_US > timer0_max_lateness_us)
+			timer0_max_lateness_us = period - TIMER0_US;
+		// 遅れが1周期以上なら、その間に来るはずだった周期を抜けたものとして数える
+		timer0_missed_periods += period / TIMER0_US - 1;
+	}
+}
+
+// タイマーを(再)起動したときに呼ぶ 次の1回目の周期は計測しない
+void irq_stat_timer_restarted(void)
+{
+	timer0_restarted = true;
+}
+
+void get_irq_stat(uint id, IRQ_STAT *stat)
+{
+	*stat = irq_stat[id];
+}
+
+uint32_t get_timer0_max_lateness_us(void)
+{
+	return timer0_max_lateness_us;
+}
+
+uint32_t get_timer0_missed_periods(void)
+{
+	return timer0_missed_periods;
+}
+
+void clear_irq_stat(void)
+{
+	memset(irq_stat, 0, sizeof(irq_stat));
+	timer0_max_lateness_us = 0;
+	timer0_missed_periods = 0;
+}
@@ -0,0 +1,55 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _DEFERRED_WORK_H_
+#define _DEFERRED_WORK_H_
+
+#include "pico/stdlib.h"
+
+// 遅延処理の優先度(番号が小さいほど先に処理する)
+#define DEFERRED_PRIORITY_HIGH (0)	 // 締め切りのある処理(S/PDIF符号化、切り替えシーケンス)
+#define DEFERRED_PRIORITY_NORMAL (1) // 定期処理(ボリューム、パワーモード監視)
+#define DEFERRED_PRIORITY_LOW (2)
+#define NUM_OF_DEFERRED_PRIORITY (3)
+
+// 優先度毎のキューの長さ
+#define SIZE_DEFERRED_QUEUE (8)
+
+// 割り込み処理の実行時間計測
+#define IRQ_ID_TIMER0 (0)	  // core0_timer_callback
+#define IRQ_ID_USB_RX (1)	  // USB Audioパケット受信
+#define IRQ_ID_DMA_I2S (2)	  // I2S DMA転送完了(Core1)
+#define IRQ_ID_DMA_SPDIF (3) // S/PDIF DMA転送完了
+#define NUM_OF_IRQ_ID (4)
+
+// 割り込み処理毎の最悪実行時間の予算(us) これを超えた回数を数える
+#define IRQ_BUDGET_US_TIMER0 (5)
+#define IRQ_BUDGET_US_USB_RX (20)
+#define IRQ_BUDGET_US_DMA_I2S (5)
+#define IRQ_BUDGET_US_DMA_SPDIF (5)
+
+typedef void (*DEFERRED_FUNC)(void);
+
+typedef struct
+{
+	uint32_t count;
+	uint32_t max_us;
+	uint32_t over_budget;
+} IRQ_STAT;
+
+extern void init_deferred_work(void);
+extern bool __not_in_flash_func(defer_work)(DEFERRED_FUNC func, uint priority);
+extern void __not_in_flash_func(run_deferred_work)(void);
+extern void __not_in_flash_func(irq_stat_record)(uint id, uint32_t start_us);
+extern void __not_in_flash_func(irq_stat_record_timer_period)(void);
+extern void irq_stat_timer_restarted(void);
+extern void get_irq_stat(uint id, IRQ_STAT *stat);
+extern uint32_t get_timer0_max_lateness_us(void);
+extern uint32_t get_timer0_missed_periods(void);
+extern void clear_irq_stat(void);
+
+#endif /* _DEFERRED_WORK_H_ */
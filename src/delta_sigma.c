@@ -0,0 +1,260 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#include <string.h>
+#include <math.h>
+#include "delta_sigma.h"
+
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+#include <arm_acle.h>
+#endif
+
+// 1bit デルタシグマ変調器(CIFB構成: 遅延積分器の縦続 + 各段への1bitフィードバック + 共振器の負帰還)
+//
+//   x[0] += a[0]*u - a[0]*v - g[0]*x[1]
+//   x[i] += x[i-1] - a[i]*v - g[i]*x[i+1]   (i = 1 .. N-1 x[i+1]は更新後の値)
+//   v = sign(x[N-1])
+//
+// NTFの零点は信号帯域(20kHzまで)の雑音の積分が最小になる位置(N次のLegendre多項式の根 x 20kHz)に置き、
+// 奇数次はDCに1つ、残りは隣り合う2段の積分器と負帰還gの共振器で作る(g = 2 - 2cos(2π f0 / fs) 零点は単位円上)。
+// 極は最大ゲイン(Lee基準)が1.5になるよう配置している。零点の角周波数が変調周波数で変わるので、係数は変調倍率毎に持つ。
+// 入力側の積分器ほど値が小さくなるので、固定小数点では各積分器を2のべき乗でスケーリングし、
+// 段間の係数を算術シフトにしている(スケーリングしない場合6次以上でSNRが大きく劣化する)。
+//
+// 入力はCore0出力(I2S出力周波数)の各サンプルをmodulation_ratioステップ保持して変調器に通す(0次ホールド 20kHzで-0.05dB)。
+// 直線補間は1ステップあたりの増分を整数に切り捨てる誤差が信号帯域の雑音になり、SNRが-125dB程度で頭打ちになる。
+// 信号帯域(20kHzまで)のSNRと安定な入力レベルの余裕(0dBFS 1kHzの正弦波 tools/dsp_host/ddc_upsample -S の実測値 雑音には高調波を含む)と、
+// Cortex-M33での1ステップ・1chあたりのサイクル数(delta_sigma.hのSDM_CYCLES_X2 下のループの命令数から求めた値で、実測ではない)は以下のとおり。
+//
+//   次数 | OSR16(5.6448MHz)  | OSR32(11.2896MHz) | サイクル/ステップ
+//   -----+-------------------+-------------------+-----------------
+//     2  |   85dB  +6.0dB    |  100dB  +6.0dB    |   12.5
+//     3  |  110dB  +5.0dB    |  132dB  +5.5dB    |   15.5
+//     4  |  133dB  +4.0dB    |  154dB  +4.0dB    |   20.5
+//     5  |  150dB  +3.0dB    |  155dB  +2.5dB    |   25.5
+//     6  |  151dB  +2.5dB    |  151dB  +2.5dB    |   32.5
+//     7  |  153dB  +2.0dB    |  153dB  +1.5dB    |   37.5
+//
+// 5次以上は入力の量子化(floatの24bit・1段目のスケールでの整数化)で、信号帯域の雑音が-150dBFS程度で頭打ちになる。
+// (零点をすべてDCに置いた場合は、OSR16の5次で134dB・7次で147dB)
+// Core1の予算は sys_clk / (I2S出力周波数 * OSR * 2ch) で、283.2MHz/352.8kHz系・307.2MHz/384kHz系ともOSR16で25サイクル、
+// OSR32で12.5サイクルになる。5次以上は係数がレジスタに収まらず毎ステップ読み直すので、予算に収まるのはOSR16で4次まで、
+// OSR32で2次まで(SDM_ORDER・DSD_ORDERが予算を超えるとtransmit_to_dac.cでビルドエラーにする)。
+// DSD出力はOSR16(DSD128)で変調し、DSD256では同じビットを2回ずつ出力する(-S のdsd128/dsd256の行)。
+
+typedef struct
+{
+	int32_t a[SDM_MAX_ORDER]; // フィードバック係数(スケーリング後 Q28)
+	int32_t g[SDM_MAX_ORDER]; // 共振器の負帰還係数(スケーリング後 Q32 共振器のない段は0)
+} SDM_COEF;
+
+// 変調倍率(16 / 32) x 次数毎の係数 [modulation_ratio == 32][order - SDM_MIN_ORDER]
+static const SDM_COEF sdm_coef_table[2][SDM_MAX_ORDER - SDM_MIN_ORDER + 1] = {
+	{
+		{{61374432, 209636796}, {709505, 0}},
+		{{48708312, 77838599, 214818697}, {0, 1277094, 0}},
+		{{26858787, 69897913, 82842766, 216203068}, {984124, 0, 1578385, 0}},
+		{{22897986, 43836340, 39720359, 84880979, 216745333}, {0, 4937296, 0, 1747819, 0}},
+		{{15730916, 42205710, 53701734, 42194813, 85893590, 217009289}, {969577, 0, 7444622, 0, 1850701, 0}},
+		{{18450434, 32398601, 27906410, 59717970, 43623659, 86460779, 217154354}, {0, 5609449, 0, 9363138, 0, 1917333, 0}},
+	},
+	{
+		{{61399851, 209655048}, {177378, 0}},
+		{{48690676, 77878557, 214849756}, {0, 319280, 0}},
+		{{26896655, 69910764, 82906201, 216246653}, {246032, 0, 394605, 0}},
+		{{22871101, 43940604, 39756203, 84972888, 216801414}, {0, 1234335, 0, 436966, 0}},
+		{{15776349, 42209494, 53896679, 42267524, 86016542, 217077855}, {242395, 0, 1861181, 0, 462688, 0}},
+		{{18405366, 32564744, 27956909, 60020675, 43737341, 86616180, 217235400}, {0, 1402369, 0, 2340824, 0, 479347, 0}},
+	},
+};
+
+// 前段からの入力に掛けるシフト量(スケーリングの差 両方の変調倍率で共通にして、シフトを即値にする) [order - SDM_MIN_ORDER]
+static const uint8_t sdm_shift_table[SDM_MAX_ORDER - SDM_MIN_ORDER + 1][SDM_MAX_ORDER] = {
+	{0, 0},
+	{0, 2, 0},
+	{0, 2, 2, 0},
+	{0, 3, 3, 1, 0},
+	{0, 3, 3, 3, 1, 0},
+	{0, 4, 4, 2, 3, 1, 0},
+};
+
+// 共振器の負帰還をかける段か(偶数次は0,2,4段 奇数次は1,3,5段 最終段を除く)
+#define SDM_IS_RESONATOR(order, i) ((((i) ^ (order)) & 1u) == 0 && ((i) + 1 < (order)))
+
+// 積分器を毎ステップ±SDM_STATE_LIMITに制限する(Cortex-M33ではSSAT 1命令)
+// 状態が±2^29以内でフィードバック係数が2^28未満なら、次のステップの加算(自段 + 前段 + フィードバック)はint32で折り返さない
+#define SDM_CLAMP_BITS (30)
+_Static_assert((1 << (SDM_CLAMP_BITS - 1)) == SDM_STATE_LIMIT, "SDM_CLAMP_BITS must match SDM_STATE_LIMIT");
+static inline __attribute__((always_inline)) int32_t sdm_clamp(int32_t x)
+{
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+	return __ssat(x, SDM_CLAMP_BITS);
+#else
+	const int32_t max = (1 << (SDM_CLAMP_BITS - 1)) - 1;
+	return (x > max) ? max : (x < -max - 1) ? -max - 1 : x;
+#endif
+}
+
+// acc - (g * x) >> 32 を丸めて求める(Cortex-M33ではSMMLSR 1命令 ホストでも同じ丸めにする)
+// 切り捨て(SMMLS)では偶数次(DCに零点がない)で、誤差の平均がDCのオフセットとして信号帯域に残る
+static inline __attribute__((always_inline)) int32_t sdm_mmlsr(int32_t acc, int32_t g, int32_t x)
+{
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+	int32_t r;
+	__asm__("smmlsr %0, %1, %2, %3" : "=r"(r) : "r"(g), "r"(x), "r"(acc));
+	return r;
+#else
+	return (int32_t)((((int64_t)acc << 32) - (int64_t)g * x + 0x80000000ll) >> 32);
+#endif
+}
+
+static SDM_CHANNEL sdm_ch[2];
+static uint32_t sdm_order = 5;
+static const SDM_COEF *sdm_coef = &sdm_coef_table[0][5 - SDM_MIN_ORDER];
+static float sdm_input_gain;
+static uint32_t sdm_hold = 1;			   // 1ステップの出力ビット数(DSD256では2)
+static uint32_t sdm_words_per_sample = 1; // 入力1サンプルあたりのPIO送信ワード数
+
+// modulation_ratio: 入力1サンプルあたりの変調ステップ数(16 or 32)
+// bits_per_sample: 入力1サンプルあたりの出力ビット数(modulation_ratioの1倍 or 2倍)
+void init_delta_sigma(uint32_t order, uint32_t modulation_ratio, uint32_t bits_per_sample)
+{
+	if (order < SDM_MIN_ORDER)
+		order = SDM_MIN_ORDER;
+	if (order > SDM_MAX_ORDER)
+		order = SDM_MAX_ORDER;
+	sdm_order = order;
+	sdm_coef = &sdm_coef_table[(modulation_ratio == 32) ? 1 : 0][order - SDM_MIN_ORDER];
+
+	sdm_hold = (bits_per_sample > modulation_ratio) ? 2 : 1;
+	sdm_words_per_sample = (modulation_ratio * sdm_hold) / SDM_BITS_PER_WORD;
+
+	// int32フルスケールの入力を、1段目の積分器のスケール(Q28 * a[0])に合わせる
+	sdm_input_gain = SDM_INPUT_LEVEL * (float)sdm_coef->a[0] / 2147483648.f;
+
+	delta_sigma_reset();
+}
+
+void delta_sigma_reset(void)
+{
+	memset(sdm_ch, 0, sizeof(sdm_ch));
+}
+
+// 発振してリセットした回数(両ch)
+uint32_t delta_sigma_reset_count(void)
+{
+	return sdm_ch[0].reset_count + sdm_ch[1].reset_count;
+}
+
+// 1ch分を変調し、outの偶数bit(Lch)または奇数bit(Rch)に書き込む
+// order, ch, holdは定数で展開させて、状態変数と係数をレジスタに載せる
+static inline __attribute__((always_inline)) void sdm_modulate_channel(SDM_CHANNEL *state, float *in, uint32_t *out, uint32_t length, const uint32_t order, const uint32_t ch, const uint32_t hold)
+{
+	const SDM_COEF *coef = sdm_coef;
+	const uint8_t *shift = sdm_shift_table[order - SDM_MIN_ORDER];
+	const float gain = sdm_input_gain;
+	const uint32_t words_per_sample = sdm_words_per_sample;
+	// 出力ビットはx[N-1]が負のときに立て(ANDの即値にしてレジスタを使わない)、1ワード詰め終わってから反転する
+	const uint32_t bit_mask = ((hold == 2) ? 0x50000000u : 0x40000000u) << ch;
+	const uint32_t word_invert = 0x55555555u << ch;
+	int32_t a[SDM_MAX_ORDER];
+	int32_t g[SDM_MAX_ORDER];
+	int32_t x[SDM_MAX_ORDER];
+
+	for (uint32_t i = 0; i < order; i++)
+	{
+		a[i] = coef->a[i];
+		g[i] = coef->g[i];
+		x[i] = state->x[i];
+	}
+
+	for (uint32_t n = 0; n < length; n++)
+	{
+		const int32_t u = (int32_t)lrintf(in[n] * gain);
+
+		for (uint32_t w = 0; w < words_per_sample; w++)
+		{
+			uint32_t word = 0;
+#pragma GCC unroll 2
+			for (uint32_t k = 0; k < SDM_BITS_PER_WORD / hold; k++)
+			{
+				// v = +1 (x[N-1] >= 0) / -1 (x[N-1] < 0)
+				const int32_t sign = x[order - 1] >> 31;
+				const int32_t v = sign | 1;
+
+				// 出力ビットは上から詰めていき、1ワード分詰め終わると最初のビットがbit0(Lch)/bit1(Rch)に来る
+				word = (word >> (2 * hold)) | ((uint32_t)sign & bit_mask);
+
+				// 上の段から更新するので、共振器の段ではx[i + 1]は更新後の値になる
+#pragma GCC unroll 8
+				for (uint32_t i = order - 1; i > 0; i--)
+				{
+					int32_t t = x[i] + (x[i - 1] >> shift[i]) - a[i] * v;
+					if (SDM_IS_RESONATOR(order, i))
+						t = sdm_mmlsr(t, g[i], x[i + 1]);
+					x[i] = sdm_clamp(t);
+				}
+
+				int32_t t = x[0] + u - a[0] * v;
+				if (SDM_IS_RESONATOR(order, 0))
+					t = sdm_mmlsr(t, g[0], x[1]);
+				x[0] = sdm_clamp(t);
+			}
+			word ^= word_invert;
+			if (ch == 0)
+				out[w] = word;
+			else
+				out[w] |= word;
+		}
+		out += words_per_sample;
+	}
+
+	// 入力過大などで発振して積分器が制限に達していたらリセットする
+	bool unstable = false;
+	for (uint32_t i = 0; i < order; i++)
+	{
+		if ((x[i] >= SDM_STATE_LIMIT - 1) || (x[i] <= -SDM_STATE_LIMIT))
+			unstable = true;
+		state->x[i] = x[i];
+	}
+	if (unstable)
+	{
+		memset(state->x, 0, sizeof(state->x));
+		state->reset_count++;
+	}
+}
+
+#define SDM_MODULATE_ORDER(n)                                                  \
+	case n:                                                                    \
+		if (sdm_hold == 2)                                                     \
+		{                                                                      \
+			sdm_modulate_channel(&sdm_ch[0], in_L, out, length, n, 0, 2); \
+			sdm_modulate_channel(&sdm_ch[1], in_R, out, length, n, 1, 2); \
+		}                                                                      \
+		else                                                                   \
+		{                                                                      \
+			sdm_modulate_channel(&sdm_ch[0], in_L, out, length, n, 0, 1); \
+			sdm_modulate_channel(&sdm_ch[1], in_R, out, length, n, 1, 1); \
+		}                                                                      \
+		break;
+
+// I2S出力周波数のfloat(int32スケール)をL/R 1bitストリームに変換する 戻り値はPIOへ送るワード数
+uint32_t __not_in_flash_func(delta_sigma_modulate)(float *in_L, float *in_R, uint32_t *out, uint32_t length)
+{
+	switch (sdm_order)
+	{
+		SDM_MODULATE_ORDER(2)
+		SDM_MODULATE_ORDER(3)
+		SDM_MODULATE_ORDER(4)
+		SDM_MODULATE_ORDER(5)
+		SDM_MODULATE_ORDER(6)
+		SDM_MODULATE_ORDER(7)
+	default:
+		break;
+	}
+	return length * sdm_words_per_sample;
+}
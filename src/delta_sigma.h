@@ -0,0 +1,76 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _DELTA_SIGMA_H_
+#define _DELTA_SIGMA_H_
+
+// 変調器はPIOを使わないので、dsp_filter.cと同じくホスト(x86)でもビルドできる(DSP_HOST_BUILD tools/dsp_host/ddc_upsample -S)
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef DSP_HOST_BUILD
+#define __not_in_flash_func(func_name) func_name
+#else
+#include "pico.h"
+#endif
+
+// 変調器の次数(2~7に対応)
+#define SDM_MIN_ORDER (2)
+#define SDM_MAX_ORDER (7)
+
+// 1ステップ・1chあたりのCortex-M33のサイクル数(sdm_modulate_channelの内側のループを次数で展開した命令数から 2ステップ分)
+//   積分器1段: ADD(前段をシフトして加算) + MLS(a*v) + SSAT = 3
+//   共振器(order / 2個): SMMLSR = 1
+//   出力ビット: ASR(符号) + ORR(v) + AND + ORR(ワードに詰める) = 4
+//   ループ: 2ステップ展開で SUBS + BNE(分岐成立2) = 3 / 2ステップ
+//   レジスタ: 状態order + 係数order + 共振器係数order/2 + u・v・符号・ワード・ループカウンタの5 が14本(r0~r12, lr)を
+//             超えた分は毎ステップLDRで読み直す(1)
+// 実機の値はPROFILE_ENABLEのCONVERT(float→int32変換・フェード・1bit変調)の行で確認する
+#define SDM_RESONATORS(order) ((order) / 2)
+#define SDM_LIVE_REGISTERS(order) (2 * (order) + SDM_RESONATORS(order) + 5)
+#define SDM_RELOADS(order) ((SDM_LIVE_REGISTERS(order) > 14) ? (SDM_LIVE_REGISTERS(order) - 14) : 0)
+#define SDM_CYCLES_X2(order) (2 * (3 * (order) + SDM_RESONATORS(order) + 4 + SDM_RELOADS(order)) + 3)
+
+// Core1の予算に収まるか: 1ステップのサイクル数 x 変調周波数(I2S出力周波数 x 変調倍率) x 2ch <= システムクロック
+// (#ifでも使えるようにキャストしない)
+#define SDM_WITHIN_BUDGET(order, modulation_ratio, sys_clock_khz, i2s_freq) \
+	((SDM_CYCLES_X2(order) * (i2s_freq) * (modulation_ratio) * 2ull) <= (2000ull * (sys_clock_khz)))
+
+// 1ワード(32bit)にL/R 1bitずつ16ビット分を詰めてPIOに送る
+#define SDM_BITS_PER_WORD (16)
+
+// DSD出力時の変調器の動作倍率(I2S出力周波数352.8kHz x 16 = 5.6448MHz = DSD128)
+// DSD256は変調器の処理が間に合わないので、DSD128で変調して各ビットを2回ずつ出力する
+#define DSD_MODULATION_RATIO (16)
+
+// I2S出力周波数1サンプルあたりの出力ビット数 / 変調器の動作倍率
+#define ONEBIT_BITS_PER_SAMPLE (DSD_OUTPUT_ENABLE ? (DSD_RATE / RATIO_UPSAMPLING_48K) : SDM_OVERSAMPLING)
+#define ONEBIT_MODULATION_RATIO (DSD_OUTPUT_ENABLE ? DSD_MODULATION_RATIO : SDM_OVERSAMPLING)
+
+// 変調器への入力レベル(int32フルスケールに対する比 0.5では7次・OSR32が0dBFSで発振するので、全次数で1.5dB以上の余裕がある0.4にする)
+#define SDM_INPUT_LEVEL (0.4f)
+
+// 状態変数の固定小数点形式(Q28 各積分器は2のべき乗でスケーリング済みで、安定時は±1.5程度に収まる)
+#define SDM_Q_BITS (28)
+
+// 積分器は毎ステップこの範囲に制限し(ブロックの途中で発振してもint32で折り返さない)、
+// ブロックの終わりに制限に達していたら発振とみなして状態をリセットする(Q28で±2.0 0dBFSでの最大は1.3程度)
+#define SDM_STATE_LIMIT (2 << SDM_Q_BITS)
+
+typedef struct
+{
+	int32_t x[SDM_MAX_ORDER]; // 積分器(x[0]が入力側)
+	uint32_t reset_count;	  // 発振してリセットした回数
+} SDM_CHANNEL;
+
+extern void init_delta_sigma(uint32_t order, uint32_t modulation_ratio, uint32_t bits_per_sample);
+extern void delta_sigma_reset(void);
+extern uint32_t delta_sigma_reset_count(void);
+extern uint32_t __not_in_flash_func(delta_sigma_modulate)(float *in_L, float *in_R, uint32_t *out, uint32_t length);
+
+#endif /* _DELTA_SIGMA_H_ */
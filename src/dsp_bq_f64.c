@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2025 ArqAlice
+ *
+ * Released under the MIT license
+ * https://opensource.org/licenses/mit-license.php
+ */
+
+#include <string.h>
+#include "dsp_bq_f64.h"
+
+// 係数表(b0, b1, b2, a0, a1, a2)からDF1の係数にする(係数表のfloatの値をそのまま倍精度にする)
+void dsp_bq_f64_init(DSP_BQ_F64 *S, const float (*coef)[6], uint16_t num_stage)
+{
+    if (num_stage > DSP_BQ_F64_MAX_STAGE)
+        num_stage = DSP_BQ_F64_MAX_STAGE;
+    for (uint16_t i = 0; i < num_stage; i++)
+    {
+        S->coef[i * 5 + 0] = coef[i][0];
+        S->coef[i * 5 + 1] = coef[i][1];
+        S->coef[i * 5 + 2] = coef[i][2];
+        S->coef[i * 5 + 3] = -(double)coef[i][4];
+        S->coef[i * 5 + 4] = -(double)coef[i][5];
+    }
+    S->num_stage = num_stage;
+    dsp_bq_f64_clear(S);
+}
+
+void dsp_bq_f64_clear(DSP_BQ_F64 *S)
+{
+    memset(S->state, 0, sizeof(S->state));
+}
+
+// NOS(同じサンプルをratio回繰り返す) + BiQuad-IIR 1サンプル毎に全段を通すので、段の間の値もdoubleのまま
+// NOS用の作業バッファは使わない 戻り値は出力サンプル数
+uint32_t __not_in_flash_func(dsp_bq_f64_nos)(DSP_BQ_F64 *S, uint32_t ratio, const float *in, float *out, uint32_t length)
+{
+    const uint16_t num_stage = S->num_stage;
+
+    for (uint32_t i = 0; i < length; i++)
+    {
+        const double x = in[i];
+        for (uint32_t r = 0; r < ratio; r++)
+        {
+            double v = x;
+            const double *c = S->coef;
+            double *st = S->state;
+            for (uint16_t k = 0; k < num_stage; k++)
+            {
+                double y = c[0] * v + c[1] * st[0] + c[2] * st[1] + c[3] * st[2] + c[4] * st[3];
+                st[1] = st[0];
+                st[0] = v;
+                st[3] = st[2];
+                st[2] = y;
+                v = y;
+                c += 5;
+                st += 4;
+            }
+            *out++ = (float)v;
+        }
+    }
+    return length * ratio;
+}
@@ -0,0 +1,40 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _DSP_BQ_F64_H_
+#define _DSP_BQ_F64_H_
+
+// 倍精度の状態・累算で実行するBiQuad-IIR(NOS統合 DF1) 入出力のサンプルはfloatのまま
+// 段の間もdoubleで受け渡すので、極が単位円に近い(Qが高い・補間後のレートに対して遮断周波数が低い)段で
+// floatの状態の丸めによる雑音が増えない
+// RP2350ではPico SDKの倍精度演算(pico_double)がDCP(倍精度コプロセッサ)を使うので、ソフトウェアの倍精度より速い
+// dsp_filter.cと同じくホスト(x86)でもビルドできる(DSP_HOST_BUILD)
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef DSP_HOST_BUILD
+#define __not_in_flash_func(func_name) func_name
+#else
+#include "pico.h"
+#endif
+
+#define DSP_BQ_F64_MAX_STAGE (4)
+
+// 1段分のカスケード
+typedef struct
+{
+    double coef[DSP_BQ_F64_MAX_STAGE * 5];  // b0, b1, b2, -a1, -a2 (CMSIS-DSPのDF1と同じ並び)
+    double state[DSP_BQ_F64_MAX_STAGE * 4]; // x[n-1], x[n-2], y[n-1], y[n-2]
+    uint16_t num_stage;
+} DSP_BQ_F64;
+
+extern void dsp_bq_f64_init(DSP_BQ_F64 *S, const float (*coef)[6], uint16_t num_stage);
+extern void dsp_bq_f64_clear(DSP_BQ_F64 *S);
+extern uint32_t __not_in_flash_func(dsp_bq_f64_nos)(DSP_BQ_F64 *S, uint32_t ratio, const float *in, float *out, uint32_t length);
+
+#endif /* _DSP_BQ_F64_H_ */
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2025 ArqAlice
+ *
+ * Released under the MIT license
+ * https://opensource.org/licenses/mit-license.php
+ */
+
+#include <math.h>
+#include <string.h>
+#include "dsp_crossfeed.h"
+
+// 係数を計算して状態をクリアする(bs2bと同じ設計 cut_freq:反対chのローパスの遮断周波数 level_db:低域での自chと反対chのレベル差)
+// 低域のモノラル成分が大きくならないよう、直流での自ch + 反対chのゲインが1になるように正規化する
+void dsp_crossfeed_init(DSP_CROSSFEED *S, uint32_t fs, float cut_freq, float level_db, float delay_us)
+{
+    const double gain_lo_db = level_db * -5. / 6. - 3.;
+    const double gain_hi_db = level_db / 6. - 3.;
+    const double g_lo = pow(10., gain_lo_db / 20.);
+    const double g_hi = 1. - pow(10., gain_hi_db / 20.);
+    const double cut_hi = cut_freq * pow(2., (gain_lo_db - 20. * log10(g_hi)) / 12.);
+    const double norm = 1. / (g_lo + 1. - g_hi);
+
+    double x = exp(-2. * M_PI * cut_freq / fs);
+    S->a0_lo = (float)(g_lo * (1. - x) * norm);
+    S->b1_lo = (float)x;
+
+    x = exp(-2. * M_PI * cut_hi / fs);
+    S->a0_hi = (float)((1. - g_hi * (1. - x)) * norm);
+    S->a1_hi = (float)(-x * norm);
+    S->b1_hi = (float)x;
+
+    uint32_t delay = (uint32_t)(delay_us * 1e-6 * fs + 0.5);
+    S->delay = (delay < DSP_CROSSFEED_MAX_DELAY) ? delay : DSP_CROSSFEED_MAX_DELAY - 1;
+    S->fs = fs;
+    dsp_crossfeed_clear(S);
+}
+
+void dsp_crossfeed_clear(DSP_CROSSFEED *S)
+{
+    memset(S->lo, 0, sizeof(S->lo));
+    memset(S->hi, 0, sizeof(S->hi));
+    memset(S->in, 0, sizeof(S->in));
+    memset(S->line, 0, sizeof(S->line));
+    S->pos = 0;
+}
+
+// 周波数freqでの自chと反対chのゲイン(dB 係数から計算した理論値 遅延は振幅に影響しない ホストでの確認用)
+void dsp_crossfeed_response(const DSP_CROSSFEED *S, float freq, float *direct_db, float *cross_db)
+{
+    const double c = cos(2. * M_PI * freq / S->fs);
+    const double den_hi = 1. + (double)S->b1_hi * S->b1_hi - 2. * S->b1_hi * c;
+    const double den_lo = 1. + (double)S->b1_lo * S->b1_lo - 2. * S->b1_lo * c;
+    const double num_hi = (double)S->a0_hi * S->a0_hi + (double)S->a1_hi * S->a1_hi + 2. * S->a0_hi * S->a1_hi * c;
+    *direct_db = (float)(10. * log10(num_hi / den_hi));
+    *cross_db = (float)(10. * log10((double)S->a0_lo * S->a0_lo / den_lo));
+}
+
+// int32→float変換・ゲイン・クロスフィードを1つのループで行う(in_x == out_xは不可)
+void __not_in_flash_func(dsp_crossfeed_convert)(DSP_CROSSFEED *S, const int32_t *in_L, const int32_t *in_R, float *out_L, float *out_R, float gain, uint32_t length)
+{
+    const float a0_lo = S->a0_lo, b1_lo = S->b1_lo;
+    const float a0_hi = S->a0_hi, a1_hi = S->a1_hi, b1_hi = S->b1_hi;
+    float lo_L = S->lo[0], lo_R = S->lo[1];
+    float hi_L = S->hi[0], hi_R = S->hi[1];
+    float x_L = S->in[0], x_R = S->in[1];
+    uint32_t pos = S->pos;
+    uint32_t read = (pos - S->delay) & (DSP_CROSSFEED_MAX_DELAY - 1);
+
+    for (uint32_t i = 0; i < length; i++)
+    {
+        float l = (float)in_L[i] * gain;
+        float r = (float)in_R[i] * gain;
+
+        lo_L = a0_lo * l + b1_lo * lo_L;
+        lo_R = a0_lo * r + b1_lo * lo_R;
+        hi_L = a0_hi * l + a1_hi * x_L + b1_hi * hi_L;
+        hi_R = a0_hi * r + a1_hi * x_R + b1_hi * hi_R;
+        x_L = l;
+        x_R = r;
+
+        // 遅延線に書いてから読むので、delay == 0 の場合は今のサンプルが出る
+        S->line[0][pos] = lo_L;
+        S->line[1][pos] = lo_R;
+        out_L[i] = hi_L + S->line[1][read];
+        out_R[i] = hi_R + S->line[0][read];
+        pos = (pos + 1) & (DSP_CROSSFEED_MAX_DELAY - 1);
+        read = (read + 1) & (DSP_CROSSFEED_MAX_DELAY - 1);
+    }
+
+    S->lo[0] = lo_L;
+    S->lo[1] = lo_R;
+    S->hi[0] = hi_L;
+    S->hi[1] = hi_R;
+    S->in[0] = x_L;
+    S->in[1] = x_R;
+    S->pos = pos;
+}
@@ -0,0 +1,44 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _DSP_CROSSFEED_H_
+#define _DSP_CROSSFEED_H_
+
+// ヘッドホン用クロスフィード(Bauer方式 bs2bと同じ1次のシェルビング2つ + 反対chへの遅延)
+// 自chは1次のハイシェルフ(高域を持ち上げる)、反対chは1次のローパスを通してdelayサンプル遅らせて足す
+// 入力のint32→float変換・ゲインと同じループで行うので、追加の処理量は1サンプルあたり積和数回
+// dsp_filter.cと同じくホスト(x86)でもビルドできる(DSP_HOST_BUILD)
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef DSP_HOST_BUILD
+#define __not_in_flash_func(func_name) func_name
+#else
+#include "pico.h"
+#endif
+
+#define DSP_CROSSFEED_MAX_DELAY (32) // 反対chの遅延の最大サンプル数(2のべき乗)
+
+// 係数と状態(両ch分)
+typedef struct
+{
+    uint32_t fs;
+    float a0_lo, b1_lo;        // 反対ch: ローパス y = a0_lo * x + b1_lo * y[-1]
+    float a0_hi, a1_hi, b1_hi; // 自ch: ハイシェルフ y = a0_hi * x + a1_hi * x[-1] + b1_hi * y[-1]
+    uint32_t delay;            // 反対chの遅延(サンプル数)
+    float lo[2], hi[2], in[2]; // 1サンプル前の値
+    float line[2][DSP_CROSSFEED_MAX_DELAY];
+    uint32_t pos;
+} DSP_CROSSFEED;
+
+extern void dsp_crossfeed_init(DSP_CROSSFEED *S, uint32_t fs, float cut_freq, float level_db, float delay_us);
+extern void dsp_crossfeed_clear(DSP_CROSSFEED *S);
+extern void dsp_crossfeed_response(const DSP_CROSSFEED *S, float freq, float *direct_db, float *cross_db);
+extern void __not_in_flash_func(dsp_crossfeed_convert)(DSP_CROSSFEED *S, const int32_t *in_L, const int32_t *in_R, float *out_L, float *out_R, float gain, uint32_t length);
+
+#endif /* _DSP_CROSSFEED_H_ */
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2025 ArqAlice
+ *
+ * Released under the MIT license
+ * https://opensource.org/licenses/mit-license.php
+ */
+
+#include <math.h>
+#include <string.h>
+#include "dsp_fft.h"
+
+// arm_rfft_fast_f32の係数表を作る 範囲外のサイズはfalse
+// ビット反転表はCMSIS-DSPの複素FFT(基数8/4/2の組み合わせ)の出力順に依存するので、
+// 並べ替えなしで x[1]=1 を変換し、各位置の位相から周波数番号を求めて入れ替え手順にする
+bool dsp_rfft_init(DSP_RFFT *S, uint32_t fft_size, float *cfft_twiddle, float *rfft_twiddle, uint16_t *bitrev)
+{
+    static float probe[DSP_RFFT_MAX_SIZE];
+    static uint16_t order[DSP_RFFT_MAX_SIZE / 2];
+    const uint32_t cfft_length = fft_size / 2;
+
+    if ((fft_size < DSP_RFFT_MIN_SIZE) || (fft_size > DSP_RFFT_MAX_SIZE) || (fft_size & (fft_size - 1)))
+        return false;
+
+    for (uint32_t i = 0; i < cfft_length; i++)
+    {
+        cfft_twiddle[2 * i] = (float)cos(2. * M_PI * i / cfft_length);
+        cfft_twiddle[2 * i + 1] = (float)sin(2. * M_PI * i / cfft_length);
+    }
+    for (uint32_t i = 0; i < fft_size / 2; i++)
+    {
+        rfft_twiddle[2 * i] = (float)sin(2. * M_PI * i / fft_size);
+        rfft_twiddle[2 * i + 1] = (float)cos(2. * M_PI * i / fft_size);
+    }
+
+    S->cfft_twiddle = cfft_twiddle;
+    S->rfft_twiddle = rfft_twiddle;
+    S->bitrev = bitrev;
+    S->rfft.Sint.fftLen = cfft_length;
+    S->rfft.Sint.pTwiddle = cfft_twiddle;
+    S->rfft.Sint.pBitRevTable = bitrev;
+    S->rfft.Sint.bitRevLength = 0;
+    S->rfft.fftLenRFFT = fft_size;
+    S->rfft.pTwiddleRFFT = rfft_twiddle;
+
+    memset(probe, 0, sizeof(float) * fft_size);
+    probe[2] = 1.f;
+    arm_cfft_f32(&S->rfft.Sint, probe, 0, 0);
+    for (uint32_t i = 0; i < cfft_length; i++)
+    {
+        // 位置iの値は exp(-2πjk/N)
+        long k = lround(-atan2(probe[2 * i + 1], probe[2 * i]) * cfft_length / (2. * M_PI));
+        order[i] = (uint16_t)((k + cfft_length) % cfft_length);
+    }
+
+    // 表の値は入れ替える2要素の位置(float複素数 8byte単位)
+    uint16_t length = 0;
+    for (uint16_t i = 0; i < cfft_length; i++)
+    {
+        if (order[i] == i)
+            continue;
+        uint16_t j = i + 1;
+        while (order[j] != i)
+            j++;
+        bitrev[length++] = i * 8;
+        bitrev[length++] = j * 8;
+        order[j] = order[i];
+        order[i] = i;
+    }
+    S->rfft.Sint.bitRevLength = length;
+    return true;
+}
@@ -0,0 +1,53 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _DSP_FFT_H_
+#define _DSP_FFT_H_
+
+// 分割FFT畳み込み(dsp_long_fir.c, dsp_room_fir.c)の共通部
+// CMSIS-DSPのarm_common_tables.cは同梱していないので、arm_rfft_fast_f32の係数表は起動時に作る
+// dsp_filter.cと同じくホスト(x86)でもビルドできる(DSP_HOST_BUILD)
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <arm_math.h>
+
+#ifdef DSP_HOST_BUILD
+#define __not_in_flash_func(func_name) func_name
+#else
+#include "pico.h"
+#endif
+
+#define DSP_RFFT_MIN_SIZE (32)
+#define DSP_RFFT_MAX_SIZE (4096)
+
+// FFTサイズfft_size(2のべき乗)の係数表
+typedef struct
+{
+    arm_rfft_fast_instance_f32 rfft;
+    float *cfft_twiddle; // fft_size個
+    float *rfft_twiddle; // fft_size個
+    uint16_t *bitrev;    // fft_size個
+} DSP_RFFT;
+
+extern bool dsp_rfft_init(DSP_RFFT *S, uint32_t fft_size, float *cfft_twiddle, float *rfft_twiddle, uint16_t *bitrev);
+
+// rfft形式のスペクトルの積和 acc += a * b ([0]:DC [1]:ナイキスト周波数 以降は複素数)
+static inline void dsp_spectrum_mac(float *acc, const float *a, const float *b, uint32_t fft_size)
+{
+    acc[0] += a[0] * b[0];
+    acc[1] += a[1] * b[1];
+    for (uint32_t k = 2; k < fft_size; k += 2)
+    {
+        float ar = a[k], ai = a[k + 1];
+        float br = b[k], bi = b[k + 1];
+        acc[k] += ar * br - ai * bi;
+        acc[k + 1] += ar * bi + ai * br;
+    }
+}
+
+#endif /* _DSP_FFT_H_ */
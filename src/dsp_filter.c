@@ -0,0 +1,495 @@
+/*
+ * Copyright (c) 2025 ArqAlice
+ *
+ * Released under the MIT license
+ * https://opensource.org/licenses/mit-license.php
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "dsp_filter.h"
+
+_Static_assert((SIZE_BQ_FILTER_3 <= DSP_BQ_F64_MAX_STAGE) && (SIZE_BQ_FILTER_4 <= DSP_BQ_F64_MAX_STAGE), "DSP_BQ_F64_MAX_STAGE is too small");
+
+// 双二次フィルタ係数(CMSIS-DSPのDF1形式 b0, b1, b2, -a1, -a2)
+static float biquad2_coeffs[SIZE_BQ_FILTER_2 * 5];
+static float biquad3_coeffs[SIZE_BQ_FILTER_3 * 5];
+static float biquad4_coeffs[SIZE_BQ_FILTER_4 * 5];
+
+static void convert_bq_coef(const float (*coef)[NUM_OF_BQ_SUB_PARAMS], uint16_t num_stage, float *coeffs)
+{
+    for (uint16_t i = 0; i < num_stage; i++)
+    {
+        coeffs[i * 5 + 0] = coef[i][0];
+        coeffs[i * 5 + 1] = coef[i][1];
+        coeffs[i * 5 + 2] = coef[i][2];
+        coeffs[i * 5 + 3] = -coef[i][4];
+        coeffs[i * 5 + 4] = -coef[i][5];
+    }
+}
+
+// BiQuad-IIRフィルタの係数を初期化する(dsp_init_channelより前に1回呼ぶ 係数は全チャンネル共通)
+void dsp_init_filter_coef(const DSP_PROFILE *profile)
+{
+    convert_bq_coef(profile->bq_2x_2, SIZE_BQ_FILTER_2, biquad2_coeffs);
+    convert_bq_coef(profile->bq_2x_3, SIZE_BQ_FILTER_3, biquad3_coeffs);
+    convert_bq_coef(profile->bq_4x_0, SIZE_BQ_FILTER_4, biquad4_coeffs);
+}
+
+// FIRの係数にゲインを掛けてRAMにコピーする
+static void scale_fir_coef(const DSP_FIR_COEF *coef, float gain, float *out)
+{
+    for (uint16_t i = 0; i < coef->num_taps; i++)
+        out[i] = coef->coef[i] * gain;
+}
+
+// FIRの係数をプロファイルのものにする(FIR前のゲイン × 補間倍率を掛ける 状態はクリアされる)
+static void load_fir_coef(DSP_CHANNEL *ch, const DSP_PROFILE *profile)
+{
+    scale_fir_coef(&profile->fir_4x_0, ch->fir_gain * 4.f, ch->fir_4x_0_coef);
+    scale_fir_coef(&profile->fir_2x_1, ch->fir_gain * 2.f, ch->fir_2x_1_coef);
+    arm_fir_interpolate_init_f32(&ch->fir_4x_0, 4, profile->fir_4x_0.num_taps, ch->fir_4x_0_coef, ch->fir_4x_0_state, DSP_FIR_BLOCKSIZE);
+    arm_fir_interpolate_init_f32(&ch->fir_2x_1, 2, profile->fir_2x_1.num_taps, ch->fir_2x_1_coef, ch->fir_2x_1_state, DSP_FIR_BLOCKSIZE);
+    ch->profile = profile;
+}
+
+// 1ch分のフィルタを初期化する
+// fir_gain: FIR前のゲイン(FIR補間で振幅が小さくなる分の補正 補間倍率と合わせてFIR段の係数に掛ける)
+void dsp_init_channel(DSP_CHANNEL *ch, const DSP_PROFILE *profile, float fir_gain)
+{
+    ch->rate_class = RATE_CLASS_48K;
+    ch->profile_request = NULL;
+    ch->profile_next = NULL;
+    ch->long_fir = NULL;
+    ch->room_fir = NULL;
+    ch->bq_2x_3_f64 = NULL;
+    ch->bq_4x_0_f64 = NULL;
+    ch->fir_gain = fir_gain;
+    dsp_peq_init(&ch->peq);
+    arm_biquad_cascade_df1_init_f32(&ch->bq_2x_2, SIZE_BQ_FILTER_2, biquad2_coeffs, ch->bq_2x_2_state);
+    arm_biquad_cascade_df1_init_f32(&ch->bq_2x_3, SIZE_BQ_FILTER_3, biquad3_coeffs, ch->bq_2x_3_state);
+    arm_biquad_cascade_df1_init_f32(&ch->bq_4x_0, SIZE_BQ_FILTER_4, biquad4_coeffs, ch->bq_4x_0_state);
+    load_fir_coef(ch, profile);
+    dsp_clear_channel(ch);
+}
+
+// クロスフェード中の切り替え先をすぐに適用する(状態をクリアする前に呼ぶ)
+static void finish_crossfade_now(DSP_CHANNEL *ch)
+{
+    if (ch->profile_next == NULL)
+        return;
+    load_fir_coef(ch, ch->profile_next);
+    ch->profile_next = NULL;
+}
+
+// フィルタの遅延バッファをクリアする
+void dsp_clear_channel(DSP_CHANNEL *ch)
+{
+    finish_crossfade_now(ch);
+    memset(ch->bq_2x_2_state, 0, sizeof(ch->bq_2x_2_state));
+    memset(ch->bq_2x_3_state, 0, sizeof(ch->bq_2x_3_state));
+    memset(ch->bq_4x_0_state, 0, sizeof(ch->bq_4x_0_state));
+    memset(ch->fir_4x_0_state, 0, sizeof(ch->fir_4x_0_state));
+    memset(ch->fir_2x_1_state, 0, sizeof(ch->fir_2x_1_state));
+    if (ch->long_fir != NULL)
+        dsp_long_fir_clear(ch->long_fir);
+    dsp_peq_clear(&ch->peq);
+    if (ch->room_fir != NULL)
+        dsp_room_fir_clear(ch->room_fir);
+    if (ch->bq_2x_3_f64 != NULL)
+        dsp_bq_f64_clear(ch->bq_2x_3_f64);
+    if (ch->bq_4x_0_f64 != NULL)
+        dsp_bq_f64_clear(ch->bq_4x_0_f64);
+}
+
+// 48kHz系のFIR 4xを長いFIR(dsp_long_fir.c)に置き換える NULLで元に戻す(dsp_long_fir_init_coefを先に呼ぶ)
+// 長いFIRを使っている間は、プロファイルの切り替え要求は96kHz系に切り替わるまで保留される
+void dsp_set_long_fir(DSP_CHANNEL *ch, DSP_LONG_FIR *long_fir)
+{
+    ch->long_fir = long_fir;
+    if (long_fir != NULL)
+        dsp_long_fir_clear(long_fir);
+}
+
+// ルーム補正FIRを設定する NULLで外す(係数の書き込みはdsp_room_fir_loadで行う 実行するかはDSP_CHAIN.run_room_fir)
+void dsp_set_room_fir(DSP_CHANNEL *ch, DSP_ROOM_FIR *room_fir)
+{
+    ch->room_fir = room_fir;
+    if (room_fir != NULL)
+        dsp_room_fir_clear(room_fir);
+}
+
+// 倍精度の最終段の係数をプロファイルのものにする
+static void load_bq_f64_coef(DSP_CHANNEL *ch, const DSP_PROFILE *profile)
+{
+    if (ch->bq_2x_3_f64 != NULL)
+        dsp_bq_f64_init(ch->bq_2x_3_f64, profile->bq_2x_3, SIZE_BQ_FILTER_3);
+    if (ch->bq_4x_0_f64 != NULL)
+        dsp_bq_f64_init(ch->bq_4x_0_f64, profile->bq_4x_0, SIZE_BQ_FILTER_4);
+}
+
+// 最終段のBiQuad-IIR(bq_2x_3, bq_4x_0)を倍精度の状態で実行する(dsp_bq_f64.c) NULLで元に戻す(出力を止めているときに呼ぶ)
+// 係数は今のプロファイルのものにする
+void dsp_set_bq_f64(DSP_CHANNEL *ch, DSP_BQ_F64 *bq_2x_3, DSP_BQ_F64 *bq_4x_0)
+{
+    ch->bq_2x_3_f64 = bq_2x_3;
+    ch->bq_4x_0_f64 = bq_4x_0;
+    load_bq_f64_coef(ch, ch->profile);
+}
+
+// プロファイルをすぐに切り替える(出力を止めているときに使う 全状態をクリアする)
+// BiQuad-IIRの係数は全チャンネル共通なので、異なる場合は全チャンネルをこの関数で切り替えること
+void dsp_set_profile(DSP_CHANNEL *ch, const DSP_PROFILE *profile)
+{
+    ch->profile_next = NULL;
+    ch->profile_request = NULL;
+    if (!dsp_is_same_biquad(ch->profile, profile))
+        dsp_init_filter_coef(profile);
+    load_fir_coef(ch, profile);
+    load_bq_f64_coef(ch, profile);
+    dsp_clear_channel(ch);
+}
+
+// プロファイルの切り替えを要求する(別コア・割り込みから呼んでよい)
+// このチャンネルを処理するコアが次のブロックでFIR段を新旧並列に実行し、xfade_length(入力サンプル数)かけてクロスフェードする
+// BiQuad-IIRは切り替えないので、BiQuad-IIRが異なるプロファイルはdsp_set_profileで切り替えること
+void dsp_request_profile(DSP_CHANNEL *ch, const DSP_PROFILE *profile, uint32_t xfade_length)
+{
+    ch->xfade_request_length = xfade_length;
+    ch->profile_request = profile;
+}
+
+bool dsp_is_profile_switching(const DSP_CHANNEL *ch)
+{
+    const DSP_PROFILE *request = ch->profile_request;
+    return (ch->profile_next != NULL) || ((request != NULL) && (request != ch->profile));
+}
+
+bool dsp_is_same_biquad(const DSP_PROFILE *a, const DSP_PROFILE *b)
+{
+    return (a->bq_2x_2 == b->bq_2x_2) && (a->bq_2x_3 == b->bq_2x_3) && (a->bq_4x_0 == b->bq_4x_0);
+}
+
+// FIR段のゲインを係数に入れているか(FIRのない192kHz系・長いFIRでは入力にかける必要がある)
+bool __not_in_flash_func(dsp_is_fir_gain_folded)(const DSP_CHANNEL *ch)
+{
+    if (ch->rate_class == RATE_CLASS_192K)
+        return false;
+    return !((ch->long_fir != NULL) && (ch->rate_class == RATE_CLASS_48K));
+}
+
+// 入力サンプルレート区分(使うFIR段)を切り替える(全バッファのクリアではなく、切り替え先で使う段のみ初期化する)
+// 切り替えはフェードアウト後なので前のレートの状態は残さない bq_2x_2は全レートで使うのでクリアする
+// FIRの状態はクリアされるので、クロスフェード中の場合は切り替え先をすぐに適用する
+void __not_in_flash_func(dsp_select_rate_class)(DSP_CHANNEL *ch, uint16_t rate_class)
+{
+    finish_crossfade_now(ch);
+    memset(ch->bq_2x_2_state, 0, sizeof(ch->bq_2x_2_state));
+
+    switch (rate_class)
+    {
+    case RATE_CLASS_96K:
+        memset(ch->fir_2x_1_state, 0, sizeof(ch->fir_2x_1_state));
+        break;
+    case RATE_CLASS_48K:
+        memset(ch->fir_4x_0_state, 0, sizeof(ch->fir_4x_0_state));
+        if (ch->long_fir != NULL)
+            dsp_long_fir_clear(ch->long_fir);
+        break;
+    default:
+        break;
+    }
+    ch->rate_class = rate_class;
+}
+
+// サンプルレートに対応する入力サンプルレート区分を取得する
+uint16_t dsp_get_rate_class(uint32_t freq)
+{
+    switch (freq)
+    {
+    case 192000:
+    case 176400:
+        return RATE_CLASS_192K;
+    case 96000:
+    case 88200:
+        return RATE_CLASS_96K;
+    case 48000:
+    case 44100:
+    default:
+        return RATE_CLASS_48K;
+    }
+}
+
+// 処理段の構成全体の補間倍率
+uint16_t dsp_get_chain_ratio(const DSP_CHAIN *chain)
+{
+    uint16_t ratio = (chain->rate_class == RATE_CLASS_48K) ? 4 : (chain->rate_class == RATE_CLASS_96K) ? 2 : 1;
+    if (chain->run_bq_2x_2)
+        ratio <<= 1;
+    return ratio * chain->ratio_final;
+}
+
+// int32_t型をfloat型にまとめてキャスト
+void __not_in_flash_func(dsp_int32_to_float)(const int32_t *in, float *out, uint32_t length)
+{
+    for (uint32_t i = 0; i < length; i++)
+        out[i] = (float)in[i];
+}
+
+// int32_t型のL/Rをfloatに変換してgain倍する(2ch分を1回のループで 4サンプルずつ展開 gainが1の場合は乗算しない)
+// Cortex-M33ではキャストがvcvt 1命令になり、ロード/ストアと乗算だけが残る
+void __not_in_flash_func(dsp_int32_to_float_stereo)(const int32_t *in_L, const int32_t *in_R, float *out_L, float *out_R, float gain, uint32_t length)
+{
+    uint32_t i = 0;
+    if (gain == 1.f)
+    {
+        for (; i + 4 <= length; i += 4)
+        {
+            float l0 = (float)in_L[i], l1 = (float)in_L[i + 1], l2 = (float)in_L[i + 2], l3 = (float)in_L[i + 3];
+            float r0 = (float)in_R[i], r1 = (float)in_R[i + 1], r2 = (float)in_R[i + 2], r3 = (float)in_R[i + 3];
+            out_L[i] = l0;
+            out_L[i + 1] = l1;
+            out_L[i + 2] = l2;
+            out_L[i + 3] = l3;
+            out_R[i] = r0;
+            out_R[i + 1] = r1;
+            out_R[i + 2] = r2;
+            out_R[i + 3] = r3;
+        }
+        for (; i < length; i++)
+        {
+            out_L[i] = (float)in_L[i];
+            out_R[i] = (float)in_R[i];
+        }
+        return;
+    }
+
+    for (; i + 4 <= length; i += 4)
+    {
+        float l0 = (float)in_L[i], l1 = (float)in_L[i + 1], l2 = (float)in_L[i + 2], l3 = (float)in_L[i + 3];
+        float r0 = (float)in_R[i], r1 = (float)in_R[i + 1], r2 = (float)in_R[i + 2], r3 = (float)in_R[i + 3];
+        out_L[i] = l0 * gain;
+        out_L[i + 1] = l1 * gain;
+        out_L[i + 2] = l2 * gain;
+        out_L[i + 3] = l3 * gain;
+        out_R[i] = r0 * gain;
+        out_R[i + 1] = r1 * gain;
+        out_R[i + 2] = r2 * gain;
+        out_R[i + 3] = r3 * gain;
+    }
+    for (; i < length; i++)
+    {
+        out_L[i] = (float)in_L[i] * gain;
+        out_R[i] = (float)in_R[i] * gain;
+    }
+}
+
+// upsampling FIR (倍率はSの設定による)
+uint32_t __not_in_flash_func(dsp_fir_interpolate)(arm_fir_interpolate_instance_f32 *S, float *in, float *out, uint32_t length)
+{
+    arm_fir_interpolate_f32(S, in, out, length);
+    return length * S->L;
+}
+
+// 現在の入力サンプルレート区分のFIR
+static arm_fir_interpolate_instance_f32 *__not_in_flash_func(get_bank_fir)(DSP_CHANNEL *ch)
+{
+    switch (ch->rate_class)
+    {
+    case RATE_CLASS_48K:
+        return &ch->fir_4x_0;
+    case RATE_CLASS_96K:
+        return &ch->fir_2x_1;
+    default:
+        return NULL;
+    }
+}
+
+// 切り替え要求を取り込み、クロスフェードを始める
+static void __not_in_flash_func(start_crossfade)(DSP_CHANNEL *ch, const DSP_PROFILE *profile)
+{
+    // クロスフェード中に次の要求が来た場合は、今の切り替え先を確定させてからやり直す
+    finish_crossfade_now(ch);
+
+    arm_fir_interpolate_instance_f32 *S = get_bank_fir(ch);
+    if ((S == NULL) || (ch->xfade_request_length == 0))
+    {
+        // FIRを使っていない区分(192kHz系)では状態を引き継ぐ必要がない
+        load_fir_coef(ch, profile);
+        return;
+    }
+
+    const DSP_FIR_COEF *coef = (ch->rate_class == RATE_CLASS_48K) ? &profile->fir_4x_0 : &profile->fir_2x_1;
+    scale_fir_coef(coef, ch->fir_gain * (float)S->L, ch->fir_next_coef);
+    arm_fir_interpolate_init_f32(&ch->fir_next, S->L, coef->num_taps, ch->fir_next_coef, ch->fir_next_state, DSP_FIR_BLOCKSIZE);
+
+    // 旧フィルタの入力履歴(pStateの先頭phaseLength-1サンプル 古い順)を新フィルタに引き継ぐ
+    // 新フィルタの方が長い場合は、足りない分が入力で埋まるまで旧フィルタの出力のみ使う
+    uint32_t hist_old = S->phaseLength - 1;
+    uint32_t hist_new = ch->fir_next.phaseLength - 1;
+    uint32_t hist = (hist_old < hist_new) ? hist_old : hist_new;
+    memcpy(ch->fir_next_state + (hist_new - hist), S->pState + (hist_old - hist), sizeof(float) * hist);
+
+    ch->xfade_pos = 0;
+    ch->xfade_prime = (hist_new - hist) * S->L;
+    ch->xfade_length = ch->xfade_request_length * S->L;
+    ch->profile_next = profile;
+}
+
+// クロスフェードを終え、新フィルタの状態を本来のFIRに移す
+static void __not_in_flash_func(end_crossfade)(DSP_CHANNEL *ch)
+{
+    uint32_t hist = ch->fir_next.phaseLength - 1;
+
+    load_fir_coef(ch, ch->profile_next);
+    ch->profile_next = NULL;
+    arm_fir_interpolate_instance_f32 *S = get_bank_fir(ch);
+    memcpy(S->pState, ch->fir_next_state, sizeof(float) * hist);
+}
+
+// FIR補間段(倍率は入力サンプルレート区分による 入力のゲインは係数に入っている) 戻り値は出力サンプル数
+// プロファイルの切り替え要求はここ(ブロックの区切り)で取り込むので、チャンネルを処理するコアだけが状態を書き換える
+uint32_t __not_in_flash_func(dsp_fir_stage)(DSP_CHANNEL *ch, float *in, float *out, uint32_t length)
+{
+    if ((ch->long_fir != NULL) && (ch->rate_class == RATE_CLASS_48K))
+        return dsp_long_fir_interpolate(ch->long_fir, in, out, length);
+
+    const DSP_PROFILE *request = ch->profile_request;
+    if ((request != NULL) && (request != ((ch->profile_next != NULL) ? ch->profile_next : ch->profile)))
+        start_crossfade(ch, request);
+
+    arm_fir_interpolate_instance_f32 *S = get_bank_fir(ch);
+    if (S == NULL)
+    {
+        memcpy(out, in, sizeof(float) * length);
+        return length;
+    }
+
+    uint32_t len = dsp_fir_interpolate(S, in, out, length);
+    if (ch->profile_next == NULL)
+        return len;
+
+    // 新旧を並列に実行し、新フィルタの状態が埋まってから線形にクロスフェードする
+    dsp_fir_interpolate(&ch->fir_next, in, ch->fir_next_out, length);
+    const float step = 1.f / (float)ch->xfade_length;
+    for (uint32_t i = 0; i < len; i++)
+    {
+        uint32_t pos = ch->xfade_pos + i;
+        if (pos < ch->xfade_prime)
+            continue;
+        pos -= ch->xfade_prime;
+        if (pos >= ch->xfade_length)
+            out[i] = ch->fir_next_out[i];
+        else
+            out[i] += (ch->fir_next_out[i] - out[i]) * ((float)pos * step);
+    }
+    ch->xfade_pos += len;
+
+    if (ch->xfade_pos >= ch->xfade_prime + ch->xfade_length)
+        end_crossfade(ch);
+    return len;
+}
+
+// upsampling biquad IIR filter NOS統合版 2x (RAM上で実行する)
+uint32_t __not_in_flash_func(dsp_bq_nos_2x)(arm_biquad_casd_df1_inst_f32 *S, float *in, float *out, uint32_t length)
+{
+    uint32_t length_buffer = length;
+    float *NOS_buffer = (float *)malloc(sizeof(float) * (length << 1));
+    float *p_NOS_buffer = NOS_buffer;
+
+    // サンプル数を2倍にする NOS方式
+    while (length_buffer--)
+    {
+        *(p_NOS_buffer++) = *(in);
+        *(p_NOS_buffer++) = *(in++);
+    }
+
+    // BiQuad-IIRフィルタを実行する
+    arm_biquad_cascade_df1_f32(S, NOS_buffer, out, length << 1);
+
+    free(NOS_buffer);
+    return length << 1;
+}
+
+// upsampling biquad IIR filter NOS統合版 4x (RAM上で実行する)
+uint32_t __not_in_flash_func(dsp_bq_nos_4x)(arm_biquad_casd_df1_inst_f32 *S, float *in, float *out, uint32_t length)
+{
+    uint32_t length_buffer = length;
+    float *NOS_buffer = (float *)malloc(sizeof(float) * (length << 2));
+    float *p_NOS_buffer = NOS_buffer;
+
+    // サンプル数を4倍にする NOS方式
+    while (length_buffer--)
+    {
+        *(p_NOS_buffer++) = *(in);
+        *(p_NOS_buffer++) = *(in);
+        *(p_NOS_buffer++) = *(in);
+        *(p_NOS_buffer++) = *(in++);
+    }
+
+    // BiQuad-IIRフィルタを実行する
+    arm_biquad_cascade_df1_f32(S, NOS_buffer, out, length << 2);
+
+    free(NOS_buffer);
+    return length << 2;
+}
+
+// 最終段 BiQuad-IIR 2x (倍精度の状態を設定している場合はそちらで実行する)
+uint32_t __not_in_flash_func(dsp_bq_stage_2x_3)(DSP_CHANNEL *ch, float *in, float *out, uint32_t length)
+{
+    if (ch->bq_2x_3_f64 != NULL)
+        return dsp_bq_f64_nos(ch->bq_2x_3_f64, 2, in, out, length);
+    return dsp_bq_nos_2x(&ch->bq_2x_3, in, out, length);
+}
+
+// 最終段 BiQuad-IIR 4x (倍精度の状態を設定している場合はそちらで実行する)
+uint32_t __not_in_flash_func(dsp_bq_stage_4x_0)(DSP_CHANNEL *ch, float *in, float *out, uint32_t length)
+{
+    if (ch->bq_4x_0_f64 != NULL)
+        return dsp_bq_f64_nos(ch->bq_4x_0_f64, 4, in, out, length);
+    return dsp_bq_nos_4x(&ch->bq_4x_0, in, out, length);
+}
+
+// 1ch分の全段(EQ → ルーム補正FIR → FIR補間 → BiQuad-IIR 2x → 最終段)を実行する 戻り値は出力サンプル数
+// work_0, work_1はlength * 8サンプル分 outはlength * dsp_get_chain_ratio()サンプル分必要
+// チャンネル毎に状態が別なので、異なるチャンネルは同時に(別コアから)処理してよい
+uint32_t __not_in_flash_func(dsp_process_channel)(DSP_CHANNEL *ch, const DSP_CHAIN *chain, float *in, float *out, float *work_0, float *work_1, uint32_t length)
+{
+    uint32_t len = length;
+
+    if (chain->rate_class != ch->rate_class)
+        dsp_select_rate_class(ch, chain->rate_class);
+
+    if (dsp_peq_process(&ch->peq, in, work_0, len))
+        in = work_0;
+
+    if (chain->run_room_fir && (ch->room_fir != NULL) && dsp_room_fir_process(ch->room_fir, in, work_0, len))
+        in = work_0;
+
+    if (chain->rate_class != RATE_CLASS_192K)
+    {
+        len = dsp_fir_stage(ch, in, work_1, len);
+        in = work_1;
+    }
+
+    if (chain->run_bq_2x_2)
+    {
+        len = dsp_bq_nos_2x(&ch->bq_2x_2, in, work_0, len);
+        in = work_0;
+    }
+
+    switch (chain->ratio_final)
+    {
+    case 4:
+        len = dsp_bq_stage_4x_0(ch, in, out, len);
+        break;
+    case 2:
+        len = dsp_bq_stage_2x_3(ch, in, out, len);
+        break;
+    case 1:
+    default:
+        memcpy(out, in, sizeof(float) * len);
+        break;
+    }
+    return len;
+}
@@ -0,0 +1,199 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _DSP_FILTER_H_
+#define _DSP_FILTER_H_
+
+// アップサンプリングフィルタ(FIR補間・NOS+BiQuad-IIR)の演算部
+// Pico SDKやリングバッファ・audio_stateに依存しないので、ホスト(x86)でもビルドできる(DSP_HOST_BUILD)
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <arm_math.h>
+#include "dsp_long_fir.h"
+#include "dsp_peq.h"
+#include "dsp_room_fir.h"
+#include "dsp_bq_f64.h"
+
+#ifdef DSP_HOST_BUILD
+#define __not_in_flash_func(func_name) func_name
+#else
+#include "pico.h"
+#endif
+
+#define NUM_OF_BQ_SUB_PARAMS (6)
+#define SIZE_BQ_FILTER_0 (17)
+#define SIZE_BQ_DELAY_0 (SIZE_BQ_FILTER_0)
+
+#define SIZE_BQ_FILTER_1 (5)
+#define SIZE_BQ_DELAY_1 (SIZE_BQ_FILTER_1)
+
+#define SIZE_BQ_FILTER_2 (4)
+#define SIZE_BQ_DELAY_2 (SIZE_BQ_FILTER_2)
+
+#define SIZE_BQ_FILTER_3 (4)
+#define SIZE_BQ_DELAY_3 (SIZE_BQ_FILTER_3)
+
+#define SIZE_BQ_FILTER_4 (3)
+#define SIZE_BQ_DELAY_4 (SIZE_BQ_FILTER_4)
+
+// 入力サンプルレート区分(使うFIR補間段が決まる 48kHz系:FIR 4x 96kHz系:FIR 2x 192kHz系:FIRなし)
+// 44.1kHz系・48kHz系(RATE_FAMILY_xxx)はどちらも同じ区分になる フィルタの状態はレート毎には持たない
+#define RATE_CLASS_48K (0)
+#define RATE_CLASS_96K (1)
+#define RATE_CLASS_192K (2)
+#define NUM_OF_RATE_CLASS (3)
+
+#define SIZE_FIR_FILTER_0 (128)
+#define SIZE_FIR_FILTER_1 (48)
+#define SIZE_FIR_FILTER_2 (48)
+
+// フィルタプロファイルのFIR段の最大タップ数(アポダイジングの4xは入力のナイキスト周波数までに減衰させるので長い)
+#define SIZE_FIR_PROFILE_0 (384)
+#define SIZE_FIR_PROFILE_1 (SIZE_FIR_FILTER_1)
+
+// FIR補間1回あたりの最大入力サンプル数(状態バッファの大きさ SIZE_EP_BUFFER * RATIO_UPSAMPLING_48K / 2)
+#define DSP_FIR_BLOCKSIZE (1024)
+
+// 双二次フィルタの係数と遅延を定義する
+typedef struct
+{
+    float a0, a1, a2;
+    float b1, b2;
+} BIQUAD_FILTER;
+
+typedef struct
+{
+    float z1, z2;
+} BQ_DELAY;
+
+typedef struct
+{
+    BQ_DELAY delay0[SIZE_BQ_DELAY_0];
+    BQ_DELAY delay1[SIZE_BQ_DELAY_1];
+    BQ_DELAY delay2[SIZE_BQ_DELAY_2];
+    BQ_DELAY delay3[SIZE_BQ_DELAY_3];
+    BQ_DELAY delay4[SIZE_BQ_DELAY_4];
+} DELAY_DATA;
+
+// フィルタ係数
+extern const float coef_bq_filter_2x_0[SIZE_BQ_FILTER_0][NUM_OF_BQ_SUB_PARAMS];
+extern const float coef_bq_filter_2x_1[SIZE_BQ_FILTER_1][NUM_OF_BQ_SUB_PARAMS];
+extern const float coef_bq_filter_2x_2[SIZE_BQ_FILTER_2][NUM_OF_BQ_SUB_PARAMS];
+extern const float coef_bq_filter_2x_3[SIZE_BQ_FILTER_3][NUM_OF_BQ_SUB_PARAMS];
+extern const float coef_bq_filter_4x_0[SIZE_BQ_FILTER_4][NUM_OF_BQ_SUB_PARAMS];
+
+extern const float coef_fir_filter_4x_0[SIZE_FIR_FILTER_0];
+extern const uint32_t size_coef_fir_filter_4x_0;
+extern const float coef_fir_filter_2x_1[SIZE_FIR_FILTER_1];
+extern const uint32_t size_coef_fir_filter_2x_1;
+extern const float coef_fir_filter_2x_2[SIZE_FIR_FILTER_2];
+extern const uint32_t size_coef_fir_filter_2x_2;
+
+// フィルタプロファイル(全段の係数と処理コスト 係数表はupsampling_coef.c)
+#define DSP_PROFILE_MINIMUM (0)   // 最小位相(従来の係数)
+#define DSP_PROFILE_LINEAR (1)    // 直線位相
+#define DSP_PROFILE_APODIZING (2) // アポダイジング(入力のナイキスト周波数で十分に減衰させる)
+#define DSP_PROFILE_SHORT (3)     // 短遅延(タップ数を半分にした最小位相)
+#define NUM_OF_DSP_PROFILE (4)
+#define DSP_PROFILE_DEFAULT (DSP_PROFILE_MINIMUM)
+
+typedef struct
+{
+    const float *coef; // CMSIS-DSPの形式(時間反転)
+    uint16_t num_taps; // 補間倍率の倍数 4x:SIZE_FIR_PROFILE_0以下 2x:SIZE_FIR_PROFILE_1以下
+} DSP_FIR_COEF;
+
+typedef struct
+{
+    const char *name;
+    DSP_FIR_COEF fir_4x_0; // 48kHz系
+    DSP_FIR_COEF fir_2x_1; // 96kHz系
+    const float (*bq_2x_2)[NUM_OF_BQ_SUB_PARAMS]; // 段数はSIZE_BQ_FILTER_x固定
+    const float (*bq_2x_3)[NUM_OF_BQ_SUB_PARAMS];
+    const float (*bq_4x_0)[NUM_OF_BQ_SUB_PARAMS];
+    uint16_t cycles[NUM_OF_RATE_CLASS]; // FIR段のサイクル数(ステレオ入力1サンプルあたり Cortex-M33 FPU RAM実行)
+} DSP_PROFILE;
+
+extern const DSP_PROFILE dsp_profile_table[NUM_OF_DSP_PROFILE];
+
+// 1ch分のフィルタの状態
+typedef struct
+{
+    arm_fir_interpolate_instance_f32 fir_4x_0;
+    arm_fir_interpolate_instance_f32 fir_2x_1;
+    arm_biquad_casd_df1_inst_f32 bq_2x_2;
+    arm_biquad_casd_df1_inst_f32 bq_2x_3;
+    arm_biquad_casd_df1_inst_f32 bq_4x_0;
+    float fir_4x_0_state[DSP_FIR_BLOCKSIZE + SIZE_FIR_PROFILE_0 - 1];
+    float fir_2x_1_state[DSP_FIR_BLOCKSIZE + SIZE_FIR_PROFILE_1 - 1];
+    float bq_2x_2_state[SIZE_BQ_FILTER_2 * 4];
+    float bq_2x_3_state[SIZE_BQ_FILTER_3 * 4];
+    float bq_4x_0_state[SIZE_BQ_FILTER_4 * 4];
+    uint16_t rate_class;
+
+    // FIR段の係数(プロファイルの係数にFIR前のゲイン × 補間倍率を掛けたRAM上のコピー)
+    // FIR補間で振幅が小さくなる分の補正をFIRの係数に入れて、入力全体にかける処理を省く(音量はdsp_volume.cで入力にかける)
+    float fir_4x_0_coef[SIZE_FIR_PROFILE_0];
+    float fir_2x_1_coef[SIZE_FIR_PROFILE_1];
+    float fir_next_coef[SIZE_FIR_PROFILE_0]; // クロスフェード中の切り替え先
+    float fir_gain;                         // 係数に掛けているゲイン(補間倍率の分を除く dsp_init_channelで決める)
+
+    // プロファイル切り替え(FIR段を新旧並列に実行してクロスフェードする)
+    const DSP_PROFILE *profile;
+    const DSP_PROFILE *volatile profile_request; // 切り替え要求(このチャンネルを処理するコアがブロックの区切りで取り込む)
+    uint32_t xfade_request_length;               // クロスフェード長(入力サンプル数)
+    const DSP_PROFILE *profile_next;             // クロスフェード中の切り替え先(NULL:クロスフェードしていない)
+    arm_fir_interpolate_instance_f32 fir_next;
+    float fir_next_state[DSP_FIR_BLOCKSIZE + SIZE_FIR_PROFILE_0 - 1];
+    float fir_next_out[DSP_FIR_BLOCKSIZE]; // FIR出力は最大 SIZE_EP_BUFFER * 4 サンプル
+    uint32_t xfade_pos;                    // 切り替え開始からの出力サンプル数
+    uint32_t xfade_prime;                  // 切り替え先の状態が埋まるまでの出力サンプル数(この間は旧フィルタのみ出力する)
+    uint32_t xfade_length;                 // クロスフェード長(出力サンプル数)
+
+    DSP_LONG_FIR *long_fir; // 48kHz系のFIR 4xを置き換える長いFIR(NULL:使わない)
+    DSP_PEQ peq;            // パラメトリックEQ(入力レート 最初の補間段の前)
+    DSP_ROOM_FIR *room_fir; // ルーム補正FIR(入力レート EQの後 NULL:使わない)
+    DSP_BQ_F64 *bq_2x_3_f64; // 最終段のBiQuad-IIRを倍精度の状態で実行する(NULL:floatのbq_2x_3, bq_4x_0を使う)
+    DSP_BQ_F64 *bq_4x_0_f64;
+} DSP_CHANNEL;
+
+// 1ch分の処理段の構成
+typedef struct
+{
+    uint16_t rate_class;  // RATE_CLASS_xxx (48kHz系:FIR 4x 96kHz系:FIR 2x 192kHz系:FIRなし)
+    bool run_bq_2x_2;     // BiQuad-IIR 2x (Core0最終段)を実行する
+    uint16_t ratio_final; // 最終段(Core1)の倍率 4:BiQuad-IIR 4x 2:BiQuad-IIR 2x 1:なし
+    bool run_room_fir;    // ルーム補正FIRを実行する(インパルス応答と入力のサンプルレートが同じ場合)
+} DSP_CHAIN;
+
+extern void dsp_init_filter_coef(const DSP_PROFILE *profile);
+extern void dsp_init_channel(DSP_CHANNEL *ch, const DSP_PROFILE *profile, float fir_gain);
+extern void dsp_clear_channel(DSP_CHANNEL *ch);
+extern void dsp_set_profile(DSP_CHANNEL *ch, const DSP_PROFILE *profile);
+extern void dsp_set_long_fir(DSP_CHANNEL *ch, DSP_LONG_FIR *long_fir);
+extern void dsp_set_room_fir(DSP_CHANNEL *ch, DSP_ROOM_FIR *room_fir);
+extern void dsp_set_bq_f64(DSP_CHANNEL *ch, DSP_BQ_F64 *bq_2x_3, DSP_BQ_F64 *bq_4x_0);
+extern void dsp_request_profile(DSP_CHANNEL *ch, const DSP_PROFILE *profile, uint32_t xfade_length);
+extern bool dsp_is_profile_switching(const DSP_CHANNEL *ch);
+extern bool dsp_is_same_biquad(const DSP_PROFILE *a, const DSP_PROFILE *b);
+extern bool dsp_is_fir_gain_folded(const DSP_CHANNEL *ch);
+extern void __not_in_flash_func(dsp_select_rate_class)(DSP_CHANNEL *ch, uint16_t rate_class);
+extern uint16_t dsp_get_rate_class(uint32_t freq);
+extern uint16_t dsp_get_chain_ratio(const DSP_CHAIN *chain);
+
+extern void __not_in_flash_func(dsp_int32_to_float)(const int32_t *in, float *out, uint32_t length);
+extern void __not_in_flash_func(dsp_int32_to_float_stereo)(const int32_t *in_L, const int32_t *in_R, float *out_L, float *out_R, float gain, uint32_t length);
+extern uint32_t __not_in_flash_func(dsp_fir_interpolate)(arm_fir_interpolate_instance_f32 *S, float *in, float *out, uint32_t length);
+extern uint32_t __not_in_flash_func(dsp_fir_stage)(DSP_CHANNEL *ch, float *in, float *out, uint32_t length);
+extern uint32_t __not_in_flash_func(dsp_bq_nos_2x)(arm_biquad_casd_df1_inst_f32 *S, float *in, float *out, uint32_t length);
+extern uint32_t __not_in_flash_func(dsp_bq_nos_4x)(arm_biquad_casd_df1_inst_f32 *S, float *in, float *out, uint32_t length);
+extern uint32_t __not_in_flash_func(dsp_bq_stage_2x_3)(DSP_CHANNEL *ch, float *in, float *out, uint32_t length);
+extern uint32_t __not_in_flash_func(dsp_bq_stage_4x_0)(DSP_CHANNEL *ch, float *in, float *out, uint32_t length);
+extern uint32_t __not_in_flash_func(dsp_process_channel)(DSP_CHANNEL *ch, const DSP_CHAIN *chain, float *in, float *out, float *work_0, float *work_1, uint32_t length);
+
+#endif /* _DSP_FILTER_H_ */
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2025 ArqAlice
+ *
+ * Released under the MIT license
+ * https://opensource.org/licenses/mit-license.php
+ */
+
+#include <math.h>
+#include <string.h>
+#include "dsp_long_fir.h"
+
+_Static_assert((DSP_LONG_FIR_FFT_SIZE >= DSP_RFFT_MIN_SIZE) && (DSP_LONG_FIR_FFT_SIZE <= DSP_RFFT_MAX_SIZE) && ((DSP_LONG_FIR_FFT_SIZE & (DSP_LONG_FIR_FFT_SIZE - 1)) == 0), "DSP_LONG_FIR_PARTITION must be a power of 2 (16..2048)");
+_Static_assert(DSP_LONG_FIR_PHASE_TAPS % DSP_LONG_FIR_PARTITION == 0, "DSP_LONG_FIR_TAPS must be a multiple of DSP_LONG_FIR_PARTITION * DSP_LONG_FIR_RATIO");
+
+// arm_rfft_fast_f32の係数表(dsp_fft.c)
+static float cfft_twiddle[DSP_LONG_FIR_FFT_SIZE];
+static float rfft_twiddle[DSP_LONG_FIR_FFT_SIZE];
+static uint16_t cfft_bitrev[DSP_LONG_FIR_FFT_SIZE];
+static DSP_RFFT rfft;
+
+// 各相・各分割のフィルタのスペクトル(全チャンネル共通)
+static float long_fir_coef[DSP_LONG_FIR_RATIO][DSP_LONG_FIR_NUM_PARTITION][DSP_LONG_FIR_FFT_SIZE];
+
+// 0次の第1種変形ベッセル関数
+static double bessel_i0(double x)
+{
+    double sum = 1.;
+    double term = 1.;
+    for (int k = 1; k < 50; k++)
+    {
+        term *= (x / (2. * k)) * (x / (2. * k));
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+
+// 補間フィルタを設計する(Kaiser窓sinc 直線位相 補間後のレートでのタップ数num_taps 係数の和は1)
+// cutoffは入力サンプルレートに対する遮断周波数の比
+void dsp_long_fir_design(float *coef, uint32_t num_taps, double cutoff, double beta)
+{
+    const double fc = cutoff / DSP_LONG_FIR_RATIO;
+    const double center = (num_taps - 1) / 2.;
+    const double i0_beta = bessel_i0(beta);
+    double sum = 0.;
+
+    for (uint32_t i = 0; i < num_taps; i++)
+    {
+        double t = i - center;
+        double sinc = (t == 0.) ? 2. * fc : sin(2. * M_PI * fc * t) / (M_PI * t);
+        double r = t / center;
+        double window = bessel_i0(beta * sqrt(fmax(0., 1. - r * r))) / i0_beta;
+        coef[i] = (float)(sinc * window);
+        sum += coef[i];
+    }
+    for (uint32_t i = 0; i < num_taps; i++)
+        coef[i] = (float)(coef[i] / sum);
+}
+
+// フィルタを設計して相・分割毎のスペクトルにする(dsp_long_fir_clearより前に1回呼ぶ)
+void dsp_long_fir_init_coef(void)
+{
+    static float coef[DSP_LONG_FIR_TAPS];
+    float block[DSP_LONG_FIR_FFT_SIZE];
+
+    dsp_rfft_init(&rfft, DSP_LONG_FIR_FFT_SIZE, cfft_twiddle, rfft_twiddle, cfft_bitrev);
+    dsp_long_fir_design(coef, DSP_LONG_FIR_TAPS, DSP_LONG_FIR_CUTOFF, DSP_LONG_FIR_BETA);
+
+    // 相pの分割jは h[(j * PARTITION + m) * RATIO + p] (m < PARTITION) 後半は0
+    for (uint32_t p = 0; p < DSP_LONG_FIR_RATIO; p++)
+    {
+        for (uint32_t j = 0; j < DSP_LONG_FIR_NUM_PARTITION; j++)
+        {
+            memset(block, 0, sizeof(block));
+            for (uint32_t m = 0; m < DSP_LONG_FIR_PARTITION; m++)
+                block[m] = coef[(j * DSP_LONG_FIR_PARTITION + m) * DSP_LONG_FIR_RATIO + p];
+            arm_rfft_fast_f32(&rfft.rfft, block, long_fir_coef[p][j], 0);
+        }
+    }
+}
+
+// 1ch分の状態をクリアする
+void dsp_long_fir_clear(DSP_LONG_FIR *S)
+{
+    memset(S, 0, sizeof(DSP_LONG_FIR));
+}
+
+// 1分割分を処理する(frameの後半に新しい入力が揃ったときに呼ぶ)
+static void __not_in_flash_func(process_partition)(DSP_LONG_FIR *S)
+{
+    // arm_rfft_fast_f32は入力を書き換えるのでコピーしてから変換する
+    memcpy(S->work, S->frame, sizeof(S->work));
+    arm_rfft_fast_f32(&rfft.rfft, S->work, S->fdl[S->head], 0);
+
+    memset(S->acc, 0, sizeof(S->acc));
+    uint32_t index = S->head;
+    for (uint32_t j = 0; j < DSP_LONG_FIR_NUM_PARTITION; j++)
+    {
+        for (uint32_t p = 0; p < DSP_LONG_FIR_RATIO; p++)
+            dsp_spectrum_mac(S->acc[p], long_fir_coef[p][j], S->fdl[index], DSP_LONG_FIR_FFT_SIZE);
+        index = (index == 0) ? DSP_LONG_FIR_NUM_PARTITION - 1 : index - 1;
+    }
+
+    // 逆変換の後半(巡回畳み込みの折り返しがない部分)が各相の出力
+    for (uint32_t p = 0; p < DSP_LONG_FIR_RATIO; p++)
+    {
+        arm_rfft_fast_f32(&rfft.rfft, S->acc[p], S->work, 1);
+        for (uint32_t n = 0; n < DSP_LONG_FIR_PARTITION; n++)
+            S->out[n * DSP_LONG_FIR_RATIO + p] = S->work[DSP_LONG_FIR_PARTITION + n];
+    }
+
+    memcpy(S->frame, S->frame + DSP_LONG_FIR_PARTITION, sizeof(float) * DSP_LONG_FIR_PARTITION);
+    S->head = (S->head + 1 == DSP_LONG_FIR_NUM_PARTITION) ? 0 : S->head + 1;
+}
+
+// 4x補間 戻り値は出力サンプル数(常にlength * 4)
+// 入力を分割長ずつまとめて処理し、1つ前の分割の出力を返すので、任意の長さで呼んでよい(遅延はDSP_LONG_FIR_PARTITIONサンプル)
+uint32_t __not_in_flash_func(dsp_long_fir_interpolate)(DSP_LONG_FIR *S, const float *in, float *out, uint32_t length)
+{
+    uint32_t done = 0;
+    while (done < length)
+    {
+        uint32_t n = DSP_LONG_FIR_PARTITION - S->fill;
+        if (n > length - done)
+            n = length - done;
+
+        memcpy(out + done * DSP_LONG_FIR_RATIO, S->out + S->fill * DSP_LONG_FIR_RATIO, sizeof(float) * n * DSP_LONG_FIR_RATIO);
+        memcpy(S->frame + DSP_LONG_FIR_PARTITION + S->fill, in + done, sizeof(float) * n);
+        S->fill += n;
+        done += n;
+
+        if (S->fill == DSP_LONG_FIR_PARTITION)
+        {
+            process_partition(S);
+            S->fill = 0;
+        }
+    }
+    return length * DSP_LONG_FIR_RATIO;
+}
@@ -0,0 +1,54 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _DSP_LONG_FIR_H_
+#define _DSP_LONG_FIR_H_
+
+// 長いFIR補間フィルタ(4x) 一様分割overlap-save畳み込み
+// 4相のポリフェーズに分け、入力のFFTを4相で共有する 周波数領域遅延線(FDL)に過去の分割のスペクトルを保持する
+// 直接形FIRに比べてタップ数あたりの演算量が小さいので、数千タップの急峻なフィルタを使える(遅延は分割長だけ増える)
+// dsp_filter.cと同じくホスト(x86)でもビルドできる(DSP_HOST_BUILD)
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <arm_math.h>
+#include "dsp_fft.h"
+
+#ifdef DSP_HOST_BUILD
+#define __not_in_flash_func(func_name) func_name
+#else
+#include "pico.h"
+#endif
+
+#define DSP_LONG_FIR_RATIO (4)
+#define DSP_LONG_FIR_TAPS (2048)     // 補間後のレートでのタップ数(直線位相 Kaiser窓)
+#define DSP_LONG_FIR_PARTITION (16)  // 分割長(入力サンプル数) 250us(TIMER0_US)の処理周期の入力サンプル数に近い2のべき乗
+#define DSP_LONG_FIR_CUTOFF (0.4955) // 遮断周波数(-6dB 入力サンプルレートに対する比)
+#define DSP_LONG_FIR_BETA (14.)      // Kaiser窓のβ(阻止域 約-140dB)
+
+#define DSP_LONG_FIR_FFT_SIZE (DSP_LONG_FIR_PARTITION * 2)
+#define DSP_LONG_FIR_PHASE_TAPS (DSP_LONG_FIR_TAPS / DSP_LONG_FIR_RATIO)
+#define DSP_LONG_FIR_NUM_PARTITION (DSP_LONG_FIR_PHASE_TAPS / DSP_LONG_FIR_PARTITION)
+
+// 1ch分の状態
+typedef struct
+{
+    float frame[DSP_LONG_FIR_FFT_SIZE];                           // 1つ前の分割と現在の分割の入力(overlap-save)
+    float fdl[DSP_LONG_FIR_NUM_PARTITION][DSP_LONG_FIR_FFT_SIZE]; // 周波数領域遅延線(CMSIS-DSPのrfft形式)
+    float acc[DSP_LONG_FIR_RATIO][DSP_LONG_FIR_FFT_SIZE];         // 相毎のスペクトルの積和
+    float work[DSP_LONG_FIR_FFT_SIZE];
+    float out[DSP_LONG_FIR_PARTITION * DSP_LONG_FIR_RATIO]; // 1つ前の分割の出力(1分割遅れで出力する)
+    uint16_t fill;                                          // 現在の分割に入っている入力サンプル数
+    uint16_t head;                                          // fdlの最新の位置
+} DSP_LONG_FIR;
+
+extern void dsp_long_fir_design(float *coef, uint32_t num_taps, double cutoff, double beta);
+extern void dsp_long_fir_init_coef(void);
+extern void dsp_long_fir_clear(DSP_LONG_FIR *S);
+extern uint32_t __not_in_flash_func(dsp_long_fir_interpolate)(DSP_LONG_FIR *S, const float *in, float *out, uint32_t length);
+
+#endif /* _DSP_LONG_FIR_H_ */
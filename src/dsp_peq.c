@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2025 ArqAlice
+ *
+ * Released under the MIT license
+ * https://opensource.org/licenses/mit-license.php
+ */
+
+#include <math.h>
+#include <string.h>
+#include "dsp_peq.h"
+
+// 1バンド分の係数を計算する(Audio EQ Cookbookの式 CMSIS-DSPのDF1形式) 範囲外の場合はfalse
+// 機器上でもすぐ終わるよう単精度で計算する 低い周波数で桁落ちしないよう 1-cos(w0) は 2sin^2(w0/2) で求める
+bool dsp_peq_design(const DSP_PEQ_BAND *band, float fs, float *coef)
+{
+    if ((band->type == DSP_PEQ_OFF) || (band->type >= NUM_OF_DSP_PEQ_TYPE))
+        return false;
+    if ((band->freq <= 0.f) || (band->freq >= fs * 0.5f) || (band->q <= 0.f) || (fabsf(band->gain_db) > 30.f))
+        return false;
+
+    const float w0 = 2.f * (float)M_PI * band->freq / fs;
+    const float s = sinf(w0 * 0.5f);
+    const float one_minus_cos = 2.f * s * s;
+    const float cos_w0 = 1.f - one_minus_cos;
+    const float alpha = sinf(w0) / (2.f * band->q);
+    const float A = powf(10.f, band->gain_db / 40.f);
+    const float sqrt_A_alpha = 2.f * sqrtf(A) * alpha;
+    float b0, b1, b2, a0, a1, a2;
+
+    switch (band->type)
+    {
+    case DSP_PEQ_PEAKING:
+        b0 = 1.f + alpha * A;
+        b1 = -2.f * cos_w0;
+        b2 = 1.f - alpha * A;
+        a0 = 1.f + alpha / A;
+        a1 = -2.f * cos_w0;
+        a2 = 1.f - alpha / A;
+        break;
+    case DSP_PEQ_LOW_SHELF:
+        b0 = A * ((A + 1.f) - (A - 1.f) * cos_w0 + sqrt_A_alpha);
+        b1 = 2.f * A * ((A - 1.f) - (A + 1.f) * cos_w0);
+        b2 = A * ((A + 1.f) - (A - 1.f) * cos_w0 - sqrt_A_alpha);
+        a0 = (A + 1.f) + (A - 1.f) * cos_w0 + sqrt_A_alpha;
+        a1 = -2.f * ((A - 1.f) + (A + 1.f) * cos_w0);
+        a2 = (A + 1.f) + (A - 1.f) * cos_w0 - sqrt_A_alpha;
+        break;
+    case DSP_PEQ_HIGH_SHELF:
+        b0 = A * ((A + 1.f) + (A - 1.f) * cos_w0 + sqrt_A_alpha);
+        b1 = -2.f * A * ((A - 1.f) + (A + 1.f) * cos_w0);
+        b2 = A * ((A + 1.f) + (A - 1.f) * cos_w0 - sqrt_A_alpha);
+        a0 = (A + 1.f) - (A - 1.f) * cos_w0 + sqrt_A_alpha;
+        a1 = 2.f * ((A - 1.f) - (A + 1.f) * cos_w0);
+        a2 = (A + 1.f) - (A - 1.f) * cos_w0 - sqrt_A_alpha;
+        break;
+    case DSP_PEQ_LOW_PASS:
+        b0 = one_minus_cos * 0.5f;
+        b1 = one_minus_cos;
+        b2 = one_minus_cos * 0.5f;
+        a0 = 1.f + alpha;
+        a1 = -2.f * cos_w0;
+        a2 = 1.f - alpha;
+        break;
+    case DSP_PEQ_HIGH_PASS:
+    default:
+        b0 = (2.f - one_minus_cos) * 0.5f;
+        b1 = -(2.f - one_minus_cos);
+        b2 = (2.f - one_minus_cos) * 0.5f;
+        a0 = 1.f + alpha;
+        a1 = -2.f * cos_w0;
+        a2 = 1.f - alpha;
+        break;
+    }
+
+    coef[0] = b0 / a0;
+    coef[1] = b1 / a0;
+    coef[2] = b2 / a0;
+    coef[3] = -a1 / a0;
+    coef[4] = -a2 / a0;
+    return true;
+}
+
+// 段数0(EQなし)で初期化する
+void dsp_peq_init(DSP_PEQ *S)
+{
+    S->active = 0;
+    S->num_prepared = 0;
+    S->num_request = 0;
+    S->request = false;
+    arm_biquad_cascade_df1_init_f32(&S->bq, 0, S->coef_bank[0], S->state);
+    dsp_peq_clear(S);
+}
+
+void dsp_peq_clear(DSP_PEQ *S)
+{
+    memset(S->state, 0, sizeof(S->state));
+}
+
+// バンド設定から係数を計算し、使っていない方の係数バンクに書く(DSP_PEQ_OFFのバンドは詰める 入れ替えはdsp_peq_commitで要求する)
+// 前の入れ替えがまだ取り込まれていない場合、範囲外のバンドがある場合はfalse(使っている係数は変えない)
+// 書き込むのは1つのコア(スレッド)だけにすること
+bool dsp_peq_prepare(DSP_PEQ *S, const DSP_PEQ_BAND *band, uint32_t num_band, float fs)
+{
+    if (S->request || (num_band > DSP_PEQ_MAX_BAND))
+        return false;
+
+    float *coef = S->coef_bank[S->active ^ 1];
+    uint8_t num_section = 0;
+    for (uint32_t i = 0; i < num_band; i++)
+    {
+        if (band[i].type == DSP_PEQ_OFF)
+            continue;
+        if (!dsp_peq_design(&band[i], fs, &coef[num_section * 5]))
+            return false;
+        num_section++;
+    }
+    S->num_prepared = num_section;
+    return true;
+}
+
+// dsp_peq_prepareで書いた係数バンクへの入れ替えを要求する
+void dsp_peq_commit(DSP_PEQ *S)
+{
+    // 係数を書き終えてから要求を出す
+    __sync_synchronize();
+    S->num_request = S->num_prepared;
+    S->request = true;
+}
+
+// 係数を計算して入れ替えを要求する(dsp_peq_prepare + dsp_peq_commit)
+bool dsp_peq_set_bands(DSP_PEQ *S, const DSP_PEQ_BAND *band, uint32_t num_band, float fs)
+{
+    if (!dsp_peq_prepare(S, band, num_band, fs))
+        return false;
+    dsp_peq_commit(S);
+    return true;
+}
+
+bool dsp_peq_is_pending(const DSP_PEQ *S)
+{
+    return S->request;
+}
+
+uint16_t dsp_peq_num_section(const DSP_PEQ *S)
+{
+    return S->request ? S->num_request : S->bq.numStages;
+}
+
+// EQを実行する(in == out可) 入れ替え要求があればブロックの先頭で係数バンクを入れ替える
+// 続けて使う段の状態は引き継ぎ、新しく増えた段の状態はクリアする
+// 段数が0の場合は何もせずfalseを返す(outには書き込まない)
+bool __not_in_flash_func(dsp_peq_process)(DSP_PEQ *S, float *in, float *out, uint32_t length)
+{
+    if (S->request)
+    {
+        uint8_t num_section = S->num_request;
+        if (num_section > S->bq.numStages)
+            memset(&S->state[S->bq.numStages * 4], 0, sizeof(float) * 4 * (num_section - S->bq.numStages));
+        S->active ^= 1;
+        S->bq.pCoeffs = S->coef_bank[S->active];
+        S->bq.numStages = num_section;
+        __sync_synchronize();
+        S->request = false;
+    }
+
+    if (S->bq.numStages == 0)
+        return false;
+    arm_biquad_cascade_df1_f32(&S->bq, in, out, length);
+    return true;
+}
@@ -0,0 +1,67 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _DSP_PEQ_H_
+#define _DSP_PEQ_H_
+
+// パラメトリックEQ(ピーキング・シェルビング・ハイパス/ローパスのBiQuad-IIR 1chあたり最大DSP_PEQ_MAX_BAND段)
+// 入力レートで最初の補間段の前に実行する(最も処理量が小さい) 演算はCMSIS-DSPのDF1カスケード
+// 係数は(種類, 周波数, Q, ゲイン)からその場で計算し、2面の係数バンクの片方に書いてからブロックの区切りで入れ替える
+// dsp_filter.cと同じくホスト(x86)でもビルドできる(DSP_HOST_BUILD)
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <arm_math.h>
+
+#ifdef DSP_HOST_BUILD
+#define __not_in_flash_func(func_name) func_name
+#else
+#include "pico.h"
+#endif
+
+#define DSP_PEQ_MAX_BAND (16)
+
+// フィルタの種類
+#define DSP_PEQ_OFF (0)
+#define DSP_PEQ_PEAKING (1)
+#define DSP_PEQ_LOW_SHELF (2)
+#define DSP_PEQ_HIGH_SHELF (3)
+#define DSP_PEQ_LOW_PASS (4)
+#define DSP_PEQ_HIGH_PASS (5)
+#define NUM_OF_DSP_PEQ_TYPE (6)
+
+typedef struct
+{
+    uint8_t type;  // DSP_PEQ_xxx
+    float freq;    // 中心/遮断周波数(Hz)
+    float q;       // Q(シェルビングは傾き)
+    float gain_db; // ゲイン(dB ハイパス/ローパスでは使わない)
+} DSP_PEQ_BAND;
+
+// 1ch分の状態
+typedef struct
+{
+    arm_biquad_casd_df1_inst_f32 bq;
+    float coef_bank[2][DSP_PEQ_MAX_BAND * 5]; // CMSIS-DSPのDF1形式(b0, b1, b2, -a1, -a2)
+    float state[DSP_PEQ_MAX_BAND * 4];
+    uint8_t active;               // bqが使っている係数バンク
+    uint8_t num_prepared;         // 使っていない方の係数バンクに書いた段数
+    volatile uint8_t num_request; // 入れ替え後の段数
+    volatile bool request;        // 入れ替え要求(このチャンネルを処理するコアがブロックの区切りで取り込む)
+} DSP_PEQ;
+
+extern bool dsp_peq_design(const DSP_PEQ_BAND *band, float fs, float *coef);
+extern void dsp_peq_init(DSP_PEQ *S);
+extern void dsp_peq_clear(DSP_PEQ *S);
+extern bool dsp_peq_prepare(DSP_PEQ *S, const DSP_PEQ_BAND *band, uint32_t num_band, float fs);
+extern void dsp_peq_commit(DSP_PEQ *S);
+extern bool dsp_peq_set_bands(DSP_PEQ *S, const DSP_PEQ_BAND *band, uint32_t num_band, float fs);
+extern bool dsp_peq_is_pending(const DSP_PEQ *S);
+extern uint16_t dsp_peq_num_section(const DSP_PEQ *S);
+extern bool __not_in_flash_func(dsp_peq_process)(DSP_PEQ *S, float *in, float *out, uint32_t length);
+
+#endif /* _DSP_PEQ_H_ */
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2025 ArqAlice
+ *
+ * Released under the MIT license
+ * https://opensource.org/licenses/mit-license.php
+ */
+
+#include <math.h>
+#include <string.h>
+#include "dsp_q31.h"
+
+_Static_assert((SIZE_BQ_FILTER_3 <= DSP_Q31_MAX_BQ_STAGE) && (SIZE_BQ_FILTER_4 <= DSP_Q31_MAX_BQ_STAGE), "DSP_Q31_MAX_BQ_STAGE is too small");
+
+// 絶対値が1未満の値をQ31に丸める(範囲外の場合はfalse)
+static bool float_to_q31(double x, q31_t *out)
+{
+    double q = round(x * 2147483648.);
+    if ((q >= 2147483648.) || (q < -2147483648.))
+        return false;
+    *out = (q31_t)q;
+    return true;
+}
+
+// BiQuad-IIRの係数(係数表の形式)をQ31にする 係数の最大値が1未満になるようpostShiftを決める
+// 係数表は初段の分子が非常に小さい(1e-5程度)ので、そのままでは量子化で全体のゲインがずれ、初段の出力も小さくなって雑音が増える
+// 各段の分子をDCゲイン1に正規化し、全体のゲインは最終段に入れる
+// 範囲外(2^7以上)の係数がある場合はfalse
+bool dsp_q31_init_biquad(DSP_Q31_BIQUAD *S, const float (*coef)[NUM_OF_BQ_SUB_PARAMS], uint16_t num_stage)
+{
+    double c[DSP_Q31_MAX_BQ_STAGE * 5];
+    double max = 0.;
+    double gain = 1.;
+    for (uint16_t i = 0; i < num_stage; i++)
+    {
+        // dsp_filter.cと同じくCMSIS-DSPの形式(b0, b1, b2, -a1, -a2)にする
+        c[i * 5 + 0] = coef[i][0];
+        c[i * 5 + 1] = coef[i][1];
+        c[i * 5 + 2] = coef[i][2];
+        c[i * 5 + 3] = -coef[i][4];
+        c[i * 5 + 4] = -coef[i][5];
+
+        double dc = (c[i * 5 + 0] + c[i * 5 + 1] + c[i * 5 + 2]) / (1. - c[i * 5 + 3] - c[i * 5 + 4]);
+        if (fabs(dc) < 1e-12)
+            continue;
+        gain *= dc;
+        for (int k = 0; k < 3; k++)
+            c[i * 5 + k] /= dc;
+    }
+    for (int k = 0; k < 3; k++)
+        c[(num_stage - 1) * 5 + k] *= gain;
+    for (uint16_t i = 0; i < num_stage * 5; i++)
+        max = fmax(max, fabs(c[i]));
+
+    uint8_t shift = 0;
+    while ((max * 2147483648. >= 2147483647.5 * (double)(1u << shift)) && (shift < 7))
+        shift++;
+    for (uint16_t i = 0; i < num_stage * 5; i++)
+    {
+        if (!float_to_q31(ldexp(c[i], -shift), &S->coef[i]))
+            return false;
+    }
+    arm_biquad_cas_df1_32x64_init_q31(&S->bq, num_stage, S->coef, S->state, shift);
+    return true;
+}
+
+// FIRの係数にゲインを掛けてQ31にする
+static bool init_fir_coef(const DSP_FIR_COEF *coef, double gain, q31_t *out)
+{
+    for (uint16_t i = 0; i < coef->num_taps; i++)
+    {
+        if (!float_to_q31((double)coef->coef[i] * gain, &out[i]))
+            return false;
+    }
+    return true;
+}
+
+// 1ch分のフィルタをプロファイルの係数で初期化する(FIR段にはgain × 補間倍率を掛ける)
+// 係数がQ31の範囲に収まらない場合はfalse
+bool dsp_q31_init_channel(DSP_Q31_CHANNEL *ch, const DSP_PROFILE *profile, float gain)
+{
+    ch->rate_class = RATE_CLASS_48K;
+    if (!init_fir_coef(&profile->fir_4x_0, gain * 4., ch->fir_4x_0_coef) || !init_fir_coef(&profile->fir_2x_1, gain * 2., ch->fir_2x_1_coef))
+        return false;
+    if (!dsp_q31_init_biquad(&ch->bq_2x_2, profile->bq_2x_2, SIZE_BQ_FILTER_2) ||
+        !dsp_q31_init_biquad(&ch->bq_2x_3, profile->bq_2x_3, SIZE_BQ_FILTER_3) ||
+        !dsp_q31_init_biquad(&ch->bq_4x_0, profile->bq_4x_0, SIZE_BQ_FILTER_4))
+        return false;
+    arm_fir_interpolate_init_q31(&ch->fir_4x_0, 4, profile->fir_4x_0.num_taps, ch->fir_4x_0_coef, ch->fir_4x_0_state, DSP_FIR_BLOCKSIZE);
+    arm_fir_interpolate_init_q31(&ch->fir_2x_1, 2, profile->fir_2x_1.num_taps, ch->fir_2x_1_coef, ch->fir_2x_1_state, DSP_FIR_BLOCKSIZE);
+    dsp_q31_clear_channel(ch);
+    return true;
+}
+
+// フィルタの遅延バッファをクリアする
+void dsp_q31_clear_channel(DSP_Q31_CHANNEL *ch)
+{
+    memset(ch->fir_4x_0_state, 0, sizeof(ch->fir_4x_0_state));
+    memset(ch->fir_2x_1_state, 0, sizeof(ch->fir_2x_1_state));
+    memset(ch->bq_2x_2.state, 0, sizeof(ch->bq_2x_2.state));
+    memset(ch->bq_2x_3.state, 0, sizeof(ch->bq_2x_3.state));
+    memset(ch->bq_4x_0.state, 0, sizeof(ch->bq_4x_0.state));
+}
+
+// サンプルレートが変わったときに呼ぶ(float版と同じく状態はクリアする)
+void __not_in_flash_func(dsp_q31_select_rate_class)(DSP_Q31_CHANNEL *ch, uint16_t rate_class)
+{
+    if (rate_class == ch->rate_class)
+        return;
+    dsp_q31_clear_channel(ch);
+    ch->rate_class = rate_class;
+}
+
+// FIR補間段(倍率は入力サンプルレート区分による 192kHz系はFIRなし) 戻り値は出力サンプル数
+uint32_t __not_in_flash_func(dsp_q31_fir_stage)(DSP_Q31_CHANNEL *ch, const q31_t *in, q31_t *out, uint32_t length)
+{
+    switch (ch->rate_class)
+    {
+    case RATE_CLASS_48K:
+        arm_fir_interpolate_q31(&ch->fir_4x_0, in, out, length);
+        return length * 4;
+    case RATE_CLASS_96K:
+        arm_fir_interpolate_q31(&ch->fir_2x_1, in, out, length);
+        return length * 2;
+    default:
+        memcpy(out, in, sizeof(q31_t) * length);
+        return length;
+    }
+}
+
+// NOS(同じサンプルをratio回繰り返す) + BiQuad-IIR 出力バッファの上でそのままフィルタをかける(作業用バッファ不要)
+uint32_t __not_in_flash_func(dsp_q31_bq_nos)(DSP_Q31_BIQUAD *S, uint32_t ratio, const q31_t *in, q31_t *out, uint32_t length)
+{
+    q31_t *p = out;
+    if (ratio == 4)
+    {
+        for (uint32_t i = 0; i < length; i++)
+        {
+            q31_t x = in[i];
+            *p++ = x;
+            *p++ = x;
+            *p++ = x;
+            *p++ = x;
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i < length; i++)
+        {
+            q31_t x = in[i];
+            *p++ = x;
+            *p++ = x;
+        }
+    }
+
+    arm_biquad_cas_df1_32x64_q31(&S->bq, out, out, length * ratio);
+    return length * ratio;
+}
+
+// 1ch分の全段(FIR補間 → BiQuad-IIR 2x → 最終段)を実行する 戻り値は出力サンプル数
+// バッファの大きさはdsp_process_channelと同じ
+uint32_t __not_in_flash_func(dsp_q31_process_channel)(DSP_Q31_CHANNEL *ch, const DSP_CHAIN *chain, const q31_t *in, q31_t *out, q31_t *work_0, q31_t *work_1, uint32_t length)
+{
+    uint32_t len = length;
+
+    dsp_q31_select_rate_class(ch, chain->rate_class);
+
+    if (chain->rate_class != RATE_CLASS_192K)
+    {
+        len = dsp_q31_fir_stage(ch, in, work_1, len);
+        in = work_1;
+    }
+
+    if (chain->run_bq_2x_2)
+    {
+        len = dsp_q31_bq_nos(&ch->bq_2x_2, 2, in, work_0, len);
+        in = work_0;
+    }
+
+    switch (chain->ratio_final)
+    {
+    case 4:
+        len = dsp_q31_bq_nos(&ch->bq_4x_0, 4, in, out, len);
+        break;
+    case 2:
+        len = dsp_q31_bq_nos(&ch->bq_2x_3, 2, in, out, len);
+        break;
+    case 1:
+    default:
+        memcpy(out, in, sizeof(q31_t) * len);
+        break;
+    }
+    return len;
+}
@@ -0,0 +1,56 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _DSP_Q31_H_
+#define _DSP_Q31_H_
+
+// Q31固定小数点のアップサンプリングフィルタ(DSP_CHANNELと同じ段構成 FIR補間 → NOS+BiQuad-IIR 2x → 最終段)
+// FIRはCMSIS-DSPのarm_fir_interpolate_q31(64bit累算 SMLAL)、BiQuad-IIRはarm_biquad_cas_df1_32x64_q31(係数32bit・出力の状態64bit)
+// 入出力はint32(フルスケール = Q31)のまま 係数はプロファイルのfloat係数から初期化時に量子化する
+// 演算は飽和せず折り返すので、FIR前のゲイン(DEFAULT_GAIN_RATIO)で各段の余裕を確保すること
+// EQ・ルーム補正FIR・長いFIR・クロスフィード・プロファイルのクロスフェードはfloat版(dsp_filter.c)だけ
+// dsp_filter.cと同じくホスト(x86)でもビルドできる(DSP_HOST_BUILD)
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <arm_math.h>
+#include "dsp_filter.h"
+
+#define DSP_Q31_MAX_BQ_STAGE (SIZE_BQ_FILTER_2) // SIZE_BQ_FILTER_2/3/4の最大
+
+// BiQuad-IIR 1段分(32x64 DF1カスケード)
+typedef struct
+{
+    arm_biquad_cas_df1_32x64_ins_q31 bq;
+    q31_t coef[DSP_Q31_MAX_BQ_STAGE * 5]; // b0, b1, b2, a1, a2 を 2^postShift で割ったもの
+    q63_t state[DSP_Q31_MAX_BQ_STAGE * 4];
+} DSP_Q31_BIQUAD;
+
+// 1ch分のフィルタの状態
+typedef struct
+{
+    arm_fir_interpolate_instance_q31 fir_4x_0;
+    arm_fir_interpolate_instance_q31 fir_2x_1;
+    q31_t fir_4x_0_coef[SIZE_FIR_PROFILE_0]; // FIR前のゲイン × 補間倍率を掛けたもの
+    q31_t fir_2x_1_coef[SIZE_FIR_PROFILE_1];
+    q31_t fir_4x_0_state[DSP_FIR_BLOCKSIZE + SIZE_FIR_PROFILE_0 / 4 - 1];
+    q31_t fir_2x_1_state[DSP_FIR_BLOCKSIZE + SIZE_FIR_PROFILE_1 / 2 - 1];
+    DSP_Q31_BIQUAD bq_2x_2;
+    DSP_Q31_BIQUAD bq_2x_3;
+    DSP_Q31_BIQUAD bq_4x_0;
+    uint16_t rate_class;
+} DSP_Q31_CHANNEL;
+
+extern bool dsp_q31_init_biquad(DSP_Q31_BIQUAD *S, const float (*coef)[NUM_OF_BQ_SUB_PARAMS], uint16_t num_stage);
+extern bool dsp_q31_init_channel(DSP_Q31_CHANNEL *ch, const DSP_PROFILE *profile, float gain);
+extern void dsp_q31_clear_channel(DSP_Q31_CHANNEL *ch);
+extern void __not_in_flash_func(dsp_q31_select_rate_class)(DSP_Q31_CHANNEL *ch, uint16_t rate_class);
+extern uint32_t __not_in_flash_func(dsp_q31_fir_stage)(DSP_Q31_CHANNEL *ch, const q31_t *in, q31_t *out, uint32_t length);
+extern uint32_t __not_in_flash_func(dsp_q31_bq_nos)(DSP_Q31_BIQUAD *S, uint32_t ratio, const q31_t *in, q31_t *out, uint32_t length);
+extern uint32_t __not_in_flash_func(dsp_q31_process_channel)(DSP_Q31_CHANNEL *ch, const DSP_CHAIN *chain, const q31_t *in, q31_t *out, q31_t *work_0, q31_t *work_1, uint32_t length);
+
+#endif /* _DSP_Q31_H_ */
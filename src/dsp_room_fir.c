@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2025 ArqAlice
+ *
+ * Released under the MIT license
+ * https://opensource.org/licenses/mit-license.php
+ */
+
+#include <string.h>
+#include "dsp_room_fir.h"
+
+_Static_assert((DSP_ROOM_FIR_FFT_SIZE >= DSP_RFFT_MIN_SIZE) && (DSP_ROOM_FIR_FFT_SIZE <= DSP_RFFT_MAX_SIZE) && ((DSP_ROOM_FIR_FFT_SIZE & (DSP_ROOM_FIR_FFT_SIZE - 1)) == 0), "DSP_ROOM_FIR_PARTITION must be a power of 2 (16..2048)");
+_Static_assert(DSP_ROOM_FIR_MAX_TAPS % DSP_ROOM_FIR_PARTITION == 0, "DSP_ROOM_FIR_MAX_TAPS must be a multiple of DSP_ROOM_FIR_PARTITION");
+
+// arm_rfft_fast_f32の係数表(dsp_fft.c 全チャンネル共通 最初のdsp_room_fir_initで作る)
+static float cfft_twiddle[DSP_ROOM_FIR_FFT_SIZE];
+static float rfft_twiddle[DSP_ROOM_FIR_FFT_SIZE];
+static uint16_t cfft_bitrev[DSP_ROOM_FIR_FFT_SIZE];
+static DSP_RFFT rfft;
+static bool rfft_ready = false;
+
+// 無効(インパルス応答なし)で初期化する
+void dsp_room_fir_init(DSP_ROOM_FIR *S)
+{
+    if (!rfft_ready)
+        rfft_ready = dsp_rfft_init(&rfft, DSP_ROOM_FIR_FFT_SIZE, cfft_twiddle, rfft_twiddle, cfft_bitrev);
+    S->num_partition = 0;
+    dsp_room_fir_clear(S);
+}
+
+// インパルス応答(num_taps個 irがNULLの場合は無音 処理量の計測用)を分割毎にFFTして係数にする 状態はクリアされる
+// num_tapsが0の場合は無効にする 処理していないときに呼ぶこと(FFTを分割数回行うので時間がかかる)
+bool dsp_room_fir_load(DSP_ROOM_FIR *S, const float *ir, uint32_t num_taps)
+{
+    if (num_taps > DSP_ROOM_FIR_MAX_TAPS)
+        return false;
+
+    // 分割jは h[j * PARTITION + m] (m < PARTITION) 後半は0
+    uint16_t num_partition = (num_taps + DSP_ROOM_FIR_PARTITION - 1) / DSP_ROOM_FIR_PARTITION;
+    for (uint32_t j = 0; j < num_partition; j++)
+    {
+        memset(S->work, 0, sizeof(S->work));
+        for (uint32_t m = 0; (ir != NULL) && (m < DSP_ROOM_FIR_PARTITION) && (j * DSP_ROOM_FIR_PARTITION + m < num_taps); m++)
+            S->work[m] = ir[j * DSP_ROOM_FIR_PARTITION + m];
+        arm_rfft_fast_f32(&rfft.rfft, S->work, S->coef[j], 0);
+    }
+
+    S->num_partition = num_partition;
+    dsp_room_fir_clear(S);
+    return true;
+}
+
+// 状態をクリアする(係数はそのまま)
+void dsp_room_fir_clear(DSP_ROOM_FIR *S)
+{
+    memset(S->fdl, 0, sizeof(S->fdl));
+    memset(S->frame, 0, sizeof(S->frame));
+    memset(S->out, 0, sizeof(S->out));
+    S->fill = 0;
+    S->head = 0;
+}
+
+// 使っているタップ数(分割長の倍数に切り上げたもの 0:無効)
+uint32_t dsp_room_fir_num_taps(const DSP_ROOM_FIR *S)
+{
+    return S->num_partition * DSP_ROOM_FIR_PARTITION;
+}
+
+// 遅延(入力サンプル数 無効の場合は0)
+uint32_t dsp_room_fir_latency(const DSP_ROOM_FIR *S)
+{
+    return (S->num_partition != 0) ? DSP_ROOM_FIR_PARTITION : 0;
+}
+
+// 1分割分を処理する(frameの後半に新しい入力が揃ったときに呼ぶ)
+static void __not_in_flash_func(process_partition)(DSP_ROOM_FIR *S)
+{
+    // arm_rfft_fast_f32は入力を書き換えるのでコピーしてから変換する
+    memcpy(S->work, S->frame, sizeof(S->work));
+    arm_rfft_fast_f32(&rfft.rfft, S->work, S->fdl[S->head], 0);
+
+    memset(S->acc, 0, sizeof(S->acc));
+    uint32_t index = S->head;
+    for (uint32_t j = 0; j < S->num_partition; j++)
+    {
+        dsp_spectrum_mac(S->acc, S->coef[j], S->fdl[index], DSP_ROOM_FIR_FFT_SIZE);
+        index = (index == 0) ? (uint32_t)S->num_partition - 1u : index - 1u;
+    }
+
+    // 逆変換の後半(巡回畳み込みの折り返しがない部分)が出力
+    arm_rfft_fast_f32(&rfft.rfft, S->acc, S->work, 1);
+    memcpy(S->out, S->work + DSP_ROOM_FIR_PARTITION, sizeof(S->out));
+
+    memcpy(S->frame, S->frame + DSP_ROOM_FIR_PARTITION, sizeof(float) * DSP_ROOM_FIR_PARTITION);
+    S->head = (S->head + 1 == S->num_partition) ? 0 : S->head + 1;
+}
+
+// 畳み込みを実行する(in == out可) 無効の場合は何もせずfalseを返す(outには書き込まない)
+// 入力を分割長ずつまとめて処理し、1つ前の分割の出力を返すので、任意の長さで呼んでよい(遅延はDSP_ROOM_FIR_PARTITIONサンプル)
+bool __not_in_flash_func(dsp_room_fir_process)(DSP_ROOM_FIR *S, const float *in, float *out, uint32_t length)
+{
+    if (S->num_partition == 0)
+        return false;
+
+    uint32_t done = 0;
+    while (done < length)
+    {
+        uint32_t n = DSP_ROOM_FIR_PARTITION - S->fill;
+        if (n > length - done)
+            n = length - done;
+
+        // in == outの場合に備えて入力を先に取り込む
+        memcpy(S->frame + DSP_ROOM_FIR_PARTITION + S->fill, in + done, sizeof(float) * n);
+        memcpy(out + done, S->out + S->fill, sizeof(float) * n);
+        S->fill += n;
+        done += n;
+
+        if (S->fill == DSP_ROOM_FIR_PARTITION)
+        {
+            process_partition(S);
+            S->fill = 0;
+        }
+    }
+    return true;
+}
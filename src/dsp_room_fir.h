@@ -0,0 +1,53 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _DSP_ROOM_FIR_H_
+#define _DSP_ROOM_FIR_H_
+
+// ルーム補正FIR(ユーザーが書き込んだインパルス応答 1chあたり最大DSP_ROOM_FIR_MAX_TAPSタップ)
+// 入力レートで最初の補間段の前に実行する(出力レートで実行する場合の1/32以下の処理量) 一様分割overlap-save畳み込み
+// 係数は書き込まれたインパルス応答を分割毎にFFTしたもの 遅延はDSP_ROOM_FIR_PARTITIONサンプル
+// dsp_filter.cと同じくホスト(x86)でもビルドできる(DSP_HOST_BUILD)
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <arm_math.h>
+#include "dsp_fft.h"
+
+#ifdef DSP_HOST_BUILD
+#define __not_in_flash_func(func_name) func_name
+#else
+#include "pico.h"
+#endif
+
+#define DSP_ROOM_FIR_MAX_TAPS (4096)  // 48kHzで約85ms
+#define DSP_ROOM_FIR_PARTITION (64)   // 分割長(=遅延 48kHzで1.3ms) 短くするとFDLの積和が増える
+#define DSP_ROOM_FIR_FFT_SIZE (DSP_ROOM_FIR_PARTITION * 2)
+#define DSP_ROOM_FIR_MAX_PARTITION (DSP_ROOM_FIR_MAX_TAPS / DSP_ROOM_FIR_PARTITION)
+
+// 1ch分の状態
+typedef struct
+{
+    float coef[DSP_ROOM_FIR_MAX_PARTITION][DSP_ROOM_FIR_FFT_SIZE]; // 分割毎のインパルス応答のスペクトル(CMSIS-DSPのrfft形式)
+    float fdl[DSP_ROOM_FIR_MAX_PARTITION][DSP_ROOM_FIR_FFT_SIZE];  // 周波数領域遅延線
+    float frame[DSP_ROOM_FIR_FFT_SIZE];                            // 1つ前の分割と現在の分割の入力(overlap-save)
+    float acc[DSP_ROOM_FIR_FFT_SIZE];
+    float work[DSP_ROOM_FIR_FFT_SIZE];
+    float out[DSP_ROOM_FIR_PARTITION]; // 1つ前の分割の出力(1分割遅れで出力する)
+    uint16_t num_partition;            // 使う分割数(0:無効)
+    uint16_t fill;                     // 現在の分割に入っている入力サンプル数
+    uint16_t head;                     // fdlの最新の位置
+} DSP_ROOM_FIR;
+
+extern void dsp_room_fir_init(DSP_ROOM_FIR *S);
+extern bool dsp_room_fir_load(DSP_ROOM_FIR *S, const float *ir, uint32_t num_taps);
+extern void dsp_room_fir_clear(DSP_ROOM_FIR *S);
+extern uint32_t dsp_room_fir_num_taps(const DSP_ROOM_FIR *S);
+extern uint32_t dsp_room_fir_latency(const DSP_ROOM_FIR *S);
+extern bool __not_in_flash_func(dsp_room_fir_process)(DSP_ROOM_FIR *S, const float *in, float *out, uint32_t length);
+
+#endif /* _DSP_ROOM_FIR_H_ */
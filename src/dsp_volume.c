@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2025 ArqAlice
+ *
+ * Released under the MIT license
+ * https://opensource.org/licenses/mit-license.php
+ */
+
+#include <math.h>
+#include "dsp_volume.h"
+
+// ゲインの表 整数dB部分(0 〜 -DSP_VOLUME_MAX_ATTEN_DB dB)と1/256dB部分に分けて、積をゲインにする
+// 変換はこれまでの volume_control() と同じ 10^(dB / 10)
+static int32_t volume_table_db[DSP_VOLUME_MAX_ATTEN_DB + 1];
+static int32_t volume_table_frac[DSP_VOLUME_RESOLUTION];
+
+// 表を作る(起動時に1回呼ぶ)
+void dsp_volume_init_table(void)
+{
+    for (int i = 0; i <= DSP_VOLUME_MAX_ATTEN_DB; i++)
+        volume_table_db[i] = (int32_t)lround(pow(10., -i / 10.) * DSP_VOLUME_UNITY);
+    for (int i = 0; i < DSP_VOLUME_RESOLUTION; i++)
+        volume_table_frac[i] = (int32_t)lround(pow(10., -i / (10. * DSP_VOLUME_RESOLUTION)) * DSP_VOLUME_UNITY);
+}
+
+// USBの音量(1/256dB単位 0以下)をゲイン(Q30)にする
+int32_t dsp_volume_from_db(int32_t volume)
+{
+    int32_t atten = -volume;
+    if (atten <= 0)
+        return DSP_VOLUME_UNITY;
+    if (atten >= DSP_VOLUME_MAX_ATTEN_DB * DSP_VOLUME_RESOLUTION)
+        return volume_table_db[DSP_VOLUME_MAX_ATTEN_DB];
+    int64_t gain = (int64_t)volume_table_db[atten / DSP_VOLUME_RESOLUTION] * volume_table_frac[atten % DSP_VOLUME_RESOLUTION];
+    return (int32_t)((gain + (DSP_VOLUME_UNITY >> 1)) >> 30);
+}
+
+void dsp_volume_init(DSP_VOLUME *v, int32_t gain)
+{
+    v->gain = gain;
+    v->target = gain;
+    v->step = 0;
+    v->remain = 0;
+    v->request = gain;
+}
+
+// 目標を変える(処理するコアが次のブロックから取り込む)
+void dsp_volume_request(DSP_VOLUME *v, int32_t gain)
+{
+    v->request = gain;
+}
+
+static inline int32_t scale(int32_t x, int32_t gain)
+{
+    return (int32_t)(((int64_t)x * gain) >> 30);
+}
+
+// 両chにゲインをかける(その場で書き換える) 目標が変わった場合はramp_lengthサンプルかけて直線で近づける
+// ランプの途中で次の目標が来た場合は、今のゲインからやり直す
+void __not_in_flash_func(dsp_volume_process_stereo)(DSP_VOLUME *v, int32_t *L, int32_t *R, uint32_t length, uint32_t ramp_length)
+{
+    int32_t request = v->request;
+    if (request != v->target)
+    {
+        v->target = request;
+        v->remain = (ramp_length > 0) ? ramp_length : 1;
+        v->step = (int32_t)(((int64_t)request - v->gain) / (int32_t)v->remain);
+    }
+
+    uint32_t i = 0;
+    int32_t gain = v->gain;
+    for (; (i < length) && (v->remain > 0); i++)
+    {
+        // 最後のサンプルで目標にそろえる(割り算の余りを残さない)
+        gain = (--v->remain == 0) ? v->target : gain + v->step;
+        L[i] = scale(L[i], gain);
+        R[i] = scale(R[i], gain);
+    }
+    v->gain = gain;
+
+    if (gain == DSP_VOLUME_UNITY)
+        return;
+    for (; i < length; i++)
+    {
+        L[i] = scale(L[i], gain);
+        R[i] = scale(R[i], gain);
+    }
+}
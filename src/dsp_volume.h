@@ -0,0 +1,44 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _DSP_VOLUME_H_
+#define _DSP_VOLUME_H_
+
+// 音量(固定小数点 Q30) 目標が変わったときはサンプル毎に直線のランプで近づける(段差によるクリックを出さない)
+// USBの音量(1/256dB単位)からゲインへの変換は表引き(起動時に1回作る)で、実行中にpowを使わない
+// 入力のint32にその場でかける 0dBでランプしていないときは何もしない
+// dsp_filter.cと同じくホスト(x86)でもビルドできる(DSP_HOST_BUILD)
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef DSP_HOST_BUILD
+#define __not_in_flash_func(func_name) func_name
+#else
+#include "pico.h"
+#endif
+
+#define DSP_VOLUME_UNITY (1 << 30)   // 0dB
+#define DSP_VOLUME_RESOLUTION (256)  // USBの音量の単位(1/256dB)
+#define DSP_VOLUME_MAX_ATTEN_DB (96) // 表の範囲(これより小さい音量はこの値にする)
+
+typedef struct
+{
+    int32_t gain;             // 今のゲイン(Q30)
+    int32_t target;           // ランプの目標
+    int32_t step;             // 1サンプルあたりの変化量
+    uint32_t remain;          // 目標までのサンプル数(0:ランプしていない)
+    volatile int32_t request; // 目標の要求(別コア・割り込みから書いてよい 処理するコアがブロックの区切りで取り込む)
+} DSP_VOLUME;
+
+extern void dsp_volume_init_table(void);
+extern int32_t dsp_volume_from_db(int32_t volume);
+extern void dsp_volume_init(DSP_VOLUME *v, int32_t gain);
+extern void dsp_volume_request(DSP_VOLUME *v, int32_t gain);
+extern void __not_in_flash_func(dsp_volume_process_stereo)(DSP_VOLUME *v, int32_t *L, int32_t *R, uint32_t length, uint32_t ramp_length);
+
+#endif /* _DSP_VOLUME_H_ */
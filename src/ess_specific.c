@@ -29,9 +29,9 @@ void ess_dac_i2c_setup(void)
 		sleep_ms(1);
 		}
 
-		// DPLL/ASRCバンド幅設定(ジッタが多いので少し広めに)
+		// DPLL/ASRCバンド幅設定(ジッタが多いので少し広めに MCLKを供給する場合はデフォルト)
 		i2cbuf[0] = 0x0C; // Resister 12
-		i2cbuf[1] = 0xC8; // default 0x5A, 0xB0~C8くらいから動く
+		i2cbuf[1] = MCLK_OUTPUT_ENABLE ? 0x5A : 0xC8; // default 0x5A, 0xB0~C8くらいから動く
 		i2c_write_blocking(I2C_PORT, I2C_ESS_DAC_ADDR >>1, i2cbuf, 2, true);
 		sleep_ms(1);
 	}
@@ -77,16 +77,16 @@ void ess_dac_i2c_setup(void)
 			sleep_ms(1);
 		}
 
-		// DPLLバンド幅設定(ジッタが多いので少し広めに)
+		// DPLLバンド幅設定(ジッタが多いので少し広めに MCLKを供給する場合は狭くする)
 		i2cbuf[0] = 0x0C; // Resister 12
-		i2cbuf[1] = 0xFA; // I2S:0xF, DSD:0xA(default)
+		i2cbuf[1] = MCLK_OUTPUT_ENABLE ? 0x2A : 0xFA; // I2S:0xF(MCLK供給時0x2), DSD:0xA(default)
 		i2c_write_blocking(I2C_PORT, I2C_ESS_DAC_ADDR >>1, i2cbuf, 2, true);
 		sleep_ms(1);		
 	}
 
 	else if(KIND_ESS_DAC == ES9039Q2M)
 	{
-		if((!BYPASS_CORE1_UPSAMPLING) && (!CORE0_UPSAMPLING_192K))
+		if((!BYPASS_CORE1_UPSAMPLING) && (!CORE0_UPSAMPLING_192K) && (!ONEBIT_OUTPUT_ENABLE))
 		{
 			// 768kHz入力を有効化し、DACを有効化する
 			i2cbuf[0] = 0x00; // Resister 0: SYSTEM_CONFIG
@@ -118,9 +118,9 @@ void ess_dac_i2c_setup(void)
 		i2c_write_blocking(I2C_PORT, I2C_ESS_DAC_ADDR >>1, i2cbuf, 2, true);
 		sleep_ms(1);
 
-		// DPLLバンド幅設定
+		// DPLLバンド幅設定(MCLKを供給する場合は狭くする)
 		i2cbuf[0] = 0x1D; // Resister 29: DPLL_BW
-		i2cbuf[1] = 0x30;
+		i2cbuf[1] = MCLK_OUTPUT_ENABLE ? 0x10 : 0x30;
 		i2c_write_blocking(I2C_PORT, I2C_ESS_DAC_ADDR >>1, i2cbuf, 2, true);
 		sleep_ms(1);
 	}
@@ -0,0 +1,115 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#include "filter_profile.h"
+#include "common.h"
+#include "upsampling.h"
+#include "stage_partition.h"
+#include "stream_switch.h"
+#include "peq_control.h"
+#include "room_fir_control.h"
+
+// フィルタプロファイル(係数表はupsampling_coef.c)の切り替え
+// BiQuad-IIRが同じプロファイル同士は、FIR段を処理するコアが新旧のFIRを並列に実行してクロスフェードする(出力を止めない)
+// BiQuad-IIRが異なる場合は、切り替えシーケンス(stream_switch.c)で出力をフェードアウトしてから入れ替える
+// 切り替え中はFIR段の負荷が新旧の合計になるので、各プロファイルのサイクル数から負荷を見積もり、
+// FILTER_PROFILE_LOAD_LIMITを超える場合は受け付けない
+static volatile uint8_t current_profile = FILTER_PROFILE_DEFAULT;
+
+// FIR段のサイクル数を見積もる(分割点の計算に使った計測値を、起動時のプロファイルとのサイクル数の比で換算する)
+static float get_fir_cycles(const DSP_PROFILE *profile, uint16_t rate_class)
+{
+	const DSP_PROFILE *base = &dsp_profile_table[FILTER_PROFILE_DEFAULT];
+	uint stage = (rate_class == RATE_CLASS_48K) ? STAGE_FIR_4X_0 : STAGE_FIR_2X_1;
+
+	if ((rate_class == RATE_CLASS_192K) || (base->cycles[rate_class] == 0))
+		return 0.f;
+	return get_stage_cycles(stage) * (float)profile->cycles[rate_class] / (float)base->cycles[rate_class];
+}
+
+// FIR段のサイクル数をfir_cyclesにしたときのコア負荷(‰)の見積もり(パラメトリックEQ・ルーム補正FIRの分を含む)
+// チャンネル分割モードでは各コアが1ch分ずつFIRを実行する
+static uint16_t estimate_load(float fir_cycles, uint32_t freq, bool is_high_power)
+{
+	const STAGE_PARTITION *partition = get_stage_partition(freq, is_high_power);
+	const DSP_PROFILE *base = &dsp_profile_table[FILTER_PROFILE_DEFAULT];
+	uint16_t rate_class = dsp_get_rate_class(freq);
+	uint32_t sys_clock_khz = get_clock_config(freq, is_high_power)->sys_clock_khz;
+	float load_fir = (fir_cycles - get_fir_cycles(base, rate_class)) * (float)freq / (float)sys_clock_khz;
+	float load_peq = get_peq_load(freq, is_high_power) + get_room_fir_load(freq, is_high_power);
+
+	if (CHANNEL_SPLIT_MODE)
+		return (uint16_t)MAX((float)MAX(partition->load_split_core0, partition->load_split_core1) + load_fir / 2.f + load_peq, 0.f);
+	return (uint16_t)MAX((float)partition->load_core0 + load_fir + load_peq, 0.f);
+}
+
+// プロファイルを受け付けられるか
+// 切り替え後は全レート・パワーモードで、切り替え中(新旧並列)は現在のレート・パワーモードで負荷が上限以下であること
+bool is_filter_profile_allowed(uint8_t id)
+{
+	const uint32_t base_freq[NUM_OF_RATE_FAMILY] = {44100, 48000};
+
+	if (id >= NUM_OF_DSP_PROFILE)
+		return false;
+
+	const DSP_PROFILE *profile = &dsp_profile_table[id];
+	for (uint16_t mode = 0; mode < NUM_OF_POWER_MODE; mode++)
+	{
+		for (uint16_t family = 0; family < NUM_OF_RATE_FAMILY; family++)
+		{
+			for (uint16_t rate_class = 0; rate_class < NUM_OF_RATE_CLASS; rate_class++)
+			{
+				// 起動時のプロファイルより軽い場合は調べなくてよい
+				uint32_t freq = base_freq[family] << rate_class;
+				if (get_fir_cycles(profile, rate_class) <= get_fir_cycles(&dsp_profile_table[FILTER_PROFILE_DEFAULT], rate_class))
+					continue;
+				if (estimate_load(get_fir_cycles(profile, rate_class), freq, mode == POWER_MODE_HIGH) > FILTER_PROFILE_LOAD_LIMIT)
+					return false;
+			}
+		}
+	}
+
+	const DSP_PROFILE *current = &dsp_profile_table[current_profile];
+	uint16_t rate_class = dsp_get_rate_class(audio_state.freq);
+	float cycles_switch = get_fir_cycles(profile, rate_class) + get_fir_cycles(current, rate_class);
+	return estimate_load(cycles_switch, audio_state.freq, is_high_power_mode) <= FILTER_PROFILE_LOAD_LIMIT;
+}
+
+// プロファイルの切り替えを要求する(USB割り込みから呼ばれる) 受け付けられない場合はfalse
+bool request_filter_profile(uint8_t id)
+{
+	if (id == current_profile)
+		return true;
+
+	// 前の切り替えが終わるまでは受け付けない
+	if (is_stream_switching() || is_upsampling_profile_switching())
+		return false;
+
+	if (!is_filter_profile_allowed(id))
+		return false;
+
+	const DSP_PROFILE *profile = &dsp_profile_table[id];
+	// Q31のフィルタにはクロスフェードがないので、常にフェードアウトして切り替える
+	if (!Q31_PIPELINE_MODE && dsp_is_same_biquad(profile, &dsp_profile_table[current_profile]))
+		request_upsampling_profile(profile, FILTER_PROFILE_XFADE_MS * audio_state.freq / 1000);
+	else
+		request_stream_profile(profile);
+
+	current_profile = id;
+	return true;
+}
+
+uint8_t get_filter_profile(void)
+{
+	return current_profile;
+}
+
+// 現在のプロファイルでのコア負荷(‰)の見積もり(peq_control.c, room_fir_control.cから呼ばれる)
+uint16_t get_filter_profile_load(uint32_t freq, bool is_high_power)
+{
+	return estimate_load(get_fir_cycles(&dsp_profile_table[current_profile], dsp_get_rate_class(freq)), freq, is_high_power);
+}
@@ -0,0 +1,23 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _FILTER_PROFILE_H_
+#define _FILTER_PROFILE_H_
+
+#include "pico/stdlib.h"
+#include "dsp_filter.h"
+
+// ベンダーリクエスト(デバイス宛て bmRequestType=0x40/0xC0)
+#define FILTER_PROFILE_REQ_SET (0x01) // wValue:プロファイル番号 データなし 受け付けられない場合はSTALL
+#define FILTER_PROFILE_REQ_GET (0x02) // 1byte:現在のプロファイル番号(切り替え中は切り替え先)
+
+extern bool request_filter_profile(uint8_t id);
+extern uint8_t get_filter_profile(void);
+extern bool is_filter_profile_allowed(uint8_t id);
+extern uint16_t get_filter_profile_load(uint32_t freq, bool is_high_power);
+
+#endif /* _FILTER_PROFILE_H_ */
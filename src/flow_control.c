@@ -0,0 +1,104 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#include "flow_control.h"
+
+// USB受信 → Core0 → Core1 → I2S出力のバッファ水位制御
+// 1. USB Feedback: Core0→Core1のリングバッファの水位がFB水位になるようにホストの送信レートを調整する
+// 2. Core0: 経過時間ぶんのサンプル数に±OSR_ADJ_SIZE(周期タイマーの処理でのみ)を加えて処理し、EPバッファを少しずつ水位に寄せる
+// 3. Core1: 処理周期ぶんのサンプル数ずつ取り出してDMAに渡す
+// ファームウェアとホストのシミュレータ(tools/sim)で同じ処理を使う
+
+#ifndef DSP_HOST_BUILD
+#include "common.h"
+
+FLOW_PARAM flow_param = {
+	.size_upsample = SIZE_UPSAMPLE_CORE0,
+	.fb_threshold = SIZE_BUFFER_FB_THRESHOLD,
+	.fb_adj_limit = FB_ADJ_LIMIT,
+	.osr_adj_size = OSR_ADJ_SIZE,
+	.restart_threshold = SWITCH_RESTART_THRESHOLD,
+	.timer0_us = TIMER0_US,
+	.timer_us_core1 = TIMER_US_CORE1,
+};
+#endif
+
+static inline int32_t flow_saturation(int32_t in, int32_t max, int32_t min)
+{
+	if (in > max)
+		return max;
+	else if (in < min)
+		return min;
+	return in;
+}
+
+// Feedbackの調整量(基準1000で±1サンプル/ms) ratioはCore0→Core1のリングバッファの入力に対する倍率
+int32_t __not_in_flash_func(flow_feedback_adjust)(const FLOW_PARAM *param, int32_t size_using, uint16_t ratio)
+{
+	float deviation = (param->fb_threshold - size_using) / (float)ratio;
+	return flow_saturation((int32_t)deviation, param->fb_adj_limit, -param->fb_adj_limit);
+}
+
+// Feedback値(10.14形式 サンプル/ms)
+uint32_t __not_in_flash_func(flow_feedback_value)(uint32_t feedback_fs)
+{
+	return (feedback_fs << 14) / 1000;
+}
+
+// バッファ長制限 Core0→Core1のリングバッファに入りきらない分は受け取らない(バッファオーバーラン防止)
+int32_t __not_in_flash_func(flow_limit_ep_length)(int32_t size_remain, uint16_t ratio, int32_t length, int32_t max_length)
+{
+	int32_t limit_length = flow_saturation(size_remain / ratio, max_length, 0);
+	return (length > limit_length) ? limit_length : length;
+}
+
+// Core0の処理サンプル数の増減(アップサンプリングバッファを一定水位に保つ)
+int32_t __not_in_flash_func(flow_osr_adjust)(const FLOW_PARAM *param, int32_t size_using)
+{
+	int32_t deviation = param->fb_threshold - size_using;
+	if (deviation > 0)
+		return param->osr_adj_size;
+	else if (deviation < 0)
+		return -param->osr_adj_size;
+	return 0;
+}
+
+// 前回処理からの経過時間ぶんの処理サンプル数を求める(端数は次回に持ち越す)
+// USBパケット受信でもタイマーでも処理するので、呼び出し間隔は一定ではない
+int32_t __not_in_flash_func(flow_ref_size)(const FLOW_PARAM *param, FLOW_REF_SIZE *state, uint32_t freq, uint32_t now_us)
+{
+	uint32_t elapsed_us = now_us - state->time_prev_us;
+	state->time_prev_us = now_us;
+
+	// 停止からの復帰時などに一度に処理しすぎないよう制限する
+	if (elapsed_us > param->timer0_us * 4)
+		elapsed_us = param->timer0_us * 4;
+
+	state->remain += freq * elapsed_us;
+	int32_t ref_size = state->remain / 1000000;
+	state->remain -= ref_size * 1000000;
+	return ref_size;
+}
+
+// Core1が1回に取り出すサンプル数(処理周期ぶん)
+int32_t __not_in_flash_func(flow_core1_transmit_size)(const FLOW_PARAM *param, uint32_t freq, uint16_t ratio, int32_t length)
+{
+	int32_t transmit_ref_size = freq * ratio / 1000 * (param->timer_us_core1 / 1000.0);
+	return flow_saturation(length, transmit_ref_size, 0);
+}
+
+// バッファに規定量以上のデータが溜まってから出力開始(切り替え直後は低い水位から再開する)
+// 入ってくるデータが枯渇したうえで、DMA送信バッファ内のすべてのデータを送信完了したら出力停止
+uint8_t __not_in_flash_func(flow_output_decision)(const FLOW_PARAM *param, bool restart_low_fill, int32_t length, uint32_t dma_using)
+{
+	int32_t start_threshold = restart_low_fill ? param->restart_threshold : param->fb_threshold;
+	if (length > start_threshold)
+		return FLOW_OUTPUT_START;
+	else if ((length <= 0) && (dma_using == 0))
+		return FLOW_OUTPUT_STOP;
+	return FLOW_OUTPUT_KEEP;
+}
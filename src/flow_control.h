@@ -0,0 +1,55 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _FLOW_CONTROL_H_
+#define _FLOW_CONTROL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ホスト(tools/sim)でもビルドできるようにPico SDKに依存しない
+#ifdef DSP_HOST_BUILD
+#define __not_in_flash_func(f) f
+#else
+#include "pico.h"
+#endif
+
+// バッファ水位制御のパラメータ(ファームウェアではcommon.hの値 シミュレータでは変更して試せる)
+typedef struct
+{
+	int32_t size_upsample;	   // Core0→Core1のリングバッファサイズ(SIZE_UPSAMPLE_CORE0)
+	int32_t fb_threshold;	   // FB水位(SIZE_BUFFER_FB_THRESHOLD)
+	int32_t fb_adj_limit;	   // Feedbackの調整幅(FB_ADJ_LIMIT 基準は1000)
+	int32_t osr_adj_size;	   // Core0の処理サンプル数の増減幅(OSR_ADJ_SIZE)
+	int32_t restart_threshold; // 切り替え後の出力再開水位(SWITCH_RESTART_THRESHOLD)
+	uint32_t timer0_us;		   // Core0の処理周期(TIMER0_US)
+	uint32_t timer_us_core1;   // Core1の処理周期(TIMER_US_CORE1)
+} FLOW_PARAM;
+
+// Core0の処理サンプル数を求めるための経過時間の積算
+typedef struct
+{
+	uint32_t time_prev_us;
+	uint32_t remain;
+} FLOW_REF_SIZE;
+
+// 出力の開始・停止判定
+#define FLOW_OUTPUT_KEEP (0)
+#define FLOW_OUTPUT_START (1)
+#define FLOW_OUTPUT_STOP (2)
+
+extern FLOW_PARAM flow_param;
+
+extern int32_t __not_in_flash_func(flow_feedback_adjust)(const FLOW_PARAM *param, int32_t size_using, uint16_t ratio);
+extern uint32_t __not_in_flash_func(flow_feedback_value)(uint32_t feedback_fs);
+extern int32_t __not_in_flash_func(flow_limit_ep_length)(int32_t size_remain, uint16_t ratio, int32_t length, int32_t max_length);
+extern int32_t __not_in_flash_func(flow_osr_adjust)(const FLOW_PARAM *param, int32_t size_using);
+extern int32_t __not_in_flash_func(flow_ref_size)(const FLOW_PARAM *param, FLOW_REF_SIZE *state, uint32_t freq, uint32_t now_us);
+extern int32_t __not_in_flash_func(flow_core1_transmit_size)(const FLOW_PARAM *param, uint32_t freq, uint16_t ratio, int32_t length);
+extern uint8_t __not_in_flash_func(flow_output_decision)(const FLOW_PARAM *param, bool restart_low_fill, int32_t length, uint32_t dma_using);
+
+#endif /* _FLOW_CONTROL_H_ */
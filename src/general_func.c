@@ -11,6 +11,14 @@
 #include "hardware/i2c.h"
 #include "transmit_to_dac.h"
 #include "nonblocking_i2c.h"
+#include "upsampling.h"
+#include "dsp_volume.h"
+
+#if MCLK_OUTPUT_ENABLE && ((MCLK_RATIO > 64) || (MCLK_RATIO < 4) || (64 % MCLK_RATIO != 0))
+#error "MCLK_RATIO must be 64, 32, 16, 8 or 4 (the PIO runs 128 cycles per I2S sample, MCLK half period 1..16 cycles)"
+#endif
+
+_Static_assert((VOLUME_RESOLUTION == DSP_VOLUME_RESOLUTION) && (MIN_VOLUME >= -DSP_VOLUME_MAX_ATTEN_DB * DSP_VOLUME_RESOLUTION), "volume table does not cover MIN_VOLUME");
 
 extern inline int32_t saturation_i32(int32_t in, int32_t max, int32_t min)
 {
@@ -88,7 +96,16 @@ inline uint16_t ratio_to_bitshift(uint16_t ratio)
 
 inline uint16_t get_ratio_upsampling_core1(void)
 {
-	if (is_high_power_mode && (!BYPASS_CORE1_UPSAMPLING) && (!CORE0_UPSAMPLING_192K))
+	return get_ratio_upsampling_core1_mode(is_high_power_mode);
+}
+
+uint16_t get_ratio_upsampling_core1_mode(bool is_high_power)
+{
+	if (ONEBIT_OUTPUT_ENABLE) // Core1はDelta-Sigma変調を行う
+	{
+		return 1;
+	}
+	else if (is_high_power && (!BYPASS_CORE1_UPSAMPLING) && (!CORE0_UPSAMPLING_192K))
 	{
 		return RATIO_UPSAMPLING_CORE1;
 	}
@@ -102,57 +119,104 @@ inline uint16_t get_ratio_upsampling_core1(void)
 	}
 }
 
-void renew_cpu_clock(bool is_high_power)
+// サンプルレート系列・パワーモード毎のクロック設定(起動時に事前計算する)
+static CLOCK_CONFIG clock_config_table[NUM_OF_POWER_MODE][NUM_OF_RATE_FAMILY];
+static const CLOCK_CONFIG *current_clock_config = NULL;
+
+static uint16_t get_rate_family(uint32_t freq)
 {
-	// CPUクロックを再設定
-	switch (audio_state.freq)
+	switch (freq)
 	{
 	case 192000:
 	case 96000:
 	case 48000:
-		if (is_high_power)
-		{
-			vreg_set_voltage(VREG_VOLTAGE_1_15);
-			busy_wait_us(100);
-			set_sys_clock_khz(SYS_CLOCK_KHZ_48K, true);
-		}
-		else
-		{
-			set_sys_clock_khz(SYS_CLOCK_KHZ_LP_48K, true);
-			busy_wait_us(100);
-			vreg_set_voltage(VREG_VOLTAGE_1_05);
-		}
-		break;
+		return RATE_FAMILY_48K;
 	case 176400:
 	case 88200:
 	case 44100:
 	default:
-		if (is_high_power)
-		{
-			vreg_set_voltage(VREG_VOLTAGE_1_15);
-			busy_wait_us(100);
-			set_sys_clock_khz(SYS_CLOCK_KHZ_44K, true);
-		}
-		else
+		return RATE_FAMILY_44K;
+	}
+}
+
+void init_clock_config_table(void)
+{
+	const uint32_t base_freq[NUM_OF_RATE_FAMILY] = {44100, 48000};
+	const uint32_t sys_clock_khz[NUM_OF_POWER_MODE][NUM_OF_RATE_FAMILY] = {
+		{SYS_CLOCK_KHZ_LP_44K, SYS_CLOCK_KHZ_LP_48K},
+		{SYS_CLOCK_KHZ_44K, SYS_CLOCK_KHZ_48K}};
+	const uint32_t vreg_voltage[NUM_OF_POWER_MODE] = {VREG_VOLTAGE_1_05, VREG_VOLTAGE_1_15};
+
+	for (uint16_t mode = 0; mode < NUM_OF_POWER_MODE; mode++)
+	{
+		for (uint16_t family = 0; family < NUM_OF_RATE_FAMILY; family++)
 		{
-			set_sys_clock_khz(SYS_CLOCK_KHZ_LP_44K, true);
-			busy_wait_us(100);
-			vreg_set_voltage(VREG_VOLTAGE_1_05);
+			// 同一系列ではI2S出力周波数は入力周波数によらず一定になる
+			uint32_t i2s_freq = base_freq[family] * get_ratio_upsampling_core0(base_freq[family]) * get_ratio_upsampling_core1_mode(mode == POWER_MODE_HIGH);
+			CLOCK_CONFIG *config = &clock_config_table[mode][family];
+			config->sys_clock_khz = sys_clock_khz[mode][family];
+			config->vreg_voltage = vreg_voltage[mode];
+			config->i2s_freq = i2s_freq;
+
+			// S/PDIFの分周率をこれの整数倍で作れるように、固定小数点(8bit小数部)で持つ
+			uint32_t div_fixed = (uint32_t)(((uint64_t)config->sys_clock_khz * 1000u << 8u) / (i2s_freq << 7u));
+			config->i2s_clkdiv_int = div_fixed >> 8u;
+			config->i2s_clkdiv_frac = div_fixed & 0xffu;
+
+			// MCLKはI2S出力周波数(DACが受け取るLRCK)のMCLK_RATIO倍 I2SのPIOは1サンプル128サイクルなので半周期は整数になる(範囲は#errorで確認済み)
+			config->mclk_half_period = (i2s_freq * 128u) / (2u * i2s_freq * MCLK_RATIO);
 		}
-		break;
+	}
+
+	// 起動時は HiPowerMode 44.1kHz系列で動作している
+	current_clock_config = &clock_config_table[POWER_MODE_HIGH][RATE_FAMILY_44K];
+}
+
+const CLOCK_CONFIG *get_clock_config(uint32_t freq, bool is_high_power)
+{
+	return &clock_config_table[is_high_power ? POWER_MODE_HIGH : POWER_MODE_LOW][get_rate_family(freq)];
+}
+
+// クロック(CPU・I2S)の再設定が必要かどうか
+bool is_clock_config_changed(uint32_t freq, bool is_high_power)
+{
+	return get_clock_config(freq, is_high_power) != current_clock_config;
+}
+
+static void renew_cpu_clock(const CLOCK_CONFIG *config)
+{
+	// 電圧を上げる場合はクロック変更前に、下げる場合はクロック変更後に設定する
+	if (config->vreg_voltage >= current_clock_config->vreg_voltage)
+	{
+		vreg_set_voltage(config->vreg_voltage);
+		busy_wait_us(100);
+		set_sys_clock_khz(config->sys_clock_khz, true);
+	}
+	else
+	{
+		set_sys_clock_khz(config->sys_clock_khz, true);
+		busy_wait_us(100);
+		vreg_set_voltage(config->vreg_voltage);
 	}
 }
 
 void renew_clock(bool is_high_power)
 {
-	// Core0の割り込みタイマを停止
-	cancel_timer0();
+	const CLOCK_CONFIG *config = get_clock_config(audio_state.freq, is_high_power);
 
-	// CPUクロックを再設定
-	renew_cpu_clock(is_high_power);
+	// システムクロックが変わる場合のみPLLを再設定する(44.1kHz系と48kHz系でLowPowerModeのクロックは共通)
+	if ((config->sys_clock_khz != current_clock_config->sys_clock_khz) || (config->vreg_voltage != current_clock_config->vreg_voltage))
+	{
+		// Core0の割り込みタイマを停止
+		cancel_timer0();
 
-	// Core0の割り込みタイマを再開
-	restart_timer0();
+		// CPUクロックを再設定
+		renew_cpu_clock(config);
+
+		// Core0の割り込みタイマを再開
+		restart_timer0();
+	}
+	current_clock_config = config;
 
 	// DMAをクリア
 	dma_stop_and_clear();
@@ -174,10 +238,11 @@ void setup_I2C(void)
 	i2c_dma_initialize(I2C_PORT);
 }
 
+// 音量・ミュートからゲインを表引きで求め(powは使わない)、アップサンプリングに設定する
+// USBの要求を受けたときと50ms毎に呼ぶ(割り込みから呼んでよい) 変化は入力でランプしてかける ミュートは0へのランプ
 void volume_control(void)
 {
-	//static float volume_slow = MIN_VOLUME;
-	//volume_slow += ((float)audio_state.acq_volume - volume_slow) * 0.85;
-
-	audio_state.vol_float = saturation_f32(pow(10, (float)audio_state.acq_volume / VOLUME_RESOLUTION / 10.0), 1.0, 0);
+	int32_t gain = dsp_volume_from_db(audio_state.acq_volume);
+	audio_state.vol_float = (float)gain / DSP_VOLUME_UNITY;
+	set_upsampling_volume(audio_state.mute ? 0 : gain);
 }
\ No newline at end of file
@@ -7,6 +7,7 @@
 
 #include "i2s_pio_interface.h"
 #include "common.h"
+#include "delta_sigma.h"
 
 // PIO
 
@@ -96,8 +97,115 @@ void I2S_freq_init(PIO pio, uint sm, pio_sm_config *sm_config, uint offset)
 {
 	pio_sm_set_enabled(pio, sm, false);
 
-	float div = (float)clock_get_hz(clk_sys) / (float)((audio_state.freq * get_ratio_upsampling_core0(audio_state.freq) * get_ratio_upsampling_core1()) << 7u);
-	sm_config_set_clkdiv(sm_config, div);
+	// 分周率はサンプルレート系列・パワーモード毎に事前計算したものを使う
+	const CLOCK_CONFIG *config = get_clock_config(audio_state.freq, is_high_power_mode);
+	sm_config_set_clkdiv_int_frac(sm_config, config->i2s_clkdiv_int, config->i2s_clkdiv_frac);
 	pio_sm_init(pio, sm, offset, sm_config);
 	pio_sm_set_enabled(pio, sm, true);
+}
+
+// Delta-Sigma出力 I2SのSM0の代わりに使う(分周率はSDM_freq_initで設定する)
+void SDM_2ch_program_init(PIO pio, uint sm, uint out_pin_base, pio_sm_config *sm_config_out, uint *offset_out)
+{
+	uint offset = pio_add_program(pio, &SDM_2ch_program);
+	pio_sm_config sm_config = SDM_2ch_program_get_default_config(offset);
+
+	pio_gpio_init(pio, out_pin_base);
+	pio_gpio_init(pio, out_pin_base + 1);
+
+	pio_sm_set_consecutive_pindirs(pio, sm, out_pin_base, 2, true);
+	sm_config_set_fifo_join(&sm_config, PIO_FIFO_JOIN_TX); // RX FIFOを無効にして2倍のTX FIFOを使用する
+
+	sm_config_set_out_pins(&sm_config, out_pin_base, 2);
+	sm_config_set_out_shift(&sm_config, true, false, 32); // LSBから送信、pullはプログラム側で行う
+
+	*sm_config_out = sm_config;
+	*offset_out = offset;
+
+	SDM_freq_init(pio, sm, sm_config_out, offset);
+}
+
+// DSD出力 データはSDMと同じ形式で、サイドセットでDSDクロックを出す
+void DSD_2ch_program_init(PIO pio, uint sm, uint data_pin_base, uint clk_pin, pio_sm_config *sm_config_out, uint *offset_out)
+{
+	uint offset = pio_add_program(pio, &DSD_2ch_program);
+	pio_sm_config sm_config = DSD_2ch_program_get_default_config(offset);
+
+	pio_gpio_init(pio, data_pin_base);
+	pio_gpio_init(pio, data_pin_base + 1);
+	pio_gpio_init(pio, clk_pin);
+
+	pio_sm_set_consecutive_pindirs(pio, sm, data_pin_base, 2, true);
+	pio_sm_set_consecutive_pindirs(pio, sm, clk_pin, 1, true);
+	sm_config_set_fifo_join(&sm_config, PIO_FIFO_JOIN_TX); // RX FIFOを無効にして2倍のTX FIFOを使用する
+
+	sm_config_set_out_pins(&sm_config, data_pin_base, 2);
+	sm_config_set_sideset_pins(&sm_config, clk_pin);
+	sm_config_set_out_shift(&sm_config, true, false, 32); // LSBから送信、pullはプログラム側で行う
+
+	*sm_config_out = sm_config;
+	*offset_out = offset;
+
+	SDM_freq_init(pio, sm, sm_config_out, offset);
+}
+
+// 1bit出力(Delta-Sigma/DSD)の分周率を設定する
+// I2Sは1サンプル128サイクル、1bit出力は1サンプル2サイクル x 出力ビット数なので、I2Sの分周率の整数倍で作れる
+void SDM_freq_init(PIO pio, uint sm, pio_sm_config *sm_config, uint offset)
+{
+	pio_sm_set_enabled(pio, sm, false);
+
+	const CLOCK_CONFIG *config = get_clock_config(audio_state.freq, is_high_power_mode);
+	uint32_t div_fixed = (((uint32_t)config->i2s_clkdiv_int << 8u) | config->i2s_clkdiv_frac) * (128u / 2u) / ONEBIT_BITS_PER_SAMPLE;
+	sm_config_set_clkdiv_int_frac(sm_config, div_fixed >> 8u, div_fixed & 0xffu);
+	pio_sm_init(pio, sm, offset, sm_config);
+
+	// FIFOが空のときに出すアイドルパターンをXレジスタに入れ、OSRにもロードしておく
+	pio_sm_put(pio, sm, DSD_OUTPUT_ENABLE ? DSD_IDLE_PATTERN : SDM_IDLE_PATTERN);
+	pio_sm_exec(pio, sm, pio_encode_pull(false, true));
+	pio_sm_exec(pio, sm, pio_encode_mov(pio_x, pio_osr));
+
+	pio_sm_set_enabled(pio, sm, true);
+}
+
+// MCLK出力 I2Sと同じ分周率で動かし、半周期をPIOのサイクル数(サイドセットの遅延)で作る
+// 周期がサンプルレート系列・パワーモードで変わるので、命令はその都度生成する
+static uint16_t mclk_program_instructions[2];
+static const pio_program_t mclk_program = {
+	.instructions = mclk_program_instructions,
+	.length = 2,
+	.origin = -1,
+};
+static int mclk_offset = -1;
+
+void MCLK_program_init(PIO pio, uint sm, uint pin)
+{
+	pio_gpio_init(pio, pin);
+	pio_sm_set_consecutive_pindirs(pio, sm, pin, 1, true);
+}
+
+// I2S(または1bit出力)のSMと同時にクロック分周器をリスタートして、位相を揃える
+void MCLK_freq_init(PIO pio, uint sm, uint pin, uint i2s_sm)
+{
+	const CLOCK_CONFIG *config = get_clock_config(audio_state.freq, is_high_power_mode);
+	uint32_t sm_mask = (1u << sm) | (1u << i2s_sm);
+
+	pio_set_sm_mask_enabled(pio, sm_mask, false);
+
+	// サイドセット1bitなので遅延は最大15(半周期16サイクル)
+	if (mclk_offset >= 0)
+		pio_remove_program(pio, &mclk_program, mclk_offset);
+	uint delay = config->mclk_half_period - 1;
+	mclk_program_instructions[0] = pio_encode_nop() | pio_encode_sideset(1, 1) | pio_encode_delay(delay);
+	mclk_program_instructions[1] = pio_encode_nop() | pio_encode_sideset(1, 0) | pio_encode_delay(delay);
+	mclk_offset = pio_add_program(pio, &mclk_program);
+
+	pio_sm_config sm_config = pio_get_default_sm_config();
+	sm_config_set_wrap(&sm_config, mclk_offset, mclk_offset + 1);
+	sm_config_set_sideset(&sm_config, 1, false, false);
+	sm_config_set_sideset_pins(&sm_config, pin);
+	sm_config_set_clkdiv_int_frac(&sm_config, config->i2s_clkdiv_int, config->i2s_clkdiv_frac);
+	pio_sm_init(pio, sm, mclk_offset, &sm_config);
+
+	pio_enable_sm_mask_in_sync(pio, sm_mask);
 }
\ No newline at end of file
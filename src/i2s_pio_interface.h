@@ -12,9 +12,20 @@
 #include "i2s.pio.h"
 #include "hardware/clocks.h"
 
+// Delta-Sigma出力のアイドルパターン(L/Rとも1010... 平均して0になる)
+#define SDM_IDLE_PATTERN (0x33333333u)
+
+// DSD出力のミュートパターン(L/Rとも0x69の繰り返し)
+#define DSD_IDLE_PATTERN (0xc33cc33cu)
+
 extern void I2S_16bit_program_init(PIO pio, uint sm, uint data_pin, uint sideset_base, uint freq, pio_sm_config *sm_config_out, uint *offset_out);
 extern void I2S_32bit_program_init(PIO pio, uint sm, uint data_pin, uint sideset_base, uint freq, pio_sm_config *sm_config_out, uint *offset_out);
 extern void I2S_32bit_inv_program_init(PIO pio, uint sm, uint data_pin, uint sideset_base, uint freq, pio_sm_config *sm_config_out, uint *offset_out);
 extern void I2S_freq_init(PIO pio, uint sm, pio_sm_config *sm_config, uint offset);
+extern void SDM_2ch_program_init(PIO pio, uint sm, uint out_pin_base, pio_sm_config *sm_config_out, uint *offset_out);
+extern void DSD_2ch_program_init(PIO pio, uint sm, uint data_pin_base, uint clk_pin, pio_sm_config *sm_config_out, uint *offset_out);
+extern void MCLK_program_init(PIO pio, uint sm, uint pin);
+extern void MCLK_freq_init(PIO pio, uint sm, uint pin, uint i2s_sm);
+extern void SDM_freq_init(PIO pio, uint sm, pio_sm_config *sm_config, uint offset);
 
 #endif /* _I2S_PIO_INTERFACE_H_ */
\ No newline at end of file
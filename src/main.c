@@ -25,8 +25,18 @@
 #include "transmit_to_dac.h"
 #include "upsampling.h"
 #include "ringbuffer.h"
-#include "debug_with_gpio.h"
 #include "ess_specific.h"
+#include "stream_switch.h"
+#include "spdif_output.h"
+#include "scheduler.h"
+#include "core_handoff.h"
+#include "deferred_work.h"
+#include "stage_partition.h"
+#include "channel_split.h"
+#include "profiler.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "peq_control.h"
 
 // パワー管理
 volatile bool is_high_power_mode = true;
@@ -35,8 +45,7 @@ volatile bool is_high_power_mode = true;
 #define MILLISEC50 (500000 / TIMER0_US)
 
 // タイマー割り込み
-struct repeating_timer timer0; // デジタルフィルタ演算を割り込みでトリガする
-volatile bool can_proceed_upsampling_core0 = false;
+struct repeating_timer timer0; // デジタルフィルタ演算をイベントで起動する
 
 // ring buffer
 RINGBUFFER buffer_ep_Lch;
@@ -54,6 +63,7 @@ static bool is_cleared_buffer = false;
 volatile absolute_time_t time_start_output;
 
 bool __not_in_flash_func(core0_timer_callback)(struct repeating_timer *t);
+static void core0_periodic_work(void);
 
 // Core1メイン
 extern void core1_main();
@@ -68,16 +78,27 @@ void cancel_timer0(void)
 
 void restart_timer0(void)
 {
+	irq_stat_timer_restarted();
 	add_repeating_timer_us(-TIMER0_US, core0_timer_callback, NULL, &timer0);
 }
 
 // アップサンプリング処理のタイミングをセットする
 bool __not_in_flash_func(core0_timer_callback)(struct repeating_timer *t)
 {
-	can_proceed_upsampling_core0 = true;
+	uint32_t start_us = time_us_32();
+	irq_stat_record_timer_period();
+	trace_event(TRACE_ID_TIMER0, 0);
+
+	// USBパケットが途切れても処理が止まらないよう、両コアに周期イベントを送る
+	sched_post(0, SCHED_EVENT_TIMER);
+	sched_post(1, SCHED_EVENT_TIMER);
+
+	// サンプルレート・パワーモード切り替えシーケンス(クロック再設定を含むのでスレッド側で行う)
+	if (is_stream_switching())
+		defer_work(stream_switch_process, DEFERRED_PRIORITY_HIGH);
 
 	// ES9038Q2Mの周波数切り替え時のノイズ対策
-	if(USE_ESS_DAC && KIND_ESS_DAC == ES9038Q2M && get_ess_dac_mute())
+	if(USE_ESS_DAC && KIND_ESS_DAC == ES9038Q2M && get_ess_dac_mute() && (!is_stream_switching()))
 	{
 		if(enable_output)
 		{
@@ -89,70 +110,117 @@ bool __not_in_flash_func(core0_timer_callback)(struct repeating_timer *t)
 		}
 	}
 
-	//volatile static uint32_t now_playing_old = 0;
+	// 50ms毎の定期処理はスレッド側で行う
 	static volatile int count = 0;
 	count++;
 	if (count >= MILLISEC50)
 	{
-		// パワーモード切り替え
-		if ((gpio_get(POWER_MODE_SWITCH_PIN) || ALWAYS_HIGH_POWER) && (!ALWAYS_LOW_POWER) && (!BYPASS_CORE1_UPSAMPLING) && (!CORE0_UPSAMPLING_192K))
-		{
-			// HiPowerMode
-			if (!is_high_power_mode)
-			{
-				is_high_power_mode = true;
-				if(USE_ESS_DAC && KIND_ESS_DAC == ES9038Q2M)
-					ess_dac_mute();
-				clear_ringbuffer(&buffer_ep_Lch);
-				clear_ringbuffer(&buffer_ep_Rch);
-				clear_ringbuffer(&buffer_upsr_data_Lch_0);
-				clear_ringbuffer(&buffer_upsr_data_Rch_0);
-				clear_bq_filter_delay();
-				renew_clock(is_high_power_mode);
-			}
-		}
-		else
-		{
-			// LoPowerMode
-			if (is_high_power_mode)
-			{
-				is_high_power_mode = false;
-				if(USE_ESS_DAC && KIND_ESS_DAC == ES9038Q2M)
-					ess_dac_mute();
-				clear_ringbuffer(&buffer_ep_Lch);
-				clear_ringbuffer(&buffer_ep_Rch);
-				clear_ringbuffer(&buffer_upsr_data_Lch_0);
-				clear_ringbuffer(&buffer_upsr_data_Rch_0);
-				clear_bq_filter_delay();
-				renew_clock(is_high_power_mode);
-			}
-		}
+		defer_work(core0_periodic_work, DEFERRED_PRIORITY_NORMAL);
+		count = 0;
+	}
+
+	irq_stat_record(IRQ_ID_TIMER0, start_us);
+	return true;
+}
 
-		gpio_put(ONBOARD_LED_PIN, is_high_power_mode);
+// 50ms毎の定期処理(遅延処理キューから実行される)
+static void core0_periodic_work(void)
+{
+	// パワーモード切り替え(フェードアウト後にクロックを再設定する)
+	bool request_high_power = (gpio_get(POWER_MODE_SWITCH_PIN) || ALWAYS_HIGH_POWER) && (!ALWAYS_LOW_POWER) && (!BYPASS_CORE1_UPSAMPLING) && (!CORE0_UPSAMPLING_192K);
+	if (ONEBIT_OUTPUT_ENABLE)
+		request_high_power = !ALWAYS_LOW_POWER;
+	if ((request_high_power != is_high_power_mode) && (!is_stream_switching()))
+	{
+		request_stream_reconfigure(audio_state.freq, request_high_power);
+	}
 
-		volume_control();
+	gpio_put(ONBOARD_LED_PIN, is_high_power_mode);
 
-		// 再生停止時にアップサンプリングフラグとバッファをクリアする
-		if ((now_playing == now_playing_old) && (!is_cleared_buffer))
-		{
-			clear_ringbuffer(&buffer_ep_Lch);
-			clear_ringbuffer(&buffer_ep_Rch);
-			clear_ringbuffer(&buffer_upsr_data_Lch_0);
-			clear_ringbuffer(&buffer_upsr_data_Rch_0);
-			clear_bq_filter_delay();
-			renew_clock(is_high_power_mode);
-			now_playing = 0;
-			is_cleared_buffer = true;
-		}
-		else if(now_playing != now_playing_old)
-		{
-			is_cleared_buffer = false;
-		}
-		now_playing_old = now_playing;
+	volume_control();
 
-		count = 0;
+	// パラメトリックEQの設定・サンプルレートが変わっていれば係数を計算し直す
+	if (PEQ_ENABLE)
+		peq_poll();
+
+	// 処理段毎のサイクル数の統計をUARTに出力する
+	static uint32_t count_report = 0;
+	if (PROFILE_ENABLE && (++count_report >= PROFILE_REPORT_INTERVAL_MS / 50))
+	{
+		profile_report();
+		count_report = 0;
 	}
-	return true;
+
+	// ホストから要求されていればテレメトリを送る
+	if (TELEMETRY_ENABLE)
+		telemetry_poll();
+
+	// 誰も読み出していなければトレースを捨てる
+	if (TRACE_ENABLE)
+		trace_poll();
+
+	// 再生停止時にアップサンプリングフラグとバッファをクリアする
+	if ((now_playing == now_playing_old) && (!is_cleared_buffer) && (!is_stream_switching()))
+	{
+		clear_ringbuffer(&buffer_ep_Lch);
+		clear_ringbuffer(&buffer_ep_Rch);
+		clear_ringbuffer(&buffer_upsr_data_Lch_0);
+		clear_ringbuffer(&buffer_upsr_data_Rch_0);
+		handoff_reset();
+		clear_bq_filter_delay();
+		renew_clock(is_high_power_mode);
+		now_playing = 0;
+		is_cleared_buffer = true;
+	}
+	else if(now_playing != now_playing_old)
+	{
+		is_cleared_buffer = false;
+	}
+	now_playing_old = now_playing;
+}
+
+// Core0のアップサンプリング処理(タイマー・USBパケット受信イベントで実行する)
+// adjust_flow: 水位の調整(±OSR_ADJ_SIZE)をする(タイマーイベントのみ)
+static void __not_in_flash_func(core0_upsampling)(bool adjust_flow)
+{
+	uint32_t write_point = get_write_point(&buffer_upsr_data_Lch_0);
+
+	trace_event(TRACE_ID_CORE0_BEGIN, get_size_using(&buffer_ep_Lch));
+	uint32_t prof = profile_start();
+	upsampling_process_core0(adjust_flow);
+	profile_end(PROF_CORE0_TOTAL, prof);
+
+	// Core1からの解放通知を取り込む
+	handoff_poll();
+
+	// 書き込んだブロックをCore1に通知する
+	uint32_t length = (get_write_point(&buffer_upsr_data_Lch_0) + SIZE_UPSAMPLE_CORE0 - write_point) % SIZE_UPSAMPLE_CORE0;
+	if (length > 0)
+	{
+		handoff_send_block(write_point, length);
+		sched_post(1, SCHED_EVENT_DATA_READY);
+	}
+	trace_event(TRACE_ID_CORE0_END, length);
+
+	// 計測結果・トレースをUARTに少しずつ送る(UARTを共用する場合はトレースのレコードの区切りで切り替える)
+	if (PROFILE_ENABLE && !(TRACE_ENABLE && TRACE_OUTPUT_UART && trace_uart_busy()))
+		profile_uart_poll();
+	if (TRACE_ENABLE && TRACE_OUTPUT_UART)
+		trace_uart_poll();
+
+	// テレメトリ・トレースのUSB送信待ちを処理する
+	if (TELEMETRY_ENABLE)
+		telemetry_usb_poll();
+}
+
+static void __not_in_flash_func(core0_timer_handler)(void)
+{
+	core0_upsampling(true);
+}
+
+static void __not_in_flash_func(core0_usb_rx_handler)(void)
+{
+	core0_upsampling(false);
 }
 
 int main(void)
@@ -164,8 +232,15 @@ int main(void)
 	set_sys_clock_khz(SYS_CLOCK_KHZ_44K, true);
 	sleep_ms(2);
 
+	// サンプルレート系列・パワーモード毎のクロック設定を事前計算
+	init_clock_config_table();
+
 	stdout_uart_init();
 
+	// トレースは両コアの処理開始前に初期化する
+	if (TRACE_ENABLE)
+		init_trace();
+
 	// 各種バッファ初期化
 	initialize_ringbuffer(SIZE_EP_BUFFER, true, &buffer_ep_Lch);				// USB EP受け取り用
 	initialize_ringbuffer(SIZE_EP_BUFFER, true, &buffer_ep_Rch);				// USB EP受け取り用
@@ -202,6 +277,15 @@ int main(void)
 		sleep_ms(10);
 	}
 
+	// イベントスケジューラを初期化する(Core1起動前に行う)
+	init_scheduler();
+	init_core_handoff();
+	init_deferred_work();
+	if (CHANNEL_SPLIT_MODE)
+		init_channel_split();
+	sched_register(0, SCHED_EVENT_TIMER, core0_timer_handler);
+	sched_register(0, SCHED_EVENT_USB_RX, core0_usb_rx_handler);
+
 	// アップサンプリング処理用Timer割り込みをアタッチする
 	add_repeating_timer_us(-TIMER0_US, core0_timer_callback, NULL, &timer0);
 
@@ -222,20 +306,24 @@ int main(void)
 	// アップサンプリングフィルタを初期化する
 	init_upsampling_filter();
 
+	// 各処理段のサイクル数を計測し、レート・パワーモード毎のCore0/Core1の分割点を決める
+	init_stage_partition();
+
+	// 処理段毎のサイクル数計測を開始する(上の計測分は含めない)
+	if (PROFILE_ENABLE)
+		init_profiler();
+
+	if (TELEMETRY_ENABLE)
+		init_telemetry();
+	// S/PDIF出力を初期化する(DMA割り込みはCore0で処理する)
+	if (SPDIF_OUTPUT_ENABLE)
+		init_spdif_output();
+
 	usb_sound_card_init();
 	sleep_ms(100);
 
 	// watchdog_enable(50, 1);
 
-	while (true)
-	{
-		// watchdog_update();
-
-		if (can_proceed_upsampling_core0)
-		{
-			can_proceed_upsampling_core0 = false;
-			upsampling_process_core0();
-		}
-		sleep_us(1);
-	}
+	// イベントが来るまでWFEで眠り、来たら処理する
+	sched_run();
 }
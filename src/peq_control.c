@@ -0,0 +1,142 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "peq_control.h"
+#include "common.h"
+#include "upsampling.h"
+#include "stage_partition.h"
+#include "filter_profile.h"
+
+// パラメトリックEQ(演算はdsp_peq.c)の設定
+// USBのベンダーリクエストでバンドを1つずつ書き込み(PEQ_REQ_SET_BAND)、PEQ_REQ_COMMITでまとめて反映する
+// 係数の計算は50ms毎の定期処理(peq_poll)で行い、EQを実行するコアがブロックの区切りで係数バンクを入れ替える
+// 係数はサンプルレートに依存するので、レートが変わった場合も計算し直す(入力のナイキスト周波数以上のバンドは使わない)
+static DSP_PEQ_BAND peq_band[NUM_OF_CH][DSP_PEQ_MAX_BAND];
+static volatile uint8_t peq_num_band[NUM_OF_CH] = {0, 0};
+static volatile bool peq_dirty = false;
+static uint32_t peq_designed_freq = 0;
+
+// EQの段数がnum_L, num_Rのときに負荷の最も大きいコアに増える負荷(‰)
+// チャンネル分割モードでは各コアが1ch分ずつEQを実行する
+static float calc_peq_load(uint num_L, uint num_R, uint32_t freq, bool is_high_power)
+{
+	uint32_t sys_clock_khz = get_clock_config(freq, is_high_power)->sys_clock_khz;
+	float load_section = get_stage_cycles(STAGE_PEQ_SECTION) / 2.f * (float)freq / (float)sys_clock_khz;
+
+	if (CHANNEL_SPLIT_MODE)
+		return load_section * (float)MAX(num_L, num_R);
+	return load_section * (float)(num_L + num_R);
+}
+
+// 現在反映しているEQの負荷(‰ filter_profile.cの負荷の見積もりにも使う)
+float get_peq_load(uint32_t freq, bool is_high_power)
+{
+	return calc_peq_load(peq_num_band[0], peq_num_band[1], freq, is_high_power);
+}
+
+// バンドの設定を書き込む(USB割り込みから呼ばれる 反映はcommit_peq) 範囲外の場合はfalse
+bool set_peq_band(uint8_t ch_mask, uint8_t index, const PEQ_BAND_PACKET *packet)
+{
+	if ((index >= DSP_PEQ_MAX_BAND) || (packet->type >= NUM_OF_DSP_PEQ_TYPE) || ((ch_mask & (PEQ_CH_L | PEQ_CH_R)) == 0))
+		return false;
+	if ((packet->type != DSP_PEQ_OFF) && ((packet->freq == 0) || (packet->q == 0) || (abs(packet->gain) > 3000)))
+		return false;
+
+	DSP_PEQ_BAND band = {
+		.type = packet->type,
+		.freq = (float)packet->freq,
+		.q = (float)packet->q / 100.f,
+		.gain_db = (float)packet->gain / 100.f,
+	};
+	for (uint ch = 0; ch < NUM_OF_CH; ch++)
+	{
+		if (ch_mask & (1u << ch))
+			peq_band[ch][index] = band;
+	}
+	return true;
+}
+
+// 書き込んだバンドのうち先頭からnum_band個を反映する(USB割り込みから呼ばれる)
+// 全レート・パワーモードで負荷の見積もりがFILTER_PROFILE_LOAD_LIMITを超える場合はfalse
+bool commit_peq(uint8_t ch_mask, uint8_t num_band)
+{
+	const uint32_t base_freq[NUM_OF_RATE_FAMILY] = {44100, 48000};
+
+	if ((num_band > DSP_PEQ_MAX_BAND) || ((ch_mask & (PEQ_CH_L | PEQ_CH_R)) == 0))
+		return false;
+
+	uint num_L = (ch_mask & PEQ_CH_L) ? num_band : peq_num_band[0];
+	uint num_R = (ch_mask & PEQ_CH_R) ? num_band : peq_num_band[1];
+	for (uint16_t mode = 0; mode < NUM_OF_POWER_MODE; mode++)
+	{
+		for (uint16_t family = 0; family < NUM_OF_RATE_FAMILY; family++)
+		{
+			for (uint16_t rate_class = 0; rate_class < NUM_OF_RATE_CLASS; rate_class++)
+			{
+				uint32_t freq = base_freq[family] << rate_class;
+				bool is_high_power = (mode == POWER_MODE_HIGH);
+				float load = (float)get_filter_profile_load(freq, is_high_power) - get_peq_load(freq, is_high_power) + calc_peq_load(num_L, num_R, freq, is_high_power);
+				if (load > FILTER_PROFILE_LOAD_LIMIT)
+					return false;
+			}
+		}
+	}
+
+	peq_num_band[0] = num_L;
+	peq_num_band[1] = num_R;
+	peq_dirty = true;
+	return true;
+}
+
+// Lchの段数 | Rchの段数 << 8 | 1段あたりのサイクル数 << 16 (PEQ_REQ_GET)
+uint32_t get_peq_info(void)
+{
+	uint32_t cycles = (uint32_t)(get_stage_cycles(STAGE_PEQ_SECTION) + 0.5f);
+	return get_upsampling_peq_sections(0) | (get_upsampling_peq_sections(1) << 8) | (MIN(cycles, 0xffffu) << 16);
+}
+
+// 設定・サンプルレートが変わっていれば係数を計算して入れ替えを要求する(50ms毎の定期処理から呼ぶ)
+void peq_poll(void)
+{
+	static DSP_PEQ_BAND band[NUM_OF_CH][DSP_PEQ_MAX_BAND];
+	uint8_t num_band[NUM_OF_CH];
+	uint32_t freq = audio_state.freq;
+
+	if ((!peq_dirty) && (freq == peq_designed_freq))
+		return;
+
+	// 前の入れ替えが取り込まれるまで待つ(両chを同じブロックで入れ替えられるようにする)
+	if (is_upsampling_peq_pending())
+		return;
+
+	// USB割り込みで書き換えられないよう、まとめて取り出す
+	uint32_t save = save_and_disable_interrupts();
+	memcpy(band, peq_band, sizeof(band));
+	num_band[0] = peq_num_band[0];
+	num_band[1] = peq_num_band[1];
+	peq_dirty = false;
+	restore_interrupts(save);
+
+	for (uint ch = 0; ch < NUM_OF_CH; ch++)
+	{
+		for (uint i = 0; i < num_band[ch]; i++)
+		{
+			if (band[ch][i].freq >= (float)freq * 0.5f)
+				band[ch][i].type = DSP_PEQ_OFF;
+		}
+	}
+
+	// 両chの係数を計算できなければどちらも入れ替えず、次の周期でやり直す
+	if (!set_upsampling_peq(band, num_band, freq))
+	{
+		peq_dirty = true;
+		return;
+	}
+	peq_designed_freq = freq;
+}
@@ -0,0 +1,38 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _PEQ_CONTROL_H_
+#define _PEQ_CONTROL_H_
+
+#include "pico/stdlib.h"
+#include "dsp_filter.h"
+
+// ベンダーリクエスト(デバイス宛て bmRequestType=0x40/0xC0 FILTER_PROFILE_REQ_xxxの続き)
+#define PEQ_REQ_SET_BAND (0x03) // wIndex:チャンネル(bit0:L bit1:R)<<8 | バンド番号 データ:PEQ_BAND_PACKET 範囲外の場合はSTALL
+#define PEQ_REQ_COMMIT (0x04)	// wIndex:チャンネル<<8 wValue:バンド数 データなし 負荷の見積もりが上限を超える場合はSTALL
+#define PEQ_REQ_GET (0x05)		// 4byte:Lchの段数, Rchの段数, 1段あたりのサイクル数(uint16 ステレオ入力1サンプルあたり)
+
+#define PEQ_CH_L (0x01)
+#define PEQ_CH_R (0x02)
+
+// PEQ_REQ_SET_BANDのデータ(リトルエンディアン)
+typedef struct __packed
+{
+	uint8_t type; // DSP_PEQ_xxx
+	uint8_t reserved;
+	uint16_t freq; // Hz
+	uint16_t q;	   // 1/100
+	int16_t gain;  // 1/100 dB
+} PEQ_BAND_PACKET;
+
+extern bool set_peq_band(uint8_t ch_mask, uint8_t index, const PEQ_BAND_PACKET *packet);
+extern bool commit_peq(uint8_t ch_mask, uint8_t num_band);
+extern uint32_t get_peq_info(void);
+extern float get_peq_load(uint32_t freq, bool is_high_power);
+extern void peq_poll(void);
+
+#endif /* _PEQ_CONTROL_H_ */
@@ -0,0 +1,139 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "profiler.h"
+#include "common.h"
+#include "upsampling.h"
+#include "stage_partition.h"
+#include "hardware/clocks.h"
+#include "hardware/uart.h"
+
+// 処理段毎の実行サイクル数をDWTのサイクルカウンタ(CYCCNT コア毎にある)で計測し、
+// 最小・平均・最大と2のべき乗区間のヒストグラムを記録する。
+// 統計はコア毎に持つので、同じ処理段を両コアで実行しても(チャンネル分割モード・段の分割)ロックは不要。
+// 結果はテキストにしてUARTのFIFOに少しずつ流し込む(printfで待たないよう、Core0の処理を止めない)。
+
+static PROF_STAT prof_stat[2][NUM_OF_PROF_ID];
+
+static const char *prof_name[NUM_OF_PROF_ID] = {
+	"unpack",
+	"int2float",
+	"scale",
+	"fir",
+	"biquad",
+	"ring_write",
+	"c1_biquad",
+	"convert",
+	"dma_handoff",
+	"core0_total",
+	"core1_total",
+	"peq",
+	"room_fir",
+};
+
+// UART送信待ちのレポート
+static char report_buffer[2048];
+static uint32_t report_length = 0;
+static uint32_t report_sent = 0;
+
+// サイクルカウンタを有効にする(各コアで呼ぶ)
+void init_profiler(void)
+{
+	m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+	m33_hw->dwt_cyccnt = 0;
+	m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+	if (get_core_num() == 0)
+		clear_profile_stat();
+}
+
+void __not_in_flash_func(profile_record)(uint id, uint32_t cycles)
+{
+	PROF_STAT *stat = &prof_stat[get_core_num()][id];
+
+	uint32_t bucket = (cycles >> PROF_HIST_MIN_SHIFT) ? (32 - __builtin_clz(cycles >> PROF_HIST_MIN_SHIFT)) : 0;
+	if (bucket >= PROF_HIST_BUCKETS)
+		bucket = PROF_HIST_BUCKETS - 1;
+
+	stat->count++;
+	stat->sum_cycles += cycles;
+	if (cycles < stat->min_cycles)
+		stat->min_cycles = cycles;
+	if (cycles > stat->max_cycles)
+		stat->max_cycles = cycles;
+	stat->hist[bucket]++;
+}
+
+void get_profile_stat(uint core, uint id, PROF_STAT *stat)
+{
+	*stat = prof_stat[core][id];
+}
+
+void clear_profile_stat(void)
+{
+	memset(prof_stat, 0, sizeof(prof_stat));
+	for (uint core = 0; core < 2; core++)
+	{
+		for (uint id = 0; id < NUM_OF_PROF_ID; id++)
+			prof_stat[core][id].min_cycles = UINT32_MAX;
+	}
+}
+
+// 統計をテキストにしてUART送信待ちにする(前回分の送信が終わっていなければ何もしない)
+// 最大値は250us(TIMER0_US)の処理周期に対する割合も出す
+void profile_report(void)
+{
+	if (report_sent < report_length)
+		return;
+
+	uint32_t cycles_per_us = clock_get_hz(clk_sys) / 1000000;
+	uint32_t deadline = cycles_per_us * TIMER0_US;
+	int n = 0;
+
+	for (uint core = 0; core < 2; core++)
+	{
+		for (uint id = 0; id < NUM_OF_PROF_ID; id++)
+		{
+			PROF_STAT stat = prof_stat[core][id];
+			if (stat.count == 0)
+				continue;
+
+			n += snprintf(report_buffer + n, sizeof(report_buffer) - n,
+						  "c%u %-11s n=%lu min=%lu avg=%lu max=%lu (%lu%%) h=",
+						  core, prof_name[id], (unsigned long)stat.count, (unsigned long)stat.min_cycles,
+						  (unsigned long)(stat.sum_cycles / stat.count), (unsigned long)stat.max_cycles,
+						  (unsigned long)(stat.max_cycles * 100u / deadline));
+			for (uint i = 0; (i < PROF_HIST_BUCKETS) && (n < (int)sizeof(report_buffer)); i++)
+				n += snprintf(report_buffer + n, sizeof(report_buffer) - n, "%lu%c", (unsigned long)stat.hist[i], (i == PROF_HIST_BUCKETS - 1) ? '\n' : ',');
+			if (n >= (int)sizeof(report_buffer))
+				break;
+		}
+	}
+
+	// 起動時に計測した処理段毎のサイクル数(ステレオ入力1サンプルあたり Q31_PIPELINE_MODEではFIR・BiQuad-IIRはQ31のフィルタ BQ_F64_ENABLEでは最終段は倍精度)
+	if (n < (int)sizeof(report_buffer))
+		n += snprintf(report_buffer + n, sizeof(report_buffer) - n,
+					  "stage(%s%s) convert=%u fir4=%u fir2=%u bq2=%u bq3=%u bq4=%u\n", Q31_PIPELINE_MODE ? "q31" : "float", (BQ_F64_ENABLE && !Q31_PIPELINE_MODE) ? " bq3/bq4 f64" : "",
+					  (uint)get_stage_cycles(STAGE_CONVERT), (uint)get_stage_cycles(STAGE_FIR_4X_0), (uint)get_stage_cycles(STAGE_FIR_2X_1),
+					  (uint)get_stage_cycles(STAGE_BQ_2X_2), (uint)get_stage_cycles(STAGE_BQ_2X_3), (uint)get_stage_cycles(STAGE_BQ_4X_0));
+
+	report_length = (n < (int)sizeof(report_buffer)) ? n : sizeof(report_buffer) - 1;
+	report_sent = 0;
+}
+
+// UARTのFIFOに空きがある分だけ送る(Core0のイベント処理から毎回呼ぶ)
+void __not_in_flash_func(profile_uart_poll)(void)
+{
+	while ((report_sent < report_length) && uart_is_writable(uart_default))
+		uart_putc_raw(uart_default, report_buffer[report_sent++]);
+}
+
+bool __not_in_flash_func(is_profile_report_pending)(void)
+{
+	return report_sent < report_length;
+}
@@ -0,0 +1,64 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include "pico/stdlib.h"
+#include "hardware/structs/m33.h"
+#include "common.h"
+
+// 計測する処理段
+#define PROF_UNPACK (0)		  // USBパケット展開・EPバッファ書き込み(USB割り込み)
+#define PROF_INT_TO_FLOAT (1) // int32→float変換
+#define PROF_SCALE (2)		  // FIR前のゲイン(int32→float変換と同じループになったので記録しない)
+#define PROF_FIR (3)		  // FIR補間(1ch分)
+#define PROF_BIQUAD (4)		  // BiQuad-IIR 2x Core0最終段(1ch分)
+#define PROF_RING_WRITE (5)	  // Core0→Core1リングバッファ書き込み
+#define PROF_CORE1_BIQUAD (6) // BiQuad-IIR Core1段(1ch分)
+#define PROF_CONVERT (7)	  // float→int32変換・フェード・1bit変調
+#define PROF_DMA_HANDOFF (8)  // DMA送信バッファへの書き込み・DMA起動
+#define PROF_CORE0_TOTAL (9)  // upsampling_process_core0全体
+#define PROF_CORE1_TOTAL (10) // dma_tx_startの1ブロック全体
+#define PROF_PEQ (11)		  // パラメトリックEQ(両ch分 段数0の場合は記録しない)
+#define PROF_ROOM_FIR (12)	  // ルーム補正FIR(両ch分 無効の場合は記録しない)
+#define NUM_OF_PROF_ID (13)
+
+// ヒストグラムは2のべき乗毎の区間(64サイクル未満 ~ 2^21サイクル以上)
+#define PROF_HIST_MIN_SHIFT (6)
+#define PROF_HIST_BUCKETS (16)
+
+typedef struct
+{
+	uint32_t count;
+	uint32_t min_cycles;
+	uint32_t max_cycles;
+	uint64_t sum_cycles;
+	uint32_t hist[PROF_HIST_BUCKETS];
+} PROF_STAT;
+
+extern void init_profiler(void);
+extern void __not_in_flash_func(profile_record)(uint id, uint32_t cycles);
+extern void get_profile_stat(uint core, uint id, PROF_STAT *stat);
+extern void clear_profile_stat(void);
+extern void profile_report(void);
+extern void __not_in_flash_func(profile_uart_poll)(void);
+extern bool __not_in_flash_func(is_profile_report_pending)(void);
+
+// PROFILE_ENABLE=falseの場合は計測処理ごと消える
+static inline __attribute__((always_inline)) uint32_t profile_start(void)
+{
+	return PROFILE_ENABLE ? m33_hw->dwt_cyccnt : 0;
+}
+
+static inline __attribute__((always_inline)) void profile_end(uint id, uint32_t start)
+{
+	if (PROFILE_ENABLE)
+		profile_record(id, m33_hw->dwt_cyccnt - start);
+}
+
+#endif /* _PROFILER_H_ */
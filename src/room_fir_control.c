@@ -0,0 +1,130 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#include <string.h>
+#include "room_fir_control.h"
+#include "common.h"
+#include "upsampling.h"
+#include "stage_partition.h"
+#include "filter_profile.h"
+#include "stream_switch.h"
+
+// ルーム補正FIR(演算はdsp_room_fir.c)のインパルス応答の書き込み
+// USBのベンダーリクエストで16タップずつ受け取り(ROOM_FIR_REQ_WRITE)、ROOM_FIR_REQ_COMMITでまとめて反映する
+// 反映(分割毎のFFT)には時間がかかるので、切り替えシーケンス(stream_switch.c)で出力をフェードアウトしてから行う
+static float room_fir_ir[NUM_OF_CH][DSP_ROOM_FIR_MAX_TAPS];
+static volatile uint16_t room_fir_num_taps = 0; // 反映する(した)タップ数
+static volatile uint32_t room_fir_freq = 0;		// 反映する(した)インパルス応答のサンプルレート
+static volatile bool room_fir_pending = false;
+
+// USBオーディオで受け付けるサンプルレートか
+static bool is_supported_freq(uint32_t freq)
+{
+	const uint32_t base_freq[NUM_OF_RATE_FAMILY] = {44100, 48000};
+
+	for (uint16_t family = 0; family < NUM_OF_RATE_FAMILY; family++)
+	{
+		for (uint16_t rate_class = 0; rate_class < NUM_OF_RATE_CLASS; rate_class++)
+		{
+			if (freq == (base_freq[family] << rate_class))
+				return true;
+		}
+	}
+	return false;
+}
+
+// タップ数num_tapsのときに負荷の最も大きいコアに増える負荷(‰ freqがインパルス応答のサンプルレートと異なる場合は0)
+// 処理量は分割数に比例するとして、最大タップ数で計測したサイクル数から換算する
+// チャンネル分割モードでは各コアが1ch分ずつ実行する
+static float calc_room_fir_load(uint32_t num_taps, uint32_t ir_freq, uint32_t freq, bool is_high_power)
+{
+	if ((num_taps == 0) || (freq != ir_freq))
+		return 0.f;
+
+	uint32_t sys_clock_khz = get_clock_config(freq, is_high_power)->sys_clock_khz;
+	uint32_t num_partition = (num_taps + DSP_ROOM_FIR_PARTITION - 1) / DSP_ROOM_FIR_PARTITION;
+	float cycles = get_stage_cycles(STAGE_ROOM_FIR) * (float)num_partition / (float)DSP_ROOM_FIR_MAX_PARTITION;
+	float load = cycles * (float)freq / (float)sys_clock_khz;
+
+	if (CHANNEL_SPLIT_MODE)
+		return load / 2.f;
+	return load;
+}
+
+// 現在反映しているルーム補正FIRの負荷(‰ filter_profile.cの負荷の見積もりにも使う)
+float get_room_fir_load(uint32_t freq, bool is_high_power)
+{
+	if (!ROOM_FIR_ENABLE)
+		return 0.f;
+	return calc_room_fir_load(room_fir_num_taps, room_fir_freq, freq, is_high_power);
+}
+
+// タップ係数を書き込む(USB割り込みから呼ばれる 反映はcommit_room_fir) 範囲外・反映待ちの場合はfalse
+bool write_room_fir(uint8_t ch_mask, uint16_t offset, const float *taps, uint32_t num_taps)
+{
+	if (room_fir_pending || ((ch_mask & (ROOM_FIR_CH_L | ROOM_FIR_CH_R)) == 0))
+		return false;
+	if ((uint32_t)offset + num_taps > DSP_ROOM_FIR_MAX_TAPS)
+		return false;
+
+	for (uint ch = 0; ch < NUM_OF_CH; ch++)
+	{
+		if (ch_mask & (1u << ch))
+			memcpy(&room_fir_ir[ch][offset], taps, sizeof(float) * num_taps);
+	}
+	return true;
+}
+
+// 前の反映(commit_room_fir)が終わっていないか(この間は書き込みを受け付けない)
+bool is_room_fir_pending(void)
+{
+	return room_fir_pending;
+}
+
+// 書き込んだタップのうち先頭からnum_taps個をfreqの入力に適用する(USB割り込みから呼ばれる)
+// そのレートの両パワーモードで負荷の見積もりがFILTER_PROFILE_LOAD_LIMITを超える場合・前の反映が終わっていない場合はfalse
+bool commit_room_fir(uint16_t num_taps, uint32_t freq)
+{
+	if ((num_taps > DSP_ROOM_FIR_MAX_TAPS) || room_fir_pending)
+		return false;
+
+	if (num_taps != 0)
+	{
+		if (!is_supported_freq(freq))
+			return false;
+		for (uint16_t mode = 0; mode < NUM_OF_POWER_MODE; mode++)
+		{
+			bool is_high_power = (mode == POWER_MODE_HIGH);
+			float load = (float)get_filter_profile_load(freq, is_high_power) - get_room_fir_load(freq, is_high_power) + calc_room_fir_load(num_taps, freq, freq, is_high_power);
+			if (load > FILTER_PROFILE_LOAD_LIMIT)
+				return false;
+		}
+	}
+
+	room_fir_num_taps = num_taps;
+	room_fir_freq = freq;
+	room_fir_pending = true;
+	request_stream_room_fir();
+	return true;
+}
+
+// 反映しているタップ数 | 遅延(入力サンプル数) << 16 (ROOM_FIR_REQ_GET)
+uint32_t get_room_fir_info(void)
+{
+	return get_upsampling_room_fir_taps() | (get_upsampling_room_fir_latency() << 16);
+}
+
+// 書き込んだインパルス応答を反映する(出力を止めているときに切り替えシーケンスから呼ばれる)
+void apply_room_fir(void)
+{
+	if (!room_fir_pending)
+		return;
+
+	if (!load_upsampling_room_fir(room_fir_ir[0], room_fir_ir[1], room_fir_num_taps, room_fir_freq))
+		room_fir_num_taps = 0;
+	room_fir_pending = false;
+}
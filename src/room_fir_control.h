@@ -0,0 +1,30 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _ROOM_FIR_CONTROL_H_
+#define _ROOM_FIR_CONTROL_H_
+
+#include "pico/stdlib.h"
+#include "dsp_filter.h"
+
+// ベンダーリクエスト(デバイス宛て bmRequestType=0x40/0xC0 PEQ_REQ_xxxの続き)
+#define ROOM_FIR_REQ_WRITE (0x06)  // wValue:先頭のタップ位置 wIndex:チャンネル(bit0:L bit1:R) データ:float(リトルエンディアン)最大ROOM_FIR_WRITE_MAX_TAPS個 前の反映が終わっていない場合はSTALL
+#define ROOM_FIR_REQ_COMMIT (0x07) // wValue:タップ数(0:無効) wIndex:サンプルレート/100 データなし 負荷の見積もりが上限を超える場合はSTALL
+#define ROOM_FIR_REQ_GET (0x08)	   // 4byte:反映しているタップ数(uint16 分割長の倍数), 遅延(uint16 入力サンプル数)
+
+#define ROOM_FIR_CH_L (0x01)
+#define ROOM_FIR_CH_R (0x02)
+#define ROOM_FIR_WRITE_MAX_TAPS (16) // 1回のROOM_FIR_REQ_WRITEで書き込むタップ数(EP0の1パケット)
+
+extern bool write_room_fir(uint8_t ch_mask, uint16_t offset, const float *taps, uint32_t num_taps);
+extern bool is_room_fir_pending(void);
+extern bool commit_room_fir(uint16_t num_taps, uint32_t freq);
+extern uint32_t get_room_fir_info(void);
+extern float get_room_fir_load(uint32_t freq, bool is_high_power);
+extern void apply_room_fir(void);
+
+#endif /* _ROOM_FIR_CONTROL_H_ */
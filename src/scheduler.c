@@ -0,0 +1,129 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#include <string.h>
+#include "scheduler.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+// 割り込み(USB受信・DMA完了・タイマー)やもう一方のコアがイベントを発行し、
+// 各コアはイベントが来るまでWFEで眠り、来たイベントのハンドラを優先順に最後まで実行する
+
+static spin_lock_t *sched_lock;
+static volatile uint32_t sched_pending[NUM_OF_CORE];
+static volatile uint32_t sched_post_time_us[NUM_OF_CORE][NUM_OF_SCHED_EVENT];
+static SCHED_HANDLER sched_handler[NUM_OF_CORE][NUM_OF_SCHED_EVENT];
+static SCHED_LATENCY_STAT sched_latency[NUM_OF_CORE][NUM_OF_SCHED_EVENT];
+
+void init_scheduler(void)
+{
+	sched_lock = spin_lock_init(spin_lock_claim_unused(true));
+	memset((void *)sched_pending, 0, sizeof(sched_pending));
+	memset(sched_handler, 0, sizeof(sched_handler));
+	sched_clear_latency_stat();
+}
+
+// 同じハンドラを複数のイベントに登録した場合、同時に来たイベントに対しては1回だけ実行する
+void sched_register(uint core, uint event, SCHED_HANDLER handler)
+{
+	sched_handler[core][event] = handler;
+}
+
+// イベントを発行する(割り込み・他コアから呼んでよい)
+void __not_in_flash_func(sched_post)(uint core, uint event)
+{
+	uint32_t bit = 1u << event;
+	uint32_t save = spin_lock_blocking(sched_lock);
+	if (!(sched_pending[core] & bit))
+		sched_post_time_us[core][event] = time_us_32();
+	sched_pending[core] |= bit;
+	spin_unlock(sched_lock, save);
+
+	// 眠っているコアを起こす(SEVは両方のコアに届く)
+	__sev();
+}
+
+static void __not_in_flash_func(sched_record_latency)(uint core, uint event, uint32_t now_us)
+{
+	SCHED_LATENCY_STAT *stat = &sched_latency[core][event];
+	uint32_t latency = now_us - sched_post_time_us[core][event];
+
+	if (latency < stat->min_us)
+		stat->min_us = latency;
+	if (latency > stat->max_us)
+		stat->max_us = latency;
+	stat->sum_us += latency;
+	stat->count++;
+}
+
+// 呼び出したコアのイベントループ(戻らない)
+void __not_in_flash_func(sched_run)(void)
+{
+	uint core = get_core_num();
+
+	while (true)
+	{
+		uint32_t save = spin_lock_blocking(sched_lock);
+		uint32_t events = sched_pending[core];
+		sched_pending[core] = 0;
+		spin_unlock(sched_lock, save);
+
+		// イベントが無ければ眠る(取り出した後に発行されたイベントはSEVでWFEを抜ける)
+		if (events == 0)
+		{
+			__wfe();
+			continue;
+		}
+
+		uint32_t now_us = time_us_32();
+		SCHED_HANDLER done[NUM_OF_SCHED_EVENT];
+		uint32_t num_of_done = 0;
+
+		for (uint event = 0; event < NUM_OF_SCHED_EVENT; event++)
+		{
+			if (!(events & (1u << event)))
+				continue;
+
+			sched_record_latency(core, event, now_us);
+
+			SCHED_HANDLER handler = sched_handler[core][event];
+			if (handler == NULL)
+				continue;
+
+			bool is_done = false;
+			for (uint32_t i = 0; i < num_of_done; i++)
+			{
+				if (done[i] == handler)
+					is_done = true;
+			}
+			if (is_done)
+				continue;
+
+			handler();
+			done[num_of_done++] = handler;
+		}
+	}
+}
+
+void sched_get_latency_stat(uint core, uint event, SCHED_LATENCY_STAT *stat)
+{
+	*stat = sched_latency[core][event];
+}
+
+void sched_clear_latency_stat(void)
+{
+	for (uint core = 0; core < NUM_OF_CORE; core++)
+	{
+		for (uint event = 0; event < NUM_OF_SCHED_EVENT; event++)
+		{
+			sched_latency[core][event].count = 0;
+			sched_latency[core][event].min_us = UINT32_MAX;
+			sched_latency[core][event].max_us = 0;
+			sched_latency[core][event].sum_us = 0;
+		}
+	}
+}
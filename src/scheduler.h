@@ -0,0 +1,42 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#include "pico/stdlib.h"
+
+// イベント(番号が小さいほど優先して処理する)
+#define SCHED_EVENT_TIMER (0)      // 周期タイマー(Core0, Core1)
+#define SCHED_EVENT_USB_RX (1)     // USB Audioパケット受信(Core0)
+#define SCHED_EVENT_DMA_DONE (2)   // I2S DMA転送完了(Core1)
+#define SCHED_EVENT_DATA_READY (3) // Core0のアップサンプリング済みデータ書き込み(Core1)
+#define SCHED_EVENT_SPLIT_BLOCK (4) // チャンネル分割モードのLch処理要求(Core0)
+#define SCHED_EVENT_DEFERRED (5)   // 割り込みから積まれた遅延処理(Core0)
+#define NUM_OF_SCHED_EVENT (6)
+
+#define NUM_OF_CORE (2)
+
+typedef void (*SCHED_HANDLER)(void);
+
+// イベント発行から処理開始までの遅延(us)
+typedef struct
+{
+	uint32_t count;
+	uint32_t min_us;
+	uint32_t max_us;
+	uint64_t sum_us;
+} SCHED_LATENCY_STAT;
+
+extern void init_scheduler(void);
+extern void sched_register(uint core, uint event, SCHED_HANDLER handler);
+extern void __not_in_flash_func(sched_post)(uint core, uint event);
+extern void __not_in_flash_func(sched_run)(void);
+extern void sched_get_latency_stat(uint core, uint event, SCHED_LATENCY_STAT *stat);
+extern void sched_clear_latency_stat(void);
+
+#endif /* _SCHEDULER_H_ */
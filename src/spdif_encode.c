@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2025 ArqAlice
+ *
+ * Released under the MIT license
+ * https://opensource.org/licenses/mit-license.php
+ */
+
+#include "spdif_encode.h"
+
+// チャンネルステータス
+#define SPDIF_CS_COPY_PERMIT (0x04ull)
+#define SPDIF_CS_WORD_LENGTH_24BIT (0x0Bull) // 最大24bit, 24bit
+
+// 1byte分(8タイムスロット)のBMC符号をNRZI符号で引けるようにしたテーブル 16bit目は奇偶パリティ
+// データ0 -> 01(セル境界のみ遷移), データ1 -> 11(セル中央でも遷移) ※LSBから送信
+static uint32_t spdif_bmc_lookup[256];
+
+void spdif_encode_init_table(void)
+{
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t v = 0x5555;
+        uint32_t p = 0;
+        for (uint32_t j = 0; j < 8; j++)
+        {
+            if (i & (1u << j))
+            {
+                p ^= 1;
+                v |= (2u << (j * 2));
+            }
+        }
+        spdif_bmc_lookup[i] = v | (p << 16u);
+    }
+}
+
+// 出力周波数に対するチャンネルステータス(コピー許可・周波数・語長24bit 先頭64bit分)
+uint64_t spdif_get_channel_status(uint32_t freq)
+{
+    uint64_t fs_code;
+    switch (freq)
+    {
+    case 48000:
+        fs_code = 0x2;
+        break;
+    case 88200:
+        fs_code = 0x8;
+        break;
+    case 96000:
+        fs_code = 0xA;
+        break;
+    case 176400:
+        fs_code = 0xC;
+        break;
+    case 192000:
+        fs_code = 0xE;
+        break;
+    case 44100:
+    default:
+        fs_code = 0x0;
+        break;
+    }
+    return SPDIF_CS_COPY_PERMIT | (fs_code << 24u) | (SPDIF_CS_WORD_LENGTH_24BIT << 32u);
+}
+
+// 24bitサンプル(int32の上位24bit)を1サブフレームに符号化する
+// slot0-3:プリアンブル, slot4-27:サンプル(LSBファースト), slot28:V, slot29:U, slot30:C, slot31:P
+static inline void __not_in_flash_func(spdif_encode_subframe)(uint32_t *out, int32_t sample, uint32_t preamble, uint32_t c_bit)
+{
+    uint32_t s0 = spdif_bmc_lookup[(uint8_t)(sample >> 8)];
+    uint32_t s1 = spdif_bmc_lookup[(uint8_t)(sample >> 16)];
+    uint32_t s2 = spdif_bmc_lookup[(uint8_t)(sample >> 24)];
+    uint32_t p = ((s0 ^ s1 ^ s2) >> 16u ^ c_bit) & 1u;
+
+    out[0] = preamble | ((s0 & 0xffffu) << 8u) | (s1 << 24u);
+    out[1] = ((s1 & 0xffffu) >> 8u) | ((s2 & 0xffffu) << 8u) | 0x55000000u | (c_bit << 29u) | (p << 31u);
+}
+
+// 1ブロック(192フレーム)を符号化する
+void __not_in_flash_func(spdif_encode_block)(uint32_t *out, const int32_t *in_L, const int32_t *in_R, uint64_t channel_status)
+{
+    for (uint32_t i = 0; i < SPDIF_BLOCK_FRAMES; i++)
+    {
+        uint32_t c_bit = (i < 64) ? (uint32_t)(channel_status >> i) & 1u : 0;
+        spdif_encode_subframe(out, in_L[i], i ? SPDIF_PREAMBLE_X : SPDIF_PREAMBLE_Z, c_bit);
+        spdif_encode_subframe(out + SPDIF_WORDS_PER_SUBFRAME, in_R[i], SPDIF_PREAMBLE_Y, c_bit);
+        out += SPDIF_WORDS_PER_SUBFRAME * 2;
+    }
+}
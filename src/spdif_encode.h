@@ -0,0 +1,39 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _SPDIF_ENCODE_H_
+#define _SPDIF_ENCODE_H_
+
+// S/PDIFのサブフレームの符号化(BMC符号をpico-extrasのaudio_spdif.pioが出力するNRZI符号で作る)
+// PIOを使わないのでdsp_filter.cと同じくホスト(x86)でもビルドできる(DSP_HOST_BUILD)
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef DSP_HOST_BUILD
+#define __not_in_flash_func(func_name) func_name
+#else
+#include "pico.h"
+#endif
+
+// S/PDIFブロック長(192フレームで1ブロック、チャンネルステータスが1周する)
+#define SPDIF_BLOCK_FRAMES (192)
+
+// 1サブフレームはNRZI符号で64bit(32タイムスロット x 2セル) = uint32_t x 2
+#define SPDIF_WORDS_PER_SUBFRAME (2)
+#define SPDIF_WORDS_PER_BLOCK (SPDIF_BLOCK_FRAMES * 2 * SPDIF_WORDS_PER_SUBFRAME)
+
+// NRZI符号でのプリアンブル(B/M/W = Z/X/Y) LSBから送信
+#define SPDIF_PREAMBLE_X (0b11001001)
+#define SPDIF_PREAMBLE_Y (0b01101001)
+#define SPDIF_PREAMBLE_Z (0b00111001)
+
+extern void spdif_encode_init_table(void);
+extern uint64_t spdif_get_channel_status(uint32_t freq);
+extern void __not_in_flash_func(spdif_encode_block)(uint32_t *out, const int32_t *in_L, const int32_t *in_R, uint64_t channel_status);
+
+#endif /* _SPDIF_ENCODE_H_ */
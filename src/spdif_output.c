@@ -0,0 +1,213 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#include <string.h>
+#include "spdif_output.h"
+#include "common.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "audio_spdif.pio.h"
+#include "deferred_work.h"
+#include "telemetry.h"
+
+// pico-extras の pico_audio_spdif のPIOプログラム(NRZI出力)を使い、
+// DMAとサブフレームの符号化(spdif_encode.c)は本体側で行う(24bit対応、I2Sとクロック同期させるため)
+
+// I2SはPIO0 SM0を使っているので、S/PDIFはSM1で出力する
+static const PIO pio = pio0;
+static const uint sm = 1;
+
+static int dma_ch;
+
+// DMA送信用ダブルバッファ
+static uint32_t spdif_tx_buf[2][SPDIF_WORDS_PER_BLOCK];
+static volatile uint8_t spdif_tx_playing = 0;
+
+// 符号化の要求(DMA割り込みで送信の終わったバッファと要求番号を渡し、符号化が済んだら番号を返す)
+static volatile uint8_t spdif_encode_target = 1;
+static volatile uint32_t spdif_block_requested = 0;
+static volatile uint32_t spdif_block_encoded = 0;
+
+// Core0からのデータ受け取り用
+static RINGBUFFER buffer_spdif_Lch;
+static RINGBUFFER buffer_spdif_Rch;
+static int32_t spdif_block_L[SPDIF_BLOCK_FRAMES];
+static int32_t spdif_block_R[SPDIF_BLOCK_FRAMES];
+static bool spdif_enable_output = false;
+
+// 現在の出力設定
+static uint32_t spdif_freq = 0;
+static const CLOCK_CONFIG *spdif_clock_config = NULL;
+static uint64_t spdif_channel_status = 0;
+
+static void __not_in_flash_func(dma_spdif_irq_handler)(void);
+static void __not_in_flash_func(spdif_encode_next_block)(void);
+
+// S/PDIF出力周波数(入力周波数の2倍は192kHzまで)
+uint32_t get_spdif_output_freq(uint32_t freq)
+{
+	if ((SPDIF_OUTPUT_RATIO == 2) && (freq <= 96000))
+		return freq * 2;
+	return freq;
+}
+
+// S/PDIFの分周率をI2Sの分周率から作る(同じシステムクロックから整数比で分周するのでI2Sとドリフトしない)
+// S/PDIFは1フレーム256サイクル、I2Sは1フレーム128サイクル
+static void spdif_renew_freq(const CLOCK_CONFIG *config, uint32_t freq)
+{
+	uint32_t out_freq = get_spdif_output_freq(freq);
+	uint64_t i2s_div_fixed = ((uint32_t)config->i2s_clkdiv_int << 8u) | config->i2s_clkdiv_frac;
+	uint32_t div_fixed = (uint32_t)((i2s_div_fixed * config->i2s_freq) / ((uint64_t)out_freq << 1u));
+
+	pio_sm_set_clkdiv_int_frac(pio, sm, div_fixed >> 8u, div_fixed & 0xffu);
+	spdif_channel_status = spdif_get_channel_status(out_freq);
+	spdif_clock_config = config;
+	spdif_freq = freq;
+}
+
+void init_spdif_output(void)
+{
+	spdif_encode_init_table();
+
+	initialize_ringbuffer(SIZE_SPDIF_BUFFER, true, &buffer_spdif_Lch);
+	initialize_ringbuffer(SIZE_SPDIF_BUFFER, true, &buffer_spdif_Rch);
+
+	// PIO初期化
+	uint offset = pio_add_program(pio, &audio_spdif_program);
+	pio_sm_claim(pio, sm);
+	pio_gpio_init(pio, SPDIF_OUT_PIN);
+	spdif_program_init(pio, sm, offset, SPDIF_OUT_PIN);
+	spdif_renew_freq(get_clock_config(audio_state.freq, is_high_power_mode), audio_state.freq);
+
+	// 無音で初期化
+	memset(spdif_block_L, 0, sizeof(spdif_block_L));
+	memset(spdif_block_R, 0, sizeof(spdif_block_R));
+	spdif_encode_block(spdif_tx_buf[0], spdif_block_L, spdif_block_R, spdif_channel_status);
+	spdif_encode_block(spdif_tx_buf[1], spdif_block_L, spdif_block_R, spdif_channel_status);
+
+	// DMA設定(I2SはDMA_IRQ_0をCore1で使っているので、DMA_IRQ_1をCore0で使う)
+	dma_ch = dma_claim_unused_channel(true);
+	dma_channel_config c_dma = dma_channel_get_default_config(dma_ch);
+	channel_config_set_transfer_data_size(&c_dma, DMA_SIZE_32);
+	channel_config_set_dreq(&c_dma, pio_get_dreq(pio, sm, true));
+	dma_channel_configure(dma_ch, &c_dma, &pio->txf[sm], spdif_tx_buf[0], SPDIF_WORDS_PER_BLOCK, false);
+
+	dma_channel_set_irq1_enabled(dma_ch, true);
+	irq_set_exclusive_handler(DMA_IRQ_1, dma_spdif_irq_handler);
+	irq_set_priority(DMA_IRQ_1, PICO_HIGHEST_IRQ_PRIORITY);
+	irq_set_enabled(DMA_IRQ_1, true);
+
+	// S/PDIFは受信側のロックを維持するため常時出力する(データがなければ無音)
+	pio_sm_set_enabled(pio, sm, true);
+	spdif_tx_playing = 0;
+	spdif_encode_target = 1;
+	spdif_block_requested = 0;
+	spdif_block_encoded = 0;
+	dma_channel_start(dma_ch);
+}
+
+// 送信完了したバッファに次のブロックを符号化する
+static void __not_in_flash_func(dma_spdif_irq_handler)(void)
+{
+	uint32_t start_us = time_us_32();
+	dma_hw->ints1 = 1u << dma_ch; // 割り込みフラグクリア
+
+	// 符号化済みのもう一方のバッファを即座に送信する
+	// 前回の要求の符号化が終わっていなければ、前のブロックをもう一度送ることになる(オーバーラン)
+	if (spdif_block_encoded != spdif_block_requested)
+		telemetry_count(TELEMETRY_COUNTER_SPDIF_OVERRUN, 1);
+	spdif_tx_playing ^= 1;
+	dma_channel_transfer_from_buffer_now(dma_ch, spdif_tx_buf[spdif_tx_playing], SPDIF_WORDS_PER_BLOCK);
+
+	// 送信の終わったバッファの符号化はスレッド側で行う(1ブロック分の時間内に終われば良い)
+	spdif_encode_target = spdif_tx_playing ^ 1;
+	spdif_block_requested++;
+	defer_work(spdif_encode_next_block, DEFERRED_PRIORITY_HIGH);
+
+	irq_stat_record(IRQ_ID_DMA_SPDIF, start_us);
+}
+
+// 割り込みで渡されたバッファに次のブロックを符号化する(遅延処理キューから実行される)
+static void __not_in_flash_func(spdif_encode_next_block)(void)
+{
+	uint32_t save = save_and_disable_interrupts();
+	uint8_t finished = spdif_encode_target;
+	uint32_t request = spdif_block_requested;
+	restore_interrupts(save);
+
+	int32_t length = get_size_using(&buffer_spdif_Lch);
+	if (length >= SPDIF_START_THRESHOLD)
+		spdif_enable_output = true;
+	else if (length < SPDIF_BLOCK_FRAMES)
+		spdif_enable_output = false;
+
+	if (spdif_enable_output)
+	{
+		ringbuf_read_array_no_spinlock(spdif_block_L, SPDIF_BLOCK_FRAMES, &buffer_spdif_Lch);
+		ringbuf_read_array_no_spinlock(spdif_block_R, SPDIF_BLOCK_FRAMES, &buffer_spdif_Rch);
+	}
+	else
+	{
+		memset(spdif_block_L, 0, sizeof(spdif_block_L));
+		memset(spdif_block_R, 0, sizeof(spdif_block_R));
+	}
+	spdif_encode_block(spdif_tx_buf[finished], spdif_block_L, spdif_block_R, spdif_channel_status);
+
+	// 符号化中に次の割り込みが来ていれば、その割り込みでオーバーランとして数えられている
+	spdif_block_encoded = request;
+}
+
+// サンプルレート・クロック設定が変わっていたら分周率を更新する(Core0から呼ばれる)
+static void __not_in_flash_func(spdif_check_freq)(void)
+{
+	const CLOCK_CONFIG *config = get_clock_config(audio_state.freq, is_high_power_mode);
+	if ((config != spdif_clock_config) || (audio_state.freq != spdif_freq))
+	{
+		uint32_t save = save_and_disable_interrupts();
+		clear_ringbuffer(&buffer_spdif_Lch);
+		clear_ringbuffer(&buffer_spdif_Rch);
+		spdif_renew_freq(config, audio_state.freq);
+		restore_interrupts(save);
+	}
+}
+
+// Core0のアップサンプリング処理途中から取り出したデータを書き込む(int32、入力周波数)
+void __not_in_flash_func(spdif_output_write_int32)(int32_t *in_L, int32_t *in_R, uint32_t length)
+{
+	spdif_check_freq();
+
+	uint32_t save = save_and_disable_interrupts();
+	ringbuf_write_array_no_spinlock(in_L, length, &buffer_spdif_Lch);
+	ringbuf_write_array_no_spinlock(in_R, length, &buffer_spdif_Rch);
+	restore_interrupts(save);
+}
+
+// Core0のアップサンプリング処理途中から取り出したデータを間引いて書き込む(float、補間フィルタ出力)
+void __not_in_flash_func(spdif_output_write_float)(float *in_L, float *in_R, uint32_t length, uint32_t decimation)
+{
+	// Core0のスタックに置くには大きいのでstaticにする(Core0からだけ呼ばれる)
+	static int32_t buf_L[SIZE_EP_BUFFER * 2];
+	static int32_t buf_R[SIZE_EP_BUFFER * 2];
+	uint32_t count = 0;
+
+	for (uint32_t i = 0; (i < length) && (count < count_of(buf_L)); i += decimation)
+	{
+		buf_L[count] = (int32_t)in_L[i];
+		buf_R[count] = (int32_t)in_R[i];
+		count++;
+	}
+	spdif_output_write_int32(buf_L, buf_R, count);
+}
+
+void spdif_output_clear(void)
+{
+	uint32_t save = save_and_disable_interrupts();
+	clear_ringbuffer(&buffer_spdif_Lch);
+	clear_ringbuffer(&buffer_spdif_Rch);
+	restore_interrupts(save);
+}
@@ -0,0 +1,26 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _SPDIF_OUTPUT_H_
+#define _SPDIF_OUTPUT_H_
+
+#include "pico/stdlib.h"
+#include "spdif_encode.h"
+
+// Core0からS/PDIF送信までのバッファ(ブロック4つ分)
+#define SIZE_SPDIF_BUFFER (SPDIF_BLOCK_FRAMES * 4)
+
+// 出力開始水位(ブロック2つ分溜まってから出力を開始する)
+#define SPDIF_START_THRESHOLD (SPDIF_BLOCK_FRAMES * 2)
+
+extern void init_spdif_output(void);
+extern void __not_in_flash_func(spdif_output_write_int32)(int32_t *in_L, int32_t *in_R, uint32_t length);
+extern void __not_in_flash_func(spdif_output_write_float)(float *in_L, float *in_R, uint32_t length, uint32_t decimation);
+extern void spdif_output_clear(void);
+extern uint32_t get_spdif_output_freq(uint32_t freq);
+
+#endif /* _SPDIF_OUTPUT_H_ */
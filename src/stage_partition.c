@@ -0,0 +1,238 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#include <string.h>
+#include "stage_partition.h"
+#include "common.h"
+#include "upsampling.h"
+
+// アップサンプリング処理を「処理段のグラフ」(入力→変換→FIR→BiQuad→Core1のBiQuad→I2S出力)として表し、
+// 各段の処理サイクル数から、Core0とCore1の負荷の大きい方が最小になる位置でグラフを分割する。
+//
+//   48kHz系 : 変換 → FIR 4x → [BiQuad 2x] → (BiQuad 4x / 2x) → I2S出力
+//   96kHz系 : 変換 → FIR 2x → [BiQuad 2x] → (BiQuad 4x / 2x) → I2S出力
+//   192kHz系: 変換 →           [BiQuad 2x] → (BiQuad 4x / 2x) → I2S出力
+//
+// []の段はどちらのコアでも実行できる。Core1に移した場合はCore0→Core1のリングバッファが補間前のレートになる。
+// FIRは状態バッファが大きく、S/PDIF出力の取り出し口もあるのでCore0に固定している。
+// 1bit出力時はCore1が変調で埋まるので分割点は動かさない。
+//
+// 各段のサイクル数は起動時に実測する(STAGE_PARTITION_MEASURE=falseの場合は下の見積もり値を使う)。
+// チャンネル分割モード(CHANNEL_SPLIT_ENABLE)と比べられるよう、その場合の負荷も求めておく。
+// 分割点はサンプルレート系列・入力レート・パワーモード毎に事前計算しておき、
+// 出力をフェードアウトしてバッファを空にしたとき(切り替えシーケンス)にだけ切り替える。
+
+// 見積もり値(ステレオ入力1サンプルあたりのサイクル数 Cortex-M33 FPU RAM実行)
+static const float stage_cycles_estimate[NUM_OF_STAGE] = {
+	10.f,  // STAGE_CONVERT  : 変換3 + スケーリング2 x 2ch
+	340.f, // STAGE_FIR_4X_0 : 128tap 4相 = 128MAC x 2ch
+	130.f, // STAGE_FIR_2X_1 : 48tap 2相 = 48MAC x 2ch
+	170.f, // STAGE_BQ_2X_2  : 4段 x 2出力 x 2ch
+	170.f, // STAGE_BQ_2X_3  : 4段 x 2出力 x 2ch
+	250.f, // STAGE_BQ_4X_0  : 3段 x 4出力 x 2ch
+	22.f,  // STAGE_PEQ_SECTION : 1段 x 1出力 x 2ch(分割点の計算には使わない)
+	850.f, // STAGE_ROOM_FIR : 4096tap 64分割 = 64複素MAC + FFT 2回/64サンプル x 2ch(同上)
+};
+
+static float stage_cycles[NUM_OF_STAGE];
+static STAGE_PARTITION partition_table[NUM_OF_POWER_MODE][NUM_OF_RATE_FAMILY][NUM_OF_RATE_CLASS];
+static volatile uint8_t current_num_moved = 0;
+
+static void get_partition_index(uint32_t freq, uint16_t *family, uint16_t *rate_class)
+{
+	switch (freq)
+	{
+	case 192000:
+	case 176400:
+		*rate_class = RATE_CLASS_192K;
+		break;
+	case 96000:
+	case 88200:
+		*rate_class = RATE_CLASS_96K;
+		break;
+	case 48000:
+	case 44100:
+	default:
+		*rate_class = RATE_CLASS_48K;
+		break;
+	}
+	*family = ((freq % 48000) == 0) ? RATE_FAMILY_48K : RATE_FAMILY_44K;
+}
+
+// レート区分・パワーモードに対応する処理段グラフを作る 戻り値はノード数
+static uint build_stage_graph(uint16_t rate_class, bool is_high_power, STAGE_NODE *graph)
+{
+	uint n = 0;
+
+	graph[n++] = (STAGE_NODE){STAGE_CONVERT, 1, STAGE_CORE0};
+	if (rate_class == RATE_CLASS_48K)
+		graph[n++] = (STAGE_NODE){STAGE_FIR_4X_0, 4, STAGE_CORE0};
+	else if (rate_class == RATE_CLASS_96K)
+		graph[n++] = (STAGE_NODE){STAGE_FIR_2X_1, 2, STAGE_CORE0};
+
+	if (!CORE0_UPSAMPLING_192K)
+		graph[n++] = (STAGE_NODE){STAGE_BQ_2X_2, 2, (STAGE_PARTITION_ENABLE && !ONEBIT_OUTPUT_ENABLE && !CHANNEL_SPLIT_MODE) ? STAGE_MOVABLE : STAGE_CORE0};
+
+	switch (get_ratio_upsampling_core1_mode(is_high_power))
+	{
+	case 4:
+		graph[n++] = (STAGE_NODE){STAGE_BQ_4X_0, 4, STAGE_CORE1};
+		break;
+	case 2:
+		graph[n++] = (STAGE_NODE){STAGE_BQ_2X_3, 2, STAGE_CORE1};
+		break;
+	default:
+		break;
+	}
+	return n;
+}
+
+// 分割点cut(これより前のノードをCore0で実行する)での各コアの負荷(‰)を求める
+static void calc_stage_load(const STAGE_NODE *graph, uint num_node, uint cut, uint32_t freq, uint32_t sys_clock_khz, STAGE_PARTITION *partition)
+{
+	float cycles[2] = {(float)STAGE_CYCLES_USB_RX * freq, 0.f};
+	float rate = freq;
+	uint8_t num_moved = 0;
+
+	for (uint i = 0; i < num_node; i++)
+	{
+		uint core = graph[i].core;
+		if (core == STAGE_MOVABLE)
+		{
+			core = (i < cut) ? STAGE_CORE0 : STAGE_CORE1;
+			if (core == STAGE_CORE1)
+				num_moved++;
+		}
+		cycles[core] += stage_cycles[graph[i].stage] * rate;
+		rate *= graph[i].ratio;
+	}
+	cycles[STAGE_CORE1] += (float)STAGE_CYCLES_I2S_OUT * rate;
+
+	// cycles/s / (sys_clock_khz * 1000) * 1000
+	partition->num_moved = num_moved;
+	partition->load_core0 = (uint16_t)(cycles[STAGE_CORE0] / sys_clock_khz);
+	partition->load_core1 = (uint16_t)(cycles[STAGE_CORE1] / sys_clock_khz);
+}
+
+// チャンネル分割モードでの各コアの負荷(‰)を求める(比較用)
+// 変換はCore0で両ch分、それ以降の段とI2S出力は各コアで1ch分ずつ行う
+static void calc_channel_split_load(const STAGE_NODE *graph, uint num_node, uint32_t freq, uint32_t sys_clock_khz, STAGE_PARTITION *partition)
+{
+	float cycles_channel = 0.f;
+	float rate = freq;
+
+	for (uint i = 1; i < num_node; i++)
+	{
+		rate *= graph[i - 1].ratio;
+		cycles_channel += stage_cycles[graph[i].stage] * rate / 2;
+	}
+	rate *= graph[num_node - 1].ratio;
+	cycles_channel += (float)STAGE_CYCLES_I2S_OUT * rate / 2;
+
+	float cycles_core0 = (float)(STAGE_CYCLES_USB_RX + stage_cycles[STAGE_CONVERT]) * freq + cycles_channel;
+	partition->load_split_core0 = (uint16_t)(cycles_core0 / sys_clock_khz);
+	partition->load_split_core1 = (uint16_t)(cycles_channel / sys_clock_khz);
+}
+
+static void calc_stage_partition(uint32_t freq, bool is_high_power, STAGE_PARTITION *partition)
+{
+	STAGE_NODE graph[MAX_STAGE_NODE];
+	uint16_t family, rate_class;
+	get_partition_index(freq, &family, &rate_class);
+	uint num_node = build_stage_graph(rate_class, is_high_power, graph);
+	uint32_t sys_clock_khz = get_clock_config(freq, is_high_power)->sys_clock_khz;
+
+	// 移動可能な段の範囲で分割点を動かす(移動可能な段はCore0とCore1の境界に並んでいる)
+	uint cut_min = num_node;
+	uint cut_max = 0;
+	for (uint i = 0; i < num_node; i++)
+	{
+		if (graph[i].core == STAGE_MOVABLE)
+		{
+			if (i < cut_min)
+				cut_min = i;
+			cut_max = i + 1;
+		}
+	}
+
+	// 既定はすべてCore0で実行する 負荷が同じなら移さない
+	calc_stage_load(graph, num_node, num_node, freq, sys_clock_khz, partition);
+	for (uint cut = cut_min; cut < cut_max; cut++)
+	{
+		STAGE_PARTITION candidate;
+		calc_stage_load(graph, num_node, cut, freq, sys_clock_khz, &candidate);
+		uint16_t peak = MAX(candidate.load_core0, candidate.load_core1);
+		if (peak < MAX(partition->load_core0, partition->load_core1))
+			*partition = candidate;
+	}
+
+	calc_channel_split_load(graph, num_node, freq, sys_clock_khz, partition);
+}
+
+// 各段のサイクル数を求め、分割点の表を作る(init_clock_config_table, init_upsampling_filterの後に呼ぶ)
+void init_stage_partition(void)
+{
+	const uint32_t base_freq[NUM_OF_RATE_FAMILY] = {44100, 48000};
+
+	for (uint i = 0; i < NUM_OF_STAGE; i++)
+	{
+		stage_cycles[i] = STAGE_PARTITION_MEASURE ? measure_upsampling_stage_cycles(i) : 0.f;
+		if (stage_cycles[i] <= 0.f)
+			stage_cycles[i] = stage_cycles_estimate[i];
+	}
+
+	for (uint16_t mode = 0; mode < NUM_OF_POWER_MODE; mode++)
+	{
+		for (uint16_t family = 0; family < NUM_OF_RATE_FAMILY; family++)
+		{
+			for (uint16_t rate_class = 0; rate_class < NUM_OF_RATE_CLASS; rate_class++)
+			{
+				calc_stage_partition(base_freq[family] << rate_class, mode == POWER_MODE_HIGH, &partition_table[mode][family][rate_class]);
+			}
+		}
+	}
+
+	select_stage_partition(audio_state.freq, is_high_power_mode);
+}
+
+const STAGE_PARTITION *get_stage_partition(uint32_t freq, bool is_high_power)
+{
+	uint16_t family, rate_class;
+	get_partition_index(freq, &family, &rate_class);
+	return &partition_table[is_high_power ? POWER_MODE_HIGH : POWER_MODE_LOW][family][rate_class];
+}
+
+// 分割点を切り替える(Core0→Core1のバッファが空のときに呼ぶ)
+void select_stage_partition(uint32_t freq, bool is_high_power)
+{
+	current_num_moved = get_stage_partition(freq, is_high_power)->num_moved;
+}
+
+// 分割点の切り替えが必要かどうか(必要なら出力を止めて切り替える)
+bool is_stage_partition_changed(uint32_t freq, bool is_high_power)
+{
+	return get_stage_partition(freq, is_high_power)->num_moved != current_num_moved;
+}
+
+bool __not_in_flash_func(is_biquad2_on_core1)(void)
+{
+	return current_num_moved > 0;
+}
+
+// Core0→Core1のリングバッファのレートの入力に対する倍率(移せる段は2倍補間のみ)
+// チャンネル分割モードでは入力レートのまま渡す
+uint16_t __not_in_flash_func(get_ratio_core0_output)(uint32_t freq)
+{
+	if (CHANNEL_SPLIT_MODE)
+		return 1;
+	return get_ratio_upsampling_core0(freq) >> current_num_moved;
+}
+
+float get_stage_cycles(uint stage)
+{
+	return stage_cycles[stage];
+}
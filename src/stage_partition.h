@@ -0,0 +1,50 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _STAGE_PARTITION_H_
+#define _STAGE_PARTITION_H_
+
+#include "pico/stdlib.h"
+#include "dsp_filter.h" // 入力サンプルレート区分(RATE_CLASS_xxx)
+
+// 処理段グラフの最大ノード数
+#define MAX_STAGE_NODE (4)
+
+// 処理段のコア割り当て
+#define STAGE_CORE0 (0)
+#define STAGE_CORE1 (1)
+#define STAGE_MOVABLE (2) // 分割点によってどちらのコアでも実行できる
+
+// 計測値がない場合の見積もり値(ステレオ入力1サンプルあたりのサイクル数)
+#define STAGE_CYCLES_USB_RX (40)	// USBパケット受信・EPバッファ書き込み(Core0)
+#define STAGE_CYCLES_I2S_OUT (14)	// float→int32変換・フェード・DMAバッファ書き込み(Core1 出力1サンプルあたり)
+
+typedef struct
+{
+	uint8_t stage;	// 処理段(STAGE_xxx upsampling.h)
+	uint8_t ratio;	// 補間倍率
+	uint8_t core;	// STAGE_CORE0 / STAGE_CORE1 / STAGE_MOVABLE
+} STAGE_NODE;
+
+typedef struct
+{
+	uint8_t num_moved;		 // Core1に移した処理段の数
+	uint16_t load_core0;	 // 各コアの負荷(‰)
+	uint16_t load_core1;
+	uint16_t load_split_core0; // チャンネル分割モードでの各コアの負荷(‰ 比較用)
+	uint16_t load_split_core1;
+} STAGE_PARTITION;
+
+extern void init_stage_partition(void);
+extern void select_stage_partition(uint32_t freq, bool is_high_power);
+extern bool is_stage_partition_changed(uint32_t freq, bool is_high_power);
+extern const STAGE_PARTITION *get_stage_partition(uint32_t freq, bool is_high_power);
+extern bool __not_in_flash_func(is_biquad2_on_core1)(void);
+extern uint16_t __not_in_flash_func(get_ratio_core0_output)(uint32_t freq);
+extern float get_stage_cycles(uint stage);
+
+#endif /* _STAGE_PARTITION_H_ */
@@ -0,0 +1,169 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#include "stream_switch.h"
+#include "common.h"
+#include "transmit_to_dac.h"
+#include "upsampling.h"
+#include "core_handoff.h"
+#include "stage_partition.h"
+#include "trace.h"
+#include "room_fir_control.h"
+
+// サンプルレート・パワーモード切り替えシーケンス
+// 1. サンプルレートの変更は、出力をフェードアウト → 新しいレートを反映(audio_state.freq) → 必要ならクロック・PIOを再設定 → 低水位から出力再開
+//    フェードアウト中は古いレートのデータだけを出力し、新しいレートのUSBのデータは捨てる(古いレートのフィルタ・クロックで処理しない)
+//    同一系列内のレート変更(44.1k/88.2k/176.4k など)もフィルタの段構成が変わるので、段差を出さないようフェードする
+// 2. パワーモードの変更でクロックまたはCore0/Core1の分割点の変更が必要な場合も、フェードアウト → クロック・PIOを再設定 → 低水位から出力再開
+// 3. BiQuad-IIRの異なるフィルタプロファイルへの切り替えは、出力をフェードアウト → 係数を入れ替え → 低水位から出力再開
+// 4. ルーム補正FIRのインパルス応答の反映も同じく、出力をフェードアウト → 係数を計算(分割毎のFFT) → 低水位から出力再開
+static volatile uint8_t switch_state = STREAM_SWITCH_IDLE;
+static volatile bool pending_high_power = true;
+static volatile bool pending_clock = false;
+static volatile uint32_t pending_freq = 0; // pending_clockの場合に反映するサンプルレート
+static const DSP_PROFILE *volatile pending_profile = NULL;
+static volatile bool pending_room_fir = false;
+static volatile bool applying_clock = false; // 取り出したサンプルレートを反映中
+static absolute_time_t time_start_fade;
+
+extern volatile absolute_time_t time_start_output;
+
+// 切り替えを要求する(USB割り込み・スレッドから呼ばれる) サンプルレートはフェードアウト完了時に反映する
+void request_stream_reconfigure(uint32_t freq, bool is_high_power)
+{
+	// 切り替え前のレートのデータは捨てる
+	clear_ringbuffer(&buffer_ep_Lch);
+	clear_ringbuffer(&buffer_ep_Rch);
+
+	pending_high_power = is_high_power;
+	pending_freq = freq;
+
+	// フェードアウト中(フィルタプロファイルの切り替えを含む)はその完了時にまとめて再設定する
+	if (switch_state != STREAM_SWITCH_IDLE)
+	{
+		pending_clock = true;
+		return;
+	}
+
+	// レートが同じでクロックもCore0/Core1の分割点も変更しなくてよい場合は出力を止めない
+	if ((freq == audio_state.freq) && (!is_clock_config_changed(freq, is_high_power)) && (!is_stage_partition_changed(freq, is_high_power)))
+	{
+		is_high_power_mode = is_high_power;
+		return;
+	}
+
+	if(USE_ESS_DAC && KIND_ESS_DAC == ES9038Q2M)
+		ess_dac_mute();
+
+	pending_clock = true;
+	trace_event(TRACE_ID_STREAM_SWITCH, 0);
+	time_start_fade = get_absolute_time();
+	request_output_fade_out();
+	switch_state = STREAM_SWITCH_FADING;
+}
+
+// フィルタプロファイルの切り替えを要求する(BiQuad-IIRが異なりクロスフェードできない場合 filter_profile.cから呼ばれる)
+void request_stream_profile(const DSP_PROFILE *profile)
+{
+	pending_profile = profile;
+
+	if (switch_state != STREAM_SWITCH_IDLE)
+		return;
+
+	trace_event(TRACE_ID_STREAM_SWITCH, 0);
+	time_start_fade = get_absolute_time();
+	request_output_fade_out();
+	switch_state = STREAM_SWITCH_FADING;
+}
+
+// ルーム補正FIRのインパルス応答の反映を要求する(room_fir_control.cから呼ばれる)
+void request_stream_room_fir(void)
+{
+	pending_room_fir = true;
+
+	if (switch_state != STREAM_SWITCH_IDLE)
+		return;
+
+	trace_event(TRACE_ID_STREAM_SWITCH, 0);
+	time_start_fade = get_absolute_time();
+	request_output_fade_out();
+	switch_state = STREAM_SWITCH_FADING;
+}
+
+bool is_stream_switching(void)
+{
+	return switch_state != STREAM_SWITCH_IDLE;
+}
+
+// 反映待ちのサンプルレートがあるか(この間はUSBのデータをEPバッファに書かない)
+bool __not_in_flash_func(is_stream_freq_pending)(void)
+{
+	return (switch_state != STREAM_SWITCH_IDLE) && (pending_clock || applying_clock);
+}
+
+// ホストが設定したサンプルレート(反映待ちの場合はそのレート)
+uint32_t get_stream_freq(void)
+{
+	return is_stream_freq_pending() ? pending_freq : audio_state.freq;
+}
+
+// フェードアウト完了を待ってクロックを再設定する(Core0のタイマ割り込みから遅延処理キューに積まれる)
+// 反映待ちの要求はUSB割り込みから書き換えられるので、割り込み禁止で取り出してから反映する
+// 反映中(renew_clockは数ms)に来た要求は次回に反映し、それまでフェードアウトしたままにする
+void __not_in_flash_func(stream_switch_process)(void)
+{
+	if (switch_state != STREAM_SWITCH_FADING)
+		return;
+
+	if ((!is_output_faded_out()) && (absolute_time_diff_us(time_start_fade, get_absolute_time()) < SWITCH_FADE_TIMEOUT_US))
+		return;
+
+	uint32_t save = save_and_disable_interrupts();
+	bool high_power = pending_high_power;
+	bool clock = pending_clock;
+	uint32_t freq = pending_freq;
+	const DSP_PROFILE *profile = pending_profile;
+	bool room_fir = pending_room_fir;
+	pending_clock = false;
+	pending_profile = NULL;
+	pending_room_fir = false;
+	applying_clock = clock;
+	restore_interrupts(save);
+
+	is_high_power_mode = high_power;
+	trace_event(TRACE_ID_STREAM_SWITCH, 1);
+
+	// 出力周波数の異なるデータは捨てる
+	clear_ringbuffer(&buffer_ep_Lch);
+	clear_ringbuffer(&buffer_ep_Rch);
+	clear_ringbuffer(&buffer_upsr_data_Lch_0);
+	clear_ringbuffer(&buffer_upsr_data_Rch_0);
+	handoff_reset();
+	clear_bq_filter_delay();
+	if (profile != NULL)
+		set_upsampling_profile(profile);
+	if (room_fir)
+		apply_room_fir();
+	if (clock)
+	{
+		audio_state.freq = freq;
+		select_stage_partition(audio_state.freq, is_high_power_mode);
+		renew_clock(is_high_power_mode);
+	}
+
+	save = save_and_disable_interrupts();
+	applying_clock = false;
+	bool requested = pending_clock || (pending_profile != NULL) || pending_room_fir;
+	restore_interrupts(save);
+	if (requested)
+		return;
+
+	// ES9038Q2Mのミュート解除は出力再開から数える
+	time_start_output = get_absolute_time();
+	request_output_restart();
+	switch_state = STREAM_SWITCH_IDLE;
+}
@@ -0,0 +1,26 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _STREAM_SWITCH_H_
+#define _STREAM_SWITCH_H_
+
+#include "pico/stdlib.h"
+#include "dsp_filter.h"
+
+// 切り替えシーケンスの状態
+#define STREAM_SWITCH_IDLE (0)
+#define STREAM_SWITCH_FADING (1)
+
+extern void request_stream_reconfigure(uint32_t freq, bool is_high_power);
+extern void request_stream_profile(const DSP_PROFILE *profile);
+extern void request_stream_room_fir(void);
+extern bool is_stream_switching(void);
+extern bool __not_in_flash_func(is_stream_freq_pending)(void);
+extern uint32_t get_stream_freq(void);
+extern void __not_in_flash_func(stream_switch_process)(void);
+
+#endif /* _STREAM_SWITCH_H_ */
@@ -0,0 +1,152 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#include <string.h>
+#include "telemetry.h"
+#include "pico/usb_device.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "transmit_to_dac.h"
+#include "stream_switch.h"
+#include "stage_partition.h"
+#include "deferred_work.h"
+#include "profiler.h"
+#include "trace.h"
+
+// ベンダー固有インターフェイス(バルクIN)でリングバッファ水位・フィードバック値・処理負荷・
+// アンダーラン/オーバーラン/クリップ数などを送る(オーディオクラスのインターフェイスとは独立)。
+// Core0の定期処理(50ms毎)でその時点の値をパケットにしておき、ホストがINトークンを出したら送る。
+// 送るものがないときはエンドポイントを覚えておき、パケットができた時点で送る。ホストが読まなければ何もしない。
+// トレース(TRACE_ENABLE)のイベントも同じエンドポイントで送る(先頭のmagicで区別する)。
+
+volatile uint32_t telemetry_counter[NUM_OF_TELEMETRY_COUNTER];
+volatile uint32_t telemetry_feedback_fs = 0;
+
+static struct usb_endpoint *volatile telemetry_ep = NULL;
+static uint32_t telemetry_seq = 0;
+static TELEMETRY_PACKET telemetry_packet;
+static volatile bool telemetry_ready = false;
+
+extern bool enable_output;
+extern DMA_TX_STRUCTURE dma_tx;
+
+void init_telemetry(void)
+{
+	memset((void *)telemetry_counter, 0, sizeof(telemetry_counter));
+	telemetry_ep = NULL;
+	telemetry_seq = 0;
+	telemetry_ready = false;
+}
+
+// テレメトリ、なければトレースのパケットを送る(USB割り込み中または割り込み禁止で呼ぶ) 送るものがなければfalse
+static bool __not_in_flash_func(send_packet)(struct usb_endpoint *ep)
+{
+	struct usb_buffer *buffer = usb_current_in_packet_buffer(ep);
+	if (telemetry_ready)
+	{
+		memcpy(buffer->data, &telemetry_packet, sizeof(TELEMETRY_PACKET));
+		buffer->data_len = sizeof(TELEMETRY_PACKET);
+		telemetry_ready = false;
+	}
+	else if (TRACE_ENABLE && trace_fill_usb_packet((TRACE_PACKET *)buffer->data))
+	{
+		buffer->data_len = sizeof(TRACE_PACKET);
+	}
+	else
+	{
+		return false;
+	}
+	usb_grow_transfer(ep->current_transfer, 1);
+	usb_packet_done(ep);
+	return true;
+}
+
+// 送信バッファが空いた(USB割り込み)
+void __not_in_flash_func(telemetry_on_packet)(struct usb_endpoint *ep)
+{
+	if (!send_packet(ep))
+		telemetry_ep = ep;
+}
+
+// 送信待ちのエンドポイントがあれば送る(Core0のイベント処理から毎回呼ぶ)
+void __not_in_flash_func(telemetry_usb_poll)(void)
+{
+	if (telemetry_ep == NULL)
+		return;
+
+	// USB割り込みと同じCore0なので、割り込みを止めればエンドポイントの状態は変わらない
+	uint32_t save = save_and_disable_interrupts();
+	struct usb_endpoint *ep = telemetry_ep;
+	telemetry_ep = NULL;
+	if ((ep != NULL) && (ep->current_transfer != NULL) && (!send_packet(ep)))
+		telemetry_ep = ep;
+	restore_interrupts(save);
+}
+
+static uint16_t get_max_pct(uint core, uint id, uint32_t deadline)
+{
+	PROF_STAT stat;
+	get_profile_stat(core, id, &stat);
+	return (uint16_t)((uint64_t)stat.max_cycles * 100u / deadline);
+}
+
+static void build_telemetry_packet(TELEMETRY_PACKET *packet)
+{
+	const CLOCK_CONFIG *config = get_clock_config(audio_state.freq, is_high_power_mode);
+	const STAGE_PARTITION *partition = get_stage_partition(audio_state.freq, is_high_power_mode);
+
+	memset(packet, 0, sizeof(TELEMETRY_PACKET));
+	packet->magic = TELEMETRY_MAGIC;
+	packet->version = TELEMETRY_VERSION;
+	packet->flags = (is_high_power_mode ? TELEMETRY_FLAG_HIGH_POWER : 0) |
+					(enable_output ? TELEMETRY_FLAG_OUTPUT_ENABLED : 0) |
+					(is_stream_switching() ? TELEMETRY_FLAG_SWITCHING : 0) |
+					(is_biquad2_on_core1() ? TELEMETRY_FLAG_BIQUAD2_ON_CORE1 : 0) |
+					(CHANNEL_SPLIT_MODE ? TELEMETRY_FLAG_CHANNEL_SPLIT : 0) |
+					(audio_state.mute ? TELEMETRY_FLAG_MUTE : 0) |
+					(PROFILE_ENABLE ? TELEMETRY_FLAG_PROFILE : 0);
+	packet->seq = telemetry_seq++;
+	packet->time_us = time_us_32();
+	packet->freq = audio_state.freq;
+	packet->i2s_freq = config->i2s_freq;
+	packet->sys_clock_khz = config->sys_clock_khz;
+	packet->feedback_fs = telemetry_feedback_fs;
+	packet->fill_ep = get_size_using(&buffer_ep_Lch);
+	packet->fill_upsr = get_size_using(&buffer_upsr_data_Lch_0);
+	packet->fb_threshold = SIZE_BUFFER_FB_THRESHOLD;
+	packet->dma_using = dma_tx.using;
+	packet->dma_depth = DEPTH_DMA_TX_BUFFER;
+	packet->volume = audio_state.now_volume;
+	packet->load_core0 = CHANNEL_SPLIT_MODE ? partition->load_split_core0 : partition->load_core0;
+	packet->load_core1 = CHANNEL_SPLIT_MODE ? partition->load_split_core1 : partition->load_core1;
+	if (PROFILE_ENABLE)
+	{
+		uint32_t deadline = config->sys_clock_khz / 1000 * TIMER0_US;
+		packet->max_core0_pct = get_max_pct(0, PROF_CORE0_TOTAL, deadline);
+		packet->max_core1_pct = get_max_pct(1, PROF_CORE1_TOTAL, deadline);
+	}
+	packet->underrun = telemetry_counter[TELEMETRY_COUNTER_UNDERRUN];
+	packet->overrun = telemetry_counter[TELEMETRY_COUNTER_OVERRUN];
+	packet->clip = telemetry_counter[TELEMETRY_COUNTER_CLIP] + telemetry_counter[TELEMETRY_COUNTER_CLIP_CORE0];
+	packet->timer0_lateness_us = (uint16_t)MIN(get_timer0_max_lateness_us(), UINT16_MAX);
+	packet->timer0_missed = (uint16_t)MIN(get_timer0_missed_periods(), UINT16_MAX);
+	packet->spdif_overrun = (uint16_t)MIN(telemetry_counter[TELEMETRY_COUNTER_SPDIF_OVERRUN], UINT16_MAX);
+}
+
+// 送るパケットを更新する(Core0の定期処理から呼ぶ)
+void telemetry_poll(void)
+{
+	TELEMETRY_PACKET packet;
+	build_telemetry_packet(&packet);
+
+	uint32_t save = save_and_disable_interrupts();
+	telemetry_packet = packet;
+	telemetry_ready = true;
+	restore_interrupts(save);
+
+	telemetry_usb_poll();
+}
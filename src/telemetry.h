@@ -0,0 +1,43 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+#include "pico/stdlib.h"
+#include "common.h"
+#include "telemetry_packet.h"
+
+// カウンタ(それぞれ1つのコアからのみ加算する)
+#define TELEMETRY_COUNTER_UNDERRUN (0) // Core1 DMA割り込み
+#define TELEMETRY_COUNTER_OVERRUN (1)  // Core0 USB割り込み
+#define TELEMETRY_COUNTER_CLIP (2)	   // Core1
+#define TELEMETRY_COUNTER_CLIP_CORE0 (3) // Core0(チャンネル分割モードのLch)
+#define TELEMETRY_COUNTER_SPDIF_OVERRUN (4) // Core0 S/PDIF DMA割り込み
+#define NUM_OF_TELEMETRY_COUNTER (5)
+
+// これ以上の値はint32変換で飽和する
+#define TELEMETRY_CLIP_LEVEL (2147483648.f)
+
+struct usb_endpoint;
+
+extern volatile uint32_t telemetry_counter[NUM_OF_TELEMETRY_COUNTER];
+extern volatile uint32_t telemetry_feedback_fs;
+
+extern void init_telemetry(void);
+extern void __not_in_flash_func(telemetry_on_packet)(struct usb_endpoint *ep);
+extern void __not_in_flash_func(telemetry_usb_poll)(void);
+extern void telemetry_poll(void);
+
+// TELEMETRY_ENABLE=falseの場合は何もしない
+static inline __attribute__((always_inline)) void telemetry_count(uint id, uint32_t n)
+{
+	if (TELEMETRY_ENABLE)
+		telemetry_counter[id] += n;
+}
+
+#endif /* _TELEMETRY_H_ */
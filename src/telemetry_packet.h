@@ -0,0 +1,59 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _TELEMETRY_PACKET_H_
+#define _TELEMETRY_PACKET_H_
+
+// テレメトリ用ベンダー固有インターフェイスのパケット形式(ファームウェアとホスト側ツールで共有する)
+// バルクIN 64byte リトルエンディアン
+
+#include <stdint.h>
+
+#define TELEMETRY_MAGIC (0x4c54u) // "TL"
+#define TELEMETRY_VERSION (1)
+#define TELEMETRY_PACKET_SIZE (64)
+
+#define TELEMETRY_FLAG_HIGH_POWER (1u << 0)		  // HiPowerMode
+#define TELEMETRY_FLAG_OUTPUT_ENABLED (1u << 1)	  // I2S出力中
+#define TELEMETRY_FLAG_SWITCHING (1u << 2)		  // レート・パワーモード切り替え中
+#define TELEMETRY_FLAG_BIQUAD2_ON_CORE1 (1u << 3) // Core0最終段をCore1で実行中
+#define TELEMETRY_FLAG_CHANNEL_SPLIT (1u << 4)	  // チャンネル分割モード
+#define TELEMETRY_FLAG_MUTE (1u << 5)			  // USBからのミュート
+#define TELEMETRY_FLAG_PROFILE (1u << 6)		  // max_core0_pct/max_core1_pctが有効
+
+typedef struct __attribute__((packed))
+{
+	uint16_t magic;
+	uint8_t version;
+	uint8_t flags;			  // TELEMETRY_FLAG_xxx
+	uint32_t seq;			  // 送信番号
+	uint32_t time_us;		  // 取得時刻
+	uint32_t freq;			  // 入力サンプルレート
+	uint32_t i2s_freq;		  // I2S出力周波数
+	uint32_t sys_clock_khz;	  // CPUクロック
+	uint32_t feedback_fs;	  // 最後に送ったフィードバック値(Hz)
+	uint16_t fill_ep;		  // EPバッファの使用量(サンプル)
+	uint16_t fill_upsr;		  // Core0→Core1リングバッファの使用量(サンプル)
+	uint16_t fb_threshold;	  // リングバッファのFB水位(サンプル)
+	uint8_t dma_using;		  // DMA送信バッファの使用数
+	uint8_t dma_depth;		  // DMA送信バッファの数
+	int16_t volume;			  // 現在のボリューム(1/256dB)
+	uint16_t load_core0;	  // 処理段の分割表の見積もり負荷(‰)
+	uint16_t load_core1;
+	uint16_t max_core0_pct;	  // 処理周期(250us)に対する最大処理時間(%)
+	uint16_t max_core1_pct;
+	uint32_t underrun;		  // DMA送信バッファが空になった回数
+	uint32_t overrun;		  // リングバッファが溢れそうでUSBのデータを捨てた回数
+	uint32_t clip;			  // int32変換でクリップしたサンプル数
+	uint16_t timer0_lateness_us; // 周期タイマーの最大遅れ(us)
+	uint16_t timer0_missed;		  // 周期タイマーが1周期以上遅れて抜けた周期の数
+	uint16_t spdif_overrun;	  // S/PDIFの符号化が間に合わず前のブロックを再送した回数
+} TELEMETRY_PACKET;
+
+_Static_assert(sizeof(TELEMETRY_PACKET) == TELEMETRY_PACKET_SIZE, "TELEMETRY_PACKET must be 64 bytes");
+
+#endif /* _TELEMETRY_PACKET_H_ */
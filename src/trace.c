@@ -0,0 +1,143 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#include <string.h>
+#include "trace.h"
+#include "hardware/uart.h"
+#include "profiler.h"
+
+// 処理の流れを時刻付きのバイナリイベントとしてコア毎のリングバッファに記録する。
+// GPIOにパルスを出す方法(待ち時間で観測対象のタイミングが変わる)の代わりに、
+// 記録は割り込みを止めずに数十命令程度(時刻の読み出しとLDREX/STREX)で行うので、計測点を残したまま計測できる。
+// 読み出しはCore0で行い、UART(TRACE_OUTPUT_UART)またはUSBテレメトリのインターフェイス(TELEMETRY_ENABLE)に流す。
+// ホスト側はtools/trace/ddc_trace.cで両コアのイベントを時刻順に並べたタイムラインにする。
+
+TRACE_BUFFER trace_buffer[2];
+
+// UART送信中のレコード
+static uint8_t uart_record[TRACE_UART_RECORD_SIZE];
+static uint32_t uart_sent = TRACE_UART_RECORD_SIZE;
+// 次に読み出すコア(USBとUARTで別々に持つ USB割り込みとスレッドから同時に更新しない)
+static uint usb_next_core = 0;
+static uint uart_next_core = 0;
+
+// 最後に読み出された時刻(誰も読み出さない場合は捨てる)
+static uint32_t last_drain_us = 0;
+
+void init_trace(void)
+{
+	memset(trace_buffer, 0, sizeof(trace_buffer));
+	uart_sent = TRACE_UART_RECORD_SIZE;
+	last_drain_us = time_us_32();
+
+	if (TRACE_OUTPUT_UART)
+		uart_set_baudrate(uart_default, TRACE_UART_BAUDRATE);
+}
+
+// 記録済みのイベントを読み出す(Core0から呼ぶ) 戻り値は読み出した数
+uint32_t __not_in_flash_func(trace_read)(uint core, TRACE_RECORD *record, uint32_t max_count)
+{
+	TRACE_BUFFER *trace = &trace_buffer[core];
+
+	// Core0の割り込みからも読み出すので、読み出し位置の更新と競合させない
+	uint32_t save = save_and_disable_interrupts();
+	uint32_t rp = trace->rp;
+	uint32_t count = trace->wp - rp;
+	__dmb();
+	if (count > max_count)
+		count = max_count;
+	for (uint32_t i = 0; i < count; i++)
+		record[i] = trace->record[(rp + i) & (SIZE_TRACE_BUFFER - 1)];
+	__dmb();
+	trace->rp = rp + count;
+	restore_interrupts(save);
+
+	if (count > 0)
+		last_drain_us = time_us_32();
+	return count;
+}
+
+// USBで送るパケットを作る(USB割り込みから呼ぶ) 送るイベントがなければfalse
+bool __not_in_flash_func(trace_fill_usb_packet)(TRACE_PACKET *packet)
+{
+	for (uint i = 0; i < 2; i++)
+	{
+		uint core = (usb_next_core + i) & 1;
+		uint32_t count = trace_read(core, packet->record, TRACE_RECORDS_PER_PACKET);
+		if (count == 0)
+			continue;
+
+		// 片方のコアに偏らないよう交互に送る
+		usb_next_core = core ^ 1;
+		packet->magic = TRACE_PACKET_MAGIC;
+		packet->version = TRACE_PACKET_VERSION;
+		packet->core = core;
+		packet->count = count;
+		packet->reserved = 0;
+		packet->dropped = (uint16_t)trace_buffer[core].dropped;
+		if (count < TRACE_RECORDS_PER_PACKET)
+			memset(&packet->record[count], 0, sizeof(TRACE_RECORD) * (TRACE_RECORDS_PER_PACKET - count));
+		return true;
+	}
+	return false;
+}
+
+// UARTのFIFOに空きがある分だけ送る(Core0のイベント処理から毎回呼ぶ)
+void __not_in_flash_func(trace_uart_poll)(void)
+{
+	while (uart_is_writable(uart_default))
+	{
+		if (uart_sent >= TRACE_UART_RECORD_SIZE)
+		{
+			// 計測結果のテキストを送っている間はレコードの区切りで止める
+			if (PROFILE_ENABLE && is_profile_report_pending())
+				return;
+
+			TRACE_RECORD record;
+			uint core = uart_next_core;
+			if (trace_read(core, &record, 1) == 0)
+			{
+				core ^= 1;
+				if (trace_read(core, &record, 1) == 0)
+					return;
+			}
+			uart_next_core = core ^ 1;
+
+			uint8_t sum = 0;
+			memcpy(&uart_record[4], &record, sizeof(record));
+			for (uint i = 4; i < TRACE_UART_RECORD_SIZE; i++)
+				sum += uart_record[i];
+			uart_record[0] = TRACE_UART_SYNC0;
+			uart_record[1] = TRACE_UART_SYNC1;
+			uart_record[2] = core;
+			uart_record[3] = sum;
+			uart_sent = 0;
+		}
+		uart_putc_raw(uart_default, uart_record[uart_sent++]);
+	}
+}
+
+// レコードの途中まで送ったところか(UARTを共用する計測結果の出力はレコードの区切りで行う)
+bool __not_in_flash_func(trace_uart_busy)(void)
+{
+	return uart_sent < TRACE_UART_RECORD_SIZE;
+}
+
+// 定期処理(Core0) しばらく誰も読み出していなければ古いイベントを捨て、読み出し再開時に新しいイベントから送る
+void trace_poll(void)
+{
+	if ((uint32_t)(time_us_32() - last_drain_us) < TRACE_IDLE_DISCARD_MS * 1000u)
+		return;
+
+	for (uint core = 0; core < 2; core++)
+	{
+		uint32_t save = save_and_disable_interrupts();
+		trace_buffer[core].rp = trace_buffer[core].wp; // 書き込み中(reserve - wp)のスロットは捨てない
+		restore_interrupts(save);
+	}
+	last_drain_us = time_us_32();
+}
@@ -0,0 +1,80 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "common.h"
+#include "trace_format.h"
+
+// コア毎のトレースバッファのレコード数(2のべき乗)
+#define SIZE_TRACE_BUFFER (512)
+
+// 書き込みは各コア自身(スレッドと割り込み)、読み出しはCore0のみ
+// 書き込み側はreserveでスロットを確保してからレコードを書き、最も外側の書き込みが終わったときにwpを進めて公開する
+typedef struct
+{
+	TRACE_RECORD record[SIZE_TRACE_BUFFER];
+	volatile uint32_t reserve; // 確保済みのスロット(書き込み中を含む)
+	volatile uint32_t wp;      // 書き込み済みのスロット(読み出してよい)
+	volatile uint32_t rp;
+	volatile uint32_t nest;    // 書き込み中のコンテキスト数(このコアのスレッド + 割り込みの多重度)
+	volatile uint32_t dropped;
+} TRACE_BUFFER;
+
+extern TRACE_BUFFER trace_buffer[2];
+
+extern void init_trace(void);
+extern uint32_t __not_in_flash_func(trace_read)(uint core, TRACE_RECORD *record, uint32_t max_count);
+extern bool __not_in_flash_func(trace_fill_usb_packet)(TRACE_PACKET *packet);
+extern void __not_in_flash_func(trace_uart_poll)(void);
+extern bool __not_in_flash_func(trace_uart_busy)(void);
+extern void trace_poll(void);
+
+// イベントを記録する(TRACE_ENABLE=falseの場合は何もしない)
+// 割り込みは止めない 同じコアの割り込みが途中に入っても、スロットの確保はLDREX/STREX(__atomic)なので別のスロットになる
+// 割り込みは入った順と逆に終わるので、書き込み中のコンテキストがなくなった時点で確保済みのスロットはすべて書き終わっている
+// コア間のロックはない(バッファはコア毎)
+static inline __attribute__((always_inline)) void trace_event(uint id, uint32_t payload)
+{
+	if (!TRACE_ENABLE)
+		return;
+
+	TRACE_BUFFER *trace = &trace_buffer[get_core_num()];
+	__atomic_add_fetch(&trace->nest, 1, __ATOMIC_ACQUIRE);
+
+	uint32_t slot = trace->reserve;
+	bool full;
+	do
+	{
+		full = (slot - trace->rp >= SIZE_TRACE_BUFFER);
+	} while (!full && !__atomic_compare_exchange_n(&trace->reserve, &slot, slot + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+	if (!full)
+	{
+		TRACE_RECORD *record = &trace->record[slot & (SIZE_TRACE_BUFFER - 1)];
+		record->time_us = time_us_32();
+		record->event = (id << 24) | (payload & TRACE_PAYLOAD_MASK);
+	}
+	else
+	{
+		__atomic_add_fetch(&trace->dropped, 1, __ATOMIC_RELAXED);
+	}
+
+	// 最も外側の書き込みが確保済みのスロットをまとめて公開する(wpは減らさない)
+	if (__atomic_sub_fetch(&trace->nest, 1, __ATOMIC_RELEASE) == 0)
+	{
+		uint32_t reserve = trace->reserve;
+		uint32_t wp = trace->wp;
+		while (((int32_t)(reserve - wp) > 0) && !__atomic_compare_exchange_n(&trace->wp, &wp, reserve, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+			;
+	}
+}
+
+#endif /* _TRACE_H_ */
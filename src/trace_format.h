@@ -0,0 +1,62 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _TRACE_FORMAT_H_
+#define _TRACE_FORMAT_H_
+
+// トレースイベントの形式(ファームウェアとホスト側ツールで共有する) リトルエンディアン
+
+#include <stdint.h>
+
+// イベントID(上位8bit)とペイロード(下位24bit)
+#define TRACE_ID_USB_RX (1)		  // USB Audioパケット受信(サンプル数)
+#define TRACE_ID_FEEDBACK (2)	  // フィードバック送信(Hz)
+#define TRACE_ID_TIMER0 (3)		  // 周期タイマー割り込み
+#define TRACE_ID_CORE0_BEGIN (4)  // Core0アップサンプリング開始(EPバッファの使用量)
+#define TRACE_ID_CORE0_END (5)	  // Core0アップサンプリング終了(Core1に渡したサンプル数)
+#define TRACE_ID_CORE1_BEGIN (6)  // Core1ブロック処理開始(受け取ったサンプル数)
+#define TRACE_ID_CORE1_END (7)	  // Core1ブロック処理終了(I2S送信バッファのワード数)
+#define TRACE_ID_DMA_IRQ (8)	  // I2S DMA転送完了(DMA送信バッファの使用数)
+#define TRACE_ID_UNDERRUN (9)	  // DMA送信バッファが空になった
+#define TRACE_ID_OVERRUN (10)	  // リングバッファが溢れそうでUSBのデータを捨てた(捨てたサンプル数)
+#define TRACE_ID_STREAM_SWITCH (11) // 切り替えシーケンス(0:フェード開始 1:クロック再設定)
+#define TRACE_ID_SPLIT_BEGIN (12) // チャンネル分割モードのLch処理開始(Core0)
+#define TRACE_ID_SPLIT_END (13)	  // チャンネル分割モードのLch処理終了(Core0)
+#define NUM_OF_TRACE_ID (14)
+
+#define TRACE_PAYLOAD_MASK (0x00ffffffu)
+
+typedef struct __attribute__((packed))
+{
+	uint32_t time_us; // time_us_32() 両コア共通のタイマー
+	uint32_t event;	  // (ID << 24) | ペイロード
+} TRACE_RECORD;
+
+// UART出力 1レコード12byte: 'T' 'R' コア番号 チェックサム(レコード8byteの和) レコード
+#define TRACE_UART_SYNC0 ('T')
+#define TRACE_UART_SYNC1 ('R')
+#define TRACE_UART_RECORD_SIZE (12)
+
+// USB出力(テレメトリのバルクINにテレメトリのパケットと混ぜて送る) 64byte
+#define TRACE_PACKET_MAGIC (0x5254u) // "TR"
+#define TRACE_PACKET_VERSION (1)
+#define TRACE_RECORDS_PER_PACKET (7)
+
+typedef struct __attribute__((packed))
+{
+	uint16_t magic;
+	uint8_t version;
+	uint8_t core;
+	uint8_t count;	  // 有効なレコード数
+	uint8_t reserved;
+	uint16_t dropped; // バッファが一杯で捨てたイベント数(累計 下位16bit)
+	TRACE_RECORD record[TRACE_RECORDS_PER_PACKET];
+} TRACE_PACKET;
+
+_Static_assert(sizeof(TRACE_PACKET) == 64, "TRACE_PACKET must be 64 bytes");
+
+#endif /* _TRACE_FORMAT_H_ */
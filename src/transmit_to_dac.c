@@ -11,9 +11,30 @@
 #include "hardware/pwm.h"
 #include "i2s_pio_interface.h"
 #include "upsampling.h"
+#include "delta_sigma.h"
+#include "scheduler.h"
+#include "core_handoff.h"
+#include "stage_partition.h"
+#include "channel_split.h"
+#include "profiler.h"
+#include "deferred_work.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "flow_control.h"
+
+// 1bit出力の変調器の次数・変調倍率は、Core1の予算(HiPowerModeのクロック 44.1kHz系・48kHz系)に収まるものだけビルドできる
+#define ONEBIT_WITHIN_BUDGET(order)                                                                        \
+    (SDM_WITHIN_BUDGET(order, ONEBIT_MODULATION_RATIO, SYS_CLOCK_KHZ_44K, 44100 * RATIO_UPSAMPLING_48K) && \
+     SDM_WITHIN_BUDGET(order, ONEBIT_MODULATION_RATIO, SYS_CLOCK_KHZ_48K, 48000 * RATIO_UPSAMPLING_48K))
+#if DSD_OUTPUT_ENABLE && !ONEBIT_WITHIN_BUDGET(DSD_ORDER)
+#error "DSD_ORDER exceeds the Core1 cycle budget (SDM_CYCLES_X2 in delta_sigma.h)"
+#elif SDM_OUTPUT_ENABLE && !DSD_OUTPUT_ENABLE && !ONEBIT_WITHIN_BUDGET(SDM_ORDER)
+#error "SDM_ORDER / SDM_OVERSAMPLING exceed the Core1 cycle budget (SDM_CYCLES_X2 in delta_sigma.h)"
+#endif
 
 static const PIO pio = pio0;
 static const uint sm = 0;
+static const uint sm_mclk = 2; // SM1はS/PDIFで使用
 static pio_sm_config sm_config;
 static uint offset;
 
@@ -40,7 +61,13 @@ void __not_in_flash_func(pwm_wrap_handler)(void);
 
 void reset_i2s_freq(void)
 {
-    I2S_freq_init(pio, sm, &sm_config, offset);
+    if (ONEBIT_OUTPUT_ENABLE)
+        SDM_freq_init(pio, sm, &sm_config, offset);
+    else
+        I2S_freq_init(pio, sm, &sm_config, offset);
+
+    if (MCLK_OUTPUT_ENABLE)
+        MCLK_freq_init(pio, sm_mclk, MCLK_PIN, sm);
 }
 
 void init_i2s_interface(void)
@@ -59,8 +86,25 @@ void init_i2s_interface(void)
         gpio_set_drive_strength(I2S_SIDESET_BASE + 1, GPIO_DRIVE_STRENGTH_12MA);
     }
 
-    // PIO I2Sの初期化
-    if(I2S_SIDESET_CHANGE)
+    if(MCLK_OUTPUT_ENABLE)
+    {
+        gpio_set_slew_rate(MCLK_PIN, GPIO_SLEW_RATE_FAST);
+        gpio_set_drive_strength(MCLK_PIN, GPIO_DRIVE_STRENGTH_12MA);
+        MCLK_program_init(pio, sm_mclk, MCLK_PIN);
+    }
+
+    // PIO I2Sの初期化(1bit出力時はI2Sの代わりにSM0から1bitストリームを出力する)
+    if(DSD_OUTPUT_ENABLE)
+    {
+        DSD_2ch_program_init(pio, sm, DSD_DATA_PIN_BASE, DSD_CLK_PIN, &sm_config, &offset);
+        init_delta_sigma(DSD_ORDER, ONEBIT_MODULATION_RATIO, ONEBIT_BITS_PER_SAMPLE);
+    }
+    else if(SDM_OUTPUT_ENABLE)
+    {
+        SDM_2ch_program_init(pio, sm, SDM_OUT_PIN_BASE, &sm_config, &offset);
+        init_delta_sigma(SDM_ORDER, ONEBIT_MODULATION_RATIO, ONEBIT_BITS_PER_SAMPLE);
+    }
+    else if(I2S_SIDESET_CHANGE)
     {
         I2S_32bit_inv_program_init(pio, sm, I2S_DATA_PIN, I2S_SIDESET_BASE, AUDIO_INITIAL_FREQ, &sm_config, &offset);
     }
@@ -92,8 +136,15 @@ void init_i2s_interface(void)
 // DMA TX割り込み処理
 void __not_in_flash_func(dma_tx_irq_handler)(void)
 {
+    uint32_t start_us = time_us_32();
     i2s_tx_process();
     dma_hw->ints0 = 1u << dma_ch; // 割り込みフラグクリア
+    trace_event(TRACE_ID_DMA_IRQ, dma_tx.using);
+
+    // 送信バッファに空きができたのでCore1に補充させる
+    sched_post(1, SCHED_EVENT_DMA_DONE);
+
+    irq_stat_record(IRQ_ID_DMA_I2S, start_us);
 }
 
 // I2S送信タイミング通知を行う
@@ -115,21 +166,128 @@ static int32_t buffer_i2s_transmit[SIZE_DMA_TX_BUF];
 static volatile bool enable_output_prev = false;
 extern volatile absolute_time_t time_start_output;
 
+// 出力フェード制御(切り替え時のクリックノイズ対策)
+static float output_gain = 0.f;
+static volatile float output_gain_target = 1.f;
+static volatile uint32_t count_silent_block = 0;
+static volatile bool restart_low_fill = false;
+
+// 出力をフェードアウトさせる
+void request_output_fade_out(void)
+{
+    count_silent_block = 0;
+    output_gain_target = 0.f;
+}
+
+// 切り替え完了後、低い水位から出力を再開してフェードインさせる
+void request_output_restart(void)
+{
+    restart_low_fill = true;
+    output_gain_target = 1.f;
+}
+
+// フェードアウトが完了し、無音がDMA送信バッファの先まで行き渡ったかどうか
+bool is_output_faded_out(void)
+{
+    return (!enable_output) || (count_silent_block > DEPTH_DMA_TX_BUFFER);
+}
+
+// 1ブロック(出力lengthサンプル)分のフェードの開始ゲインと1サンプルあたりの増分を求め、ゲインを目標値に近づける
+static void __not_in_flash_func(prepare_output_fade)(uint32_t length, float *gain_start, float *gain_step)
+{
+    float target = output_gain_target;
+
+    *gain_start = output_gain;
+    *gain_step = 0.f;
+    if (output_gain == target)
+    {
+        if (target == 0.f)
+            count_silent_block++;
+        return;
+    }
+
+    // SWITCH_FADE_BLOCKSブロックかけて線形にフェードする
+    float gain_end = output_gain + ((target > output_gain) ? (1.f / SWITCH_FADE_BLOCKS) : (-1.f / SWITCH_FADE_BLOCKS));
+    gain_end = saturation_f32(gain_end, 1.f, 0.f);
+    if ((target > output_gain) ? (gain_end > target) : (gain_end < target))
+        gain_end = target;
+
+    *gain_step = (length > 0) ? (gain_end - output_gain) / (float)length : 0.f;
+    output_gain = gain_end;
+}
+
+// ゲインを1ブロックかけて目標値に近づける(入力バッファを直接書き換える)
+static void __not_in_flash_func(apply_output_fade)(float *in_L, float *in_R, uint32_t length)
+{
+    float gain, step;
+    prepare_output_fade(length, &gain, &step);
+
+    if (step == 0.f)
+    {
+        if (gain == 0.f)
+        {
+            memset(in_L, 0, sizeof(float) * length);
+            memset(in_R, 0, sizeof(float) * length);
+        }
+        return;
+    }
+
+    for (uint i = 0; i < length; i++)
+    {
+        gain += step;
+        in_L[i] *= gain;
+        in_R[i] *= gain;
+    }
+}
+
+// フェードをかけながらI2S送信バッファに変換する
+static uint32_t __not_in_flash_func(convert_to_i2s_with_fade)(float *in_L, float *in_R, int32_t *out, uint32_t length)
+{
+    uint32_t count = 0;
+    uint32_t clip = 0;
+
+    apply_output_fade(in_L, in_R, length);
+    for (uint i = 0; i < length; i++)
+    {
+        if (TELEMETRY_ENABLE)
+            clip += (fabsf(in_L[i]) >= TELEMETRY_CLIP_LEVEL) + (fabsf(in_R[i]) >= TELEMETRY_CLIP_LEVEL);
+        out[count++] = (int32_t)in_L[i];
+        out[count++] = (int32_t)in_R[i];
+    }
+    telemetry_count(TELEMETRY_COUNTER_CLIP, clip);
+    return count;
+}
+
 void __not_in_flash_func(dma_tx_start)(void)
 {
+    // Core0から通知されたブロックを取り込み、通知済みの分だけを読む
+    handoff_poll();
     int32_t length = get_size_using(&buffer_upsr_data_Lch_0);
+    int32_t available = handoff_get_available();
+    if (length > available)
+        length = available;
 
-    // バッファに規定量以上のデータが溜まってから出力開始
-    if (length > SIZE_BUFFER_FB_THRESHOLD)
-        enable_output = true;
-
+    // バッファに規定量以上のデータが溜まってから出力開始(切り替え直後は低い水位から再開する)
     // 入ってくるデータが枯渇したうえで、DMA送信バッファ内のすべてのデータを送信完了したら出力停止
-    else if ((length <= 0) && (dma_tx.using == 0))
+    switch (flow_output_decision(&flow_param, restart_low_fill, length, dma_tx.using))
+    {
+    case FLOW_OUTPUT_START:
+        enable_output = true;
+        restart_low_fill = false;
+        break;
+    case FLOW_OUTPUT_STOP:
         enable_output = false;
+        break;
+    default:
+        break;
+    }
 
-    // 出力開始した時間を取得
+    // 出力開始した時間を取得し、無音からフェードインさせる
     if(enable_output == true && enable_output_prev == false)
+    {
         time_start_output = get_absolute_time();
+        output_gain = 0.f;
+    }
     enable_output_prev = enable_output;
 
     if (enable_output)
@@ -137,22 +295,44 @@ void __not_in_flash_func(dma_tx_start)(void)
         // 入ってくるデータが枯渇した、またはDMA送信バッファに規定量以上データが蓄積されているときはデータ送信処理をしない
         if ((length > 0) && (dma_tx.using < SIZE_DMA_TX_BUF_STACK))
         {
-            int32_t transmit_ref_size = audio_state.freq * get_ratio_upsampling_core0(audio_state.freq) / 1000 * (TIMER_US_CORE1 / 1000.0);
-            length = saturation_i32(length, transmit_ref_size, 0);
+            uint32_t prof_total = profile_start();
+            trace_event(TRACE_ID_CORE1_BEGIN, length);
+            length = flow_core1_transmit_size(&flow_param, audio_state.freq, get_ratio_core0_output(audio_state.freq), length);
 
+            uint32_t read_point = get_read_point(&buffer_upsr_data_Lch_0);
             ringbuf_read_array_spinlock((int32_t*)from_core0_Lch, length, &buffer_upsr_data_Lch_0);
             ringbuf_read_array_spinlock((int32_t*)from_core0_Rch, length, &buffer_upsr_data_Rch_0);
 
-            // Core1で、さらにアップサンプリングをする(絶対250us以内に終わらせること)
-            length = upsampling_process_core1(from_core0_Lch, from_core0_Rch, upsr_core1_Lch, upsr_core1_Rch, length);
+            // 読み出したブロックをCore0に返す
+            handoff_release(read_point, length);
 
-            int count = 0;
-            for (uint i = 0; i < length; i++)
+            int count;
+            if (ONEBIT_OUTPUT_ENABLE)
             {
-                buffer_i2s_transmit[count++] = (int32_t)upsr_core1_Lch[i];
-                buffer_i2s_transmit[count++] = (int32_t)upsr_core1_Rch[i];
+                // Core1で、Delta-Sigma変調をする(絶対250us以内に終わらせること)
+                uint32_t prof = profile_start();
+                apply_output_fade(from_core0_Lch, from_core0_Rch, length);
+                count = delta_sigma_modulate(from_core0_Lch, from_core0_Rch, (uint32_t *)buffer_i2s_transmit, length);
+                profile_end(PROF_CONVERT, prof);
             }
+            else if (CHANNEL_SPLIT_MODE)
+            {
+                // LchをCore0、RchをCore1で並列にアップサンプリングし、I2S送信バッファの偶数/奇数スロットに書き込む
+                float gain, step;
+                prepare_output_fade(length * get_ratio_upsampling_core0(audio_state.freq) * get_ratio_upsampling_core1(), &gain, &step);
+                count = channel_split_process(from_core0_Lch, from_core0_Rch, buffer_i2s_transmit, length, gain, step);
+            }
+            else
+            {
+                // Core1で、さらにアップサンプリングをする(絶対250us以内に終わらせること)
+                length = upsampling_process_core1(from_core0_Lch, from_core0_Rch, upsr_core1_Lch, upsr_core1_Rch, length);
 
+                uint32_t prof = profile_start();
+                count = convert_to_i2s_with_fade(upsr_core1_Lch, upsr_core1_Rch, buffer_i2s_transmit, length);
+                profile_end(PROF_CONVERT, prof);
+            }
+
+            uint32_t prof_handoff = profile_start();
             uint32_t save = save_and_disable_interrupts();
             dma_tx.data[dma_tx.wp].tx_size = count;
             memcpy((void *)dma_tx.data[dma_tx.wp].tx_buf, (void *)buffer_i2s_transmit, sizeof(uint32_t) * dma_tx.data[dma_tx.wp].tx_size);
@@ -170,6 +350,9 @@ void __not_in_flash_func(dma_tx_start)(void)
                 is_enabled_dma_tx_isr = true;
                 i2s_tx_process();
             }
+            profile_end(PROF_DMA_HANDOFF, prof_handoff);
+            profile_end(PROF_CORE1_TOTAL, prof_total);
+            trace_event(TRACE_ID_CORE1_END, count);
         }
     }
     else
@@ -190,7 +373,12 @@ void __not_in_flash_func(i2s_tx_process)(void)
 
     if (dma_tx.using == 0)
     {
-        // buffer is empty
+        // buffer is empty (出力中に送信が途切れた場合はアンダーラン)
+        if (enable_output && (dma_tx.prev_write_length != 0))
+        {
+            telemetry_count(TELEMETRY_COUNTER_UNDERRUN, 1);
+            trace_event(TRACE_ID_UNDERRUN, 0);
+        }
         dma_tx.prev_write_length = 0;
         return;
     }
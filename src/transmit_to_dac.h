@@ -36,6 +36,9 @@ extern void init_i2s_interface(void);
 extern void reset_i2s_freq(void);
 extern void __not_in_flash_func(dma_tx_start)(void);
 extern void dma_stop_and_clear(void);
+extern void request_output_fade_out(void);
+extern void request_output_restart(void);
+extern bool is_output_faded_out(void);
 extern void pwm_i2s_streaming_rate_change(void);
 extern void set_pwm_isr_1(float period_us);
 
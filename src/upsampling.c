@@ -7,231 +7,349 @@
 
 #include <arm_math.h>
 #include "upsampling.h"
-#include "debug_with_gpio.h"
+#include "dsp_q31.h"
+#include "dsp_volume.h"
 #include "ringbuffer.h"
 #include "common.h"
+#include "spdif_output.h"
+#include "stage_partition.h"
+#include "profiler.h"
+#include "transmit_to_dac.h"
+#include "flow_control.h"
+#include "hardware/clocks.h"
 
-#define ARM_FIR_BLOCKSIZE_0 SIZE_EP_BUFFER *RATIO_UPSAMPLING_48K / 2
-#define ARM_FIR_BLOCKSIZE_1 SIZE_EP_BUFFER *RATIO_UPSAMPLING_48K / 2
-#define ARM_FIR_BLOCKSIZE_2 SIZE_EP_BUFFER *RATIO_UPSAMPLING_48K
-
-// 双二次フィルタ構造体
-static arm_biquad_casd_df1_inst_f32 biquad_filter2L;
-static arm_biquad_casd_df1_inst_f32 biquad_filter2R;
-static arm_biquad_casd_df1_inst_f32 biquad_filter3L;
-static arm_biquad_casd_df1_inst_f32 biquad_filter3R;
-static arm_biquad_casd_df1_inst_f32 biquad_filter4L;
-static arm_biquad_casd_df1_inst_f32 biquad_filter4R;
-
-// 双二次フィルタ状態バッファ
-static float biquad2L_state[SIZE_BQ_FILTER_2 * 4];
-static float biquad2R_state[SIZE_BQ_FILTER_2 * 4];
-static float biquad3L_state[SIZE_BQ_FILTER_3 * 4];
-static float biquad3R_state[SIZE_BQ_FILTER_3 * 4];
-static float biquad4L_state[SIZE_BQ_FILTER_4 * 4];
-static float biquad4R_state[SIZE_BQ_FILTER_4 * 4];
-
-// 双二次フィルタ係数
-static float biquad2_coeffs[SIZE_BQ_FILTER_2 * 5];
-static float biquad3_coeffs[SIZE_BQ_FILTER_3 * 5];
-static float biquad4_coeffs[SIZE_BQ_FILTER_4 * 5];
-
-// ARM FIR構造体
-arm_fir_interpolate_instance_f32 fir_filter4x0L;
-arm_fir_interpolate_instance_f32 fir_filter4x0R;
-arm_fir_interpolate_instance_f32 fir_filter2x1L;
-arm_fir_interpolate_instance_f32 fir_filter2x1R;
-arm_fir_interpolate_instance_f32 fir_filter2x2L;
-arm_fir_interpolate_instance_f32 fir_filter2x2R;
-
-// ARM FIR 状態保存バッファ
-float fir4x0L_state[ARM_FIR_BLOCKSIZE_0 + SIZE_FIR_FILTER_0 - 1];
-float fir4x0R_state[ARM_FIR_BLOCKSIZE_0 + SIZE_FIR_FILTER_0 - 1];
-float fir2x1L_state[ARM_FIR_BLOCKSIZE_1 + SIZE_FIR_FILTER_1 - 1];
-float fir2x1R_state[ARM_FIR_BLOCKSIZE_1 + SIZE_FIR_FILTER_1 - 1];
-
-// BiQuad-IIRフィルタの係数を初期化する
-static void initialize_bq_filter_coef(void)
+_Static_assert(SIZE_EP_BUFFER * RATIO_UPSAMPLING_48K / 2 <= DSP_FIR_BLOCKSIZE, "DSP_FIR_BLOCKSIZE is too small");
+
+// フィルタの状態(演算はdsp_filter.c)
+static DSP_CHANNEL dsp_channel[NUM_OF_CH];
+#define dsp_L (&dsp_channel[0])
+#define dsp_R (&dsp_channel[1])
+
+// 長いFIRの状態(LONG_FIR_ENABLEのときだけ使う 係数はdsp_long_fir.cで共有)
+static DSP_LONG_FIR long_fir[NUM_OF_CH];
+
+// ルーム補正FIRの状態(ROOM_FIR_ENABLEのときだけ使う) インパルス応答のサンプルレートと入力が同じ場合だけ実行する
+static DSP_ROOM_FIR room_fir[NUM_OF_CH];
+static volatile uint32_t room_fir_freq = 0;
+
+// クロスフィード(CROSSFEED_ENABLEのときだけ使う 係数は入力レートが変わったときに計算し直す)
+static DSP_CROSSFEED crossfeed;
+
+// 音量(USBの音量・ミュート) 入力のint32にかけ、変わったときはVOLUME_RAMP_MSかけてランプする
+static DSP_VOLUME input_volume;
+
+// 倍精度の状態で実行する最終段のBiQuad-IIR(BQ_F64_ENABLEのときだけ使う)
+static DSP_BQ_F64 bq_f64_2x_3[NUM_OF_CH];
+static DSP_BQ_F64 bq_f64_4x_0[NUM_OF_CH];
+
+// Q31固定小数点のフィルタの状態(Q31_PIPELINE_MODEのときだけ使う 係数はプロファイルからRAMに量子化する)
+static DSP_Q31_CHANNEL dsp_q31_channel[NUM_OF_CH];
+
+// アップサンプリングフィルタの初期化処理
+extern void init_upsampling_filter(void)
 {
-    for (uint16_t i = 0; i < SIZE_BQ_FILTER_2; i++)
+    const DSP_PROFILE *profile = &dsp_profile_table[FILTER_PROFILE_DEFAULT];
+    dsp_init_filter_coef(profile);
+    dsp_init_channel(dsp_L, profile, DEFAULT_GAIN_RATIO);
+    dsp_init_channel(dsp_R, profile, DEFAULT_GAIN_RATIO);
+    dsp_volume_init_table();
+    dsp_volume_init(&input_volume, DSP_VOLUME_UNITY);
+    if (BQ_F64_ENABLE)
     {
-        biquad2_coeffs[i * 5 + 0] = coef_bq_filter_2x_2[i][0];
-        biquad2_coeffs[i * 5 + 1] = coef_bq_filter_2x_2[i][1];
-        biquad2_coeffs[i * 5 + 2] = coef_bq_filter_2x_2[i][2];
-        biquad2_coeffs[i * 5 + 3] = -coef_bq_filter_2x_2[i][4];
-        biquad2_coeffs[i * 5 + 4] = -coef_bq_filter_2x_2[i][5];
+        dsp_set_bq_f64(dsp_L, &bq_f64_2x_3[0], &bq_f64_4x_0[0]);
+        dsp_set_bq_f64(dsp_R, &bq_f64_2x_3[1], &bq_f64_4x_0[1]);
     }
-    arm_biquad_cascade_df1_init_f32(
-        &biquad_filter2L,
-        SIZE_BQ_FILTER_2,
-        biquad2_coeffs,
-        biquad2L_state
-    );
-    arm_biquad_cascade_df1_init_f32(
-        &biquad_filter2R,
-        SIZE_BQ_FILTER_2,
-        biquad2_coeffs,
-        biquad2R_state
-    );
-
-    for (uint16_t i = 0; i < SIZE_BQ_FILTER_3; i++)
+    if (LONG_FIR_ENABLE)
     {
-        biquad3_coeffs[i * 5 + 0] = coef_bq_filter_2x_3[i][0];
-        biquad3_coeffs[i * 5 + 1] = coef_bq_filter_2x_3[i][1];
-        biquad3_coeffs[i * 5 + 2] = coef_bq_filter_2x_3[i][2];
-        biquad3_coeffs[i * 5 + 3] = -coef_bq_filter_2x_3[i][4];
-        biquad3_coeffs[i * 5 + 4] = -coef_bq_filter_2x_3[i][5];
+        dsp_long_fir_init_coef();
+        dsp_set_long_fir(dsp_L, &long_fir[0]);
+        dsp_set_long_fir(dsp_R, &long_fir[1]);
     }
-    arm_biquad_cascade_df1_init_f32(
-        &biquad_filter3L,
-        SIZE_BQ_FILTER_3,
-        biquad3_coeffs,
-        biquad3L_state);
-    arm_biquad_cascade_df1_init_f32(
-        &biquad_filter3R,
-        SIZE_BQ_FILTER_3,
-        biquad3_coeffs,
-        biquad3R_state);
-
-    for (uint16_t i = 0; i < SIZE_BQ_FILTER_4; i++)
+    if (ROOM_FIR_ENABLE)
     {
-        biquad4_coeffs[i * 5 + 0] = coef_bq_filter_4x_0[i][0];
-        biquad4_coeffs[i * 5 + 1] = coef_bq_filter_4x_0[i][1];
-        biquad4_coeffs[i * 5 + 2] = coef_bq_filter_4x_0[i][2];
-        biquad4_coeffs[i * 5 + 3] = -coef_bq_filter_4x_0[i][4];
-        biquad4_coeffs[i * 5 + 4] = -coef_bq_filter_4x_0[i][5];
+        dsp_room_fir_init(&room_fir[0]);
+        dsp_room_fir_init(&room_fir[1]);
+        dsp_set_room_fir(dsp_L, &room_fir[0]);
+        dsp_set_room_fir(dsp_R, &room_fir[1]);
+    }
+    if (CROSSFEED_ENABLE)
+        dsp_crossfeed_init(&crossfeed, audio_state.freq, CROSSFEED_CUT_FREQ, CROSSFEED_LEVEL_DB, CROSSFEED_DELAY_US);
+    if (Q31_PIPELINE_MODE)
+    {
+        dsp_q31_init_channel(&dsp_q31_channel[0], profile, DEFAULT_GAIN_RATIO);
+        dsp_q31_init_channel(&dsp_q31_channel[1], profile, DEFAULT_GAIN_RATIO);
     }
-    arm_biquad_cascade_df1_init_f32(
-        &biquad_filter4L,
-        SIZE_BQ_FILTER_4,
-        biquad4_coeffs,
-        biquad4L_state);
-    arm_biquad_cascade_df1_init_f32(
-        &biquad_filter4R,
-        SIZE_BQ_FILTER_4,
-        biquad4_coeffs,
-        biquad4R_state);
-
-    arm_fir_interpolate_init_f32(&fir_filter4x0L, 4, size_coef_fir_filter_4x_0, coef_fir_filter_4x_0, fir4x0L_state, ARM_FIR_BLOCKSIZE_0);
-    arm_fir_interpolate_init_f32(&fir_filter4x0R, 4, size_coef_fir_filter_4x_0, coef_fir_filter_4x_0, fir4x0R_state, ARM_FIR_BLOCKSIZE_0);
-    arm_fir_interpolate_init_f32(&fir_filter2x1L, 2, size_coef_fir_filter_2x_1, coef_fir_filter_2x_1, fir2x1L_state, ARM_FIR_BLOCKSIZE_1);
-    arm_fir_interpolate_init_f32(&fir_filter2x1R, 2, size_coef_fir_filter_2x_1, coef_fir_filter_2x_1, fir2x1R_state, ARM_FIR_BLOCKSIZE_1);
 }
 
-// アップサンプリングフィルタの初期化処理
-extern void init_upsampling_filter(void)
+// 音量の目標を設定する(Q30 DSP_VOLUME_UNITYで0dB ミュートは0) USB割り込みから呼んでよい
+// Core0が次のブロックから入力にVOLUME_RAMP_MSかけて直線で近づける(バッファ・フィルタの状態はそのまま)
+void set_upsampling_volume(int32_t volume)
 {
-    initialize_bq_filter_coef();
-    clear_bq_filter_delay();
+    dsp_volume_request(&input_volume, volume);
 }
 
-// BiQuad-IIRフィルタの遅延バッファをクリアする
-extern void clear_bq_filter_delay(void)
+// フィルタプロファイルをすぐに切り替える(出力を止めているときに呼ぶ)
+void set_upsampling_profile(const DSP_PROFILE *profile)
 {
-    for (uint16_t i = 0; i < SIZE_BQ_DELAY_2 * 4; i++)
-    {
-        biquad2L_state[i] = 0;
-        biquad2R_state[i] = 0;
-    }
-    for (uint16_t i = 0; i < SIZE_BQ_DELAY_3 * 4; i++)
+    dsp_set_profile(dsp_L, profile);
+    dsp_set_profile(dsp_R, profile);
+    if (Q31_PIPELINE_MODE)
     {
-        biquad3L_state[i] = 0;
-        biquad3R_state[i] = 0;
+        dsp_q31_init_channel(&dsp_q31_channel[0], profile, DEFAULT_GAIN_RATIO);
+        dsp_q31_init_channel(&dsp_q31_channel[1], profile, DEFAULT_GAIN_RATIO);
     }
-    for (uint16_t i = 0; i < SIZE_BQ_DELAY_4 * 4; i++)
-    {
-        biquad4L_state[i] = 0;
-        biquad4R_state[i] = 0;
-    }
-    for (uint16_t i = 0; i < (ARM_FIR_BLOCKSIZE_0 + SIZE_FIR_FILTER_0 - 1); i++)
-    {
-        fir4x0L_state[i] = 0;
-        fir4x0R_state[i] = 0;
-    }
-    for (uint16_t i = 0; i < (ARM_FIR_BLOCKSIZE_1 + SIZE_FIR_FILTER_1 - 1); i++)
+}
+
+// フィルタプロファイルの切り替えを要求する(FIR段を処理するコアが新旧をクロスフェードしながら切り替える)
+void request_upsampling_profile(const DSP_PROFILE *profile, uint32_t xfade_length)
+{
+    dsp_request_profile(dsp_L, profile, xfade_length);
+    dsp_request_profile(dsp_R, profile, xfade_length);
+}
+
+bool is_upsampling_profile_switching(void)
+{
+    return dsp_is_profile_switching(dsp_L) || dsp_is_profile_switching(dsp_R);
+}
+
+// パラメトリックEQのバンド設定(ch毎 band[ch]のnum_band[ch]個)から係数を計算し、入れ替えを要求する
+// 両chの係数を計算できた場合だけ両chの入れ替えを要求する(入れ替えはCore0/各チャンネルを処理するコアがブロックの区切りで行う)
+// 前の入れ替えがまだ取り込まれていない場合・範囲外のバンドがある場合はfalse(どちらのchも変えない)
+bool set_upsampling_peq(DSP_PEQ_BAND (*band)[DSP_PEQ_MAX_BAND], const uint8_t *num_band, uint32_t freq)
+{
+    for (uint ch = 0; ch < NUM_OF_CH; ch++)
     {
-        fir2x1L_state[i] = 0;
-        fir2x1R_state[i] = 0;
+        if (!dsp_peq_prepare(&dsp_channel[ch].peq, band[ch], num_band[ch], (float)freq))
+            return false;
     }
+    for (uint ch = 0; ch < NUM_OF_CH; ch++)
+        dsp_peq_commit(&dsp_channel[ch].peq);
+    return true;
 }
 
-// upsampling FIR 4x
-static uint32_t __not_in_flash_func(FIR_filter_4x)(uint32_t length, float *input, float *output, arm_fir_interpolate_instance_f32 *S)
+uint16_t get_upsampling_peq_sections(uint ch)
 {
-    arm_fir_interpolate_f32(S, input, output, length);
-    return length << 2;
+    return dsp_peq_num_section(&dsp_channel[ch].peq);
 }
 
-// upsampling FIR 2x
-static uint32_t __not_in_flash_func(FIR_filter_2x)(uint32_t length, float *input, float *output, arm_fir_interpolate_instance_f32 *S)
+bool is_upsampling_peq_pending(void)
 {
-    arm_fir_interpolate_f32(S, input, output, length);
-    return length << 1;
+    return dsp_peq_is_pending(&dsp_L->peq) || dsp_peq_is_pending(&dsp_R->peq);
 }
 
-// upsampling biquad IIR filter NOS統合版 (RAM上で実行する)
-static uint32_t __not_in_flash_func(fast_BQ_filter_2x_2)(uint32_t length, float *p_in, float *p_out, arm_biquad_casd_df1_inst_f32 *S)
+// ルーム補正FIRのインパルス応答(各chnum_taps個 freqのサンプルレート用)を読み込む num_tapsが0の場合は無効にする
+// 分割毎にFFTするので時間がかかる 出力を止めているときに呼ぶ(切り替えシーケンス stream_switch.c)
+bool load_upsampling_room_fir(const float *ir_L, const float *ir_R, uint32_t num_taps, uint32_t freq)
 {
-    uint32_t length_buffer = length;
-    float *NOS_buffer = (float *)malloc(sizeof(float) * (length << 1));
-    float *p_NOS_buffer = NOS_buffer;
+    if (!ROOM_FIR_ENABLE)
+        return false;
 
-    // サンプル数を2倍にする NOS方式
-    while (length_buffer--)
+    room_fir_freq = 0;
+    if (!dsp_room_fir_load(&room_fir[0], ir_L, num_taps) || !dsp_room_fir_load(&room_fir[1], ir_R, num_taps))
     {
-        *(p_NOS_buffer++) = *(p_in);
-        *(p_NOS_buffer++) = *(p_in++);
+        dsp_room_fir_load(&room_fir[0], NULL, 0);
+        dsp_room_fir_load(&room_fir[1], NULL, 0);
+        return false;
     }
+    room_fir_freq = (num_taps != 0) ? freq : 0;
+    return true;
+}
+
+uint32_t get_upsampling_room_fir_taps(void)
+{
+    return ROOM_FIR_ENABLE ? dsp_room_fir_num_taps(&room_fir[0]) : 0;
+}
 
-    // BiQuad-IIRフィルタを実行する
-    arm_biquad_cascade_df1_f32(S, NOS_buffer, p_out, length << 1);
+// 遅延(入力サンプル数)
+uint32_t get_upsampling_room_fir_latency(void)
+{
+    return ROOM_FIR_ENABLE ? dsp_room_fir_latency(&room_fir[0]) : 0;
+}
 
-    free(NOS_buffer);
-    return length << 1;
+// 現在の入力レートでルーム補正FIRを実行するか
+static bool __not_in_flash_func(is_room_fir_active)(void)
+{
+    return ROOM_FIR_ENABLE && (room_fir_freq == audio_state.freq);
 }
 
-// upsampling biquad IIR filter NOS統合版 (RAM上で実行する)
-static uint32_t __not_in_flash_func(fast_BQ_filter_2x_3)(uint32_t length, float *p_in, float *p_out, arm_biquad_casd_df1_inst_f32 *S)
+// BiQuad-IIRフィルタの遅延バッファをクリアする
+extern void clear_bq_filter_delay(void)
 {
-    uint32_t length_buffer = length;
-    float *NOS_buffer = (float *)malloc(sizeof(float) * (length << 1));
-    float *p_NOS_buffer = NOS_buffer;
+    dsp_clear_channel(dsp_L);
+    dsp_clear_channel(dsp_R);
+    dsp_crossfeed_clear(&crossfeed);
+    dsp_q31_clear_channel(&dsp_q31_channel[0]);
+    dsp_q31_clear_channel(&dsp_q31_channel[1]);
+}
 
-    // サンプル数を2倍にする NOS方式
-    while (length_buffer--)
-    {
-        *(p_NOS_buffer++) = *(p_in);
-        *(p_NOS_buffer++) = *(p_in++);
-    }
+// 入力サンプルレート区分を切り替える(全バッファのクリアではなく、切り替え先で使う段のみ初期化する)
+static void __not_in_flash_func(select_rate_class)(uint16_t rate_class)
+{
+    dsp_select_rate_class(dsp_L, rate_class);
+    dsp_select_rate_class(dsp_R, rate_class);
+}
 
-    // BiQuad-IIRフィルタを実行する
-    arm_biquad_cascade_df1_f32(S, NOS_buffer, p_out, length << 1);
+// upsampling FIR (倍率は入力サンプルレート区分による 4x:48kHz系 2x:96kHz系 プロファイル切り替え中は新旧をクロスフェードする)
+static uint32_t __not_in_flash_func(FIR_filter)(uint32_t length, float *input, float *output, DSP_CHANNEL *ch)
+{
+    uint32_t prof = profile_start();
+    length = dsp_fir_stage(ch, input, output, length);
+    profile_end(PROF_FIR, prof);
+    return length;
+}
 
-    free(NOS_buffer);
-    return length << 1;
+// upsampling biquad IIR filter NOS統合版 (RAM上で実行する)
+static uint32_t __not_in_flash_func(fast_BQ_filter_2x_2)(uint32_t length, float *p_in, float *p_out, arm_biquad_casd_df1_inst_f32 *S)
+{
+    uint32_t prof = profile_start();
+    length = dsp_bq_nos_2x(S, p_in, p_out, length);
+    profile_end(PROF_BIQUAD, prof);
+    return length;
+}
+
+// upsampling biquad IIR filter NOS統合版 (RAM上で実行する)
+static uint32_t __not_in_flash_func(fast_BQ_filter_2x_3)(uint32_t length, float *p_in, float *p_out, DSP_CHANNEL *ch)
+{
+    uint32_t prof = profile_start();
+    length = dsp_bq_stage_2x_3(ch, p_in, p_out, length);
+    profile_end(PROF_CORE1_BIQUAD, prof);
+    return length;
 }
 
 // upsampling biquad IIR filter NOS統合版 (RAM上で実行する)
-static uint32_t __not_in_flash_func(fast_BQ_filter_4x_0)(uint32_t length, float *p_in, float *p_out, arm_biquad_casd_df1_inst_f32 *S)
+static uint32_t __not_in_flash_func(fast_BQ_filter_4x_0)(uint32_t length, float *p_in, float *p_out, DSP_CHANNEL *ch)
 {
-    uint32_t length_buffer = length;
-    float *NOS_buffer = (float *)malloc(sizeof(float) * (length << 2));
-    float *p_NOS_buffer = NOS_buffer;
+    uint32_t prof = profile_start();
+    length = dsp_bq_stage_4x_0(ch, p_in, p_out, length);
+    profile_end(PROF_CORE1_BIQUAD, prof);
+    return length;
+}
+
+// 処理段毎のサイクル数を計測する(ステレオ入力1サンプルあたり 起動時に呼ぶ)
+// 無音を入力して所定回数実行し、終わったらフィルタの状態をクリアする
+// Q31_PIPELINE_MODEではFIR・BiQuad-IIRの段はQ31のフィルタで計測する
+#define STAGE_MEASURE_LENGTH (64)
+#define STAGE_MEASURE_REPEAT (16)
+float measure_upsampling_stage_cycles(uint stage)
+{
+    static int32_t measure_in[STAGE_MEASURE_LENGTH];
+    static float measure_in_L[STAGE_MEASURE_LENGTH];
+    static float measure_in_R[STAGE_MEASURE_LENGTH];
+    static float measure_out_L[STAGE_MEASURE_LENGTH * 4];
+    static float measure_out_R[STAGE_MEASURE_LENGTH * 4];
+    q31_t *measure_q31_out_L = (q31_t *)measure_out_L;
+    q31_t *measure_q31_out_R = (q31_t *)measure_out_R;
+
+    // パラメトリックEQは係数が変わっても処理量は同じなので、1段のカスケードで計測する
+    static const float peq_measure_coef[5] = {1.f, 0.f, 0.f, 0.f, 0.f};
+    static float peq_measure_state[2][4];
+    arm_biquad_casd_df1_inst_f32 peq_measure[2];
+    arm_biquad_cascade_df1_init_f32(&peq_measure[0], 1, peq_measure_coef, peq_measure_state[0]);
+    arm_biquad_cascade_df1_init_f32(&peq_measure[1], 1, peq_measure_coef, peq_measure_state[1]);
+
+    // ルーム補正FIRは最大タップ数の無音のインパルス応答で計測する(処理量は分割数に比例する)
+    if (stage == STAGE_ROOM_FIR)
+    {
+        if (!ROOM_FIR_ENABLE)
+            return 0.f;
+        load_upsampling_room_fir(NULL, NULL, DSP_ROOM_FIR_MAX_TAPS, 0);
+    }
+
+    memset(measure_in, 0, sizeof(measure_in));
+    memset(measure_in_L, 0, sizeof(measure_in_L));
+    memset(measure_in_R, 0, sizeof(measure_in_R));
 
-    // サンプル数を4倍にする NOS方式
-    while (length_buffer--)
+    uint32_t save = save_and_disable_interrupts();
+    uint32_t start_us = time_us_32();
+    for (uint32_t i = 0; i < STAGE_MEASURE_REPEAT; i++)
     {
-        *(p_NOS_buffer++) = *(p_in);
-        *(p_NOS_buffer++) = *(p_in);
-        *(p_NOS_buffer++) = *(p_in);
-        *(p_NOS_buffer++) = *(p_in++);
+        switch (stage)
+        {
+        case STAGE_CONVERT:
+            // FIR前のゲインはFIR段の係数に入れている(音量は入力のint32にかける)ので変換だけ
+            if (CROSSFEED_ENABLE)
+            {
+                dsp_crossfeed_convert(&crossfeed, measure_in, measure_in, measure_out_L, measure_out_R, 1.f, STAGE_MEASURE_LENGTH);
+                break;
+            }
+            dsp_int32_to_float_stereo(measure_in, measure_in, measure_out_L, measure_out_R, 1.f, STAGE_MEASURE_LENGTH);
+            break;
+        case STAGE_FIR_4X_0:
+            if (Q31_PIPELINE_MODE)
+            {
+                arm_fir_interpolate_q31(&dsp_q31_channel[0].fir_4x_0, measure_in, measure_q31_out_L, STAGE_MEASURE_LENGTH);
+                arm_fir_interpolate_q31(&dsp_q31_channel[1].fir_4x_0, measure_in, measure_q31_out_R, STAGE_MEASURE_LENGTH);
+                break;
+            }
+            if (LONG_FIR_ENABLE)
+            {
+                dsp_long_fir_interpolate(&long_fir[0], measure_in_L, measure_out_L, STAGE_MEASURE_LENGTH);
+                dsp_long_fir_interpolate(&long_fir[1], measure_in_R, measure_out_R, STAGE_MEASURE_LENGTH);
+                break;
+            }
+            dsp_fir_interpolate(&dsp_L->fir_4x_0, measure_in_L, measure_out_L, STAGE_MEASURE_LENGTH);
+            dsp_fir_interpolate(&dsp_R->fir_4x_0, measure_in_R, measure_out_R, STAGE_MEASURE_LENGTH);
+            break;
+        case STAGE_FIR_2X_1:
+            if (Q31_PIPELINE_MODE)
+            {
+                arm_fir_interpolate_q31(&dsp_q31_channel[0].fir_2x_1, measure_in, measure_q31_out_L, STAGE_MEASURE_LENGTH);
+                arm_fir_interpolate_q31(&dsp_q31_channel[1].fir_2x_1, measure_in, measure_q31_out_R, STAGE_MEASURE_LENGTH);
+                break;
+            }
+            dsp_fir_interpolate(&dsp_L->fir_2x_1, measure_in_L, measure_out_L, STAGE_MEASURE_LENGTH);
+            dsp_fir_interpolate(&dsp_R->fir_2x_1, measure_in_R, measure_out_R, STAGE_MEASURE_LENGTH);
+            break;
+        case STAGE_BQ_2X_2:
+            if (Q31_PIPELINE_MODE)
+            {
+                dsp_q31_bq_nos(&dsp_q31_channel[0].bq_2x_2, 2, measure_in, measure_q31_out_L, STAGE_MEASURE_LENGTH);
+                dsp_q31_bq_nos(&dsp_q31_channel[1].bq_2x_2, 2, measure_in, measure_q31_out_R, STAGE_MEASURE_LENGTH);
+                break;
+            }
+            fast_BQ_filter_2x_2(STAGE_MEASURE_LENGTH, measure_in_L, measure_out_L, &dsp_L->bq_2x_2);
+            fast_BQ_filter_2x_2(STAGE_MEASURE_LENGTH, measure_in_R, measure_out_R, &dsp_R->bq_2x_2);
+            break;
+        case STAGE_BQ_2X_3:
+            if (Q31_PIPELINE_MODE)
+            {
+                dsp_q31_bq_nos(&dsp_q31_channel[0].bq_2x_3, 2, measure_in, measure_q31_out_L, STAGE_MEASURE_LENGTH);
+                dsp_q31_bq_nos(&dsp_q31_channel[1].bq_2x_3, 2, measure_in, measure_q31_out_R, STAGE_MEASURE_LENGTH);
+                break;
+            }
+            fast_BQ_filter_2x_3(STAGE_MEASURE_LENGTH, measure_in_L, measure_out_L, dsp_L);
+            fast_BQ_filter_2x_3(STAGE_MEASURE_LENGTH, measure_in_R, measure_out_R, dsp_R);
+            break;
+        case STAGE_BQ_4X_0:
+            if (Q31_PIPELINE_MODE)
+            {
+                dsp_q31_bq_nos(&dsp_q31_channel[0].bq_4x_0, 4, measure_in, measure_q31_out_L, STAGE_MEASURE_LENGTH);
+                dsp_q31_bq_nos(&dsp_q31_channel[1].bq_4x_0, 4, measure_in, measure_q31_out_R, STAGE_MEASURE_LENGTH);
+                break;
+            }
+            fast_BQ_filter_4x_0(STAGE_MEASURE_LENGTH, measure_in_L, measure_out_L, dsp_L);
+            fast_BQ_filter_4x_0(STAGE_MEASURE_LENGTH, measure_in_R, measure_out_R, dsp_R);
+            break;
+        case STAGE_PEQ_SECTION:
+            arm_biquad_cascade_df1_f32(&peq_measure[0], measure_in_L, measure_out_L, STAGE_MEASURE_LENGTH);
+            arm_biquad_cascade_df1_f32(&peq_measure[1], measure_in_R, measure_out_R, STAGE_MEASURE_LENGTH);
+            break;
+        case STAGE_ROOM_FIR:
+            dsp_room_fir_process(&room_fir[0], measure_in_L, measure_out_L, STAGE_MEASURE_LENGTH);
+            dsp_room_fir_process(&room_fir[1], measure_in_R, measure_out_R, STAGE_MEASURE_LENGTH);
+            break;
+        default:
+            break;
+        }
     }
+    uint32_t elapsed_us = time_us_32() - start_us;
+    restore_interrupts(save);
 
-    // BiQuad-IIRフィルタを実行する
-    arm_biquad_cascade_df1_f32(S, NOS_buffer, p_out, length << 2);
+    clear_bq_filter_delay();
+    if (stage == STAGE_ROOM_FIR)
+        load_upsampling_room_fir(NULL, NULL, 0, 0);
 
-    free(NOS_buffer);
-    return length << 2;
+    return (float)elapsed_us * ((float)clock_get_hz(clk_sys) / 1000000.f) / (STAGE_MEASURE_LENGTH * STAGE_MEASURE_REPEAT);
 }
 
 // アップサンプリングに使用するメモリを静的確保
@@ -244,30 +362,142 @@ static float upsample_buffer_1_L[SIZE_EP_BUFFER * RATIO_UPSAMPLING_48K];
 static float upsample_buffer_0_R[SIZE_EP_BUFFER * RATIO_UPSAMPLING_48K];
 static float upsample_buffer_1_R[SIZE_EP_BUFFER * RATIO_UPSAMPLING_48K];
 
-void __not_in_flash_func(upsampling_process_core0)(void)
+// パラメトリックEQ(入力レートで最初の補間段の前に実行する 段数0なら何もしない)
+static void __not_in_flash_func(eq_input)(int32_t length)
+{
+    uint32_t prof = profile_start();
+    bool run_L = dsp_peq_process(&dsp_L->peq, buffer_from_ep_Lch_float, buffer_from_ep_Lch_float, length);
+    bool run_R = dsp_peq_process(&dsp_R->peq, buffer_from_ep_Rch_float, buffer_from_ep_Rch_float, length);
+    if (run_L || run_R)
+        profile_end(PROF_PEQ, prof);
+}
+
+// ルーム補正FIR(入力レートでEQの後に実行する インパルス応答と入力のサンプルレートが異なる場合は何もしない)
+static void __not_in_flash_func(room_fir_input)(int32_t length)
+{
+    if (!is_room_fir_active())
+        return;
+
+    uint32_t prof = profile_start();
+    dsp_room_fir_process(&room_fir[0], buffer_from_ep_Lch_float, buffer_from_ep_Lch_float, length);
+    dsp_room_fir_process(&room_fir[1], buffer_from_ep_Rch_float, buffer_from_ep_Rch_float, length);
+    profile_end(PROF_ROOM_FIR, prof);
+}
+
+// 入力にかけるゲイン FIR補間で振幅が小さくなるための DEFAULT_GAIN_RATIO × 補間倍率は通常FIR段の係数に入っているので1
+// FIRのない192kHz系では1、長いFIRでは入力にかける(音量はvolume_inputでint32のままかけている)
+static float __not_in_flash_func(get_input_gain)(uint16_t rate_class)
+{
+    if (dsp_is_fir_gain_folded(dsp_L) || (rate_class == RATE_CLASS_192K))
+        return 1.f;
+    return DEFAULT_GAIN_RATIO * 4.f;
+}
+
+// EPバッファから読み出した入力に音量をかける(ランプ中・0dB以外のとき 入力レートなので処理量は小さい)
+static void __not_in_flash_func(volume_input)(int32_t length)
+{
+    dsp_volume_process_stereo(&input_volume, buffer_copy_from_ep_left_ch, buffer_copy_from_ep_right_ch, length, VOLUME_RAMP_MS * audio_state.freq / 1000);
+}
+
+// S/PDIF出力用に入力周波数のデータを書き込む(音量はvolume_inputでかけてある)
+static void __not_in_flash_func(spdif_write_input)(int32_t length)
+{
+    spdif_output_write_int32(buffer_copy_from_ep_left_ch, buffer_copy_from_ep_right_ch, length);
+}
+
+// EPバッファから読み出したデータをfloatに変換し、gain倍する(両ch・ゲインを1回のループで クロスフィードを有効にしている場合も同じループで行う)
+static void __not_in_flash_func(convert_input)(float gain, int32_t length)
+{
+    uint32_t prof = profile_start();
+    if (!CROSSFEED_ENABLE)
+    {
+        dsp_int32_to_float_stereo(buffer_copy_from_ep_left_ch, buffer_copy_from_ep_right_ch, buffer_from_ep_Lch_float, buffer_from_ep_Rch_float, gain, length);
+        profile_end(PROF_INT_TO_FLOAT, prof);
+        return;
+    }
+
+    if (crossfeed.fs != audio_state.freq)
+        dsp_crossfeed_init(&crossfeed, audio_state.freq, CROSSFEED_CUT_FREQ, CROSSFEED_LEVEL_DB, CROSSFEED_DELAY_US);
+    dsp_crossfeed_convert(&crossfeed, buffer_copy_from_ep_left_ch, buffer_copy_from_ep_right_ch, buffer_from_ep_Lch_float, buffer_from_ep_Rch_float, gain, length);
+    profile_end(PROF_INT_TO_FLOAT, prof);
+}
+
+// Core0→Core1のリングバッファに書き込む
+static void __not_in_flash_func(write_to_core1)(float *in_L, float *in_R, int32_t len_L, int32_t len_R)
+{
+    uint32_t prof = profile_start();
+    uint32_t save = save_and_disable_interrupts();
+    ringbuf_write_array_spinlock((int32_t *)in_L, len_L, &buffer_upsr_data_Lch_0);
+    ringbuf_write_array_spinlock((int32_t *)in_R, len_R, &buffer_upsr_data_Rch_0);
+    restore_interrupts(save);
+    profile_end(PROF_RING_WRITE, prof);
+}
+
+// 前回処理からの経過時間ぶんの処理サンプル数を求める
+static int32_t __not_in_flash_func(get_ref_size_core0)(void)
+{
+    static FLOW_REF_SIZE ref_size_state = {0, 0};
+    return flow_ref_size(&flow_param, &ref_size_state, audio_state.freq, time_us_32());
+}
+
+// adjust_flow: 処理サンプル数を±OSR_ADJ_SIZE増減してリングバッファの水位を寄せる(周期タイマーの処理でのみtrue)
+void __not_in_flash_func(upsampling_process_core0)(bool adjust_flow)
 {
     uint32_t save;
     // epバッファサイズを取得
     int32_t size_buf = get_size_using(&buffer_ep_Lch);
 
     // フィルタ演算を実行
-    int32_t ref_size, length, deviation, adj;
+    int32_t ref_size, length, adj;
     int32_t len_L, len_R;
 
+    // 最終段のBiQuad-IIRをCore1に移している場合は、その前のデータをCore1に渡す
+    bool run_biquad2 = (!CORE0_UPSAMPLING_192K) && (!is_biquad2_on_core1());
+
+    // サンプルレートが変わった場合は入力サンプルレート区分(使うFIR段)を切り替える
+    uint16_t rate_class = dsp_get_rate_class(audio_state.freq);
+    if (rate_class != dsp_L->rate_class)
+        select_rate_class(rate_class);
+
     // アップサンプリングバッファを一定水位に保つようにFBをかける
-    deviation = SIZE_BUFFER_FB_THRESHOLD - get_size_using(&buffer_upsr_data_Lch_0);
-    if (deviation > 0)
-        adj = OSR_ADJ_SIZE;
-    else if (deviation < 0)
-        adj = -OSR_ADJ_SIZE;
-    else
-        adj = 0;
+    // USBパケット受信でも処理するので、増減は周期(TIMER0_US)毎に1回にする
+    adj = adjust_flow ? flow_osr_adjust(&flow_param, get_size_using(&buffer_upsr_data_Lch_0)) : 0;
+
+    // チャンネル分割モードでは入力レートのままCore1に渡し、フィルタはチャンネル毎に各コアで実行する
+    if (CHANNEL_SPLIT_MODE)
+    {
+        length = saturation_i32(get_ref_size_core0() + adj, size_buf, 0);
+        if (length > 0)
+        {
+            save = save_and_disable_interrupts();
+            ringbuf_read_array_no_spinlock(buffer_copy_from_ep_left_ch, length, &buffer_ep_Lch);
+            ringbuf_read_array_no_spinlock(buffer_copy_from_ep_right_ch, length, &buffer_ep_Rch);
+            restore_interrupts(save);
+            volume_input(length);
+
+            // S/PDIF出力は入力周波数のみ(補間後のデータはCore0に残らない)
+            if (SPDIF_OUTPUT_ENABLE && (get_spdif_output_freq(audio_state.freq) == audio_state.freq))
+                spdif_write_input(length);
+
+            // Q31のフィルタではint32のまま渡す(ゲインはFIR段の係数に入っている)
+            if (Q31_PIPELINE_MODE)
+            {
+                write_to_core1((float *)buffer_copy_from_ep_left_ch, (float *)buffer_copy_from_ep_right_ch, length, length);
+                return;
+            }
+
+            convert_input(get_input_gain(rate_class), length);
+
+            write_to_core1(buffer_from_ep_Lch_float, buffer_from_ep_Rch_float, length, length);
+        }
+        return;
+    }
 
     switch (audio_state.freq)
     {
     case 192000:
     case 176400:
-        ref_size = (int64_t)audio_state.freq * TIMER0_US / 1000000;
+        ref_size = get_ref_size_core0();
         length = ref_size + adj;
 
         length = saturation_i32(length, size_buf, 0);
@@ -277,33 +507,36 @@ void __not_in_flash_func(upsampling_process_core0)(void)
             ringbuf_read_array_no_spinlock(buffer_copy_from_ep_left_ch, length, &buffer_ep_Lch);
             ringbuf_read_array_no_spinlock(buffer_copy_from_ep_right_ch, length, &buffer_ep_Rch);
             restore_interrupts(save);
+            volume_input(length);
 
-            int32_to_float_array(buffer_copy_from_ep_left_ch, buffer_from_ep_Lch_float, length);
-            int32_to_float_array(buffer_copy_from_ep_right_ch, buffer_from_ep_Rch_float, length);
+            // S/PDIF出力用に入力周波数のデータを取り出す
+            if (SPDIF_OUTPUT_ENABLE && (get_spdif_output_freq(audio_state.freq) == audio_state.freq))
+                spdif_write_input(length);
 
-            if (!CORE0_UPSAMPLING_192K)
+            convert_input(get_input_gain(rate_class), length);
+            eq_input(length);
+            room_fir_input(length);
+
+            if (run_biquad2)
             {
-                len_L = fast_BQ_filter_2x_2(length, buffer_from_ep_Lch_float, upsample_buffer_0_L, &biquad_filter2L);
-                len_R = fast_BQ_filter_2x_2(length, buffer_from_ep_Rch_float, upsample_buffer_0_R, &biquad_filter2R);
+                len_L = fast_BQ_filter_2x_2(length, buffer_from_ep_Lch_float, upsample_buffer_0_L, &dsp_L->bq_2x_2);
+                len_R = fast_BQ_filter_2x_2(length, buffer_from_ep_Rch_float, upsample_buffer_0_R, &dsp_R->bq_2x_2);
             }
             else
             {
                 len_L = length;
                 len_R = length;
-                memcpy(buffer_from_ep_Lch_float, upsample_buffer_0_L, sizeof(float) * length);
-                memcpy(buffer_from_ep_Rch_float, upsample_buffer_0_R, sizeof(float) * length);
+                memcpy(upsample_buffer_0_L, buffer_from_ep_Lch_float, sizeof(float) * length);
+                memcpy(upsample_buffer_0_R, buffer_from_ep_Rch_float, sizeof(float) * length);
             }
 
-            save = save_and_disable_interrupts();
-            ringbuf_write_array_spinlock((int32_t *)upsample_buffer_0_L, len_L, &buffer_upsr_data_Lch_0);
-            ringbuf_write_array_spinlock((int32_t *)upsample_buffer_0_R, len_R, &buffer_upsr_data_Rch_0);
-            restore_interrupts(save);
+            write_to_core1(upsample_buffer_0_L, upsample_buffer_0_R, len_L, len_R);
         }
         break;
 
     case 96000:
     case 88200:
-        ref_size = (int64_t)audio_state.freq * TIMER0_US / 1000000;
+        ref_size = get_ref_size_core0();
         length = ref_size + adj;
 
         length = saturation_i32(length, size_buf, 0);
@@ -313,38 +546,45 @@ void __not_in_flash_func(upsampling_process_core0)(void)
             ringbuf_read_array_no_spinlock(buffer_copy_from_ep_left_ch, length, &buffer_ep_Lch);
             ringbuf_read_array_no_spinlock(buffer_copy_from_ep_right_ch, length, &buffer_ep_Rch);
             restore_interrupts(save);
+            volume_input(length);
 
-            int32_to_float_array(buffer_copy_from_ep_left_ch, buffer_from_ep_Lch_float, length);
-            int32_to_float_array(buffer_copy_from_ep_right_ch, buffer_from_ep_Rch_float, length);
+            // S/PDIF出力用に入力周波数のデータを取り出す
+            if (SPDIF_OUTPUT_ENABLE && (get_spdif_output_freq(audio_state.freq) == audio_state.freq))
+                spdif_write_input(length);
 
-            // FIR補間で振幅が小さくなるためあらかじめ大きくしておく
-            arm_scale_f32(buffer_from_ep_Lch_float, DEFAULT_GAIN_RATIO * 2., buffer_from_ep_Lch_float, length);
-            arm_scale_f32(buffer_from_ep_Rch_float, DEFAULT_GAIN_RATIO * 2., buffer_from_ep_Rch_float, length);
+            convert_input(get_input_gain(rate_class), length);
+            eq_input(length);
+            room_fir_input(length);
 
-            if (!CORE0_UPSAMPLING_192K)
+            if (run_biquad2)
             {
-                len_L = FIR_filter_2x(length, buffer_from_ep_Lch_float, upsample_buffer_0_L, &fir_filter2x1L);
-                len_L = fast_BQ_filter_2x_2(len_L, upsample_buffer_0_L, upsample_buffer_1_L, &biquad_filter2L);
+                len_L = FIR_filter(length, buffer_from_ep_Lch_float, upsample_buffer_0_L, dsp_L);
+                len_R = FIR_filter(length, buffer_from_ep_Rch_float, upsample_buffer_0_R, dsp_R);
+
+                // S/PDIF出力用に2倍補間後のデータを取り出す
+                if (SPDIF_OUTPUT_ENABLE && (get_spdif_output_freq(audio_state.freq) != audio_state.freq))
+                    spdif_output_write_float(upsample_buffer_0_L, upsample_buffer_0_R, len_L, 1);
 
-                len_R = FIR_filter_2x(length, buffer_from_ep_Rch_float, upsample_buffer_0_R, &fir_filter2x1R);
-                len_R = fast_BQ_filter_2x_2(len_R, upsample_buffer_0_R, upsample_buffer_1_R, &biquad_filter2R);
+                len_L = fast_BQ_filter_2x_2(len_L, upsample_buffer_0_L, upsample_buffer_1_L, &dsp_L->bq_2x_2);
+                len_R = fast_BQ_filter_2x_2(len_R, upsample_buffer_0_R, upsample_buffer_1_R, &dsp_R->bq_2x_2);
             }
             else
             {
-                len_L = FIR_filter_2x(length, buffer_from_ep_Lch_float, upsample_buffer_1_L, &fir_filter2x1L);
-                len_R = FIR_filter_2x(length, buffer_from_ep_Rch_float, upsample_buffer_1_R, &fir_filter2x1R);
+                len_L = FIR_filter(length, buffer_from_ep_Lch_float, upsample_buffer_1_L, dsp_L);
+                len_R = FIR_filter(length, buffer_from_ep_Rch_float, upsample_buffer_1_R, dsp_R);
+
+                // S/PDIF出力用に2倍補間後のデータを取り出す
+                if (SPDIF_OUTPUT_ENABLE && (get_spdif_output_freq(audio_state.freq) != audio_state.freq))
+                    spdif_output_write_float(upsample_buffer_1_L, upsample_buffer_1_R, len_L, 1);
             }
 
-            save = save_and_disable_interrupts();
-            ringbuf_write_array_spinlock((int32_t *)upsample_buffer_1_L, len_L, &buffer_upsr_data_Lch_0);
-            ringbuf_write_array_spinlock((int32_t *)upsample_buffer_1_R, len_R, &buffer_upsr_data_Rch_0);
-            restore_interrupts(save);
+            write_to_core1(upsample_buffer_1_L, upsample_buffer_1_R, len_L, len_R);
         }
         break;
     case 48000:
     case 44100:
     default:
-        ref_size = (int64_t)audio_state.freq * TIMER0_US / 1000000;
+        ref_size = get_ref_size_core0();
         length = ref_size + adj;
 
         length = saturation_i32(length, size_buf, 0);
@@ -354,53 +594,64 @@ void __not_in_flash_func(upsampling_process_core0)(void)
             ringbuf_read_array_no_spinlock(buffer_copy_from_ep_left_ch, length, &buffer_ep_Lch);
             ringbuf_read_array_no_spinlock(buffer_copy_from_ep_right_ch, length, &buffer_ep_Rch);
             restore_interrupts(save);
+            volume_input(length);
 
-            int32_to_float_array(buffer_copy_from_ep_left_ch, buffer_from_ep_Lch_float, length);
-            int32_to_float_array(buffer_copy_from_ep_right_ch, buffer_from_ep_Rch_float, length);
+            // S/PDIF出力用に入力周波数のデータを取り出す
+            if (SPDIF_OUTPUT_ENABLE && (get_spdif_output_freq(audio_state.freq) == audio_state.freq))
+                spdif_write_input(length);
 
-            // FIR補間で振幅が小さくなるためあらかじめ大きくしておく
-            arm_scale_f32(buffer_from_ep_Lch_float, DEFAULT_GAIN_RATIO * 4., buffer_from_ep_Lch_float, length);
-            arm_scale_f32(buffer_from_ep_Rch_float, DEFAULT_GAIN_RATIO * 4., buffer_from_ep_Rch_float, length);
+            convert_input(get_input_gain(rate_class), length);
+            eq_input(length);
+            room_fir_input(length);
 
-            len_L = FIR_filter_4x(length, buffer_from_ep_Lch_float, upsample_buffer_1_L, &fir_filter4x0L);
-            len_R = FIR_filter_4x(length, buffer_from_ep_Rch_float, upsample_buffer_1_R, &fir_filter4x0R);
+            len_L = FIR_filter(length, buffer_from_ep_Lch_float, upsample_buffer_1_L, dsp_L);
+            len_R = FIR_filter(length, buffer_from_ep_Rch_float, upsample_buffer_1_R, dsp_R);
 
-            if (!CORE0_UPSAMPLING_192K)
-            {
-                len_L = fast_BQ_filter_2x_2(len_L, upsample_buffer_1_L, upsample_buffer_0_L, &biquad_filter2L);
-                len_R = fast_BQ_filter_2x_2(len_R, upsample_buffer_1_R, upsample_buffer_0_R, &biquad_filter2R);
-            }
+            // S/PDIF出力用に4倍補間後のデータを1/2に間引いて取り出す(帯域制限済みなので折り返しはない)
+            if (SPDIF_OUTPUT_ENABLE && (get_spdif_output_freq(audio_state.freq) != audio_state.freq))
+                spdif_output_write_float(upsample_buffer_1_L, upsample_buffer_1_R, len_L, 2);
 
-            save = save_and_disable_interrupts();
-            if (!CORE0_UPSAMPLING_192K)
+            if (run_biquad2)
             {
-                ringbuf_write_array_spinlock((int32_t *)upsample_buffer_0_L, len_L, &buffer_upsr_data_Lch_0);
-                ringbuf_write_array_spinlock((int32_t *)upsample_buffer_0_R, len_R, &buffer_upsr_data_Rch_0);
+                len_L = fast_BQ_filter_2x_2(len_L, upsample_buffer_1_L, upsample_buffer_0_L, &dsp_L->bq_2x_2);
+                len_R = fast_BQ_filter_2x_2(len_R, upsample_buffer_1_R, upsample_buffer_0_R, &dsp_R->bq_2x_2);
             }
+
+            if (run_biquad2)
+                write_to_core1(upsample_buffer_0_L, upsample_buffer_0_R, len_L, len_R);
             else
-            {
-                ringbuf_write_array_spinlock((int32_t *)upsample_buffer_1_L, len_L, &buffer_upsr_data_Lch_0);
-                ringbuf_write_array_spinlock((int32_t *)upsample_buffer_1_R, len_R, &buffer_upsr_data_Rch_0);
-            }
-            restore_interrupts(save);
+                write_to_core1(upsample_buffer_1_L, upsample_buffer_1_R, len_L, len_R);
         }
         break;
     }
 }
 
+// Core0から移した最終段のBiQuad-IIRの出力
+static float biquad2_core1_L[SIZE_DMA_TX_BUF / RATIO_UPSAMPLING_CORE1 / 2];
+static float biquad2_core1_R[SIZE_DMA_TX_BUF / RATIO_UPSAMPLING_CORE1 / 2];
+
 uint32_t __not_in_flash_func(upsampling_process_core1)(float *in_L, float *in_R, float *out_L, float *out_R, uint32_t length)
 {
+    // Core0の最終段をCore1で実行する(Core0からは補間前のデータが来る)
+    if (is_biquad2_on_core1())
+    {
+        length = fast_BQ_filter_2x_2(length, in_L, biquad2_core1_L, &dsp_L->bq_2x_2);
+        fast_BQ_filter_2x_2(length >> 1, in_R, biquad2_core1_R, &dsp_R->bq_2x_2);
+        in_L = biquad2_core1_L;
+        in_R = biquad2_core1_R;
+    }
+
     uint32_t len_L = length;
     switch (get_ratio_upsampling_core1())
     {
     case 4:
-        len_L = fast_BQ_filter_4x_0(length, in_L, out_L, &biquad_filter4L);
-        fast_BQ_filter_4x_0(length, in_R, out_R, &biquad_filter4R);
+        len_L = fast_BQ_filter_4x_0(length, in_L, out_L, dsp_L);
+        fast_BQ_filter_4x_0(length, in_R, out_R, dsp_R);
         break;
 
     case 2:
-        len_L = fast_BQ_filter_2x_3(length, in_L, out_L, &biquad_filter3L);
-        fast_BQ_filter_2x_3(length, in_R, out_R, &biquad_filter3R);
+        len_L = fast_BQ_filter_2x_3(length, in_L, out_L, dsp_L);
+        fast_BQ_filter_2x_3(length, in_R, out_R, dsp_R);
         break;
 
     case 1:
@@ -410,4 +661,35 @@ uint32_t __not_in_flash_func(upsampling_process_core1)(float *in_L, float *in_R,
         break;
     }
     return len_L;
-}
\ No newline at end of file
+}
+
+// チャンネル分割モード: 1ch分の全段(Core0の段 + Core1の段)を実行する Lch(ch=0)はCore0、Rch(ch=1)はCore1から呼ぶ
+// 作業用バッファ・フィルタ状態はチャンネル毎に別なので、両コアから同時に呼んでよい
+uint32_t __not_in_flash_func(upsampling_process_channel)(uint ch, float *in, float *out, uint32_t length)
+{
+    DSP_CHAIN chain = {
+        .rate_class = dsp_channel[ch].rate_class,
+        .run_bq_2x_2 = !CORE0_UPSAMPLING_192K,
+        .ratio_final = get_ratio_upsampling_core1(),
+        .run_room_fir = is_room_fir_active(),
+    };
+    float *buffer_0 = (ch == 0) ? upsample_buffer_0_L : upsample_buffer_0_R;
+    float *buffer_1 = (ch == 0) ? upsample_buffer_1_L : upsample_buffer_1_R;
+
+    return dsp_process_channel(&dsp_channel[ch], &chain, in, out, buffer_0, buffer_1, length);
+}
+
+// チャンネル分割モード: 1ch分の全段をQ31固定小数点で実行する(Q31_PIPELINE_MODE) 入出力はint32のまま
+// 作業用バッファはfloat版と共有する(同じ大きさ)
+uint32_t __not_in_flash_func(upsampling_process_channel_q31)(uint ch, const int32_t *in, int32_t *out, uint32_t length)
+{
+    DSP_CHAIN chain = {
+        .rate_class = dsp_channel[ch].rate_class,
+        .run_bq_2x_2 = !CORE0_UPSAMPLING_192K,
+        .ratio_final = get_ratio_upsampling_core1(),
+    };
+    q31_t *buffer_0 = (q31_t *)((ch == 0) ? upsample_buffer_0_L : upsample_buffer_0_R);
+    q31_t *buffer_1 = (q31_t *)((ch == 0) ? upsample_buffer_1_L : upsample_buffer_1_R);
+
+    return dsp_q31_process_channel(&dsp_q31_channel[ch], &chain, in, out, buffer_0, buffer_1, length);
+}
@@ -12,68 +12,39 @@
 #include <stdlib.h>
 #include <string.h>
 #include "pico/stdlib.h"
+#include "dsp_filter.h"
+#include "dsp_crossfeed.h"
 
 #define NUM_OF_CH (2)
-#define NUM_OF_BQ_SUB_PARAMS (6)
-#define SIZE_BQ_FILTER_0 (17)
-#define SIZE_BQ_DELAY_0 (SIZE_BQ_FILTER_0)
 
-#define SIZE_BQ_FILTER_1 (5)
-#define SIZE_BQ_DELAY_1 (SIZE_BQ_FILTER_1)
-
-#define SIZE_BQ_FILTER_2 (4)
-#define SIZE_BQ_DELAY_2 (SIZE_BQ_FILTER_2)
-
-#define SIZE_BQ_FILTER_3 (4)
-#define SIZE_BQ_DELAY_3 (SIZE_BQ_FILTER_3)
-
-#define SIZE_BQ_FILTER_4 (3)
-#define SIZE_BQ_DELAY_4 (SIZE_BQ_FILTER_4)
-
-#define SIZE_FIR_FILTER_0 (128)
-#define SIZE_FIR_FILTER_1 (48)
-#define SIZE_FIR_FILTER_2 (48)
-
-
-// 双二次フィルタの係数と遅延を定義する
-typedef struct
-{
-    float a0, a1, a2;
-    float b1, b2;
-} BIQUAD_FILTER;
-
-typedef struct
-{
-    float z1, z2;
-} BQ_DELAY;
-
-typedef struct
-{
-    BQ_DELAY delay0[SIZE_BQ_DELAY_0];
-    BQ_DELAY delay1[SIZE_BQ_DELAY_1];
-    BQ_DELAY delay2[SIZE_BQ_DELAY_2];
-    BQ_DELAY delay3[SIZE_BQ_DELAY_3];
-    BQ_DELAY delay4[SIZE_BQ_DELAY_4];
-} DELAY_DATA;
-
-// フィルタ係数
-extern const float coef_bq_filter_2x_0[SIZE_BQ_FILTER_0][NUM_OF_BQ_SUB_PARAMS];
-extern const float coef_bq_filter_2x_1[SIZE_BQ_FILTER_1][NUM_OF_BQ_SUB_PARAMS];
-extern const float coef_bq_filter_2x_2[SIZE_BQ_FILTER_2][NUM_OF_BQ_SUB_PARAMS];
-extern const float coef_bq_filter_2x_3[SIZE_BQ_FILTER_3][NUM_OF_BQ_SUB_PARAMS];
-extern const float coef_bq_filter_4x_0[SIZE_BQ_FILTER_4][NUM_OF_BQ_SUB_PARAMS];
-
-extern const float coef_fir_filter_4x_0[SIZE_FIR_FILTER_0];
-extern const uint32_t size_coef_fir_filter_4x_0;
-extern const float coef_fir_filter_2x_1[SIZE_FIR_FILTER_1];
-extern const uint32_t size_coef_fir_filter_2x_1;
-extern const float coef_fir_filter_2x_2[SIZE_FIR_FILTER_2];
-extern const uint32_t size_coef_fir_filter_2x_2;
+// Core0/Core1の分割に使う処理段(ステレオ入力1サンプルあたりのサイクル数を計測する)
+#define STAGE_CONVERT (0)  // int32→float変換・ゲイン
+#define STAGE_FIR_4X_0 (1) // FIR 4x (48kHz系)
+#define STAGE_FIR_2X_1 (2) // FIR 2x (96kHz系)
+#define STAGE_BQ_2X_2 (3)  // BiQuad-IIR 2x (Core0最終段 Core1に移せる)
+#define STAGE_BQ_2X_3 (4)  // BiQuad-IIR 2x (Core1 LowPowerMode)
+#define STAGE_BQ_4X_0 (5)  // BiQuad-IIR 4x (Core1 HiPowerMode)
+#define STAGE_PEQ_SECTION (6) // パラメトリックEQ 1段あたり(段数は実行時に変わるので分割点の計算には使わない)
+#define STAGE_ROOM_FIR (7)    // ルーム補正FIR DSP_ROOM_FIR_MAX_TAPSタップ(同上 タップ数に比例させて使う)
+#define NUM_OF_STAGE (8)
 
 
 extern void init_upsampling_filter(void);
 extern void clear_bq_filter_delay(void);
-extern void __not_in_flash_func(upsampling_process_core0)(void);
+extern void set_upsampling_volume(int32_t volume);
+extern void set_upsampling_profile(const DSP_PROFILE *profile);
+extern void request_upsampling_profile(const DSP_PROFILE *profile, uint32_t xfade_length);
+extern bool is_upsampling_profile_switching(void);
+extern bool set_upsampling_peq(DSP_PEQ_BAND (*band)[DSP_PEQ_MAX_BAND], const uint8_t *num_band, uint32_t freq);
+extern uint16_t get_upsampling_peq_sections(uint ch);
+extern bool is_upsampling_peq_pending(void);
+extern bool load_upsampling_room_fir(const float *ir_L, const float *ir_R, uint32_t num_taps, uint32_t freq);
+extern uint32_t get_upsampling_room_fir_taps(void);
+extern uint32_t get_upsampling_room_fir_latency(void);
+extern float measure_upsampling_stage_cycles(uint stage);
+extern void __not_in_flash_func(upsampling_process_core0)(bool adjust_flow);
 extern uint32_t __not_in_flash_func(upsampling_process_core1)(float *in_L, float *in_R, float *out_L, float *out_R, uint32_t length);
+extern uint32_t __not_in_flash_func(upsampling_process_channel)(uint ch, float *in, float *out, uint32_t length);
+extern uint32_t __not_in_flash_func(upsampling_process_channel_q31)(uint ch, const int32_t *in, int32_t *out, uint32_t length);
 
 #endif /* _UPSAMPLING_H_ */
\ No newline at end of file
@@ -6,7 +6,7 @@
  */
 
 #include <stdlib.h>
-#include "pico/stdlib.h"
+#include "dsp_filter.h"
 
 // BQ-IIR 2x filter0  44.1k/48k to 88.2k/96k
 const float coef_bq_filter_2x_0[][6] =
@@ -119,4 +119,193 @@ const float coef_fir_filter_2x_2[] =
      -0.00010363666390114375, -2.3207236303279864e-05, 1.617054560147816e-05, 1.4490979640598436e-05, 3.2303632696684967e-06, -1.5688680645295024e-06,
      -1.1644240182924044e-06, -1.3691560125759443e-07, 1.0285352714726494e-07, 2.897584527358658e-08, -2.69127915770613e-09, -6.009812970373258e-10};
 
-const uint32_t size_coef_fir_filter_2x_2 = sizeof(coef_fir_filter_2x_2) / sizeof(float);
\ No newline at end of file
+const uint32_t size_coef_fir_filter_2x_2 = sizeof(coef_fir_filter_2x_2) / sizeof(float);
+
+// 以下のプロファイルの周波数特性は44.1kHz系での実測値(float係数 48kHz系では周波数が48/44.1倍になる)
+// FIR 4x filter0 linear phase(128tap 20kHzまで-0.1dB以内 28kHz以上-150dB) 44.1k/48k to 176.4k/192k
+const float coef_fir_filter_4x_0_linear[] =
+    {-3.896255122981529e-07, -2.590378016975592e-06, -9.874625902739353e-06, -2.73266250587767e-05, -5.96351019339636e-05, -0.00010592709440970793,
+     -0.00015293408068828285, -0.0001707563642412424, -0.00011735451698768884, 4.4019194319844246e-05, 0.00031724240398034453, 0.0006482902681455016,
+     0.0009220981155522168, 0.0009967224905267358, 0.0007724437164142728, 0.0002677429292816669, -0.00034450271050445735, -0.0007815755670890212,
+     -0.000780195405241102, -0.0002591447264421731, 0.0005780197097919881, 0.0012870500795543194, 0.0013926889514550567, 0.0006786042940802872,
+     -0.0006079042796045542, -0.0017948488239198923, -0.002110045636072755, -0.001154361292719841, 0.0007493832381442189, 0.0025937973987311125,
+     0.003181715263053775, 0.0018620006740093231, -0.0009233099408447742, -0.0036861286498606205, -0.004637150559574366, -0.0027907390613108873,
+     0.0012220145436003804, 0.005231424234807491, 0.0066340770572423935, 0.004007982090115547, -0.0017220288282260299, -0.007425561547279358,
+     -0.009380712173879147, -0.00559089845046401, 0.0025760361459106207, 0.010628161951899529, 0.013272786512970924, 0.007709902245551348,
+     -0.004054073244333267, -0.015553568489849567, -0.019158298149704933, -0.010775063186883926, 0.006757419090718031, 0.023974690586328506,
+     0.02933194488286972, 0.016036562621593475, -0.012494304217398167, -0.042009979486465454, -0.052844710648059845, -0.02934468910098076,
+     0.031217342242598534, 0.11501285433769226, 0.1957624852657318, 0.24520307779312134, 0.24520307779312134, 0.1957624852657318,
+     0.11501285433769226, 0.031217342242598534, -0.02934468910098076, -0.052844710648059845, -0.042009979486465454, -0.012494304217398167,
+     0.016036562621593475, 0.02933194488286972, 0.023974690586328506, 0.006757419090718031, -0.010775063186883926, -0.019158298149704933,
+     -0.015553568489849567, -0.004054073244333267, 0.007709902245551348, 0.013272786512970924, 0.010628161951899529, 0.0025760361459106207,
+     -0.00559089845046401, -0.009380712173879147, -0.007425561547279358, -0.0017220288282260299, 0.004007982090115547, 0.0066340770572423935,
+     0.005231424234807491, 0.0012220145436003804, -0.0027907390613108873, -0.004637150559574366, -0.0036861286498606205, -0.0009233099408447742,
+     0.0018620006740093231, 0.003181715263053775, 0.0025937973987311125, 0.0007493832381442189, -0.001154361292719841, -0.002110045636072755,
+     -0.0017948488239198923, -0.0006079042796045542, 0.0006786042940802872, 0.0013926889514550567, 0.0012870500795543194, 0.0005780197097919881,
+     -0.0002591447264421731, -0.000780195405241102, -0.0007815755670890212, -0.00034450271050445735, 0.0002677429292816669, 0.0007724437164142728,
+     0.0009967224905267358, 0.0009220981155522168, 0.0006482902681455016, 0.00031724240398034453, 4.4019194319844246e-05, -0.00011735451698768884,
+     -0.0001707563642412424, -0.00015293408068828285, -0.00010592709440970793, -5.96351019339636e-05, -2.73266250587767e-05, -9.874625902739353e-06,
+     -2.590378016975592e-06, -3.896255122981529e-07};
+
+const uint32_t size_coef_fir_filter_4x_0_linear = sizeof(coef_fir_filter_4x_0_linear) / sizeof(float);
+
+// FIR 4x filter0 apodizing(384tap 20kHzまで-0.1dB以内 入力のナイキスト周波数から-102dB 24.1kHz以上-145dB) 44.1k/48k to 176.4k/192k
+const float coef_fir_filter_4x_0_apodizing[] =
+    {-3.2672977567926864e-07, -1.734168790790136e-06, -5.7248757912020665e-06, -1.4467303117271513e-05, -3.0221703127608635e-05, -5.407903154264204e-05,
+     -8.420232916250825e-05, -0.00011418794747442007, -0.00013251916971057653, -0.00012409432383719832, -7.428092794725671e-05, 2.5097548132180236e-05,
+     0.00016967006376944482, 0.0003389991179574281, 0.0004981810925528407, 0.0006056948332116008, 0.0006261823000386357, 0.0005442388937808573,
+     0.0003737484512384981, 0.00015785990399308503, -4.234636799083091e-05, -0.00016793308896012604, -0.0001840455806814134, -9.482160385232419e-05,
+     5.595443144557066e-05, 0.00020043813856318593, 0.0002735873276833445, 0.00024068130005616695, 0.00011339023330947384, -5.375347245717421e-05,
+     -0.00018640203052200377, -0.0002237955923192203, -0.00014769834524486214, 7.0794421844766475e-06, 0.0001668396289460361, 0.0002526853932067752,
+     0.00021869259944651276, 7.617471419507638e-05, -0.0001088625576812774, -0.0002456210495438427, -0.0002626749046612531, -0.00014517591625917703,
+     5.417432839749381e-05, 0.0002377670316491276, 0.00031014191335998476, 0.00022709151380695403, 2.1751249732915312e-05, -0.00020738663442898542,
+     -0.000343050982337445, -0.0003087171062361449, -0.00011112347419839352, 0.00015754051855765283, 0.0003618063637986779, 0.0003906400525011122,
+     0.00021715111506637186, -8.151598740369081e-05, -0.00035738060250878334, -0.00046429966459982097, -0.0003347804304212332, -2.086234417220112e-05,
+     0.00032498425571247935, 0.0005231316899880767, 0.0004594623460434377, 0.0001499458885518834, -0.0002589000796433538, -0.000558373227249831,
+     -0.0005834480980411172, -0.0003027968341484666, 0.00015569711104035378, 0.0005618318682536483, 0.0006978930905461311, 0.0004745380429085344,
+     -1.3514548300008755e-05, -0.0005255061550997198, -0.0007924690726213157, -0.000657716125715524, -0.00016702309949323535, 0.0004425992665346712,
+     0.0008561918511986732, 0.0008427168359048665, 0.0003827677574008703, -0.00030783042893745005, -0.0008776870090514421, -0.0010176821378991008,
+     -0.0006274871411733329, 0.00011835985060315579, 0.0008461726829409599, 0.0011692037805914879, 0.0008920521358959377, 0.00012591744598466903,
+     -0.0007519812206737697, -0.0012827202444896102, -0.0011644430924206972, -0.0004219482943881303, 0.0005872001056559384, 0.0013430195394903421,
+     0.001429801806807518, 0.0007630201289430261, -0.00034655004856176674, -0.0013351207599043846, -0.0016709265764802694, -0.0011386681580916047,
+     2.7981561288470402e-05, 0.001245039515197277, 0.001868798746727407, 0.001534684794023633, 0.0003668268327601254, -0.0010605043498799205,
+     -0.002003089990466833, -0.001933084917254746, -0.000831823970656842, 0.0007719648419879377, 0.002053097588941455, 0.002312559401616454,
+     0.001356392866000533, -0.00037327001336961985, -0.001998502528294921, -0.0026488788425922394, -0.0019251625053584576, -0.0001376395084662363,
+     0.001820199890062213, 0.00291540939360857, 0.002517915330827236, 0.0007580467499792576, -0.0015012541553005576, -0.0030838886741548777,
+     -0.003109833924099803, -0.0014801174402236938, 0.0010275795357301831, 0.003125021932646632, 0.0036716570612043142, 0.002290502190589905,
+     -0.0003887042112182826, -0.003009249223396182, -0.0041701034642755985, -0.003170279785990715, -0.00042180719901807606, 0.0027072536759078503,
+     0.004568206146359444, 0.0040950109250843525, 0.001406210707500577, -0.002190129831433296, -0.004825383424758911, -0.005034725647419691,
+     -0.002562581794336438, 0.0014293254353106022, 0.004897433333098888, 0.005954216234385967, 0.003885597689077258, -0.00039548167842440307,
+     -0.004735514987260103, -0.006812881678342819, -0.005367719102650881, -0.0009438225533813238, 0.004283958114683628, 0.007564186118543148,
+     0.00700135575607419, 0.002628525486215949, -0.0034757405519485474, -0.008154244162142277, -0.008782877586781979, -0.004714973270893097,
+     0.0022228688467293978, 0.008517829701304436, 0.010719239711761475, 0.007292763330042362, -0.0003971746191382408, -0.008569777943193913,
+     -0.012841163203120232, -0.010520195588469505, -0.0022118433844298124, 0.008184424601495266, 0.015230965800583363, 0.014705189503729343,
+     0.005997673608362675, -0.007143630180507898, -0.018092043697834015, -0.020519651472568512, -0.011817502789199352, 0.004982508718967438,
+     0.021960437297821045, 0.029701903462409973, 0.021982215344905853, -0.0003970998805016279, -0.028589513152837753, -0.0483492948114872,
+     -0.04556596279144287, -0.012511234730482101, 0.047892164438962936, 0.12180894613265991, 0.18866178393363953, 0.22828461229801178,
+     0.22828461229801178, 0.18866178393363953, 0.12180894613265991, 0.047892164438962936, -0.012511234730482101, -0.04556596279144287,
+     -0.0483492948114872, -0.028589513152837753, -0.0003970998805016279, 0.021982215344905853, 0.029701903462409973, 0.021960437297821045,
+     0.004982508718967438, -0.011817502789199352, -0.020519651472568512, -0.018092043697834015, -0.007143630180507898, 0.005997673608362675,
+     0.014705189503729343, 0.015230965800583363, 0.008184424601495266, -0.0022118433844298124, -0.010520195588469505, -0.012841163203120232,
+     -0.008569777943193913, -0.0003971746191382408, 0.007292763330042362, 0.010719239711761475, 0.008517829701304436, 0.0022228688467293978,
+     -0.004714973270893097, -0.008782877586781979, -0.008154244162142277, -0.0034757405519485474, 0.002628525486215949, 0.00700135575607419,
+     0.007564186118543148, 0.004283958114683628, -0.0009438225533813238, -0.005367719102650881, -0.006812881678342819, -0.004735514987260103,
+     -0.00039548167842440307, 0.003885597689077258, 0.005954216234385967, 0.004897433333098888, 0.0014293254353106022, -0.002562581794336438,
+     -0.005034725647419691, -0.004825383424758911, -0.002190129831433296, 0.001406210707500577, 0.0040950109250843525, 0.004568206146359444,
+     0.0027072536759078503, -0.00042180719901807606, -0.003170279785990715, -0.0041701034642755985, -0.003009249223396182, -0.0003887042112182826,
+     0.002290502190589905, 0.0036716570612043142, 0.003125021932646632, 0.0010275795357301831, -0.0014801174402236938, -0.003109833924099803,
+     -0.0030838886741548777, -0.0015012541553005576, 0.0007580467499792576, 0.002517915330827236, 0.00291540939360857, 0.001820199890062213,
+     -0.0001376395084662363, -0.0019251625053584576, -0.0026488788425922394, -0.001998502528294921, -0.00037327001336961985, 0.001356392866000533,
+     0.002312559401616454, 0.002053097588941455, 0.0007719648419879377, -0.000831823970656842, -0.001933084917254746, -0.002003089990466833,
+     -0.0010605043498799205, 0.0003668268327601254, 0.001534684794023633, 0.001868798746727407, 0.001245039515197277, 2.7981561288470402e-05,
+     -0.0011386681580916047, -0.0016709265764802694, -0.0013351207599043846, -0.00034655004856176674, 0.0007630201289430261, 0.001429801806807518,
+     0.0013430195394903421, 0.0005872001056559384, -0.0004219482943881303, -0.0011644430924206972, -0.0012827202444896102, -0.0007519812206737697,
+     0.00012591744598466903, 0.0008920521358959377, 0.0011692037805914879, 0.0008461726829409599, 0.00011835985060315579, -0.0006274871411733329,
+     -0.0010176821378991008, -0.0008776870090514421, -0.00030783042893745005, 0.0003827677574008703, 0.0008427168359048665, 0.0008561918511986732,
+     0.0004425992665346712, -0.00016702309949323535, -0.000657716125715524, -0.0007924690726213157, -0.0005255061550997198, -1.3514548300008755e-05,
+     0.0004745380429085344, 0.0006978930905461311, 0.0005618318682536483, 0.00015569711104035378, -0.0003027968341484666, -0.0005834480980411172,
+     -0.000558373227249831, -0.0002589000796433538, 0.0001499458885518834, 0.0004594623460434377, 0.0005231316899880767, 0.00032498425571247935,
+     -2.086234417220112e-05, -0.0003347804304212332, -0.00046429966459982097, -0.00035738060250878334, -8.151598740369081e-05, 0.00021715111506637186,
+     0.0003906400525011122, 0.0003618063637986779, 0.00015754051855765283, -0.00011112347419839352, -0.0003087171062361449, -0.000343050982337445,
+     -0.00020738663442898542, 2.1751249732915312e-05, 0.00022709151380695403, 0.00031014191335998476, 0.0002377670316491276, 5.417432839749381e-05,
+     -0.00014517591625917703, -0.0002626749046612531, -0.0002456210495438427, -0.0001088625576812774, 7.617471419507638e-05, 0.00021869259944651276,
+     0.0002526853932067752, 0.0001668396289460361, 7.0794421844766475e-06, -0.00014769834524486214, -0.0002237955923192203, -0.00018640203052200377,
+     -5.375347245717421e-05, 0.00011339023330947384, 0.00024068130005616695, 0.0002735873276833445, 0.00020043813856318593, 5.595443144557066e-05,
+     -9.482160385232419e-05, -0.0001840455806814134, -0.00016793308896012604, -4.234636799083091e-05, 0.00015785990399308503, 0.0003737484512384981,
+     0.0005442388937808573, 0.0006261823000386357, 0.0006056948332116008, 0.0004981810925528407, 0.0003389991179574281, 0.00016967006376944482,
+     2.5097548132180236e-05, -7.428092794725671e-05, -0.00012409432383719832, -0.00013251916971057653, -0.00011418794747442007, -8.420232916250825e-05,
+     -5.407903154264204e-05, -3.0221703127608635e-05, -1.4467303117271513e-05, -5.7248757912020665e-06, -1.734168790790136e-06, -3.2672977567926864e-07};
+
+const uint32_t size_coef_fir_filter_4x_0_apodizing = sizeof(coef_fir_filter_4x_0_apodizing) / sizeof(float);
+_Static_assert(sizeof(coef_fir_filter_4x_0_apodizing) / sizeof(float) <= SIZE_FIR_PROFILE_0, "SIZE_FIR_PROFILE_0 is too small");
+
+// FIR 4x filter0 short delay(64tap 最小位相 20kHzまで-0.1dB以内 38kHz以上-150dB) 44.1k/48k to 176.4k/192k
+const float coef_fir_filter_4x_0_short[] =
+    {9.215320062594401e-09, 1.1131107413575592e-07, 6.55141377592372e-07, 2.481695901224157e-06, 6.648358976235613e-06, 1.2807568964490201e-05,
+     1.6386071365559474e-05, 7.562440259789582e-06, -2.2592499590246007e-05, -6.702129758195952e-05, -8.920004620449618e-05, -3.4337608667556196e-05,
+     0.00011937195813516155, 0.0002945020387414843, 0.00030750184669159353, -8.644259651191533e-06, -0.0005863223923370242, -0.0009984374046325684,
+     -0.0006591326091438532, 0.0006310450844466686, 0.0021757055073976517, 0.002518769120797515, 0.000507432734593749, -0.0032961484976112843,
+     -0.006160445977002382, -0.004703411366790533, 0.00213013612665236, 0.01089884340763092, 0.01480934303253889, 0.00850542914122343,
+     -0.006551051512360573, -0.020866714417934418, -0.022416817024350166, -0.006105503998696804, 0.01992960460484028, 0.03745333477854729,
+     0.030418692156672478, -0.0017001861706376076, -0.040157467126846313, -0.057537857443094254, -0.036807771772146225, 0.014494312927126884,
+     0.0660795047879219, 0.08302709460258484, 0.04869995266199112, -0.022932445630431175, -0.09397266805171967, -0.12396145612001419,
+     -0.09228605031967163, -0.008233238942921162, 0.09590497612953186, 0.18267129361629486, 0.2268955260515213, 0.22379755973815918,
+     0.18585139513015747, 0.13295169174671173, 0.08257489651441574, 0.04447447508573532, 0.020590027794241905, 0.008051413111388683,
+     0.0025798631832003593, 0.0006422740407288074, 0.0001118944346671924, 1.0392125659564044e-05};
+
+const uint32_t size_coef_fir_filter_4x_0_short = sizeof(coef_fir_filter_4x_0_short) / sizeof(float);
+
+// FIR 2x filter1 linear phase(48tap 20kHzまで-0.1dB以内 44.1kHz以上-159dB) 88.2k/96k to 176.4k/192k
+const float coef_fir_filter_2x_1_linear[] =
+    {-1.2817544075005571e-06, -1.2007132681901567e-05, -5.475706348079257e-05, -0.0001537486386951059, -0.0002671881811693311, -0.00018456375983078033,
+     0.0004569623270072043, 0.0018258077325299382, 0.0032890583388507366, 0.00320197525434196, -2.807396958814934e-05, -0.005709938704967499,
+     -0.009480985812842846, -0.005527390167117119, 0.007401803974062204, 0.020948823541402817, 0.02011050097644329, -0.003918577451258898,
+     -0.039687033742666245, -0.05484401062130928, -0.01588241383433342, 0.08294263482093811, 0.20540902018547058, 0.29016536474227905,
+     0.29016536474227905, 0.20540902018547058, 0.08294263482093811, -0.01588241383433342, -0.05484401062130928, -0.039687033742666245,
+     -0.003918577451258898, 0.02011050097644329, 0.020948823541402817, 0.007401803974062204, -0.005527390167117119, -0.009480985812842846,
+     -0.005709938704967499, -2.807396958814934e-05, 0.00320197525434196, 0.0032890583388507366, 0.0018258077325299382, 0.0004569623270072043,
+     -0.00018456375983078033, -0.0002671881811693311, -0.0001537486386951059, -5.475706348079257e-05, -1.2007132681901567e-05, -1.2817544075005571e-06};
+
+const uint32_t size_coef_fir_filter_2x_1_linear = sizeof(coef_fir_filter_2x_1_linear) / sizeof(float);
+
+// FIR 2x filter1 apodizing(48tap 20kHzまで-0.1dB以内 40kHz以上-140dB) 88.2k/96k to 176.4k/192k
+const float coef_fir_filter_2x_1_apodizing[] =
+    {-8.461947800242342e-06, -6.243463576538488e-05, -0.00023401198268402368, -0.0005614508409053087, -0.0008838451467454433, -0.0007242666906677186,
+     0.0004811292455997318, 0.0026818979531526566, 0.004522328730672598, 0.0036840520333498716, -0.0011567875044420362, -0.007869892753660679,
+     -0.010632192716002464, -0.003908737562596798, 0.011127135716378689, 0.02358327992260456, 0.0187013428658247, -0.00876747164875269,
+     -0.04364372789859772, -0.053744006901979446, -0.010142133571207523, 0.08816585689783096, 0.20503924787044525, 0.2843531668186188,
+     0.2843531668186188, 0.20503924787044525, 0.08816585689783096, -0.010142133571207523, -0.053744006901979446, -0.04364372789859772,
+     -0.00876747164875269, 0.0187013428658247, 0.02358327992260456, 0.011127135716378689, -0.003908737562596798, -0.010632192716002464,
+     -0.007869892753660679, -0.0011567875044420362, 0.0036840520333498716, 0.004522328730672598, 0.0026818979531526566, 0.0004811292455997318,
+     -0.0007242666906677186, -0.0008838451467454433, -0.0005614508409053087, -0.00023401198268402368, -6.243463576538488e-05, -8.461947800242342e-06};
+
+const uint32_t size_coef_fir_filter_2x_1_apodizing = sizeof(coef_fir_filter_2x_1_apodizing) / sizeof(float);
+
+// FIR 2x filter1 short delay(24tap 最小位相 20kHzまで-0.1dB以内 64kHz以上-148dB) 88.2k/96k to 176.4k/192k
+const float coef_fir_filter_2x_1_short[] =
+    {5.216320914769312e-06, 1.7554908481542952e-05, -3.995458973804489e-05, -0.00025598632055334747, -0.00014052038022782654, 0.001290582469664514,
+     0.0025578464847058058, -0.0018524647457525134, -0.01186970341950655, -0.010005231946706772, 0.020572176203131676, 0.05342557281255722,
+     0.026356421411037445, -0.06958774477243423, -0.1350725144147873, -0.057865094393491745, 0.14026276767253876, 0.3100731670856476,
+     0.33505722880363464, 0.23658345639705658, 0.11481121927499771, 0.03747406229376793, 0.007499835919588804, 0.0007021084311418235};
+
+const uint32_t size_coef_fir_filter_2x_1_short = sizeof(coef_fir_filter_2x_1_short) / sizeof(float);
+
+// フィルタプロファイル(BiQuad-IIRは全プロファイル共通 FIR段のサイクル数は128tap 4相で340を基準にタップ数に比例させた見積もり値)
+const DSP_PROFILE dsp_profile_table[NUM_OF_DSP_PROFILE] = {
+    [DSP_PROFILE_MINIMUM] = {
+        .name = "minimum",
+        .fir_4x_0 = {coef_fir_filter_4x_0, sizeof(coef_fir_filter_4x_0) / sizeof(float)},
+        .fir_2x_1 = {coef_fir_filter_2x_1, sizeof(coef_fir_filter_2x_1) / sizeof(float)},
+        .bq_2x_2 = coef_bq_filter_2x_2,
+        .bq_2x_3 = coef_bq_filter_2x_3,
+        .bq_4x_0 = coef_bq_filter_4x_0,
+        .cycles = {340, 130, 0},
+    },
+    [DSP_PROFILE_LINEAR] = {
+        .name = "linear",
+        .fir_4x_0 = {coef_fir_filter_4x_0_linear, sizeof(coef_fir_filter_4x_0_linear) / sizeof(float)},
+        .fir_2x_1 = {coef_fir_filter_2x_1_linear, sizeof(coef_fir_filter_2x_1_linear) / sizeof(float)},
+        .bq_2x_2 = coef_bq_filter_2x_2,
+        .bq_2x_3 = coef_bq_filter_2x_3,
+        .bq_4x_0 = coef_bq_filter_4x_0,
+        .cycles = {340, 130, 0},
+    },
+    [DSP_PROFILE_APODIZING] = {
+        .name = "apodizing",
+        .fir_4x_0 = {coef_fir_filter_4x_0_apodizing, sizeof(coef_fir_filter_4x_0_apodizing) / sizeof(float)},
+        .fir_2x_1 = {coef_fir_filter_2x_1_apodizing, sizeof(coef_fir_filter_2x_1_apodizing) / sizeof(float)},
+        .bq_2x_2 = coef_bq_filter_2x_2,
+        .bq_2x_3 = coef_bq_filter_2x_3,
+        .bq_4x_0 = coef_bq_filter_4x_0,
+        .cycles = {1020, 130, 0},
+    },
+    [DSP_PROFILE_SHORT] = {
+        .name = "short",
+        .fir_4x_0 = {coef_fir_filter_4x_0_short, sizeof(coef_fir_filter_4x_0_short) / sizeof(float)},
+        .fir_2x_1 = {coef_fir_filter_2x_1_short, sizeof(coef_fir_filter_2x_1_short) / sizeof(float)},
+        .bq_2x_2 = coef_bq_filter_2x_2,
+        .bq_2x_3 = coef_bq_filter_2x_3,
+        .bq_4x_0 = coef_bq_filter_4x_0,
+        .cycles = {170, 65, 0},
+    },
+};
@@ -10,6 +10,18 @@
 #include "lufa/AudioClassCommon.h"
 #include "common.h"
 #include "upsampling.h"
+#include "stream_switch.h"
+#include "scheduler.h"
+#include "core_handoff.h"
+#include "deferred_work.h"
+#include "stage_partition.h"
+#include "profiler.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "flow_control.h"
+#include "filter_profile.h"
+#include "peq_control.h"
+#include "room_fir_control.h"
 
 // todo make descriptor strings should probably belong to the configs
 static char *descriptor_strings[] =
@@ -27,6 +39,8 @@ static char *descriptor_strings[] =
 
 #define AUDIO_OUT_ENDPOINT (0x01U)
 #define AUDIO_IN_ENDPOINT 0x82U
+#define TELEMETRY_ENDPOINT (0x83U)
+#define TELEMETRY_INTERFACE_NUMBER (2)
 
 #undef AUDIO_SAMPLE_FREQ
 #define AUDIO_SAMPLE_FREQ(frq) (uint8_t)(frq), (uint8_t)((frq >> 8)), (uint8_t)((frq >> 16))
@@ -91,15 +105,21 @@ struct audio_device_config
 		USB_Audio_StdDescriptor_StreamEndpoint_Spc_t audio;
 	} ep1_2;
 	struct usb_endpoint_descriptor_long ep2_2;
+
+	// テレメトリ用ベンダー固有インターフェイス(TELEMETRY_ENABLE=falseの場合はwTotalLengthから外す)
+	struct usb_interface_descriptor telemetry_interface;
+	struct usb_endpoint_descriptor ep_telemetry;
 };
 
+#define SIZE_TELEMETRY_DESCRIPTOR (sizeof(struct usb_interface_descriptor) + sizeof(struct usb_endpoint_descriptor))
+
 static const struct audio_device_config audio_device_config =
 	{
 		.descriptor = {
 			.bLength = sizeof(audio_device_config.descriptor),
 			.bDescriptorType = DTYPE_Configuration,
-			.wTotalLength = sizeof(audio_device_config),
-			.bNumInterfaces = 2,
+			.wTotalLength = sizeof(audio_device_config) - (TELEMETRY_ENABLE ? 0 : SIZE_TELEMETRY_DESCRIPTOR),
+			.bNumInterfaces = TELEMETRY_ENABLE ? 3 : 2,
 			.bConfigurationValue = 0x01,
 			.iConfiguration = 0x00,
 			.bmAttributes = 0x80,
@@ -295,11 +315,32 @@ static const struct audio_device_config audio_device_config =
 			.bInterval = 0x01,
 			.bRefresh = 0, // 1ms
 			.bSyncAddr = 0,
+		},
+		.telemetry_interface = {
+			.bLength = sizeof(audio_device_config.telemetry_interface),
+			.bDescriptorType = DTYPE_Interface,
+			.bInterfaceNumber = TELEMETRY_INTERFACE_NUMBER,
+			.bAlternateSetting = 0x00,
+			.bNumEndpoints = 0x01,
+			.bInterfaceClass = 0xff, // Vendor Specific
+			.bInterfaceSubClass = 0x00,
+			.bInterfaceProtocol = 0x00,
+			.iInterface = 0x00,
+		},
+		.ep_telemetry = {
+			.bLength = sizeof(audio_device_config.ep_telemetry),
+			.bDescriptorType = DTYPE_Endpoint,
+			.bEndpointAddress = TELEMETRY_ENDPOINT,
+			.bmAttributes = 0x02, // Bulk
+			.wMaxPacketSize = sizeof(TELEMETRY_PACKET),
+			.bInterval = 0x00,
 		}};
 
 static struct usb_interface ac_interface;
 static struct usb_interface as_op_interface;
 static struct usb_endpoint ep_op_out, ep_op_sync;
+static struct usb_interface telemetry_interface;
+static struct usb_endpoint ep_telemetry;
 
 static const struct usb_device_descriptor boot_device_descriptor = {
 	.bLength = 18,
@@ -333,14 +374,11 @@ const char *_get_descriptor_string(uint index)
 // バッファ長制限 バッファオーバーラン防止処理
 uint16_t buffer_length_limiter(uint32_t freq, uint16_t length)
 {
-	int32_t limit_length = get_size_remain(&buffer_upsr_data_Lch_0) / get_ratio_upsampling_core0(freq);
-
-	limit_length = saturation_i32(limit_length, SIZE_EP_BUFFER, 0);
-	
-	uint16_t output = length;
-	if (length > limit_length)
+	uint16_t output = flow_limit_ep_length(get_size_remain(&buffer_upsr_data_Lch_0), get_ratio_core0_output(freq), length, SIZE_EP_BUFFER);
+	if (output < length)
 	{
-		output = limit_length;
+		telemetry_count(TELEMETRY_COUNTER_OVERRUN, 1);
+		trace_event(TRACE_ID_OVERRUN, length - output);
 	}
 
 	return output;
@@ -365,9 +403,9 @@ uint16_t __not_in_flash_func(usb_ep_data_acquire)(uint bit_depth, int16_t *ep, u
 		while (sample_num--)
 		{
 			data = ((int32_t)(*u16_ep++) | (*u16_ep++ << 16)) >> 0;
-			buf_left_ch[count] = (int32_t)((float)data * audio_state.vol_float);
+			buf_left_ch[count] = data;
 			data = ((int32_t)(*u16_ep++) | (*u16_ep++ << 16)) >> 0;
-			buf_right_ch[count] = (int32_t)((float)data * audio_state.vol_float);
+			buf_right_ch[count] = data;
 			count++;
 		}
 		break;
@@ -379,9 +417,9 @@ uint16_t __not_in_flash_func(usb_ep_data_acquire)(uint bit_depth, int16_t *ep, u
 		while (sample_num--)
 		{
 			data = ((int32_t)(*u16_ep++ << 8) | (*u16_ep << 24)) >> 0;
-			buf_left_ch[count] = (int32_t)((float)data * audio_state.vol_float);
+			buf_left_ch[count] = data;
 			data = ((int32_t)(*u16_ep++ & 0xff00) | (*u16_ep++ << 16)) >> 0;
-			buf_right_ch[count] = (int32_t)((float)data * audio_state.vol_float);
+			buf_right_ch[count] = data;
 			count++;
 		}
 		break;
@@ -394,9 +432,9 @@ uint16_t __not_in_flash_func(usb_ep_data_acquire)(uint bit_depth, int16_t *ep, u
 		while (sample_num--)
 		{
 			data = ((int32_t)*ep++) << 16;
-			buf_left_ch[count] = (int32_t)((float)data * audio_state.vol_float);
+			buf_left_ch[count] = data;
 			data = ((int32_t)*ep++) << 16;
-			buf_right_ch[count] = (int32_t)((float)data * audio_state.vol_float);
+			buf_right_ch[count] = data;
 			count++;
 		}
 		break;
@@ -412,12 +450,12 @@ static void _as_sync_packet(struct usb_endpoint *ep)
 	buffer->data_len = 3;
 
 	// Feedbackパラメータ計算 アップサンプリングバッファの使用率でFBをかけている
-	float ratio = get_ratio_upsampling_core0(audio_state.freq);
-	float deviation = (SIZE_BUFFER_FB_THRESHOLD - get_size_using(&buffer_upsr_data_Lch_0)) / ratio;
-	int32_t adjust_value = saturation_i32((int32_t)deviation, FB_ADJ_LIMIT, -FB_ADJ_LIMIT);
+	int32_t adjust_value = flow_feedback_adjust(&flow_param, get_size_using(&buffer_upsr_data_Lch_0), get_ratio_core0_output(audio_state.freq));
 
 	uint32_t feedback_fs = audio_state.freq + adjust_value;
-	uint32_t feedback = (feedback_fs << 14) / 1000;
+	uint32_t feedback = flow_feedback_value(feedback_fs);
+	telemetry_feedback_fs = feedback_fs;
+	trace_event(TRACE_ID_FEEDBACK, feedback_fs);
 
 	buffer->data[0] = feedback;
 	buffer->data[1] = feedback >> 8u;
@@ -437,8 +475,14 @@ static const struct usb_transfer_type as_sync_transfer_type = {
 	.initial_packet_count = 1,
 };
 
+static const struct usb_transfer_type telemetry_transfer_type = {
+	.on_packet = telemetry_on_packet,
+	.initial_packet_count = 1,
+};
+
 static struct usb_transfer as_transfer;
 static struct usb_transfer as_sync_transfer;
+static struct usb_transfer telemetry_transfer;
 
 static bool do_get_current(struct usb_setup_packet *setup)
 {
@@ -462,7 +506,7 @@ static bool do_get_current(struct usb_setup_packet *setup)
 	{
 		if ((setup->wValue >> 8u) == ENDPOINT_FREQ_CONTROL)
 		{
-			usb_start_tiny_control_in_transfer(audio_state.freq, 3);
+			usb_start_tiny_control_in_transfer(get_stream_freq(), 3);
 			return true;
 		}
 	}
@@ -551,22 +595,15 @@ static void audio_cmd_packet(struct usb_endpoint *ep)
 			{
 			case FEATURE_MUTE_CONTROL:
 			{
+				// ミュートは音量と同じく短いランプで0にする(バッファ・フィルタの状態はクリアしないので、解除後すぐに音が出る)
 				audio_state.mute = buffer->data[0];
-				if (audio_state.mute == true)
-				{
-					//if(USE_ESS_DAC && KIND_ESS_DAC == ES9038Q2M)
-					//	ess_dac_mute();
-					clear_ringbuffer(&buffer_ep_Lch);
-					clear_ringbuffer(&buffer_ep_Rch);
-					clear_ringbuffer(&buffer_upsr_data_Lch_0);
-					clear_ringbuffer(&buffer_upsr_data_Rch_0);
-					clear_bq_filter_delay();
-				}
+				volume_control();
 				break;
 			}
 			case FEATURE_VOLUME_CONTROL:
 			{
 				audio_set_volume(*(int16_t *)buffer->data);
+				volume_control();
 				break;
 			}
 			}
@@ -576,18 +613,9 @@ static void audio_cmd_packet(struct usb_endpoint *ep)
 			if (audio_control_cmd_t.cs == ENDPOINT_FREQ_CONTROL)
 			{
 				uint32_t new_freq = (*(uint32_t *)buffer->data) & 0x00ffffffu;
-				if (audio_state.freq != new_freq)
-				{
-					audio_state.freq = new_freq;
-					if(USE_ESS_DAC && KIND_ESS_DAC == ES9038Q2M)
-						ess_dac_mute();
-					clear_ringbuffer(&buffer_ep_Lch);
-					clear_ringbuffer(&buffer_ep_Rch);
-					clear_ringbuffer(&buffer_upsr_data_Lch_0);
-					clear_ringbuffer(&buffer_upsr_data_Rch_0);
-					clear_bq_filter_delay();
-					renew_clock(is_high_power_mode);
-				}
+				// audio_state.freqはフェードアウト後にstream_switch_processで反映する
+				if (get_stream_freq() != new_freq)
+					request_stream_reconfigure(new_freq, is_high_power_mode);
 			}
 		}
 	}
@@ -702,6 +730,137 @@ bool _as_setup_request_handler(__unused struct usb_endpoint *ep, struct usb_setu
 	return false;
 }
 
+// デバイス宛てのベンダーリクエスト(フィルタプロファイルの切り替え) falseを返すとSTALLになる
+// PEQ_REQ_SET_BANDのデータステージ
+static uint8_t peq_band_ch_mask;
+static uint8_t peq_band_index;
+
+static void peq_band_packet(struct usb_endpoint *ep)
+{
+	struct usb_buffer *buffer = usb_current_out_packet_buffer(ep);
+	PEQ_BAND_PACKET packet;
+	if (buffer->data_len >= sizeof(packet))
+	{
+		memcpy(&packet, buffer->data, sizeof(packet));
+		set_peq_band(peq_band_ch_mask, peq_band_index, &packet);
+	}
+	usb_start_empty_control_in_transfer_null_completion();
+}
+
+static const struct usb_transfer_type peq_band_transfer_type = {
+	.on_packet = peq_band_packet,
+	.initial_packet_count = 1,
+};
+
+// ROOM_FIR_REQ_WRITEのデータステージ
+// 書き込めなかった場合(SETUPの後に反映が始まった場合など)はステータスステージを返さずにSTALLにする
+// usb_stall_control_pipeはpico-extrasのusb_device.cで定義されているがヘッダで公開されていない
+extern void usb_stall_control_pipe(struct usb_setup_packet *setup);
+
+static uint8_t room_fir_ch_mask;
+static uint16_t room_fir_offset;
+
+static void room_fir_packet(struct usb_endpoint *ep)
+{
+	struct usb_buffer *buffer = usb_current_out_packet_buffer(ep);
+	float taps[ROOM_FIR_WRITE_MAX_TAPS];
+	uint32_t num_taps = MIN(buffer->data_len / sizeof(float), ROOM_FIR_WRITE_MAX_TAPS);
+	memcpy(taps, buffer->data, sizeof(float) * num_taps);
+	if (!write_room_fir(room_fir_ch_mask, room_fir_offset, taps, num_taps))
+	{
+		usb_stall_control_pipe(NULL);
+		return;
+	}
+	usb_start_empty_control_in_transfer_null_completion();
+}
+
+static const struct usb_transfer_type room_fir_transfer_type = {
+	.on_packet = room_fir_packet,
+	.initial_packet_count = 1,
+};
+
+static bool device_setup_request_handler(__unused struct usb_device *device, struct usb_setup_packet *setup)
+{
+	setup = __builtin_assume_aligned(setup, 4);
+	if (USB_REQ_TYPE_TYPE_VENDOR != (setup->bmRequestType & USB_REQ_TYPE_TYPE_MASK))
+		return false;
+
+	switch (setup->bRequest)
+	{
+	case FILTER_PROFILE_REQ_SET:
+		if ((setup->bmRequestType & USB_DIR_IN) || (setup->wLength != 0))
+			return false;
+		if (!request_filter_profile((uint8_t)setup->wValue))
+			return false;
+		usb_start_empty_control_in_transfer_null_completion();
+		return true;
+
+	case FILTER_PROFILE_REQ_GET:
+		if (!(setup->bmRequestType & USB_DIR_IN) || (setup->wLength == 0))
+			return false;
+		usb_start_tiny_control_in_transfer(get_filter_profile(), 1);
+		return true;
+
+	// Q31のフィルタ(Q31_PIPELINE_MODE)にはEQ・ルーム補正FIRがないので設定は受け付けない
+	case PEQ_REQ_SET_BAND:
+		if ((!PEQ_ENABLE || Q31_PIPELINE_MODE) || (setup->bmRequestType & USB_DIR_IN) || (setup->wLength != sizeof(PEQ_BAND_PACKET)))
+			return false;
+		if (((uint8_t)setup->wIndex >= DSP_PEQ_MAX_BAND) || ((setup->wIndex >> 8) == 0))
+			return false;
+		peq_band_ch_mask = setup->wIndex >> 8;
+		peq_band_index = (uint8_t)setup->wIndex;
+		usb_start_control_out_transfer(&peq_band_transfer_type);
+		return true;
+
+	case PEQ_REQ_COMMIT:
+		if ((!PEQ_ENABLE || Q31_PIPELINE_MODE) || (setup->bmRequestType & USB_DIR_IN) || (setup->wLength != 0))
+			return false;
+		if (!commit_peq(setup->wIndex >> 8, (uint8_t)MIN(setup->wValue, 0xff)))
+			return false;
+		usb_start_empty_control_in_transfer_null_completion();
+		return true;
+
+	case PEQ_REQ_GET:
+		if ((!PEQ_ENABLE) || !(setup->bmRequestType & USB_DIR_IN) || (setup->wLength == 0))
+			return false;
+		usb_start_tiny_control_in_transfer(get_peq_info(), MIN(setup->wLength, 4));
+		return true;
+
+	case ROOM_FIR_REQ_WRITE:
+		if ((!ROOM_FIR_ENABLE || Q31_PIPELINE_MODE) || (setup->bmRequestType & USB_DIR_IN))
+			return false;
+		if ((setup->wLength == 0) || (setup->wLength > sizeof(float) * ROOM_FIR_WRITE_MAX_TAPS) || (setup->wLength % sizeof(float) != 0))
+			return false;
+		if (((uint8_t)setup->wIndex == 0) || ((uint32_t)setup->wValue + setup->wLength / sizeof(float) > DSP_ROOM_FIR_MAX_TAPS))
+			return false;
+		// 反映中はインパルス応答を書き換えない
+		if (is_room_fir_pending())
+			return false;
+		room_fir_ch_mask = (uint8_t)setup->wIndex;
+		room_fir_offset = setup->wValue;
+		usb_start_control_out_transfer(&room_fir_transfer_type);
+		return true;
+
+	case ROOM_FIR_REQ_COMMIT:
+		if ((!ROOM_FIR_ENABLE || Q31_PIPELINE_MODE) || (setup->bmRequestType & USB_DIR_IN) || (setup->wLength != 0))
+			return false;
+		if (!commit_room_fir(setup->wValue, (uint32_t)setup->wIndex * 100))
+			return false;
+		usb_start_empty_control_in_transfer_null_completion();
+		return true;
+
+	case ROOM_FIR_REQ_GET:
+		if ((!ROOM_FIR_ENABLE) || !(setup->bmRequestType & USB_DIR_IN) || (setup->wLength == 0))
+			return false;
+		usb_start_tiny_control_in_transfer(get_room_fir_info(), MIN(setup->wLength, 4));
+		return true;
+
+	default:
+		break;
+	}
+	return false;
+}
+
 void usb_sound_card_init()
 {
 	// msd_interface.setup_request_handler = msd_setup_request_handler;
@@ -719,14 +878,26 @@ void usb_sound_card_init()
 	as_sync_transfer.type = &as_sync_transfer_type;
 	usb_set_default_transfer(&ep_op_sync, &as_sync_transfer);
 
+	static struct usb_endpoint *const telemetry_endpoints[] = {
+		&ep_telemetry};
+	if (TELEMETRY_ENABLE)
+	{
+		usb_interface_init(&telemetry_interface, &audio_device_config.telemetry_interface, telemetry_endpoints, count_of(telemetry_endpoints),
+						   false);
+		telemetry_transfer.type = &telemetry_transfer_type;
+		usb_set_default_transfer(&ep_telemetry, &telemetry_transfer);
+	}
+
 	static struct usb_interface *const boot_device_interfaces[] = {
 		&ac_interface,
 		&as_op_interface,
+		&telemetry_interface,
 	};
-	__unused struct usb_device *device = usb_device_init(&boot_device_descriptor, &audio_device_config.descriptor,
-														 boot_device_interfaces, count_of(boot_device_interfaces),
+	struct usb_device *device = usb_device_init(&boot_device_descriptor, &audio_device_config.descriptor,
+														 boot_device_interfaces, count_of(boot_device_interfaces) - (TELEMETRY_ENABLE ? 0 : 1),
 														 _get_descriptor_string);
 	assert(device);
+	device->setup_request_handler = device_setup_request_handler;
 	audio_set_volume(DEFAULT_VOLUME);
 	//_audio_reconfigure();
 	//    device->on_configure = _on_configure;
@@ -736,6 +907,7 @@ void usb_sound_card_init()
 // UAC Audio Packet受信時のデータ処理
 static void _as_audio_packet(struct usb_endpoint *ep)
 {
+	uint32_t start_us = time_us_32();
 	struct usb_buffer *usb_buffer = usb_current_out_packet_buffer(ep);
 	// uint8ポインタをint16にキャスト
 	int16_t *ep_in = (int16_t *)usb_buffer->data;
@@ -747,14 +919,26 @@ static void _as_audio_packet(struct usb_endpoint *ep)
 	int32_t ep_Rch[SIZE_EP_BUFFER];
 
 	// usb epデータコピー
+	uint32_t prof = profile_start();
 	length = usb_ep_data_acquire(audio_state.bit_depth, ep_in, length, ep_Lch, ep_Rch);
 
 	now_playing++; // この処理が来ているかどうかを確認するための変数
 
-	ringbuf_write_array_no_spinlock(ep_Lch, length, &buffer_ep_Lch);
-	ringbuf_write_array_no_spinlock(ep_Rch, length, &buffer_ep_Rch);
+	// サンプルレートの切り替え中は、新しいレートのデータを古いレートのフィルタ・クロックで処理しないよう捨てる
+	if (!is_stream_freq_pending())
+	{
+		ringbuf_write_array_no_spinlock(ep_Lch, length, &buffer_ep_Lch);
+		ringbuf_write_array_no_spinlock(ep_Rch, length, &buffer_ep_Rch);
+	}
+	profile_end(PROF_UNPACK, prof);
+	trace_event(TRACE_ID_USB_RX, length);
+
+	// データ到着をCore0に通知し、タイマーを待たずにアップサンプリングさせる
+	sched_post(0, SCHED_EVENT_USB_RX);
 
 	// usb epデータコピー完了処理
 	usb_grow_transfer(ep->current_transfer, 1);
 	usb_packet_done(ep);
+
+	irq_stat_record(IRQ_ID_USB_RX, start_us);
 }
\ No newline at end of file
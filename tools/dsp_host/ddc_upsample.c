@@ -0,0 +1,1881 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+// アップサンプリングフィルタのホスト用CLI
+// ファームウェアと同じフィルタ演算部(src/dsp_filter.c)とCMSIS-DSPで、WAVファイルをアップサンプリングする
+//
+// build: cmake -S tools/dsp_host -B build_host && cmake --build build_host
+//
+// usage: ddc_upsample [options] in.wav out.wav
+//          -m lo|hi|bypass|all  最終段(Core1) lo:BiQuad-IIR 2x hi:BiQuad-IIR 4x bypass:なし(既定 BYPASS_CORE1_UPSAMPLING)
+//                               allの場合はout.wavの代わりにout_lo.wav out_hi.wav out_bypass.wavを出力する
+//          -n                   Core0最終段のBiQuad-IIR 2xを実行しない(CORE0_UPSAMPLING_192K)
+//          -g gain              FIR前のゲイン(既定 0.6 DEFAULT_GAIN_RATIO)
+//          -v dB[@frame]        USBの音量(dB 既定 0) ファームウェアと同じく表引きでゲイン(10^(dB/10))にし、int32の入力にかける
+//                               @frameの場合は0dBから始め、入力フレームframeのブロックからVOLUME_RAMP_MSかけてランプする(クリックの確認用)
+//          -B samples           1回に処理する入力サンプル数(既定 48 USBパケット1回分)
+//          -f                   32bit floatで出力する(既定はI2S出力と同じ32bit整数 飽和あり)
+//          -x golden.wav        出力をgolden.wavと比較し、差の最大値が-tを超えたら終了コード2にする
+//          -t dBFS              比較の許容値(既定 -120)
+//          -p profile           フィルタプロファイル minimum|linear|apodizing|short(既定 minimum)
+//          -s profile@frame     入力フレームframeからのブロックでプロファイルを切り替える(クロスフェードの確認用)
+//          -l                   48kHz系のFIR 4xを長いFIR(src/dsp_long_fir.c 分割FFT畳み込み)にする(LONG_FIR_ENABLE)
+//          -d                   最終段のBiQuad-IIRを倍精度の状態(src/dsp_bq_f64.c)で実行する(BQ_F64_ENABLE)
+//          -e eq.txt            パラメトリックEQ(src/dsp_peq.c)をかける 1行1バンド "L|R|LR 種類 周波数 Q ゲイン(dB)"
+//                               種類は peaking|lowshelf|highshelf|lowpass|highpass  #以降はコメント
+//          -c                   クロスフィード(src/dsp_crossfeed.c)をかける(CROSSFEED_ENABLE 700Hz 4.5dB 遅延なし)
+//          -r ir.wav            ルーム補正FIR(src/dsp_room_fir.c)をかける ir.wavは2chのインパルス応答(最大4096タップ)
+//                               ファームウェアと同じく、ir.wavとin.wavのサンプルレートが同じ場合だけかける
+//        ddc_upsample [-r ir.wav] -b
+//                               各段のスループットを計測する(長いFIRは同じタップ数の直接形と比較し、差が-110dBを超えたら終了コード2 EQは1段あたり)
+//                               int32→float変換とゲインは2回に分けた場合と1回のループ(dsp_int32_to_float_stereo)を比較する
+//                               Q31版(src/dsp_q31.c)のFIR・BiQuad-IIR、倍精度の状態の最終段(src/dsp_bq_f64.c)も計測する
+//                               ルーム補正FIRはir.wavのLch(省略時は減衰する雑音)で、倍精度の直接畳み込みと出力を比較する(差が-120dBを超えたら終了コード2)
+//        ddc_upsample -C        クロスフィードの周波数特性(48kHz 自ch/反対ch)を正弦波で測り、係数からの理論値と比較する
+//                               差が0.01dBを超えたら終了コード2にする
+//        ddc_upsample -Q        float版とQ31版(src/dsp_q31.c)の全段の演算誤差を倍精度の参照と比べる(48kHz 997Hz -3dBFS)
+//                               Q31版の誤差の最大値が-120dBFSを超えたら(オーバーフロー)終了コード2にする
+//        ddc_upsample -G        48/96/192kHz x 最終段bypass/lo/hiの全組み合わせで、float版の出力を倍精度の参照と比べる
+//                               (997Hz -6dBFS + 12kHz -12dBFS) 誤差の最大値が-100dBFSを超えたら終了コード2にする
+//        ddc_upsample -D        最終段のBiQuad-IIRのfloat版と倍精度の状態(src/dsp_bq_f64.c)の演算誤差をlong doubleの参照と比べる
+//                               (384kHz 997Hz -3dBFS 高Qのピーキングの例を含む) 倍精度の方が誤差が大きければ終了コード2にする
+//        ddc_upsample -P        S/PDIFのサブフレームの符号化(src/spdif_encode.c)を規格の波形から作った参照のフレームと比べ、
+//                               復号したサンプル・パリティ・チャンネルステータスを確認する 違いがあれば終了コード2にする
+//        ddc_upsample -S        Delta-Sigma変調器(src/delta_sigma.c)の次数2~7 x OSR16/32とDSD128/DSD256(次数4~7)で、
+//                               0dBFSの正弦波の信号帯域のSNRとリセットせずに変調できる入力レベルを測る
+//                               0dBFSでリセットするか余裕が1dB未満か、DSDの信号帯域の雑音が-130dBFSを超えたら終了コード2にする
+//                               サイクル数(SDM_CYCLES_X2)がCore1の予算を超える設定はunsupportedと表示する(ファームウェアはビルドエラー)
+//        ddc_upsample -T capture.bin
+//                               テレメトリCLI(tools/telemetry)の表示処理で記録したパケットをCSVにし、capture.csvと比べる
+//                               (tools/telemetry/testdata/capture.bin) 1行でも異なれば終了コード2にする
+
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "dsp_filter.h"
+#include "dsp_crossfeed.h"
+#include "dsp_q31.h"
+#include "dsp_volume.h"
+#include "spdif_encode.h"
+#include "delta_sigma.h"
+#include "telemetry_decode.h"
+
+#define DEFAULT_GAIN (0.6)
+#define DEFAULT_BLOCK (48)
+#define CROSSFEED_CUT_FREQ (700.f) // src/common.hと同じ
+#define CROSSFEED_LEVEL_DB (4.5f)
+#define CROSSFEED_DELAY_US (0.f)
+#define MAX_BLOCK (256) // SIZE_EP_BUFFER
+#define FULL_SCALE (2147483648.0)
+#define XFADE_MS (5) // FILTER_PROFILE_XFADE_MS
+#define VOLUME_RAMP_MS (10) // src/common.hと同じ
+
+#define WAVE_FORMAT_PCM (1)
+#define WAVE_FORMAT_IEEE_FLOAT (3)
+#define WAVE_FORMAT_EXTENSIBLE (0xfffe)
+
+typedef struct
+{
+	FILE *fp;
+	uint16_t format;
+	uint16_t channels;
+	uint32_t rate;
+	uint16_t bits;
+	uint32_t frames;
+	uint32_t data_bytes;
+} WAV_FILE;
+
+static const char *mode_name[3] = {"bypass", "lo", "hi"};
+static const uint16_t mode_ratio[3] = {1, 2, 4};
+
+static DSP_CHANNEL dsp_channel[2];
+static DSP_LONG_FIR long_fir[2];
+static DSP_ROOM_FIR room_fir[2];
+static float room_ir[2][DSP_ROOM_FIR_MAX_TAPS];
+static uint32_t room_ir_taps = 0; // 0:ルーム補正FIRなし
+static uint32_t room_ir_rate = 0;
+static float work_0[2][MAX_BLOCK * 8];
+static float work_1[2][MAX_BLOCK * 8];
+static float output[2][MAX_BLOCK * 32];
+static DSP_CROSSFEED crossfeed;
+static bool use_crossfeed = false;
+static DSP_Q31_CHANNEL q31_channel;
+static DSP_BQ_F64 bq_f64[2][2]; // [ch][0:bq_2x_3 1:bq_4x_0]
+
+static uint32_t read_u32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t read_u16(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static bool wav_open_read(const char *path, WAV_FILE *wav)
+{
+	uint8_t header[12];
+	memset(wav, 0, sizeof(WAV_FILE));
+	wav->fp = fopen(path, "rb");
+	if (wav->fp == NULL)
+	{
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return false;
+	}
+	if ((fread(header, 1, 12, wav->fp) != 12) || memcmp(header, "RIFF", 4) || memcmp(header + 8, "WAVE", 4))
+	{
+		fprintf(stderr, "%s: not a WAV file\n", path);
+		return false;
+	}
+
+	// fmt と data チャンクを探す
+	bool has_fmt = false;
+	uint8_t chunk[8];
+	while (fread(chunk, 1, 8, wav->fp) == 8)
+	{
+		uint32_t size = read_u32(chunk + 4);
+		if (!memcmp(chunk, "fmt ", 4))
+		{
+			uint8_t fmt[40] = {0};
+			uint32_t n = (size < sizeof(fmt)) ? size : sizeof(fmt);
+			if (fread(fmt, 1, n, wav->fp) != n)
+				break;
+			fseek(wav->fp, size - n + (size & 1), SEEK_CUR);
+			wav->format = read_u16(fmt);
+			wav->channels = read_u16(fmt + 2);
+			wav->rate = read_u32(fmt + 4);
+			wav->bits = read_u16(fmt + 14);
+			if ((wav->format == WAVE_FORMAT_EXTENSIBLE) && (n >= 26))
+				wav->format = read_u16(fmt + 24);
+			has_fmt = true;
+		}
+		else if (!memcmp(chunk, "data", 4))
+		{
+			if (!has_fmt)
+				break;
+			wav->data_bytes = size;
+			wav->frames = size / (wav->channels * wav->bits / 8);
+			bool supported = (wav->channels == 2) &&
+							 (((wav->format == WAVE_FORMAT_PCM) && ((wav->bits == 16) || (wav->bits == 24) || (wav->bits == 32))) ||
+							  ((wav->format == WAVE_FORMAT_IEEE_FLOAT) && (wav->bits == 32)));
+			if (!supported)
+			{
+				fprintf(stderr, "%s: only 2ch 16/24/32bit PCM or 32bit float is supported\n", path);
+				return false;
+			}
+			return true;
+		}
+		else
+		{
+			fseek(wav->fp, size + (size & 1), SEEK_CUR);
+		}
+	}
+	fprintf(stderr, "%s: data chunk not found\n", path);
+	return false;
+}
+
+// フレームを読み出す(-1.0 ~ 1.0) 戻り値は読み出したフレーム数
+static uint32_t wav_read(WAV_FILE *wav, double *L, double *R, uint32_t max_frames)
+{
+	uint8_t buf[MAX_BLOCK * 32 * 2 * 4];
+	uint32_t bytes = wav->bits / 8;
+	uint32_t frames = fread(buf, 2 * bytes, max_frames, wav->fp);
+
+	for (uint32_t i = 0; i < frames * 2; i++)
+	{
+		const uint8_t *p = buf + i * bytes;
+		double value;
+		if (wav->format == WAVE_FORMAT_IEEE_FLOAT)
+		{
+			float f;
+			memcpy(&f, p, sizeof(f));
+			value = f;
+		}
+		else if (bytes == 2)
+		{
+			value = (int32_t)((uint32_t)read_u16(p) << 16) / FULL_SCALE;
+		}
+		else if (bytes == 3)
+		{
+			value = (int32_t)((p[0] << 8) | (p[1] << 16) | ((uint32_t)p[2] << 24)) / FULL_SCALE;
+		}
+		else
+		{
+			value = (int32_t)read_u32(p) / FULL_SCALE;
+		}
+		if (i & 1)
+			R[i >> 1] = value;
+		else
+			L[i >> 1] = value;
+	}
+	return frames;
+}
+
+static void write_u32(uint8_t *p, uint32_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+static void wav_write_header(WAV_FILE *wav)
+{
+	uint8_t header[44];
+	memcpy(header, "RIFF", 4);
+	write_u32(header + 4, 36 + wav->data_bytes);
+	memcpy(header + 8, "WAVEfmt ", 8);
+	write_u32(header + 16, 16);
+	header[20] = wav->format;
+	header[21] = 0;
+	header[22] = 2;
+	header[23] = 0;
+	write_u32(header + 24, wav->rate);
+	write_u32(header + 28, wav->rate * 2 * 4);
+	header[32] = 2 * 4;
+	header[33] = 0;
+	header[34] = 32;
+	header[35] = 0;
+	memcpy(header + 36, "data", 4);
+	write_u32(header + 40, wav->data_bytes);
+	fseek(wav->fp, 0, SEEK_SET);
+	fwrite(header, 1, sizeof(header), wav->fp);
+}
+
+static bool wav_open_write(const char *path, WAV_FILE *wav, uint32_t rate, bool is_float)
+{
+	memset(wav, 0, sizeof(WAV_FILE));
+	wav->fp = fopen(path, "wb");
+	if (wav->fp == NULL)
+	{
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return false;
+	}
+	wav->format = is_float ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM;
+	wav->channels = 2;
+	wav->bits = 32;
+	wav->rate = rate;
+	wav_write_header(wav);
+	return true;
+}
+
+static void wav_close_write(WAV_FILE *wav)
+{
+	wav_write_header(wav);
+	fclose(wav->fp);
+}
+
+// float→int32 ARMのVCVTと同じく飽和させる
+static int32_t float_to_int32(float x)
+{
+	if (x >= 2147483647.f)
+		return INT32_MAX;
+	if (x <= -2147483648.f)
+		return INT32_MIN;
+	return (int32_t)x;
+}
+
+static void wav_write(WAV_FILE *wav, const float *L, const float *R, uint32_t frames)
+{
+	static uint8_t buf[MAX_BLOCK * 32 * 2 * 4];
+	for (uint32_t i = 0; i < frames; i++)
+	{
+		if (wav->format == WAVE_FORMAT_IEEE_FLOAT)
+		{
+			float l = L[i] / (float)FULL_SCALE;
+			float r = R[i] / (float)FULL_SCALE;
+			memcpy(buf + i * 8, &l, 4);
+			memcpy(buf + i * 8 + 4, &r, 4);
+		}
+		else
+		{
+			write_u32(buf + i * 8, float_to_int32(L[i]));
+			write_u32(buf + i * 8 + 4, float_to_int32(R[i]));
+		}
+	}
+	fwrite(buf, 8, frames, wav->fp);
+	wav->data_bytes += frames * 8;
+	wav->frames += frames;
+}
+
+// 入力にかけるゲイン(ファームウェアと同じく FIR前のゲイン × 補間倍率 は通常FIR段の係数に入っているので1)
+// FIRのない192kHz系では1、長いFIRでは入力にかける(音量はint32の入力にかける)
+static float get_input_gain(const DSP_CHANNEL *ch, float gain)
+{
+	if (dsp_is_fir_gain_folded(ch) || (ch->rate_class == RATE_CLASS_192K))
+		return 1.f;
+	return gain * 4.f;
+}
+
+// 1ブロック(ステレオ)をファームウェアと同じ手順で処理する 戻り値は出力フレーム数
+static uint32_t process_block(const DSP_CHAIN *chain, const int32_t *in_L, const int32_t *in_R, float input_gain, uint32_t length)
+{
+	static float in_float[2][MAX_BLOCK];
+	uint32_t len = 0;
+
+	if (use_crossfeed)
+	{
+		dsp_crossfeed_convert(&crossfeed, in_L, in_R, in_float[0], in_float[1], input_gain, length);
+	}
+	else
+	{
+		dsp_int32_to_float_stereo(in_L, in_R, in_float[0], in_float[1], input_gain, length);
+	}
+	for (int ch = 0; ch < 2; ch++)
+	{
+		len = dsp_process_channel(&dsp_channel[ch], chain, in_float[ch], output[ch], work_0[ch], work_1[ch], length);
+	}
+	return len;
+}
+
+typedef struct
+{
+	bool no_bq2;
+	bool is_float;
+	float gain;
+	float volume_db;
+	uint32_t volume_frame;
+	uint32_t block;
+	const char *golden_path;
+	double tolerance_db;
+	const DSP_PROFILE *profile;
+	const DSP_PROFILE *switch_profile;
+	uint32_t switch_frame;
+	bool long_fir;
+	bool bq_f64;
+	const char *eq_path;
+} OPTION;
+
+// プロファイル名から係数表を引く
+static const DSP_PROFILE *find_profile(const char *name)
+{
+	for (int i = 0; i < NUM_OF_DSP_PROFILE; i++)
+	{
+		if (!strcmp(name, dsp_profile_table[i].name))
+			return &dsp_profile_table[i];
+	}
+	fprintf(stderr, "unknown profile: %s\n", name);
+	return NULL;
+}
+
+// パラメトリックEQの設定ファイルを読む 戻り値はエラーの場合false
+static bool read_eq_file(const char *path, DSP_PEQ_BAND band[2][DSP_PEQ_MAX_BAND], uint32_t num_band[2])
+{
+	const char *type_name[NUM_OF_DSP_PEQ_TYPE] = {"off", "peaking", "lowshelf", "highshelf", "lowpass", "highpass"};
+	FILE *fp = fopen(path, "r");
+	if (fp == NULL)
+	{
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return false;
+	}
+
+	char line[256];
+	int line_no = 0;
+	num_band[0] = num_band[1] = 0;
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		char ch_name[8], type[16];
+		DSP_PEQ_BAND b = {0};
+		line_no++;
+		char *comment = strchr(line, '#');
+		if (comment != NULL)
+			*comment = '\0';
+		int n = sscanf(line, "%7s %15s %f %f %f", ch_name, type, &b.freq, &b.q, &b.gain_db);
+		if (n <= 0)
+			continue;
+		for (b.type = 0; (b.type < NUM_OF_DSP_PEQ_TYPE) && strcmp(type, type_name[b.type]); b.type++)
+			;
+		bool to_L = (strchr(ch_name, 'L') != NULL);
+		bool to_R = (strchr(ch_name, 'R') != NULL);
+		if ((n < 4) || (b.type == NUM_OF_DSP_PEQ_TYPE) || !(to_L || to_R) ||
+			(to_L && (num_band[0] >= DSP_PEQ_MAX_BAND)) || (to_R && (num_band[1] >= DSP_PEQ_MAX_BAND)))
+		{
+			fprintf(stderr, "%s:%d: invalid band\n", path, line_no);
+			fclose(fp);
+			return false;
+		}
+		if (to_L)
+			band[0][num_band[0]++] = b;
+		if (to_R)
+			band[1][num_band[1]++] = b;
+	}
+	fclose(fp);
+	return true;
+}
+
+// ルーム補正FIRのインパルス応答(2ch WAV)をroom_irに読む 戻り値はエラーの場合false
+static bool read_ir_file(const char *path)
+{
+	static double L[MAX_BLOCK * 32];
+	static double R[MAX_BLOCK * 32];
+	WAV_FILE ir;
+	if (!wav_open_read(path, &ir))
+		return false;
+	if ((ir.frames == 0) || (ir.frames > DSP_ROOM_FIR_MAX_TAPS))
+	{
+		fprintf(stderr, "%s: %u taps (must be 1..%d)\n", path, ir.frames, DSP_ROOM_FIR_MAX_TAPS);
+		fclose(ir.fp);
+		return false;
+	}
+
+	uint32_t frames;
+	room_ir_taps = 0;
+	while ((room_ir_taps < ir.frames) && ((frames = wav_read(&ir, L, R, MAX_BLOCK * 32)) > 0))
+	{
+		for (uint32_t i = 0; (i < frames) && (room_ir_taps < ir.frames); i++, room_ir_taps++)
+		{
+			room_ir[0][room_ir_taps] = (float)L[i];
+			room_ir[1][room_ir_taps] = (float)R[i];
+		}
+	}
+	room_ir_rate = ir.rate;
+	fclose(ir.fp);
+	return true;
+}
+
+// 1つのモードでファイルを処理する 戻り値 0:成功 1:エラー 2:goldenとの差が許容値を超えた
+static int upsample_file(const char *in_path, const char *out_path, uint mode, const OPTION *opt)
+{
+	WAV_FILE in, out, golden;
+	if (!wav_open_read(in_path, &in))
+		return 1;
+
+	DSP_CHAIN chain = {
+		.rate_class = dsp_get_rate_class(in.rate),
+		.run_bq_2x_2 = !opt->no_bq2,
+		.ratio_final = mode_ratio[mode],
+		.run_room_fir = (room_ir_taps != 0) && (room_ir_rate == in.rate),
+	};
+	uint32_t out_rate = in.rate * dsp_get_chain_ratio(&chain);
+
+	if (!wav_open_write(out_path, &out, out_rate, opt->is_float))
+		return 1;
+	bool compare = (opt->golden_path != NULL);
+	if (compare && !wav_open_read(opt->golden_path, &golden))
+		return 1;
+	if (compare && (golden.rate != out_rate))
+	{
+		fprintf(stderr, "%s: rate %u differs from the output %u\n", opt->golden_path, golden.rate, out_rate);
+		return 1;
+	}
+
+	dsp_init_filter_coef(opt->profile);
+	dsp_init_channel(&dsp_channel[0], opt->profile, opt->gain);
+	dsp_init_channel(&dsp_channel[1], opt->profile, opt->gain);
+	if (opt->long_fir)
+	{
+		dsp_long_fir_init_coef();
+		dsp_set_long_fir(&dsp_channel[0], &long_fir[0]);
+		dsp_set_long_fir(&dsp_channel[1], &long_fir[1]);
+	}
+	if (opt->bq_f64)
+	{
+		dsp_set_bq_f64(&dsp_channel[0], &bq_f64[0][0], &bq_f64[0][1]);
+		dsp_set_bq_f64(&dsp_channel[1], &bq_f64[1][0], &bq_f64[1][1]);
+	}
+	// FIR前のゲインはdsp_init_channelでFIR段の係数に入れている
+	for (int ch = 0; ch < 2; ch++)
+		dsp_select_rate_class(&dsp_channel[ch], chain.rate_class);
+	float input_gain = get_input_gain(&dsp_channel[0], opt->gain);
+
+	// 音量はファームウェアと同じく表引きで求め、int32の入力にかける(@frameの場合は0dBから始めて、そのフレームからランプする)
+	static DSP_VOLUME volume;
+	dsp_volume_init_table();
+	int32_t volume_gain = dsp_volume_from_db((int32_t)lround(opt->volume_db * DSP_VOLUME_RESOLUTION));
+	dsp_volume_init(&volume, (opt->volume_frame == 0) ? volume_gain : DSP_VOLUME_UNITY);
+	if (use_crossfeed)
+		dsp_crossfeed_init(&crossfeed, in.rate, CROSSFEED_CUT_FREQ, CROSSFEED_LEVEL_DB, CROSSFEED_DELAY_US);
+	if (room_ir_taps != 0)
+	{
+		if (!chain.run_room_fir)
+			fprintf(stderr, "warning: room fir is for %uHz, not applied to %uHz\n", room_ir_rate, in.rate);
+		for (int ch = 0; ch < 2; ch++)
+		{
+			dsp_room_fir_init(&room_fir[ch]);
+			dsp_room_fir_load(&room_fir[ch], room_ir[ch], room_ir_taps);
+			dsp_set_room_fir(&dsp_channel[ch], &room_fir[ch]);
+		}
+	}
+	if (opt->eq_path != NULL)
+	{
+		static DSP_PEQ_BAND band[2][DSP_PEQ_MAX_BAND];
+		uint32_t num_band[2];
+		if (!read_eq_file(opt->eq_path, band, num_band))
+			return 1;
+		for (int ch = 0; ch < 2; ch++)
+		{
+			if (!dsp_peq_set_bands(&dsp_channel[ch].peq, band[ch], num_band[ch], (float)in.rate))
+			{
+				fprintf(stderr, "%s: a band is out of range for %uHz\n", opt->eq_path, in.rate);
+				return 1;
+			}
+		}
+	}
+
+	static double dL[MAX_BLOCK * 32];
+	static double dR[MAX_BLOCK * 32];
+	static int32_t iL[MAX_BLOCK];
+	static int32_t iR[MAX_BLOCK];
+	double max_diff = 0.;
+	uint64_t compared = 0;
+	uint32_t frames;
+	uint32_t frame_pos = 0;
+	while ((frames = wav_read(&in, dL, dR, opt->block)) > 0)
+	{
+		if ((opt->switch_profile != NULL) && (frame_pos <= opt->switch_frame) && (opt->switch_frame < frame_pos + frames))
+		{
+			dsp_request_profile(&dsp_channel[0], opt->switch_profile, XFADE_MS * in.rate / 1000);
+			dsp_request_profile(&dsp_channel[1], opt->switch_profile, XFADE_MS * in.rate / 1000);
+		}
+		if ((opt->volume_frame != 0) && (frame_pos <= opt->volume_frame) && (opt->volume_frame < frame_pos + frames))
+			dsp_volume_request(&volume, volume_gain);
+		frame_pos += frames;
+		for (uint32_t i = 0; i < frames; i++)
+		{
+			iL[i] = float_to_int32((float)(dL[i] * FULL_SCALE));
+			iR[i] = float_to_int32((float)(dR[i] * FULL_SCALE));
+		}
+		dsp_volume_process_stereo(&volume, iL, iR, frames, VOLUME_RAMP_MS * in.rate / 1000);
+		uint32_t len = process_block(&chain, iL, iR, input_gain, frames);
+		wav_write(&out, output[0], output[1], len);
+
+		if (compare)
+		{
+			uint32_t n = wav_read(&golden, dL, dR, len);
+			for (uint32_t i = 0; i < n; i++)
+			{
+				double l = opt->is_float ? output[0][i] / FULL_SCALE : float_to_int32(output[0][i]) / FULL_SCALE;
+				double r = opt->is_float ? output[1][i] / FULL_SCALE : float_to_int32(output[1][i]) / FULL_SCALE;
+				max_diff = fmax(max_diff, fmax(fabs(l - dL[i]), fabs(r - dR[i])));
+			}
+			compared += n;
+		}
+	}
+
+	fprintf(stderr, "%s: %uHz -> %uHz (%s, %s%s%s%s%s%s) %u frames -> %u frames\n", out_path, in.rate, out_rate,
+			opt->profile->name, use_crossfeed ? "crossfeed, " : "", opt->long_fir ? "long fir, " : "", (opt->eq_path != NULL) ? "eq, " : "", chain.run_room_fir ? "room fir, " : "", opt->no_bq2 ? "no bq2, " : "",
+			mode_name[mode], in.frames, out.frames);
+	wav_close_write(&out);
+	fclose(in.fp);
+
+	if (!compare)
+		return 0;
+	fclose(golden.fp);
+	double diff_db = (max_diff > 0.) ? 20. * log10(max_diff) : -INFINITY;
+	bool ok = (compared == out.frames) && (diff_db <= opt->tolerance_db);
+	fprintf(stderr, "compare %s: %llu/%u frames, max diff %.1f dBFS (tolerance %.1f) %s\n", opt->golden_path,
+			(unsigned long long)compared, out.frames, diff_db, opt->tolerance_db, ok ? "OK" : "NG");
+	return ok ? 0 : 2;
+}
+
+static double get_time_sec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#define BENCH_BLOCK (MAX_BLOCK)
+#define BENCH_SEC (0.3)
+#define LONG_FIR_MAX_DIFF_DB (-110.) // 長いFIRと直接形の出力の差の上限(最大出力に対するdB)
+#define ROOM_FIR_MAX_DIFF_DB (-120.) // ルーム補正FIRと倍精度の直接畳み込みの差の上限(同上)
+
+// 長いFIR(分割FFT畳み込み)と同じ係数の直接形(arm_fir_interpolate)の比較
+// 出力が一致すること(長いFIRはDSP_LONG_FIR_PARTITION入力サンプル遅れる)とスループットを確認する
+// 差がLONG_FIR_MAX_DIFF_DBを超えたらfalse
+static bool benchmark_long_fir(const float *in)
+{
+	static float coef[DSP_LONG_FIR_TAPS];
+	static float coef_rev[DSP_LONG_FIR_TAPS];
+	static float state[BENCH_BLOCK + DSP_LONG_FIR_PHASE_TAPS - 1];
+	static float out_long[BENCH_BLOCK * DSP_LONG_FIR_RATIO];
+	static float out_direct[BENCH_BLOCK * DSP_LONG_FIR_RATIO * 2];
+	static DSP_LONG_FIR S;
+	arm_fir_interpolate_instance_f32 direct;
+	const uint32_t delay = DSP_LONG_FIR_PARTITION * DSP_LONG_FIR_RATIO;
+	const uint32_t out_len = BENCH_BLOCK * DSP_LONG_FIR_RATIO;
+
+	// 直接形は係数を時間反転して渡す(CMSIS-DSP)
+	dsp_long_fir_design(coef, DSP_LONG_FIR_TAPS, DSP_LONG_FIR_CUTOFF, DSP_LONG_FIR_BETA);
+	for (int i = 0; i < DSP_LONG_FIR_TAPS; i++)
+		coef_rev[i] = coef[DSP_LONG_FIR_TAPS - 1 - i];
+	arm_fir_interpolate_init_f32(&direct, DSP_LONG_FIR_RATIO, DSP_LONG_FIR_TAPS, coef_rev, state, BENCH_BLOCK);
+	dsp_long_fir_init_coef();
+	dsp_long_fir_clear(&S);
+
+	// 一致の確認 直接形の出力を1ブロック分持ち越して遅延を合わせる
+	double max_diff = 0.;
+	double max_out = 0.;
+	for (int n = 0; n < 32; n++)
+	{
+		memcpy(out_direct, out_direct + out_len, out_len * sizeof(float));
+		arm_fir_interpolate_f32(&direct, (float *)in, out_direct + out_len, BENCH_BLOCK);
+		dsp_long_fir_interpolate(&S, in, out_long, BENCH_BLOCK);
+		for (uint32_t i = 0; (n > 0) && (i < out_len); i++)
+		{
+			max_diff = fmax(max_diff, fabs(out_long[i] - out_direct[out_len + i - delay]));
+			max_out = fmax(max_out, fabs(out_direct[out_len + i - delay]));
+		}
+	}
+
+	for (int kind = 0; kind < 2; kind++)
+	{
+		uint64_t samples = 0;
+		double start = get_time_sec();
+		double elapsed;
+		do
+		{
+			for (int n = 0; n < 16; n++)
+			{
+				if (kind == 0)
+					arm_fir_interpolate_f32(&direct, (float *)in, out_direct, BENCH_BLOCK);
+				else
+					dsp_long_fir_interpolate(&S, in, out_long, BENCH_BLOCK);
+				samples += BENCH_BLOCK;
+			}
+			elapsed = get_time_sec() - start;
+		} while (elapsed < BENCH_SEC);
+
+		char name[32];
+		snprintf(name, sizeof(name), "fir_4x_0 %s %d", (kind == 0) ? "direct" : "fft", DSP_LONG_FIR_TAPS);
+		printf("%-22s %12.2f %14.2f\n", name, elapsed * 1e9 / samples, samples / elapsed * 1e-6);
+	}
+	double diff_db = 20. * log10(max_diff / max_out);
+	bool ok = (diff_db <= LONG_FIR_MAX_DIFF_DB);
+	printf("%-22s %12.1f dB (delay %u samples) %s\n", "fft - direct", diff_db, delay, ok ? "OK" : "NG");
+	return ok;
+}
+
+// ルーム補正FIRの速度と、倍精度の直接畳み込みとの一致を確認する(インパルス応答はroom_irのLch なければ減衰する雑音)
+// 差がROOM_FIR_MAX_DIFF_DBを超えたらfalse
+static bool benchmark_room_fir(const float *in)
+{
+	static float ir[DSP_ROOM_FIR_MAX_TAPS];
+	static float out[BENCH_BLOCK];
+	static DSP_ROOM_FIR S;
+	const uint32_t num_block = DSP_ROOM_FIR_MAX_TAPS / BENCH_BLOCK * 2;
+	uint32_t num_taps = room_ir_taps;
+
+	if (num_taps != 0)
+	{
+		memcpy(ir, room_ir[0], sizeof(float) * num_taps);
+	}
+	else
+	{
+		num_taps = DSP_ROOM_FIR_MAX_TAPS;
+		for (uint32_t k = 0; k < num_taps; k++)
+			ir[k] = (float)((rand() - RAND_MAX / 2) / (double)RAND_MAX * exp(-6. * k / num_taps));
+	}
+	dsp_room_fir_init(&S);
+	dsp_room_fir_load(&S, ir, num_taps);
+
+	// 一致の確認 入力はinの繰り返し 出力はDSP_ROOM_FIR_PARTITIONサンプル遅れる
+	const uint32_t latency = dsp_room_fir_latency(&S);
+	double max_diff = 0.;
+	double max_out = 0.;
+	for (uint32_t b = 0; b < num_block; b++)
+	{
+		dsp_room_fir_process(&S, in, out, BENCH_BLOCK);
+		for (uint32_t i = 0; i < BENCH_BLOCK; i++)
+		{
+			int64_t n = (int64_t)b * BENCH_BLOCK + i - latency;
+			if (n < 0)
+				continue;
+			double y = 0.;
+			for (uint32_t k = 0; (k < num_taps) && (k <= n); k++)
+				y += (double)ir[k] * in[(n - k) % BENCH_BLOCK];
+			max_diff = fmax(max_diff, fabs(out[i] - y));
+			max_out = fmax(max_out, fabs(y));
+		}
+	}
+
+	uint64_t samples = 0;
+	double start = get_time_sec();
+	double elapsed;
+	do
+	{
+		for (int n = 0; n < 16; n++)
+		{
+			dsp_room_fir_process(&S, in, out, BENCH_BLOCK);
+			samples += BENCH_BLOCK;
+		}
+		elapsed = get_time_sec() - start;
+	} while (elapsed < BENCH_SEC);
+
+	char name[32];
+	snprintf(name, sizeof(name), "room_fir fft %u", dsp_room_fir_num_taps(&S));
+	printf("%-22s %12.2f %14.2f\n", name, elapsed * 1e9 / samples, samples / elapsed * 1e-6);
+	double diff_db = 20. * log10(max_diff / max_out);
+	bool ok = (diff_db <= ROOM_FIR_MAX_DIFF_DB);
+	printf("%-22s %12.1f dB (latency %u samples) %s\n", "room_fir - direct", diff_db, latency, ok ? "OK" : "NG");
+	return ok;
+}
+
+// 処理段毎のスループット(入力1サンプル・1chあたり)
+// 長いFIR・ルーム補正FIRの出力が直接形と一致しなければ終了コード2にする
+static int benchmark(const DSP_PROFILE *profile)
+{
+	static int32_t in_int[BENCH_BLOCK];
+	static float in[BENCH_BLOCK];
+	static float out[BENCH_BLOCK * 32];
+	const char *stage_name[] = {"convert", "fir_4x_0", "fir_2x_1", "bq_2x_2", "bq_2x_3", "bq_4x_0"};
+	DSP_CHANNEL *ch = &dsp_channel[0];
+
+	srand(1);
+	for (int i = 0; i < BENCH_BLOCK; i++)
+	{
+		in_int[i] = (rand() - RAND_MAX / 2) << 8;
+		in[i] = in_int[i] * 0.5f;
+	}
+	dsp_init_channel(ch, profile, DEFAULT_GAIN);
+
+	printf("%-22s %12s %14s\n", "stage", "ns/sample", "Msample/s");
+	for (int stage = 0; stage < 6; stage++)
+	{
+		uint64_t samples = 0;
+		double start = get_time_sec();
+		double elapsed;
+		do
+		{
+			for (int n = 0; n < 64; n++)
+			{
+				switch (stage)
+				{
+				case 0:
+					dsp_int32_to_float(in_int, out, BENCH_BLOCK);
+					break;
+				case 1:
+					dsp_fir_interpolate(&ch->fir_4x_0, in, out, BENCH_BLOCK);
+					break;
+				case 2:
+					dsp_fir_interpolate(&ch->fir_2x_1, in, out, BENCH_BLOCK);
+					break;
+				case 3:
+					dsp_bq_nos_2x(&ch->bq_2x_2, in, out, BENCH_BLOCK);
+					break;
+				case 4:
+					dsp_bq_nos_2x(&ch->bq_2x_3, in, out, BENCH_BLOCK);
+					break;
+				default:
+					dsp_bq_nos_4x(&ch->bq_4x_0, in, out, BENCH_BLOCK);
+					break;
+				}
+				samples += BENCH_BLOCK;
+			}
+			elapsed = get_time_sec() - start;
+		} while (elapsed < BENCH_SEC);
+		printf("%-22s %12.2f %14.2f\n", stage_name[stage], elapsed * 1e9 / samples, samples / elapsed * 1e-6);
+	}
+
+	// Q31版(src/dsp_q31.c)の各段
+	{
+		static const char *name[5] = {"fir_4x_0 q31", "fir_2x_1 q31", "bq_2x_2 q31", "bq_2x_3 q31", "bq_4x_0 q31"};
+		static q31_t out_q31[BENCH_BLOCK * 4];
+		dsp_q31_init_channel(&q31_channel, profile, DEFAULT_GAIN);
+		for (int stage = 0; stage < 5; stage++)
+		{
+			uint64_t samples = 0;
+			double start = get_time_sec();
+			double elapsed;
+			q31_channel.rate_class = (stage == 1) ? RATE_CLASS_96K : RATE_CLASS_48K;
+			do
+			{
+				for (int n = 0; n < 64; n++)
+				{
+					switch (stage)
+					{
+					case 0:
+					case 1:
+						dsp_q31_fir_stage(&q31_channel, in_int, out_q31, BENCH_BLOCK);
+						break;
+					case 2:
+						dsp_q31_bq_nos(&q31_channel.bq_2x_2, 2, in_int, out_q31, BENCH_BLOCK);
+						break;
+					case 3:
+						dsp_q31_bq_nos(&q31_channel.bq_2x_3, 2, in_int, out_q31, BENCH_BLOCK);
+						break;
+					default:
+						dsp_q31_bq_nos(&q31_channel.bq_4x_0, 4, in_int, out_q31, BENCH_BLOCK);
+						break;
+					}
+					samples += BENCH_BLOCK;
+				}
+				elapsed = get_time_sec() - start;
+			} while (elapsed < BENCH_SEC);
+			printf("%-22s %12.2f %14.2f\n", name[stage], elapsed * 1e9 / samples, samples / elapsed * 1e-6);
+		}
+	}
+
+	// 倍精度の状態の最終段(src/dsp_bq_f64.c)
+	{
+		static const char *name[2] = {"bq_2x_3 f64", "bq_4x_0 f64"};
+		static DSP_BQ_F64 bq[2];
+		dsp_bq_f64_init(&bq[0], profile->bq_2x_3, SIZE_BQ_FILTER_3);
+		dsp_bq_f64_init(&bq[1], profile->bq_4x_0, SIZE_BQ_FILTER_4);
+		for (int k = 0; k < 2; k++)
+		{
+			uint64_t samples = 0;
+			double start = get_time_sec();
+			double elapsed;
+			do
+			{
+				for (int n = 0; n < 64; n++)
+				{
+					dsp_bq_f64_nos(&bq[k], (k == 0) ? 2 : 4, in, out, BENCH_BLOCK);
+					samples += BENCH_BLOCK;
+				}
+				elapsed = get_time_sec() - start;
+			} while (elapsed < BENCH_SEC);
+			printf("%-22s %12.2f %14.2f\n", name[k], elapsed * 1e9 / samples, samples / elapsed * 1e-6);
+		}
+	}
+
+	// int32→float変換とゲイン 2回に分けた場合(変換してからarm_scale_f32)と1回のループの比較 1chあたり
+	{
+		static const char *name[4] = {"convert 2-pass", "convert fused", "convert 2-pass x2.4", "convert fused x2.4"};
+		static float out_R[BENCH_BLOCK];
+		for (int k = 0; k < 4; k++)
+		{
+			const float gain = (k < 2) ? 1.f : 2.4f;
+			uint64_t samples = 0;
+			double start = get_time_sec();
+			double elapsed;
+			do
+			{
+				for (int n = 0; n < 64; n++)
+				{
+					if (k & 1)
+					{
+						dsp_int32_to_float_stereo(in_int, in_int, out, out_R, gain, BENCH_BLOCK);
+					}
+					else
+					{
+						dsp_int32_to_float(in_int, out, BENCH_BLOCK);
+						dsp_int32_to_float(in_int, out_R, BENCH_BLOCK);
+						if (gain != 1.f)
+						{
+							arm_scale_f32(out, gain, out, BENCH_BLOCK);
+							arm_scale_f32(out_R, gain, out_R, BENCH_BLOCK);
+						}
+					}
+					samples += BENCH_BLOCK * 2;
+				}
+				elapsed = get_time_sec() - start;
+			} while (elapsed < BENCH_SEC);
+			printf("%-22s %12.2f %14.2f\n", name[k], elapsed * 1e9 / samples, samples / elapsed * 1e-6);
+		}
+	}
+
+	// クロスフィード(変換・ゲインと同じループ) convertと比べられるよう1chあたり
+	{
+		dsp_crossfeed_init(&crossfeed, 48000, CROSSFEED_CUT_FREQ, CROSSFEED_LEVEL_DB, CROSSFEED_DELAY_US);
+		uint64_t samples = 0;
+		double start = get_time_sec();
+		double elapsed;
+		do
+		{
+			for (int n = 0; n < 64; n++)
+			{
+				dsp_crossfeed_convert(&crossfeed, in_int, in_int, out, out + BENCH_BLOCK, 2.4f, BENCH_BLOCK);
+				samples += BENCH_BLOCK * 2;
+			}
+			elapsed = get_time_sec() - start;
+		} while (elapsed < BENCH_SEC);
+		printf("%-22s %12.2f %14.2f\n", "convert + crossfeed", elapsed * 1e9 / samples, samples / elapsed * 1e-6);
+	}
+
+	bool ok = benchmark_long_fir(in);
+	ok &= benchmark_room_fir(in);
+
+	// パラメトリックEQ(DSP_PEQ_MAX_BAND段) 1段あたり
+	{
+		DSP_PEQ_BAND band[DSP_PEQ_MAX_BAND];
+		for (int i = 0; i < DSP_PEQ_MAX_BAND; i++)
+			band[i] = (DSP_PEQ_BAND){DSP_PEQ_PEAKING, 30.f * (i + 1), 1.f, (i & 1) ? 3.f : -3.f};
+		dsp_peq_set_bands(&ch->peq, band, DSP_PEQ_MAX_BAND, 48000.f);
+		uint64_t samples = 0;
+		double start = get_time_sec();
+		double elapsed;
+		do
+		{
+			for (int n = 0; n < 64; n++)
+			{
+				dsp_peq_process(&ch->peq, in, out, BENCH_BLOCK);
+				samples += BENCH_BLOCK * DSP_PEQ_MAX_BAND;
+			}
+			elapsed = get_time_sec() - start;
+		} while (elapsed < BENCH_SEC);
+		printf("%-22s %12.2f %14.2f\n", "peq (per section)", elapsed * 1e9 / samples, samples / elapsed * 1e-6);
+	}
+
+	// 全段(ステレオ) 実時間に対する倍率
+	const uint32_t rate[3] = {48000, 96000, 192000};
+	printf("\n%-22s %12s %14s\n", "chain (stereo)", "ns/frame", "x realtime");
+	for (int r = 0; r < 3; r++)
+	{
+		for (uint mode = 0; mode < 3; mode++)
+		{
+			DSP_CHAIN chain = {.rate_class = dsp_get_rate_class(rate[r]), .run_bq_2x_2 = true, .ratio_final = mode_ratio[mode]};
+			dsp_init_channel(&dsp_channel[0], profile, DEFAULT_GAIN);
+			dsp_init_channel(&dsp_channel[1], profile, DEFAULT_GAIN);
+			uint64_t frames = 0;
+			double start = get_time_sec();
+			double elapsed;
+			do
+			{
+				for (int n = 0; n < 16; n++)
+				{
+					process_block(&chain, in_int, in_int, 1.f, BENCH_BLOCK);
+					frames += BENCH_BLOCK;
+				}
+				elapsed = get_time_sec() - start;
+			} while (elapsed < BENCH_SEC);
+
+			char name[32];
+			snprintf(name, sizeof(name), "%ukHz %s", rate[r] / 1000, mode_name[mode]);
+			printf("%-22s %12.2f %14.1f\n", name, elapsed * 1e9 / frames, frames / elapsed / rate[r]);
+		}
+	}
+	return ok ? 0 : 2;
+}
+
+// クロスフィードの周波数特性を確認する 左chだけに正弦波を入れ、1秒(整数周期)分の出力の振幅をDFTで求める
+// 戻り値は理論値との差の最大値が0.01dB以下なら0 超えたら2
+static int test_crossfeed_response(void)
+{
+	const float freq_list[] = {20.f, 50.f, 100.f, 200.f, 500.f, 700.f, 1000.f, 2000.f, 5000.f, 10000.f, 20000.f};
+	const uint32_t fs = 48000;
+	static int32_t in_L[MAX_BLOCK];
+	static int32_t in_R[MAX_BLOCK];
+	static float out_L[MAX_BLOCK];
+	static float out_R[MAX_BLOCK];
+	double max_err = 0.;
+
+	printf("%-10s %12s %12s %12s %12s\n", "freq(Hz)", "direct(dB)", "theory", "cross(dB)", "theory");
+	for (uint32_t f = 0; f < sizeof(freq_list) / sizeof(freq_list[0]); f++)
+	{
+		const double w = 2. * M_PI * freq_list[f] / fs;
+		const double amp = 1073741824.; // 2^30
+		double re[2] = {0., 0.}, im[2] = {0., 0.};
+		dsp_crossfeed_init(&crossfeed, fs, CROSSFEED_CUT_FREQ, CROSSFEED_LEVEL_DB, CROSSFEED_DELAY_US);
+		memset(in_R, 0, sizeof(in_R));
+
+		// 1秒で定常状態にしてから次の1秒を測る
+		for (uint32_t n = 0; n < fs * 2; n += MAX_BLOCK)
+		{
+			uint32_t len = (fs * 2 - n < MAX_BLOCK) ? fs * 2 - n : MAX_BLOCK;
+			for (uint32_t i = 0; i < len; i++)
+				in_L[i] = (int32_t)lrint(amp * sin(w * (n + i)));
+			dsp_crossfeed_convert(&crossfeed, in_L, in_R, out_L, out_R, 1.f, len);
+			for (uint32_t i = 0; i < len; i++)
+			{
+				if (n + i < fs)
+					continue;
+				re[0] += out_L[i] * cos(w * (n + i));
+				im[0] += out_L[i] * sin(w * (n + i));
+				re[1] += out_R[i] * cos(w * (n + i));
+				im[1] += out_R[i] * sin(w * (n + i));
+			}
+		}
+
+		float theory[2];
+		double measured[2];
+		dsp_crossfeed_response(&crossfeed, freq_list[f], &theory[0], &theory[1]);
+		for (int ch = 0; ch < 2; ch++)
+		{
+			measured[ch] = 20. * log10(2. * sqrt(re[ch] * re[ch] + im[ch] * im[ch]) / fs / amp);
+			max_err = fmax(max_err, fabs(measured[ch] - theory[ch]));
+		}
+		printf("%-10.0f %12.3f %12.3f %12.3f %12.3f\n", freq_list[f], measured[0], theory[0], measured[1], theory[1]);
+	}
+	printf("max error %.4f dB %s\n", max_err, (max_err <= 0.01) ? "OK" : "NG");
+	return (max_err <= 0.01) ? 0 : 2;
+}
+
+// 倍精度の参照(ファームウェアと同じ段構成・同じfloat係数) Q31/floatの演算誤差を測るのに使う
+typedef struct
+{
+	double x1, x2, y1, y2;
+} REF_BQ;
+
+typedef struct
+{
+	double b[SIZE_FIR_PROFILE_0]; // FIRのインパルス応答(ゲイン × 補間倍率込み 時間順)
+	double line[SIZE_FIR_PROFILE_0];
+	uint16_t num_taps;
+	uint16_t pos;
+	uint16_t ratio_fir; // FIRの補間倍率(48kHz系:4 96kHz系:2 192kHz系:1 FIRなし)
+	REF_BQ bq_2x_2[SIZE_BQ_FILTER_2];
+	REF_BQ bq_final[SIZE_BQ_FILTER_2];
+} REF_CHANNEL;
+
+static double ref_bq(REF_BQ *S, const float (*coef)[NUM_OF_BQ_SUB_PARAMS], uint16_t num_stage, double x)
+{
+	for (uint16_t i = 0; i < num_stage; i++)
+	{
+		double y = coef[i][0] * x + coef[i][1] * S[i].x1 + coef[i][2] * S[i].x2 - coef[i][4] * S[i].y1 - coef[i][5] * S[i].y2;
+		S[i].x2 = S[i].x1;
+		S[i].x1 = x;
+		S[i].y2 = S[i].y1;
+		S[i].y1 = y;
+		x = y;
+	}
+	return x;
+}
+
+// 入力サンプルレート区分のFIR(ファームウェアと同じくゲイン × 補間倍率を掛ける)で参照を初期化する 192kHz系はFIRなしでゲインもかけない
+static void ref_init(REF_CHANNEL *S, const DSP_PROFILE *profile, uint16_t rate_class, double gain)
+{
+	memset(S, 0, sizeof(*S));
+	const DSP_FIR_COEF *coef = (rate_class == RATE_CLASS_48K) ? &profile->fir_4x_0 : &profile->fir_2x_1;
+	S->ratio_fir = (rate_class == RATE_CLASS_48K) ? 4 : (rate_class == RATE_CLASS_96K) ? 2 : 1;
+	if (S->ratio_fir == 1)
+		return;
+	S->num_taps = coef->num_taps;
+	for (uint16_t i = 0; i < S->num_taps; i++)
+		S->b[i] = (double)coef->coef[S->num_taps - 1 - i] * gain * S->ratio_fir;
+}
+
+// 全段(FIR → BiQuad-IIR 2x → 最終段)を1サンプル分実行する 戻り値は出力サンプル数
+static uint32_t ref_process(REF_CHANNEL *S, const DSP_PROFILE *profile, uint16_t ratio_final, double x, double *out)
+{
+	uint32_t n = 0;
+	for (int k = 0; k < S->ratio_fir; k++)
+	{
+		// 0を挿入した入力とインパルス応答の畳み込み
+		double y = x;
+		if (S->ratio_fir > 1)
+		{
+			S->pos = (S->pos + 1) % S->num_taps;
+			S->line[S->pos] = (k == 0) ? x : 0.;
+			y = 0.;
+			for (uint16_t i = 0; i < S->num_taps; i++)
+				y += S->b[i] * S->line[(S->pos + S->num_taps - i) % S->num_taps];
+		}
+
+		for (int j = 0; j < 2; j++)
+		{
+			double z = ref_bq(S->bq_2x_2, profile->bq_2x_2, SIZE_BQ_FILTER_2, y);
+			for (int m = 0; m < ratio_final; m++)
+			{
+				if (ratio_final == 4)
+					out[n++] = ref_bq(S->bq_final, profile->bq_4x_0, SIZE_BQ_FILTER_4, z);
+				else if (ratio_final == 2)
+					out[n++] = ref_bq(S->bq_final, profile->bq_2x_3, SIZE_BQ_FILTER_3, z);
+				else
+					out[n++] = z;
+			}
+		}
+	}
+	return n;
+}
+
+// float版とQ31版(src/dsp_q31.c)の演算誤差を倍精度の参照と比べる(48kHz 997Hz -3dBFSの正弦波 1秒)
+static int test_q31_noise(const DSP_PROFILE *profile)
+{
+	const uint32_t fs = 48000;
+	const double amp = FULL_SCALE * 0.7071;
+	static int32_t in[DEFAULT_BLOCK];
+	static float in_float[DEFAULT_BLOCK];
+	static q31_t q31_work_0[DEFAULT_BLOCK * 8];
+	static q31_t q31_work_1[DEFAULT_BLOCK * 8];
+	static q31_t q31_out[DEFAULT_BLOCK * 32];
+	static double ref_out[DEFAULT_BLOCK * 32];
+	static REF_CHANNEL ref;
+	double max_q31_err = 0.;
+
+	dsp_init_filter_coef(profile);
+	printf("%-8s %14s %14s %14s %14s\n", "mode", "float rms(dB)", "float max", "q31 rms(dB)", "q31 max");
+	for (uint mode = 0; mode < 3; mode++)
+	{
+		DSP_CHAIN chain = {.rate_class = RATE_CLASS_48K, .run_bq_2x_2 = true, .ratio_final = mode_ratio[mode]};
+		DSP_CHANNEL *ch = &dsp_channel[0];
+		dsp_init_channel(ch, profile, DEFAULT_GAIN);
+		dsp_select_rate_class(ch, RATE_CLASS_96K);
+		dsp_select_rate_class(ch, RATE_CLASS_48K);
+		if (!dsp_q31_init_channel(&q31_channel, profile, DEFAULT_GAIN))
+		{
+			fprintf(stderr, "%s: coefficients out of Q31 range\n", profile->name);
+			return 1;
+		}
+		ref_init(&ref, profile, RATE_CLASS_48K, DEFAULT_GAIN);
+
+		double sum_err[2] = {0., 0.}, max_err[2] = {0., 0.};
+		uint64_t count = 0;
+		for (uint32_t n = 0; n < fs; n += DEFAULT_BLOCK)
+		{
+			for (uint32_t i = 0; i < DEFAULT_BLOCK; i++)
+				in[i] = (int32_t)lrint(amp * sin(2. * M_PI * 997. * (n + i) / fs));
+			dsp_int32_to_float(in, in_float, DEFAULT_BLOCK);
+			uint32_t len = dsp_process_channel(ch, &chain, in_float, output[0], work_0[0], work_1[0], DEFAULT_BLOCK);
+			dsp_q31_process_channel(&q31_channel, &chain, in, q31_out, q31_work_0, q31_work_1, DEFAULT_BLOCK);
+			uint32_t len_ref = 0;
+			for (uint32_t i = 0; i < DEFAULT_BLOCK; i++)
+				len_ref += ref_process(&ref, profile, chain.ratio_final, (double)in[i], &ref_out[len_ref]);
+			if (len_ref != len)
+			{
+				fprintf(stderr, "length mismatch %u %u\n", len, len_ref);
+				return 1;
+			}
+			for (uint32_t i = 0; i < len; i++)
+			{
+				double err[2] = {(double)output[0][i] - ref_out[i], (double)q31_out[i] - ref_out[i]};
+				for (int k = 0; k < 2; k++)
+				{
+					sum_err[k] += err[k] * err[k];
+					max_err[k] = fmax(max_err[k], fabs(err[k]));
+				}
+			}
+			count += len;
+		}
+		printf("%-8s %14.1f %14.1f %14.1f %14.1f\n", mode_name[mode],
+			   20. * log10(sqrt(sum_err[0] / count) / FULL_SCALE), 20. * log10(max_err[0] / FULL_SCALE),
+			   20. * log10(sqrt(sum_err[1] / count) / FULL_SCALE), 20. * log10(max_err[1] / FULL_SCALE));
+		max_q31_err = fmax(max_q31_err, max_err[1]);
+	}
+
+	// 折り返し(オーバーフロー)があれば誤差が大きくなる
+	bool ok = (20. * log10(max_q31_err / FULL_SCALE) <= -120.);
+	printf("q31 max error %.1f dBFS %s\n", 20. * log10(max_q31_err / FULL_SCALE), ok ? "OK" : "NG");
+	return ok ? 0 : 2;
+}
+
+// 全レート(48/96/192kHz系) x 全最終段(bypass/lo/hi)で、float版の出力を倍精度の参照(同じ段構成・同じfloat係数)と比べる
+// 入力は997Hz -6dBFS + 12kHz -12dBFSの正弦波 0.25秒 演算誤差の最大値がGOLDEN_MAX_ERROR_DBを超えたら(段の構成・係数・ゲインの変化)終了コード2
+#define GOLDEN_MAX_ERROR_DB (-100.)
+static int test_golden_chain(const DSP_PROFILE *profile)
+{
+	static const uint32_t rate[3] = {48000, 96000, 192000};
+	static int32_t in[DEFAULT_BLOCK];
+	static float in_float[DEFAULT_BLOCK];
+	static double ref_out[DEFAULT_BLOCK * 32];
+	static REF_CHANNEL ref;
+	bool ok = true;
+
+	dsp_init_filter_coef(profile);
+	printf("%-16s %14s %14s\n", "rate mode", "rms(dBFS)", "max(dBFS)");
+	for (uint32_t r = 0; r < 3; r++)
+	{
+		for (uint mode = 0; mode < 3; mode++)
+		{
+			const uint32_t fs = rate[r];
+			DSP_CHAIN chain = {.rate_class = dsp_get_rate_class(fs), .run_bq_2x_2 = true, .ratio_final = mode_ratio[mode]};
+			DSP_CHANNEL *ch = &dsp_channel[0];
+			dsp_init_channel(ch, profile, DEFAULT_GAIN);
+			dsp_select_rate_class(ch, chain.rate_class);
+			ref_init(&ref, profile, chain.rate_class, DEFAULT_GAIN);
+
+			double sum_err = 0., max_err = 0.;
+			uint64_t count = 0;
+			for (uint32_t n = 0; n < fs / 4; n += DEFAULT_BLOCK)
+			{
+				for (uint32_t i = 0; i < DEFAULT_BLOCK; i++)
+				{
+					double t = (double)(n + i) / fs;
+					in[i] = (int32_t)lrint(FULL_SCALE * (0.5 * sin(2. * M_PI * 997. * t) + 0.25 * sin(2. * M_PI * 12000. * t)));
+				}
+				dsp_int32_to_float(in, in_float, DEFAULT_BLOCK);
+				uint32_t len = dsp_process_channel(ch, &chain, in_float, output[0], work_0[0], work_1[0], DEFAULT_BLOCK);
+				uint32_t len_ref = 0;
+				for (uint32_t i = 0; i < DEFAULT_BLOCK; i++)
+					len_ref += ref_process(&ref, profile, chain.ratio_final, (double)in[i], &ref_out[len_ref]);
+				if (len_ref != len)
+				{
+					fprintf(stderr, "length mismatch %u %u\n", len, len_ref);
+					return 1;
+				}
+				for (uint32_t i = 0; i < len; i++)
+				{
+					double err = (double)output[0][i] - ref_out[i];
+					sum_err += err * err;
+					max_err = fmax(max_err, fabs(err));
+				}
+				count += len;
+			}
+			double max_db = 20. * log10(max_err / FULL_SCALE);
+			char name[32];
+			snprintf(name, sizeof(name), "%ukHz %s", fs / 1000, mode_name[mode]);
+			printf("%-16s %14.1f %14.1f\n", name, 20. * log10(sqrt(sum_err / count) / FULL_SCALE), max_db);
+			ok &= (max_db <= GOLDEN_MAX_ERROR_DB);
+		}
+	}
+	printf("golden %s\n", ok ? "OK" : "NG");
+	return ok ? 0 : 2;
+}
+
+// 最終段のBiQuad-IIRの演算誤差を、float版(CMSIS-DSP)と倍精度の状態(src/dsp_bq_f64.c)で比べる
+// 参照はlong double(x86では80bit)で、係数は同じfloatの値 入力は384kHzの997Hz -3dBFSの正弦波 1秒
+// プロファイルの最終段のほかに、極が単位円に近い段の例としてピーキング(1kHz Q=10 +6dB / 100Hz Q=10 +6dB 出力レート768kHz)も測る
+#define F64_TEST_NUM (4)
+static double ref_bq_ld(long double *state, const float (*coef)[NUM_OF_BQ_SUB_PARAMS], uint16_t num_stage, double x)
+{
+	long double v = x;
+	for (uint16_t i = 0; i < num_stage; i++)
+	{
+		long double *st = &state[i * 4];
+		long double y = (long double)coef[i][0] * v + (long double)coef[i][1] * st[0] + (long double)coef[i][2] * st[1] - (long double)coef[i][4] * st[2] - (long double)coef[i][5] * st[3];
+		st[1] = st[0];
+		st[0] = v;
+		st[3] = st[2];
+		st[2] = y;
+		v = y;
+	}
+	return (double)v;
+}
+
+// ピーキング(RBJ Audio EQ Cookbook)の係数表 1段
+static void make_peaking(float coef[1][NUM_OF_BQ_SUB_PARAMS], double fs, double f0, double q, double gain_db)
+{
+	double A = pow(10., gain_db / 40.);
+	double w0 = 2. * M_PI * f0 / fs;
+	double alpha = sin(w0) / (2. * q);
+	double a0 = 1. + alpha / A;
+	coef[0][0] = (float)((1. + alpha * A) / a0);
+	coef[0][1] = (float)((-2. * cos(w0)) / a0);
+	coef[0][2] = (float)((1. - alpha * A) / a0);
+	coef[0][3] = 1.f;
+	coef[0][4] = (float)((-2. * cos(w0)) / a0);
+	coef[0][5] = (float)((1. - alpha / A) / a0);
+}
+
+static int test_bq_f64_noise(const DSP_PROFILE *profile)
+{
+	const uint32_t fs = 384000;
+	const double amp = FULL_SCALE * 0.7071;
+	static float peak_coef[2][1][NUM_OF_BQ_SUB_PARAMS];
+	static float in[DEFAULT_BLOCK];
+	static float out_f32[DEFAULT_BLOCK * 4];
+	static float out_f64[DEFAULT_BLOCK * 4];
+	static float coeffs[SIZE_BQ_FILTER_2 * 5];
+	static float state[SIZE_BQ_FILTER_2 * 4];
+	long double ref_state[SIZE_BQ_FILTER_2 * 4];
+	const char *name[F64_TEST_NUM] = {"bq_2x_3", "bq_4x_0", "peak 1kHz Q10", "peak 100Hz Q10"};
+	bool ok = true;
+
+	make_peaking(peak_coef[0], fs * 2, 1000., 10., 6.);
+	make_peaking(peak_coef[1], fs * 2, 100., 10., 6.);
+
+	printf("%-16s %14s %14s %14s %14s\n", "stage", "float rms(dB)", "float max", "f64 rms(dB)", "f64 max");
+	for (int t = 0; t < F64_TEST_NUM; t++)
+	{
+		const float (*coef)[NUM_OF_BQ_SUB_PARAMS] = (t == 0) ? profile->bq_2x_3 : (t == 1) ? profile->bq_4x_0 : (const float (*)[NUM_OF_BQ_SUB_PARAMS])peak_coef[t - 2];
+		uint16_t num_stage = (t == 0) ? SIZE_BQ_FILTER_3 : (t == 1) ? SIZE_BQ_FILTER_4 : 1;
+		uint32_t ratio = (t == 1) ? 4 : 2;
+		arm_biquad_casd_df1_inst_f32 bq_f32;
+		DSP_BQ_F64 bq;
+
+		// dsp_filter.cと同じ形式(b0, b1, b2, -a1, -a2)
+		for (uint16_t i = 0; i < num_stage; i++)
+		{
+			coeffs[i * 5 + 0] = coef[i][0];
+			coeffs[i * 5 + 1] = coef[i][1];
+			coeffs[i * 5 + 2] = coef[i][2];
+			coeffs[i * 5 + 3] = -coef[i][4];
+			coeffs[i * 5 + 4] = -coef[i][5];
+		}
+		memset(state, 0, sizeof(state));
+		arm_biquad_cascade_df1_init_f32(&bq_f32, num_stage, coeffs, state);
+		dsp_bq_f64_init(&bq, coef, num_stage);
+		memset(ref_state, 0, sizeof(ref_state));
+
+		double sum_err[2] = {0., 0.}, max_err[2] = {0., 0.};
+		uint64_t count = 0;
+		for (uint32_t n = 0; n < fs; n += DEFAULT_BLOCK)
+		{
+			for (uint32_t i = 0; i < DEFAULT_BLOCK; i++)
+				in[i] = (float)(amp * sin(2. * M_PI * 997. * (n + i) / fs));
+			uint32_t len = (ratio == 4) ? dsp_bq_nos_4x(&bq_f32, in, out_f32, DEFAULT_BLOCK) : dsp_bq_nos_2x(&bq_f32, in, out_f32, DEFAULT_BLOCK);
+			dsp_bq_f64_nos(&bq, ratio, in, out_f64, DEFAULT_BLOCK);
+			for (uint32_t i = 0; i < len; i++)
+			{
+				double ref = ref_bq_ld(ref_state, coef, num_stage, in[i / ratio]);
+				double err[2] = {(double)out_f32[i] - ref, (double)out_f64[i] - ref};
+				for (int k = 0; k < 2; k++)
+				{
+					sum_err[k] += err[k] * err[k];
+					max_err[k] = fmax(max_err[k], fabs(err[k]));
+				}
+			}
+			count += len;
+		}
+		printf("%-16s %14.1f %14.1f %14.1f %14.1f\n", name[t],
+			   20. * log10(sqrt(sum_err[0] / count) / FULL_SCALE), 20. * log10(max_err[0] / FULL_SCALE),
+			   20. * log10(sqrt(sum_err[1] / count) / FULL_SCALE), 20. * log10(max_err[1] / FULL_SCALE));
+		ok = ok && (sum_err[1] <= sum_err[0]);
+	}
+
+	// 倍精度の状態の誤差はfloatの出力の丸め程度になるはず
+	printf("f64 %s\n", ok ? "OK" : "NG (larger error than float)");
+	return ok ? 0 : 2;
+}
+
+// S/PDIFのサブフレームの符号化(src/spdif_encode.c)を、規格の波形から1セルずつ作った参照のフレームと比べる
+// 参照: スロット0-3はプリアンブルのレベル波形(直前のレベルが0の場合 B:11101000 M:11100010 W:11100100 1なら反転)、
+// スロット4-31はBMC(スロットの先頭で必ず反転し、データ1ならスロットの中央でも反転)
+// audio_spdif.pioはNRZIの復号器(1のビットでレベルを反転)なので、各セルのビットは直前のセルとのレベルの差になる
+// チャンネルステータスの周波数・語長はIEC 60958-3の表のビット列と比べる
+// 戻り値は全サブフレームが一致し、復号したサンプル・チャンネルステータスが入力と同じなら0 違えば2
+static void ref_spdif_subframe(uint32_t *out, int32_t sample, char preamble, uint32_t c_bit, uint32_t *level)
+{
+	static const char *preamble_wave[3] = {"11101000", "11100010", "11100100"}; // B, M, W
+	const char *wave = preamble_wave[(preamble == 'B') ? 0 : (preamble == 'M') ? 1 : 2];
+	uint32_t slot[32];
+	uint32_t cell[64];
+	uint32_t parity = 0;
+
+	for (int i = 4; i < 28; i++)
+		slot[i] = ((uint32_t)sample >> (i + 4)) & 1u; // int32の上位24bitをLSBから
+	slot[28] = 0; // V
+	slot[29] = 0; // U
+	slot[30] = c_bit;
+	for (int i = 4; i < 31; i++)
+		parity ^= slot[i];
+	slot[31] = parity; // 偶数パリティ
+
+	// セル毎のレベル
+	uint32_t start = *level;
+	for (int i = 0; i < 8; i++)
+		cell[i] = (uint32_t)(wave[i] - '0') ^ start;
+	uint32_t v = cell[7];
+	for (int i = 4; i < 32; i++)
+	{
+		v ^= 1;
+		cell[i * 2] = v;
+		v ^= slot[i];
+		cell[i * 2 + 1] = v;
+	}
+
+	// NRZI(直前のセルとの差)にしてLSBから詰める
+	out[0] = out[1] = 0;
+	uint32_t prev = start;
+	for (int i = 0; i < 64; i++)
+	{
+		out[i / 32] |= (cell[i] ^ prev) << (i % 32);
+		prev = cell[i];
+	}
+	*level = prev;
+}
+
+// NRZIのサブフレームを復号する(プリアンブルの後はスロットの先頭で必ず反転していること パリティが合うこと)
+static bool decode_spdif_subframe(const uint32_t *in, int32_t *sample, uint32_t *c_bit)
+{
+	uint32_t bit[64];
+	uint32_t data = 0, parity = 0;
+
+	for (int i = 0; i < 64; i++)
+		bit[i] = (in[i / 32] >> (i % 32)) & 1u;
+	for (int i = 4; i < 32; i++)
+	{
+		if (!bit[i * 2])
+			return false;
+		parity ^= bit[i * 2 + 1];
+		if (i < 28)
+			data |= bit[i * 2 + 1] << (i + 4);
+	}
+	*sample = (int32_t)data;
+	*c_bit = bit[61];
+	return (parity == 0);
+}
+
+static int test_spdif_frames(void)
+{
+	// IEC 60958-3 チャンネルステータス ビット24-27(周波数) ビット32-35(語長 最大24bit・24bit)
+	static const struct
+	{
+		uint32_t freq;
+		const char *fs_bits;
+	} fs_table[] = {{44100, "0000"}, {48000, "0100"}, {88200, "0001"}, {96000, "0101"}, {176400, "0011"}, {192000, "0111"}};
+	const char *word_length_bits = "1101";
+	static int32_t in_L[SPDIF_BLOCK_FRAMES];
+	static int32_t in_R[SPDIF_BLOCK_FRAMES];
+	static uint32_t encoded[SPDIF_WORDS_PER_BLOCK];
+	uint32_t ref[SPDIF_WORDS_PER_SUBFRAME];
+	uint32_t mismatch = 0, decode_error = 0, count = 0;
+
+	spdif_encode_init_table();
+	srand(1);
+	for (uint32_t f = 0; f < sizeof(fs_table) / sizeof(fs_table[0]); f++)
+	{
+		uint64_t cs = spdif_get_channel_status(fs_table[f].freq);
+		uint64_t ref_cs = 1ull << 2; // コピー許可
+		for (int i = 0; i < 4; i++)
+		{
+			ref_cs |= (uint64_t)(fs_table[f].fs_bits[i] - '0') << (24 + i);
+			ref_cs |= (uint64_t)(word_length_bits[i] - '0') << (32 + i);
+		}
+
+		// 無音・フルスケール・最小値・ランプ・乱数(下位8bitは捨てられる)
+		for (uint32_t i = 0; i < SPDIF_BLOCK_FRAMES; i++)
+		{
+			switch (i % 4)
+			{
+			case 0:
+				in_L[i] = (i & 8) ? INT32_MAX : INT32_MIN;
+				in_R[i] = 0;
+				break;
+			case 1:
+				in_L[i] = (int32_t)(i * 0x01010101u);
+				in_R[i] = -(int32_t)(i << 8);
+				break;
+			default:
+				in_L[i] = (int32_t)(((uint32_t)rand() << 16) ^ (uint32_t)rand());
+				in_R[i] = (int32_t)(((uint32_t)rand() << 16) ^ (uint32_t)rand());
+				break;
+			}
+		}
+		spdif_encode_block(encoded, in_L, in_R, cs);
+
+		uint32_t level = 0;
+		uint64_t decoded_cs = 0;
+		for (uint32_t i = 0; i < SPDIF_BLOCK_FRAMES; i++)
+		{
+			uint32_t c_bit = (i < 64) ? (uint32_t)(ref_cs >> i) & 1u : 0;
+			for (int ch = 0; ch < 2; ch++)
+			{
+				const uint32_t *sub = &encoded[(i * 2 + ch) * SPDIF_WORDS_PER_SUBFRAME];
+				int32_t sample = ch ? in_R[i] : in_L[i];
+				int32_t decoded = 0;
+				uint32_t decoded_c = 0;
+
+				ref_spdif_subframe(ref, sample, ch ? 'W' : (i ? 'M' : 'B'), c_bit, &level);
+				if ((sub[0] != ref[0]) || (sub[1] != ref[1]))
+				{
+					if (mismatch++ < 4)
+						fprintf(stderr, "fs %u frame %u ch %d: %08x %08x (ref %08x %08x)\n", fs_table[f].freq, i, ch, sub[0], sub[1], ref[0], ref[1]);
+				}
+				if (!decode_spdif_subframe(sub, &decoded, &decoded_c) || (decoded != (int32_t)(sample & 0xffffff00)))
+					decode_error++;
+				if ((ch == 0) && (i < 64))
+					decoded_cs |= (uint64_t)decoded_c << i;
+				count++;
+			}
+		}
+		if (decoded_cs != ref_cs)
+		{
+			fprintf(stderr, "fs %u: channel status %016llx (ref %016llx)\n", fs_table[f].freq, (unsigned long long)decoded_cs, (unsigned long long)ref_cs);
+			decode_error++;
+		}
+		// 各サブフレームの反転は偶数回なので、ブロックの終わりのレベルは始めと同じ
+		if (level != 0)
+			decode_error++;
+	}
+
+	bool ok = (mismatch == 0) && (decode_error == 0);
+	printf("spdif %u subframes, %u mismatch, %u decode error %s\n", count, mismatch, decode_error, ok ? "OK" : "NG");
+	return ok ? 0 : 2;
+}
+
+// Delta-Sigma変調器(src/delta_sigma.c)の信号帯域のSNR・安定性を、ファームウェアと同じ変調器の出力ビット列から測る
+// 入力はI2S出力周波数(352.8kHz 44.1kHz系 HiPowerMode)の約1kHzの正弦波(出力ビット列でFFTのビンに揃えてHann窓で測る)
+// 変調器の過渡応答の分を捨ててから SDM_TEST_BITS ビットを測る 信号帯域は20kHzまで 雑音には高調波を含む
+#define SDM_TEST_FS (352800)
+#define SDM_TEST_SYS_CLOCK_KHZ (283200) // src/common.hのSYS_CLOCK_KHZ_44Kと同じ
+#define SDM_TEST_FS_48K (384000)
+#define SDM_TEST_SYS_CLOCK_KHZ_48K (307200) // src/common.hのSYS_CLOCK_KHZ_48Kと同じ
+#define SDM_TEST_BITS (1u << 18)
+#define SDM_TEST_BAND (20000.)
+#define SDM_TEST_SIGNAL_BINS (2)
+#define SDM_TEST_MAX_LEVEL_DB (6.)
+#define SDM_TEST_MIN_MARGIN_DB (1.) // 0dBFSを超えてもこれだけはリセットせずに変調できること
+#define DSD_TEST_MIN_ORDER (4)        // DSD出力で使う次数(src/common.hのDSD_ORDER 予算に収まるのは4次まで)
+#define DSD_TEST_MAX_NOISE_DBFS (-130.) // DSD出力の信号帯域の雑音(高調波を含む)の上限 4次の実測は-133dBFS、5~7次は-150dBFS程度
+
+static void fft(double *re, double *im, uint32_t n)
+{
+	for (uint32_t i = 1, j = 0; i < n; i++)
+	{
+		uint32_t bit = n >> 1;
+		for (; j & bit; bit >>= 1)
+			j ^= bit;
+		j ^= bit;
+		if (i < j)
+		{
+			double t = re[i];
+			re[i] = re[j];
+			re[j] = t;
+			t = im[i];
+			im[i] = im[j];
+			im[j] = t;
+		}
+	}
+	for (uint32_t len = 2; len <= n; len <<= 1)
+	{
+		const double w = -2. * M_PI / len;
+		for (uint32_t i = 0; i < n; i += len)
+		{
+			for (uint32_t k = 0; k < len / 2; k++)
+			{
+				double c = cos(w * k), s = sin(w * k);
+				double *a_re = &re[i + k], *a_im = &im[i + k];
+				double *b_re = &re[i + k + len / 2], *b_im = &im[i + k + len / 2];
+				double t_re = *b_re * c - *b_im * s;
+				double t_im = *b_re * s + *b_im * c;
+				*b_re = *a_re - t_re;
+				*b_im = *a_im - t_im;
+				*a_re += t_re;
+				*a_im += t_im;
+			}
+		}
+	}
+}
+
+// 1つの設定(次数・変調倍率・入力1サンプルあたりの出力ビット数)でlevel_db(dBFS)の正弦波を変調する 戻り値はリセット(発振)回数
+// snr_dbがNULLでなければ、Lchの出力ビット列の信号帯域のSNRと雑音(入力のフルスケールに対するdB)を求める
+static uint32_t measure_sdm(uint32_t order, uint32_t ratio, uint32_t bits_per_sample, double level_db, double *snr_db, double *noise_dbfs)
+{
+	static double re[SDM_TEST_BITS];
+	static double im[SDM_TEST_BITS];
+	static float in_L[DEFAULT_BLOCK];
+	static float in_R[DEFAULT_BLOCK];
+	static uint32_t out[DEFAULT_BLOCK * 4];
+	const double fs_out = (double)SDM_TEST_FS * bits_per_sample;
+	const uint32_t bin = (uint32_t)lrint(997. * SDM_TEST_BITS / fs_out);
+	const double amp = FULL_SCALE * pow(10., level_db / 20.);
+	uint32_t pos = 0;
+
+	init_delta_sigma(order, ratio, bits_per_sample);
+	for (uint32_t n = 0; pos < SDM_TEST_BITS * 2; n += DEFAULT_BLOCK)
+	{
+		for (uint32_t i = 0; i < DEFAULT_BLOCK; i++)
+		{
+			double x = amp * sin(2. * M_PI * bin * ((double)(n + i) * bits_per_sample / SDM_TEST_BITS));
+			in_L[i] = (float)x;
+			in_R[i] = (float)-x;
+		}
+		uint32_t words = delta_sigma_modulate(in_L, in_R, out, DEFAULT_BLOCK);
+		for (uint32_t w = 0; w < words; w++)
+		{
+			for (uint32_t b = 0; b < 32; b += 2, pos++)
+			{
+				// 前半は過渡応答として捨てる Lchは偶数bit(先に出力するビットがbit0)
+				if ((pos >= SDM_TEST_BITS) && (pos < SDM_TEST_BITS * 2))
+				{
+					re[pos - SDM_TEST_BITS] = ((out[w] >> b) & 1u) ? 1. : -1.;
+					im[pos - SDM_TEST_BITS] = 0.;
+				}
+			}
+		}
+	}
+	if (snr_db == NULL)
+		return delta_sigma_reset_count();
+
+	// 窓なしでは帯域外の大きな雑音の漏れ込み(サイドローブ)で信号帯域の雑音が-90dB程度に見えるので、Hann窓をかける
+	for (uint32_t i = 0; i < SDM_TEST_BITS; i++)
+		re[i] *= 0.5 - 0.5 * cos(2. * M_PI * i / SDM_TEST_BITS);
+	fft(re, im, SDM_TEST_BITS);
+	const uint32_t band = (uint32_t)(SDM_TEST_BAND * SDM_TEST_BITS / fs_out);
+	double p_signal = 0.;
+	double p_noise = 0.;
+	for (uint32_t k = 1; k <= band; k++)
+	{
+		// 信号はHann窓のメインローブ(±SDM_TEST_SIGNAL_BINS)の和
+		if ((k + SDM_TEST_SIGNAL_BINS >= bin) && (k <= bin + SDM_TEST_SIGNAL_BINS))
+			p_signal += re[k] * re[k] + im[k] * im[k];
+		else
+			p_noise += re[k] * re[k] + im[k] * im[k];
+	}
+	// 入力のフルスケールは変調器の入力SDM_INPUT_LEVELに当たる(Hann窓の電力の平均3/8をかける)
+	double p_full = pow(SDM_INPUT_LEVEL * SDM_TEST_BITS / 2., 2.) * 3. / 8.;
+	*snr_db = 10. * log10(p_signal / p_noise);
+	*noise_dbfs = 10. * log10(p_noise / p_full);
+	return delta_sigma_reset_count();
+}
+
+// リセットせずに変調できる最大の入力レベル(0.5dB刻み SDM_TEST_MAX_LEVEL_DBまで 0dBFSで発振する場合は-INFINITY)
+static double sdm_stable_level(uint32_t order, uint32_t ratio, uint32_t bits_per_sample)
+{
+	double level = -INFINITY;
+	for (double db = 0.; db <= SDM_TEST_MAX_LEVEL_DB; db += 0.5)
+	{
+		if (measure_sdm(order, ratio, bits_per_sample, db, NULL, NULL) != 0)
+			break;
+		level = db;
+	}
+	return level;
+}
+
+// 1つの設定を測って1行出力する 0dBFSでリセットするか、安定な入力レベルの余裕がSDM_TEST_MIN_MARGIN_DB未満か、
+// 信号帯域の雑音がmax_noise_dbfsを超えたらfalse
+// サイクル数はsrc/delta_sigma.hのSDM_CYCLES_X2(Cortex-M33の命令数から求めた値)で、ファームウェアのビルド時の判定と同じ
+// 予算は 44.1kHz系・48kHz系で小さい方の SYS_CLOCK / (I2S出力周波数 * 変調倍率 * 2ch) で、超える設定はunsupportedと表示する
+static bool print_sdm_row(const char *name, uint32_t order, uint32_t ratio, uint32_t bits_per_sample, double max_noise_dbfs)
+{
+	double snr, noise;
+	uint32_t resets = measure_sdm(order, ratio, bits_per_sample, 0., &snr, &noise);
+	double stable = sdm_stable_level(order, ratio, bits_per_sample);
+	double budget = fmin(SDM_TEST_SYS_CLOCK_KHZ * 1000. / (SDM_TEST_FS * ratio * 2.), SDM_TEST_SYS_CLOCK_KHZ_48K * 1000. / (SDM_TEST_FS_48K * ratio * 2.));
+	bool supported = SDM_WITHIN_BUDGET(order, ratio, SDM_TEST_SYS_CLOCK_KHZ, SDM_TEST_FS) &&
+					 SDM_WITHIN_BUDGET(order, ratio, SDM_TEST_SYS_CLOCK_KHZ_48K, SDM_TEST_FS_48K);
+	printf("%-8s %-6u %10.1f %12.1f %8u %+12.1f %8.1f %8.1f%s\n", name, order, snr, noise, resets, stable,
+		   SDM_CYCLES_X2(order) / 2., budget, supported ? "" : " unsupported");
+	return (resets == 0) && (stable >= SDM_TEST_MIN_MARGIN_DB) && (noise <= max_noise_dbfs);
+}
+
+// 次数2~7 x OSR16/32と、DSD出力(DSD128/DSD256 次数5~7)の信号帯域のSNR・雑音・安定性と、
+// 1ステップ・1chあたりのサイクル数とCore1の予算を表にする
+// 0dBFS(変調器の入力SDM_INPUT_LEVEL)の正弦波でリセット(発振)するか、安定な範囲の余裕が足りないか、
+// DSD出力の信号帯域の雑音がDSD_TEST_MAX_NOISE_DBFSを超えたら終了コード2にする
+static int test_sdm_noise(void)
+{
+	static const uint32_t osr_list[2] = {16, 32};
+	bool ok = true;
+
+	printf("%-8s %-6s %10s %12s %8s %12s %8s %8s\n", "mode", "order", "snr(dB)", "noise(dBFS)", "resets", "stable(dBFS)", "cycles", "budget");
+	for (uint32_t o = 0; o < 2; o++)
+	{
+		char name[16];
+		snprintf(name, sizeof(name), "osr%u", osr_list[o]);
+		for (uint32_t order = SDM_MIN_ORDER; order <= SDM_MAX_ORDER; order++)
+			ok &= print_sdm_row(name, order, osr_list[o], osr_list[o], 0.);
+	}
+	// DSD128はDSD_MODULATION_RATIO(I2S出力周波数x16)で変調し、DSD256は同じビットを2回ずつ出力する
+	for (uint32_t order = DSD_TEST_MIN_ORDER; order <= SDM_MAX_ORDER; order++)
+		ok &= print_sdm_row("dsd128", order, DSD_MODULATION_RATIO, DSD_MODULATION_RATIO, DSD_TEST_MAX_NOISE_DBFS);
+	for (uint32_t order = DSD_TEST_MIN_ORDER; order <= SDM_MAX_ORDER; order++)
+		ok &= print_sdm_row("dsd256", order, DSD_MODULATION_RATIO, DSD_MODULATION_RATIO * 2, DSD_TEST_MAX_NOISE_DBFS);
+	printf("sdm %s\n", ok ? "OK" : "NG");
+	return ok ? 0 : 2;
+}
+
+// テレメトリCLI(tools/telemetry/ddc_telemetry -r -c)と同じ表示処理で、記録したパケットをCSVにして期待値と比べる
+// 期待値は記録ファイルの拡張子を.csvにしたもの(tools/telemetry/testdata/capture.bin → capture.csv)
+// 形式の異なるパケット(magic・versionが違うもの)は読み飛ばし、CSVが1行でも異なれば終了コード2にする
+static int test_telemetry_decode(const char *capture_path)
+{
+	char expect_path[1024];
+	const char *ext = strrchr(capture_path, '.');
+	int base_len = ext ? (int)(ext - capture_path) : (int)strlen(capture_path);
+	snprintf(expect_path, sizeof(expect_path), "%.*s.csv", base_len, capture_path);
+
+	FILE *in = fopen(capture_path, "rb");
+	if (in == NULL)
+	{
+		fprintf(stderr, "%s: %s\n", capture_path, strerror(errno));
+		return 1;
+	}
+	FILE *expect = fopen(expect_path, "r");
+	if (expect == NULL)
+	{
+		fprintf(stderr, "%s: %s\n", expect_path, strerror(errno));
+		fclose(in);
+		return 1;
+	}
+	FILE *out = tmpfile();
+	if (out == NULL)
+	{
+		fprintf(stderr, "tmpfile: %s\n", strerror(errno));
+		fclose(in);
+		fclose(expect);
+		return 1;
+	}
+
+	uint32_t invalid = 0;
+	uint32_t count = telemetry_replay(in, out, true, &invalid);
+	rewind(out);
+
+	char line[2][512];
+	uint32_t num_line = 0;
+	uint32_t mismatch = 0;
+	for (;;)
+	{
+		bool has_out = (fgets(line[0], sizeof(line[0]), out) != NULL);
+		bool has_expect = (fgets(line[1], sizeof(line[1]), expect) != NULL);
+		if (!has_out && !has_expect)
+			break;
+		num_line++;
+		if (has_out && has_expect && !strcmp(line[0], line[1]))
+			continue;
+		if (mismatch++ == 0)
+			fprintf(stderr, "line %u\n  decoded:  %s  expected: %s", num_line, has_out ? line[0] : "(none)\n", has_expect ? line[1] : "(none)\n");
+	}
+	fclose(in);
+	fclose(expect);
+	fclose(out);
+
+	bool ok = (mismatch == 0) && (count > 0);
+	printf("telemetry %u packets, %u skipped, %u mismatch %s\n", count, invalid, mismatch, ok ? "OK" : "NG");
+	return ok ? 0 : 2;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-m lo|hi|bypass|all] [-n] [-g gain] [-v dB[@frame]] [-B samples] [-f] [-x golden.wav [-t dBFS]] [-p profile] [-s profile@frame] [-c] [-l] [-d] [-e eq.txt] [-r ir.wav] in.wav out.wav\n"
+					"       %s [-p profile] [-r ir.wav] -b\n"
+					"       %s -C\n"
+					"       %s [-p profile] -Q\n"
+					"       %s [-p profile] -D\n"
+					"       %s [-p profile] -G\n"
+					"       %s -P\n"
+					"       %s -S\n"
+					"       %s -T capture.bin\n",
+			name, name, name, name, name, name, name, name, name);
+}
+
+int main(int argc, char *argv[])
+{
+	OPTION opt = {
+		.no_bq2 = false,
+		.is_float = false,
+		.gain = DEFAULT_GAIN,
+		.volume_db = 0.f,
+		.volume_frame = 0,
+		.block = DEFAULT_BLOCK,
+		.golden_path = NULL,
+		.tolerance_db = -120.,
+		.profile = &dsp_profile_table[DSP_PROFILE_DEFAULT],
+		.switch_profile = NULL,
+		.switch_frame = 0,
+		.long_fir = false,
+		.bq_f64 = false,
+		.eq_path = NULL,
+	};
+	int mode = 0; // bypass
+	bool all_modes = false;
+	int c;
+
+	while ((c = getopt(argc, argv, "m:ng:v:B:fx:t:p:s:cldDe:r:bCQGPST:")) != -1)
+	{
+		switch (c)
+		{
+		case 'm':
+			if (!strcmp(optarg, "all"))
+			{
+				all_modes = true;
+				break;
+			}
+			for (mode = 0; (mode < 3) && strcmp(optarg, mode_name[mode]); mode++)
+				;
+			if (mode == 3)
+			{
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'n':
+			opt.no_bq2 = true;
+			break;
+		case 'g':
+			opt.gain = atof(optarg);
+			break;
+		case 'v':
+		{
+			char *end;
+			opt.volume_db = strtod(optarg, &end);
+			if (*end == '@')
+				opt.volume_frame = strtoul(end + 1, NULL, 0);
+			break;
+		}
+		case 'B':
+			opt.block = atoi(optarg);
+			if ((opt.block == 0) || (opt.block > MAX_BLOCK))
+			{
+				fprintf(stderr, "block size must be 1..%d\n", MAX_BLOCK);
+				return 1;
+			}
+			break;
+		case 'f':
+			opt.is_float = true;
+			break;
+		case 'x':
+			opt.golden_path = optarg;
+			break;
+		case 't':
+			opt.tolerance_db = atof(optarg);
+			break;
+		case 'p':
+			if ((opt.profile = find_profile(optarg)) == NULL)
+				return 1;
+			break;
+		case 's':
+		{
+			char name[32];
+			char *at = strchr(optarg, '@');
+			if ((at == NULL) || (at - optarg >= (int)sizeof(name)))
+			{
+				usage(argv[0]);
+				return 1;
+			}
+			memcpy(name, optarg, at - optarg);
+			name[at - optarg] = '\0';
+			if ((opt.switch_profile = find_profile(name)) == NULL)
+				return 1;
+			opt.switch_frame = strtoul(at + 1, NULL, 0);
+			break;
+		}
+		case 'c':
+			use_crossfeed = true;
+			break;
+		case 'l':
+			opt.long_fir = true;
+			break;
+		case 'd':
+			opt.bq_f64 = true;
+			break;
+		case 'D':
+			return test_bq_f64_noise(opt.profile);
+		case 'e':
+			opt.eq_path = optarg;
+			break;
+		case 'r':
+			if (!read_ir_file(optarg))
+				return 1;
+			break;
+		case 'b':
+			dsp_init_filter_coef(opt.profile);
+			return benchmark(opt.profile);
+		case 'C':
+			return test_crossfeed_response();
+		case 'Q':
+			return test_q31_noise(opt.profile);
+		case 'G':
+			return test_golden_chain(opt.profile);
+		case 'P':
+			return test_spdif_frames();
+		case 'S':
+			return test_sdm_noise();
+		case 'T':
+			return test_telemetry_decode(optarg);
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (argc - optind != 2)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+	const char *in_path = argv[optind];
+	const char *out_path = argv[optind + 1];
+
+	if (!all_modes)
+		return upsample_file(in_path, out_path, mode, &opt);
+
+	if (opt.golden_path != NULL)
+	{
+		fprintf(stderr, "-x cannot be used with -m all\n");
+		return 1;
+	}
+
+	// out.wav → out_lo.wav out_hi.wav out_bypass.wav
+	char path[1024];
+	const char *ext = strrchr(out_path, '.');
+	int base_len = ext ? (int)(ext - out_path) : (int)strlen(out_path);
+	for (uint m = 0; m < 3; m++)
+	{
+		snprintf(path, sizeof(path), "%.*s_%s%s", base_len, out_path, mode_name[m], ext ? ext : ".wav");
+		int ret = upsample_file(in_path, path, m, &opt);
+		if (ret != 0)
+			return ret;
+	}
+	return 0;
+}
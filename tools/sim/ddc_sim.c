@@ -0,0 +1,711 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+// Pico2 UltraHiRes USB-DDC バッファ水位シミュレータ
+// USB SOF(ホストのクロック)とI2S出力(デバイスのクロック)を仮想時間で動かし、
+// ファームウェアと同じ水位制御(src/flow_control.c)で USB受信 → EPバッファ → Core0 → リングバッファ → Core1 → DMA → I2S を再現する
+// 実機なしでバッファサイズ・FB水位・調整幅を試せる(音声データは扱わず、サンプル数だけを追う)
+//
+// build: cc -O2 -DDSP_HOST_BUILD -I../../src -o ddc_sim ddc_sim.c ../../src/flow_control.c -lm
+//
+// usage: ddc_sim [options]
+//        -r freq          入力サンプルレート(既定 48000)
+//        -k ratio         Core0→Core1のリングバッファの倍率(既定 48kHz系:8 96kHz系:4 192kHz系:2)
+//        -d sec           シミュレーション時間(既定 60)
+//        -H ppm -D ppm    ホスト(USB SOF)・デバイス(水晶)のクロック偏差
+//        -I ppm           I2Sクロックの分周誤差(デバイスのクロックに対する偏差)
+//        -j us -J us      USB SOFの揺らぎ(±) Core0/Core1の割り込み遅延(0~)
+//        -c us -C us      Core0/Core1のリングバッファ1サンプルあたりの処理時間(既定 0.45 / 0.30 PROF_CORE0_TOTAL等の実測値から求める)
+//        -R frames        ホストがFeedbackを読む間隔(既定 1 = 1ms)
+//        -F               Feedbackを使わず公称レートで送る
+//        -u size          SIZE_UPSAMPLE_CORE0      -T size  SIZE_BUFFER_FB_THRESHOLD(既定 -uの1/2)
+//        -L value         FB_ADJ_LIMIT             -A size  OSR_ADJ_SIZE
+//        -e size          SIZE_EP_BUFFER
+//        -o file.csv      水位の推移を出力する(-i ms 間隔 既定 1)
+//        -s seed          乱数の種
+//        -q               結果を1行で出力する(パラメータを振って比較する場合)
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "flow_control.h"
+
+// common.h / transmit_to_dac.h の既定値
+#define DEFAULT_SIZE_EP_BUFFER (256)
+#define DEFAULT_SIZE_UPSAMPLE_CORE0 (8192)
+#define DEFAULT_FB_ADJ_LIMIT (1000)
+#define DEFAULT_OSR_ADJ_SIZE (1)
+#define DEFAULT_TIMER0_US (250)
+#define DEFAULT_TIMER_US_CORE1 (250)
+#define DEPTH_DMA_TX_BUFFER (3)
+#define SIZE_DMA_TX_BUF_STACK (2)
+
+#define WARMUP_SEC (1.0)		// 統計から除く起動直後の時間
+#define CORE_WAKE_LATENCY_NS (2000) // 割り込みからコアの処理開始までの時間
+#define CORE_OVERHEAD_NS (3000)		// 1回の処理の固定分
+#define DEFAULT_CORE0_US_PER_SAMPLE (0.45)
+#define DEFAULT_CORE1_US_PER_SAMPLE (0.30)
+#define NS_PER_MS (1000000)
+#define MAX_LATENCY_SEGMENT (4096)
+
+typedef struct
+{
+	uint32_t freq;
+	uint16_t ratio;
+	double duration_sec;
+	double host_ppm;
+	double device_ppm;
+	double i2s_ppm;
+	double sof_jitter_us;
+	double irq_jitter_us;
+	double core0_us_per_sample;
+	double core1_us_per_sample;
+	uint32_t refresh_frames;
+	bool no_feedback;
+	int32_t size_ep;
+	const char *csv_path;
+	uint32_t csv_interval_ms;
+	bool quiet;
+} SIM_CONFIG;
+
+typedef struct
+{
+	double min;
+	double max;
+	double sum;
+	uint64_t count;
+} STAT;
+
+// 入力サンプルの到着時刻(遅延の計算用) 入力レート換算のサンプル数で持つ
+typedef struct
+{
+	int64_t time_ns;
+	double frames;
+} LATENCY_SEGMENT;
+
+// 各コアのイベントループ(scheduler.c) 処理中に発行されたイベントは処理後に実行し、実行前に重なったイベントは1回にまとめる
+typedef struct
+{
+	int64_t wake;
+	int64_t busy_until;
+	bool timer; // 次の処理にタイマーイベントが含まれる(Core0の水位の調整はタイマーイベントでのみ行う)
+} SIM_CORE;
+
+typedef struct
+{
+	// バッファ水位(サンプル数)
+	int32_t ep_level;
+	int32_t upsr_level;
+
+	// DMA送信バッファ(transmit_to_dac.c の DMA_TX_STRUCTURE)
+	int32_t dma_size[DEPTH_DMA_TX_BUFFER];
+	uint32_t dma_wp;
+	uint32_t dma_rp;
+	uint32_t dma_using;
+	int32_t prev_write_length;
+	bool dma_busy;
+	bool is_enabled_dma_tx_isr;
+	bool enable_output;
+
+	FLOW_REF_SIZE ref_size_state;
+	uint32_t feedback_value; // ホストが最後に読んだFeedback(10.14)
+	uint32_t feedback_fs;
+	uint32_t host_acc;		 // ホスト側の送信サンプル数の端数(x2^14)
+
+	// 遅延計算用の到着時刻キュー
+	LATENCY_SEGMENT segment[MAX_LATENCY_SEGMENT];
+	uint32_t seg_rp;
+	uint32_t seg_wp;
+
+	// 統計
+	uint32_t underrun;
+	int64_t underrun_ns;
+	int64_t time_idle_start;
+	uint32_t ep_drop;
+	uint32_t overrun;
+	uint32_t upsr_drop;
+	int64_t time_first_output;
+	STAT stat_ep;
+	STAT stat_upsr;
+	STAT stat_dma;
+	STAT stat_fb;
+	STAT stat_latency;
+} SIM_STATE;
+
+FLOW_PARAM flow_param; // ファームウェアではflow_control.cでcommon.hの値から作る
+static SIM_CONFIG config;
+static SIM_STATE sim;
+static uint64_t rng_state = 1;
+
+// xorshift64 (シードが同じなら結果も同じになるように)
+static double rand_uniform(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return (rng_state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void stat_init(STAT *stat)
+{
+	stat->min = INFINITY;
+	stat->max = -INFINITY;
+	stat->sum = 0.;
+	stat->count = 0;
+}
+
+static void stat_add(STAT *stat, double value, int64_t now)
+{
+	if (now < WARMUP_SEC * 1e9)
+		return;
+	stat->min = fmin(stat->min, value);
+	stat->max = fmax(stat->max, value);
+	stat->sum += value;
+	stat->count++;
+}
+
+static double stat_avg(const STAT *stat)
+{
+	return stat->count ? stat->sum / stat->count : NAN;
+}
+
+// デバイスのクロックでの時刻(time_us_32)
+static uint32_t device_time_us(int64_t now)
+{
+	return (uint32_t)(uint64_t)(now * (1. + config.device_ppm * 1e-6) / 1000.);
+}
+
+static int64_t device_period_ns(uint32_t period_us)
+{
+	return (int64_t)(period_us * 1000. / (1. + config.device_ppm * 1e-6));
+}
+
+static void latency_push(int64_t now, double frames)
+{
+	uint32_t next = (sim.seg_wp + 1) % MAX_LATENCY_SEGMENT;
+	if (next == sim.seg_rp)
+		return;
+	sim.segment[sim.seg_wp] = (LATENCY_SEGMENT){now, frames};
+	sim.seg_wp = next;
+}
+
+// 入力サンプルを先頭から取り除く 戻り値は先頭サンプルの到着時刻
+static int64_t latency_pop(double frames)
+{
+	int64_t time_ns = -1;
+	while ((frames > 1e-9) && (sim.seg_rp != sim.seg_wp))
+	{
+		LATENCY_SEGMENT *seg = &sim.segment[sim.seg_rp];
+		if (time_ns < 0)
+			time_ns = seg->time_ns;
+		double n = fmin(frames, seg->frames);
+		seg->frames -= n;
+		frames -= n;
+		if (seg->frames <= 1e-9)
+			sim.seg_rp = (sim.seg_rp + 1) % MAX_LATENCY_SEGMENT;
+	}
+	return time_ns;
+}
+
+// 捨てたサンプルを末尾から取り除く
+static void latency_drop_tail(double frames)
+{
+	while ((frames > 1e-9) && (sim.seg_rp != sim.seg_wp))
+	{
+		uint32_t last = (sim.seg_wp + MAX_LATENCY_SEGMENT - 1) % MAX_LATENCY_SEGMENT;
+		double n = fmin(frames, sim.segment[last].frames);
+		sim.segment[last].frames -= n;
+		frames -= n;
+		if (sim.segment[last].frames <= 1e-9)
+			sim.seg_wp = last;
+	}
+}
+
+// _as_sync_packet
+static uint32_t device_feedback(void)
+{
+	int32_t adjust_value = flow_feedback_adjust(&flow_param, sim.upsr_level, config.ratio);
+	sim.feedback_fs = config.freq + adjust_value;
+	return flow_feedback_value(sim.feedback_fs);
+}
+
+// _as_audio_packet → usb_ep_data_acquire(buffer_length_limiter)
+static void device_usb_rx(int64_t now, int32_t frames)
+{
+	int32_t length = flow_limit_ep_length(flow_param.size_upsample - sim.upsr_level, config.ratio, frames, config.size_ep);
+	if (length < frames)
+		sim.overrun++;
+
+	// EPバッファに入りきらないパケットは捨てられる(ringbuf_write_array_no_spinlock)
+	if (config.size_ep - sim.ep_level < length)
+	{
+		sim.ep_drop++;
+		return;
+	}
+	sim.ep_level += length;
+	latency_push(now, length);
+}
+
+// upsampling_process_core0 戻り値はリングバッファに書き込んだサンプル数
+static int32_t device_core0(int64_t now, bool adjust_flow)
+{
+	int32_t ref_size = flow_ref_size(&flow_param, &sim.ref_size_state, config.freq, device_time_us(now));
+	int32_t adj = adjust_flow ? flow_osr_adjust(&flow_param, sim.upsr_level) : 0;
+	int32_t length = ref_size + adj;
+	if (length > sim.ep_level)
+		length = sim.ep_level;
+	if (length <= 0)
+		return 0;
+
+	sim.ep_level -= length;
+
+	// Core0→Core1のリングバッファに入りきらない場合は書き込まれない(ringbuf_write_array_spinlock)
+	int32_t size = length * config.ratio;
+	if (flow_param.size_upsample - sim.upsr_level < size)
+	{
+		sim.upsr_drop++;
+		latency_drop_tail(length);
+		return 0;
+	}
+	sim.upsr_level += size;
+	return size;
+}
+
+// i2s_tx_process 戻り値は開始したDMAブロックのサンプル数(0:開始しない)
+static int32_t device_i2s_tx(int64_t now)
+{
+	if (sim.dma_using == DEPTH_DMA_TX_BUFFER)
+	{
+		sim.prev_write_length = 0;
+		return 0;
+	}
+	if (sim.dma_using == 0)
+	{
+		if (sim.enable_output && (sim.prev_write_length != 0))
+		{
+			sim.underrun++;
+			sim.time_idle_start = now;
+		}
+		sim.prev_write_length = 0;
+		return 0;
+	}
+
+	int32_t size = sim.dma_size[sim.dma_rp];
+	sim.prev_write_length = size;
+	sim.dma_rp = (sim.dma_rp + 1) % DEPTH_DMA_TX_BUFFER;
+	sim.dma_using--;
+
+	// 出力ブロックの先頭サンプルの遅延
+	int64_t arrival = latency_pop((double)size / config.ratio);
+	if (arrival >= 0)
+		stat_add(&sim.stat_latency, (now - arrival) / 1000., now);
+	if (sim.time_first_output < 0)
+		sim.time_first_output = now;
+	if (sim.time_idle_start >= 0)
+	{
+		sim.underrun_ns += now - sim.time_idle_start;
+		sim.time_idle_start = -1;
+	}
+	return size;
+}
+
+// dma_tx_start 戻り値はDMAを開始した場合そのブロックのサンプル数 processedに処理したサンプル数を返す
+static int32_t device_core1(int64_t now, int32_t *processed)
+{
+	*processed = 0;
+	int32_t length = sim.upsr_level;
+	switch (flow_output_decision(&flow_param, false, length, sim.dma_using))
+	{
+	case FLOW_OUTPUT_START:
+		sim.enable_output = true;
+		break;
+	case FLOW_OUTPUT_STOP:
+		sim.enable_output = false;
+		break;
+	default:
+		break;
+	}
+
+	if (!sim.enable_output)
+	{
+		sim.is_enabled_dma_tx_isr = false;
+		sim.dma_using = 0;
+		sim.dma_wp = 0;
+		sim.dma_rp = 0;
+		sim.prev_write_length = 0;
+		return 0;
+	}
+	if ((length <= 0) || (sim.dma_using >= SIZE_DMA_TX_BUF_STACK))
+		return 0;
+
+	length = flow_core1_transmit_size(&flow_param, config.freq, config.ratio, length);
+	*processed = length;
+	sim.upsr_level -= length;
+	sim.dma_size[sim.dma_wp] = length;
+	sim.dma_wp = (sim.dma_wp + 1) % DEPTH_DMA_TX_BUFFER;
+	sim.dma_using++;
+
+	if (sim.prev_write_length == 0)
+		sim.is_enabled_dma_tx_isr = false;
+	if ((!sim.is_enabled_dma_tx_isr) && (!sim.dma_busy))
+	{
+		sim.is_enabled_dma_tx_isr = true;
+		return device_i2s_tx(now);
+	}
+	return 0;
+}
+
+// I2S出力にかかる時間(デバイスのクロックから作る)
+static int64_t i2s_duration_ns(int32_t size)
+{
+	double rate = (double)config.freq * config.ratio * (1. + config.device_ppm * 1e-6) * (1. + config.i2s_ppm * 1e-6);
+	return (int64_t)(size / rate * 1e9);
+}
+
+static int64_t irq_latency_ns(void)
+{
+	return CORE_WAKE_LATENCY_NS + (int64_t)(rand_uniform() * config.irq_jitter_us * 1000.);
+}
+
+// sched_post(発行時刻nowに呼ぶ) すでに発行済みで未実行ならまとめる 処理中なら処理後に実行する
+static void request_wake(SIM_CORE *core, int64_t now, int64_t latency)
+{
+	if (core->wake >= 0)
+		return;
+	int64_t time = now + latency;
+	if (time < core->busy_until)
+		time = core->busy_until;
+	core->wake = time;
+}
+
+static int64_t processing_ns(double us_per_sample, int32_t samples)
+{
+	return CORE_OVERHEAD_NS + (int64_t)(us_per_sample * 1000. * samples);
+}
+
+static void write_csv_header(FILE *fp)
+{
+	fprintf(fp, "time_ms,ep_level,upsr_level,dma_using,feedback_fs,enable_output,underrun,ep_drop,overrun\n");
+}
+
+static void write_csv(FILE *fp, int64_t now)
+{
+	fprintf(fp, "%.3f,%d,%d,%u,%u,%d,%u,%u,%u\n", now / 1e6, sim.ep_level, sim.upsr_level, sim.dma_using,
+			sim.feedback_fs, sim.enable_output, sim.underrun, sim.ep_drop, sim.overrun);
+}
+
+static void run(FILE *csv)
+{
+	const int64_t end = (int64_t)(config.duration_sec * 1e9);
+	const int64_t sof_period = (int64_t)(NS_PER_MS / (1. + config.host_ppm * 1e-6));
+	const int64_t timer0_period = device_period_ns(flow_param.timer0_us);
+
+	int64_t sof_grid = 0;	 // SOFの公称時刻(ホストのクロック)
+	int64_t timer0_grid = 0; // タイマ割り込みの公称時刻(デバイスのクロック)
+	int64_t next_sof = 0;
+	int64_t next_timer0 = timer0_period;
+	SIM_CORE core0 = {-1, 0, false};
+	SIM_CORE core1 = {-1, 0, false};
+	int64_t data_ready = -1; // Core0の処理完了(Core1への通知)
+	int64_t dma_done = -1;
+	int64_t next_csv = 0;
+	uint64_t frame = 0;
+
+	sim.feedback_value = flow_feedback_value(config.freq);
+	sim.feedback_fs = config.freq;
+
+	while (true)
+	{
+		// 次のイベントを選ぶ(同時刻ならCore0の処理完了 → DMA → USB → Core0 → Core1の順)
+		int64_t now = next_sof;
+		if (next_timer0 < now)
+			now = next_timer0;
+		if ((core0.wake >= 0) && (core0.wake < now))
+			now = core0.wake;
+		if ((core1.wake >= 0) && (core1.wake < now))
+			now = core1.wake;
+		if ((dma_done >= 0) && (dma_done < now))
+			now = dma_done;
+		if ((data_ready >= 0) && (data_ready < now))
+			now = data_ready;
+		if (now >= end)
+			break;
+
+		if (csv && (now >= next_csv))
+		{
+			write_csv(csv, now);
+			next_csv += (int64_t)config.csv_interval_ms * NS_PER_MS;
+		}
+
+		if (now == data_ready)
+		{
+			data_ready = -1;
+			request_wake(&core1, now, CORE_WAKE_LATENCY_NS);
+		}
+		else if (now == dma_done)
+		{
+			// DMA割り込み: 次のブロックを送信し、Core1に補充させる
+			sim.dma_busy = false;
+			dma_done = -1;
+			int32_t size = device_i2s_tx(now);
+			if (size > 0)
+			{
+				sim.dma_busy = true;
+				dma_done = now + i2s_duration_ns(size);
+			}
+			request_wake(&core1, now, irq_latency_ns());
+		}
+		else if (now == next_sof)
+		{
+			// USB フレーム: Feedbackの読み出しとオーディオパケットの受信
+			if ((!config.no_feedback) && ((frame % config.refresh_frames) == 0))
+				sim.feedback_value = device_feedback();
+			sim.host_acc += config.no_feedback ? flow_feedback_value(config.freq) : sim.feedback_value;
+			int32_t frames = sim.host_acc >> 14;
+			sim.host_acc -= frames << 14;
+			device_usb_rx(now, frames);
+			request_wake(&core0, now, irq_latency_ns());
+
+			frame++;
+			sof_grid += sof_period;
+			double jitter = (rand_uniform() * 2. - 1.) * config.sof_jitter_us * 1000.;
+			next_sof = sof_grid + (int64_t)jitter;
+			if (next_sof <= now)
+				next_sof = now + 1;
+		}
+		else if (now == core0.wake)
+		{
+			// 処理結果は処理時間が経ってからCore1に通知する
+			core0.wake = -1;
+			int32_t processed = device_core0(now, core0.timer);
+			core0.timer = false;
+			core0.busy_until = now + processing_ns(config.core0_us_per_sample, processed);
+			if (processed > 0)
+				data_ready = core0.busy_until;
+		}
+		else if (now == core1.wake)
+		{
+			core1.wake = -1;
+			int32_t processed;
+			int32_t size = device_core1(now, &processed);
+			core1.busy_until = now + processing_ns(config.core1_us_per_sample, processed);
+			if (size > 0)
+			{
+				sim.dma_busy = true;
+				dma_done = now + i2s_duration_ns(size);
+			}
+		}
+		else
+		{
+			// タイマ割り込み: 両コアを起こす
+			request_wake(&core0, now, irq_latency_ns());
+			core0.timer = true;
+			request_wake(&core1, now, irq_latency_ns());
+			timer0_grid += timer0_period;
+			next_timer0 = timer0_grid + timer0_period;
+		}
+
+		stat_add(&sim.stat_ep, sim.ep_level, now);
+		stat_add(&sim.stat_upsr, sim.upsr_level, now);
+		stat_add(&sim.stat_dma, sim.dma_using, now);
+		stat_add(&sim.stat_fb, sim.feedback_fs, now);
+	}
+}
+
+static void print_stat(const char *name, const STAT *stat)
+{
+	printf("%-18s %10.1f %10.1f %10.1f\n", name, stat->min, stat_avg(stat), stat->max);
+}
+
+static void print_result(void)
+{
+	if (config.quiet)
+	{
+		// freq,ratio,size_upsample,fb_threshold,fb_adj_limit,osr_adj_size,host_ppm,device_ppm,underrun,ep_drop,overrun,upsr_drop,upsr_min,upsr_max,latency_avg_us,latency_max_us
+		printf("%u,%u,%d,%d,%d,%d,%.1f,%.1f,%u,%u,%u,%u,%.0f,%.0f,%.1f,%.1f\n", config.freq, config.ratio,
+			   flow_param.size_upsample, flow_param.fb_threshold, flow_param.fb_adj_limit, flow_param.osr_adj_size,
+			   config.host_ppm, config.device_ppm, sim.underrun, sim.ep_drop, sim.overrun, sim.upsr_drop,
+			   sim.stat_upsr.min, sim.stat_upsr.max, stat_avg(&sim.stat_latency), sim.stat_latency.max);
+		return;
+	}
+
+	printf("freq %uHz ratio %u  host %+.1fppm device %+.1fppm i2s %+.1fppm  SOF jitter %.1fus IRQ jitter %.1fus  %.0fs\n",
+		   config.freq, config.ratio, config.host_ppm, config.device_ppm, config.i2s_ppm, config.sof_jitter_us,
+		   config.irq_jitter_us, config.duration_sec);
+	printf("SIZE_UPSAMPLE_CORE0 %d  FB threshold %d  FB_ADJ_LIMIT %d  OSR_ADJ_SIZE %d  SIZE_EP_BUFFER %d%s\n",
+		   flow_param.size_upsample, flow_param.fb_threshold, flow_param.fb_adj_limit, flow_param.osr_adj_size,
+		   config.size_ep, config.no_feedback ? "  (no feedback)" : "");
+	if (sim.time_first_output >= 0)
+		printf("first output       %.2f ms\n", sim.time_first_output / 1e6);
+	else
+		printf("first output       none\n");
+	printf("underrun           %u (silent %.2f ms)\n", sim.underrun, sim.underrun_ns / 1e6);
+	printf("ep drop            %u\n", sim.ep_drop);
+	printf("limiter overrun    %u\n", sim.overrun);
+	printf("ring buffer drop   %u\n", sim.upsr_drop);
+	printf("\n%-18s %10s %10s %10s   (after %.0fs)\n", "", "min", "avg", "max", WARMUP_SEC);
+	print_stat("ep buffer", &sim.stat_ep);
+	print_stat("ring buffer", &sim.stat_upsr);
+	print_stat("dma queue", &sim.stat_dma);
+	print_stat("feedback fs", &sim.stat_fb);
+	print_stat("latency (us)", &sim.stat_latency);
+}
+
+static uint16_t get_default_ratio(uint32_t freq)
+{
+	// get_ratio_upsampling_core0 (RATIO_UPSAMPLING_48K=8)
+	if (freq >= 176400)
+		return 2;
+	if (freq >= 88200)
+		return 4;
+	return 8;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-r freq] [-k ratio] [-d sec] [-H ppm] [-D ppm] [-I ppm] [-j us] [-J us] [-c us] [-C us] [-R frames] [-F]\n"
+					"          [-u size] [-T size] [-L value] [-A size] [-e size] [-o file.csv [-i ms]] [-s seed] [-q]\n",
+			name);
+}
+
+int main(int argc, char *argv[])
+{
+	int32_t fb_threshold = -1;
+	int c;
+
+	config = (SIM_CONFIG){
+		.freq = 48000,
+		.ratio = 0,
+		.duration_sec = 60.,
+		.core0_us_per_sample = DEFAULT_CORE0_US_PER_SAMPLE,
+		.core1_us_per_sample = DEFAULT_CORE1_US_PER_SAMPLE,
+		.refresh_frames = 1,
+		.size_ep = DEFAULT_SIZE_EP_BUFFER,
+		.csv_interval_ms = 1,
+	};
+	flow_param = (FLOW_PARAM){
+		.size_upsample = DEFAULT_SIZE_UPSAMPLE_CORE0,
+		.fb_adj_limit = DEFAULT_FB_ADJ_LIMIT,
+		.osr_adj_size = DEFAULT_OSR_ADJ_SIZE,
+		.timer0_us = DEFAULT_TIMER0_US,
+		.timer_us_core1 = DEFAULT_TIMER_US_CORE1,
+	};
+
+	while ((c = getopt(argc, argv, "r:k:d:H:D:I:j:J:c:C:R:Fu:T:L:A:e:o:i:s:q")) != -1)
+	{
+		switch (c)
+		{
+		case 'r':
+			config.freq = atoi(optarg);
+			break;
+		case 'k':
+			config.ratio = atoi(optarg);
+			break;
+		case 'd':
+			config.duration_sec = atof(optarg);
+			break;
+		case 'H':
+			config.host_ppm = atof(optarg);
+			break;
+		case 'D':
+			config.device_ppm = atof(optarg);
+			break;
+		case 'I':
+			config.i2s_ppm = atof(optarg);
+			break;
+		case 'j':
+			config.sof_jitter_us = atof(optarg);
+			break;
+		case 'J':
+			config.irq_jitter_us = atof(optarg);
+			break;
+		case 'c':
+			config.core0_us_per_sample = atof(optarg);
+			break;
+		case 'C':
+			config.core1_us_per_sample = atof(optarg);
+			break;
+		case 'R':
+			config.refresh_frames = atoi(optarg);
+			break;
+		case 'F':
+			config.no_feedback = true;
+			break;
+		case 'u':
+			flow_param.size_upsample = atoi(optarg);
+			break;
+		case 'T':
+			fb_threshold = atoi(optarg);
+			break;
+		case 'L':
+			flow_param.fb_adj_limit = atoi(optarg);
+			break;
+		case 'A':
+			flow_param.osr_adj_size = atoi(optarg);
+			break;
+		case 'e':
+			config.size_ep = atoi(optarg);
+			break;
+		case 'o':
+			config.csv_path = optarg;
+			break;
+		case 'i':
+			config.csv_interval_ms = atoi(optarg);
+			break;
+		case 's':
+			rng_state = strtoull(optarg, NULL, 0) | 1;
+			break;
+		case 'q':
+			config.quiet = true;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if ((optind != argc) || (config.freq == 0) || (config.refresh_frames == 0) || (config.csv_interval_ms == 0))
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (config.ratio == 0)
+		config.ratio = get_default_ratio(config.freq);
+	flow_param.fb_threshold = (fb_threshold >= 0) ? fb_threshold : flow_param.size_upsample / 2;
+	flow_param.restart_threshold = flow_param.size_upsample / 16;
+
+	memset(&sim, 0, sizeof(sim));
+	sim.time_first_output = -1;
+	sim.time_idle_start = -1;
+	stat_init(&sim.stat_ep);
+	stat_init(&sim.stat_upsr);
+	stat_init(&sim.stat_dma);
+	stat_init(&sim.stat_fb);
+	stat_init(&sim.stat_latency);
+
+	FILE *csv = NULL;
+	if (config.csv_path)
+	{
+		csv = fopen(config.csv_path, "w");
+		if (csv == NULL)
+		{
+			perror(config.csv_path);
+			return 1;
+		}
+		write_csv_header(csv);
+	}
+
+	run(csv);
+
+	if (csv)
+		fclose(csv);
+	print_result();
+	return (sim.underrun > 0) ? 2 : 0;
+}
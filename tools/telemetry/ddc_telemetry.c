@@ -0,0 +1,549 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+// Pico2 UltraHiRes USB-DDC テレメトリ表示ツール(Linux / macOS)
+// ファームウェアのTELEMETRY_ENABLEをtrueにしてビルドした場合に使える
+//
+// build: cc -O2 -o ddc_telemetry ddc_telemetry.c telemetry_decode.c $(pkg-config --cflags --libs libusb-1.0)
+//
+// usage: ddc_telemetry              デバイスから読み出して表示する
+//        ddc_telemetry -w file.bin  表示しながらパケットをそのまま記録する
+//        ddc_telemetry -r file.bin  記録したファイルを表示する
+//        ddc_telemetry -c           1行1パケットのCSVで出力する
+//        ddc_telemetry -p N         フィルタプロファイルを切り替える(0:minimum 1:linear 2:apodizing 3:short)
+//        ddc_telemetry -p ?         現在のフィルタプロファイルを表示する
+//        ddc_telemetry -e eq.txt    パラメトリックEQを設定する 1行1バンド "L|R|LR 種類 周波数 Q ゲイン(dB)"(空のファイルでEQなし)
+//                                   種類は peaking|lowshelf|highshelf|lowpass|highpass  #以降はコメント
+//        ddc_telemetry -e ?         現在のEQの段数と1段あたりのサイクル数を表示する
+//        ddc_telemetry -i ir.wav    ルーム補正FIRのインパルス応答(2ch 32bit float 最大4096タップ)を書き込み、ir.wavのサンプルレートの入力に適用する
+//        ddc_telemetry -i off       ルーム補正FIRを無効にする
+//        ddc_telemetry -i ?         現在のルーム補正FIRのタップ数と遅延を表示する
+//                                   (-p/-e/-iはTELEMETRY_ENABLEに関係なく使える デバイス宛てのベンダーリクエストなのでインターフェイスを取得しない)
+
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <libusb.h>
+#include "telemetry_decode.h"
+
+#define VENDOR_ID (0x16c0)
+#define PRODUCT_ID (0x27e0)
+#define TELEMETRY_INTERFACE_NUMBER (2)
+#define TELEMETRY_ENDPOINT (0x83)
+#define TIMEOUT_MS (1000)
+
+// フィルタプロファイルのベンダーリクエスト(src/filter_profile.h)
+#define FILTER_PROFILE_REQ_SET (0x01)
+#define FILTER_PROFILE_REQ_GET (0x02)
+
+// パラメトリックEQのベンダーリクエスト(src/peq_control.h)
+#define PEQ_REQ_SET_BAND (0x03)
+#define PEQ_REQ_COMMIT (0x04)
+#define PEQ_REQ_GET (0x05)
+#define PEQ_MAX_BAND (16)
+#define NUM_OF_PEQ_TYPE (6)
+
+// ルーム補正FIRのベンダーリクエスト(src/room_fir_control.h)
+#define ROOM_FIR_REQ_WRITE (0x06)
+#define ROOM_FIR_REQ_COMMIT (0x07)
+#define ROOM_FIR_REQ_GET (0x08)
+#define ROOM_FIR_MAX_TAPS (4096)
+#define ROOM_FIR_WRITE_MAX_TAPS (16)
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int sig)
+{
+	(void)sig;
+	stop = 1;
+}
+
+// 記録したファイルを表示する
+static int replay(const char *path, bool csv)
+{
+	FILE *fp = fopen(path, "rb");
+	if (fp == NULL)
+	{
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return 1;
+	}
+
+	uint32_t invalid = 0;
+	uint32_t count = telemetry_replay(fp, stdout, csv, &invalid);
+	fclose(fp);
+
+	fprintf(stderr, "%u packets", count);
+	if (invalid)
+		fprintf(stderr, " (%u invalid)", invalid);
+	fprintf(stderr, "\n");
+	return 0;
+}
+
+// デバイスから読み出して表示する
+static int capture(const char *path, bool csv)
+{
+	FILE *fp = NULL;
+	if (path != NULL)
+	{
+		fp = fopen(path, "wb");
+		if (fp == NULL)
+		{
+			fprintf(stderr, "%s: %s\n", path, strerror(errno));
+			return 1;
+		}
+	}
+
+	int ret = 1;
+	libusb_context *ctx = NULL;
+	libusb_device_handle *handle = NULL;
+	int r = libusb_init(&ctx);
+	if (r < 0)
+	{
+		fprintf(stderr, "libusb_init: %s\n", libusb_error_name(r));
+		goto exit;
+	}
+
+	handle = libusb_open_device_with_vid_pid(ctx, VENDOR_ID, PRODUCT_ID);
+	if (handle == NULL)
+	{
+		fprintf(stderr, "device %04x:%04x not found\n", VENDOR_ID, PRODUCT_ID);
+		goto exit;
+	}
+
+	// オーディオのインターフェイスはOSのドライバのまま テレメトリのインターフェイスだけを取得する
+	libusb_set_auto_detach_kernel_driver(handle, 1);
+	r = libusb_claim_interface(handle, TELEMETRY_INTERFACE_NUMBER);
+	if (r < 0)
+	{
+		fprintf(stderr, "claim interface %d: %s (TELEMETRY_ENABLE of the firmware may be false)\n",
+				TELEMETRY_INTERFACE_NUMBER, libusb_error_name(r));
+		goto exit;
+	}
+
+	telemetry_print_header(stdout, csv);
+	while (!stop)
+	{
+		TELEMETRY_PACKET packet;
+		int length = 0;
+		r = libusb_bulk_transfer(handle, TELEMETRY_ENDPOINT, (unsigned char *)&packet, sizeof(packet), &length, TIMEOUT_MS);
+		if (r == LIBUSB_ERROR_TIMEOUT)
+			continue;
+		if (r < 0)
+		{
+			fprintf(stderr, "bulk transfer: %s\n", libusb_error_name(r));
+			break;
+		}
+		// トレース(TRACE_ENABLE)のパケットも同じエンドポイントで届くので読み飛ばす
+		if ((length == sizeof(packet)) && (packet.magic != TELEMETRY_MAGIC))
+			continue;
+		if ((length != sizeof(packet)) || (!telemetry_is_valid_packet(&packet)))
+		{
+			fprintf(stderr, "invalid packet (%d bytes)\n", length);
+			continue;
+		}
+
+		if (fp != NULL)
+			fwrite(&packet, sizeof(packet), 1, fp);
+		telemetry_print_packet(stdout, &packet, csv);
+		fflush(stdout);
+	}
+	ret = 0;
+	libusb_release_interface(handle, TELEMETRY_INTERFACE_NUMBER);
+
+exit:
+	if (handle != NULL)
+		libusb_close(handle);
+	if (ctx != NULL)
+		libusb_exit(ctx);
+	if (fp != NULL)
+		fclose(fp);
+	return ret;
+}
+
+// フィルタプロファイルを切り替える(argが"?"の場合は読み出すだけ)
+static int select_profile(const char *arg)
+{
+	int ret = 1;
+	libusb_context *ctx = NULL;
+	libusb_device_handle *handle = NULL;
+	int r = libusb_init(&ctx);
+	if (r < 0)
+	{
+		fprintf(stderr, "libusb_init: %s\n", libusb_error_name(r));
+		goto exit;
+	}
+
+	handle = libusb_open_device_with_vid_pid(ctx, VENDOR_ID, PRODUCT_ID);
+	if (handle == NULL)
+	{
+		fprintf(stderr, "device %04x:%04x not found\n", VENDOR_ID, PRODUCT_ID);
+		goto exit;
+	}
+
+	if (strcmp(arg, "?") != 0)
+	{
+		uint16_t id = (uint16_t)strtoul(arg, NULL, 0);
+		r = libusb_control_transfer(handle, LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+									FILTER_PROFILE_REQ_SET, id, 0, NULL, 0, TIMEOUT_MS);
+		if (r < 0)
+		{
+			// STALL: 番号が範囲外、切り替え中、または負荷の見積もりが上限を超える
+			fprintf(stderr, "set profile %u: %s (refused by the device)\n", id, libusb_error_name(r));
+			goto exit;
+		}
+	}
+
+	unsigned char current = 0;
+	r = libusb_control_transfer(handle, LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+								FILTER_PROFILE_REQ_GET, 0, 0, &current, 1, TIMEOUT_MS);
+	if (r < 1)
+	{
+		fprintf(stderr, "get profile: %s\n", libusb_error_name(r));
+		goto exit;
+	}
+	printf("filter profile: %u\n", current);
+	ret = 0;
+
+exit:
+	if (handle != NULL)
+		libusb_close(handle);
+	if (ctx != NULL)
+		libusb_exit(ctx);
+	return ret;
+}
+
+// EQの設定ファイルの1行をPEQ_BAND_PACKET(8byte)にする 戻り値はチャンネル(bit0:L bit1:R) 空行は0 エラーは-1
+static int parse_eq_line(char *line, unsigned char *packet)
+{
+	const char *type_name[NUM_OF_PEQ_TYPE] = {"off", "peaking", "lowshelf", "highshelf", "lowpass", "highpass"};
+	char ch_name[8], type_str[16];
+	float freq, q, gain = 0.f;
+	int type;
+
+	char *comment = strchr(line, '#');
+	if (comment != NULL)
+		*comment = '\0';
+	int n = sscanf(line, "%7s %15s %f %f %f", ch_name, type_str, &freq, &q, &gain);
+	if (n <= 0)
+		return 0;
+	for (type = 0; (type < NUM_OF_PEQ_TYPE) && strcmp(type_str, type_name[type]); type++)
+		;
+	int ch_mask = (strchr(ch_name, 'L') ? 1 : 0) | (strchr(ch_name, 'R') ? 2 : 0);
+	if ((n < 4) || (type == NUM_OF_PEQ_TYPE) || (ch_mask == 0) || (freq < 1.f) || (freq > 65535.f) || (q < 0.01f) || (q > 655.f) || (gain < -30.f) || (gain > 30.f))
+		return -1;
+
+	uint16_t freq_u16 = (uint16_t)(freq + 0.5f);
+	uint16_t q_u16 = (uint16_t)(q * 100.f + 0.5f);
+	int16_t gain_i16 = (int16_t)(gain * 100.f + ((gain < 0.f) ? -0.5f : 0.5f));
+	packet[0] = (unsigned char)type;
+	packet[1] = 0;
+	packet[2] = freq_u16 & 0xff;
+	packet[3] = freq_u16 >> 8;
+	packet[4] = q_u16 & 0xff;
+	packet[5] = q_u16 >> 8;
+	packet[6] = (uint16_t)gain_i16 & 0xff;
+	packet[7] = (uint16_t)gain_i16 >> 8;
+	return ch_mask;
+}
+
+// パラメトリックEQを設定する(argが"?"の場合は読み出すだけ)
+static int set_eq(const char *arg)
+{
+	int ret = 1;
+	FILE *fp = NULL;
+	libusb_context *ctx = NULL;
+	libusb_device_handle *handle = NULL;
+	int r = libusb_init(&ctx);
+	if (r < 0)
+	{
+		fprintf(stderr, "libusb_init: %s\n", libusb_error_name(r));
+		goto exit;
+	}
+
+	handle = libusb_open_device_with_vid_pid(ctx, VENDOR_ID, PRODUCT_ID);
+	if (handle == NULL)
+	{
+		fprintf(stderr, "device %04x:%04x not found\n", VENDOR_ID, PRODUCT_ID);
+		goto exit;
+	}
+
+	if (strcmp(arg, "?") != 0)
+	{
+		fp = fopen(arg, "r");
+		if (fp == NULL)
+		{
+			fprintf(stderr, "%s: %s\n", arg, strerror(errno));
+			goto exit;
+		}
+
+		// バンドを1つずつ書き込んでから、両chまとめて反映する
+		char line[256];
+		int line_no = 0;
+		int num_band[2] = {0, 0};
+		while (fgets(line, sizeof(line), fp) != NULL)
+		{
+			unsigned char packet[8];
+			line_no++;
+			int ch_mask = parse_eq_line(line, packet);
+			if (ch_mask == 0)
+				continue;
+			if ((ch_mask < 0) || ((ch_mask & 1) && (num_band[0] >= PEQ_MAX_BAND)) || ((ch_mask & 2) && (num_band[1] >= PEQ_MAX_BAND)))
+			{
+				fprintf(stderr, "%s:%d: invalid band\n", arg, line_no);
+				goto exit;
+			}
+			for (int ch = 0; ch < 2; ch++)
+			{
+				if (!(ch_mask & (1 << ch)))
+					continue;
+				r = libusb_control_transfer(handle, LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+											PEQ_REQ_SET_BAND, 0, ((1 << ch) << 8) | num_band[ch], packet, sizeof(packet), TIMEOUT_MS);
+				if (r < 0)
+				{
+					fprintf(stderr, "%s:%d: %s (refused by the device)\n", arg, line_no, libusb_error_name(r));
+					goto exit;
+				}
+				num_band[ch]++;
+			}
+		}
+		for (int ch = 0; ch < 2; ch++)
+		{
+			r = libusb_control_transfer(handle, LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+										PEQ_REQ_COMMIT, num_band[ch], (1 << ch) << 8, NULL, 0, TIMEOUT_MS);
+			if (r < 0)
+			{
+				// STALL: 負荷の見積もりが上限を超える
+				fprintf(stderr, "commit %s %d bands: %s (refused by the device)\n", (ch == 0) ? "L" : "R", num_band[ch], libusb_error_name(r));
+				goto exit;
+			}
+		}
+	}
+
+	unsigned char info[4];
+	r = libusb_control_transfer(handle, LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+								PEQ_REQ_GET, 0, 0, info, sizeof(info), TIMEOUT_MS);
+	if (r < (int)sizeof(info))
+	{
+		fprintf(stderr, "get eq: %s\n", libusb_error_name(r));
+		goto exit;
+	}
+	// 係数の反映は50ms毎なので、書き込み直後は前の段数が返ることがある
+	printf("eq sections: L %u R %u, %u cycles/section (stereo input sample)\n", info[0], info[1], info[2] | (info[3] << 8));
+	ret = 0;
+
+exit:
+	if (fp != NULL)
+		fclose(fp);
+	if (handle != NULL)
+		libusb_close(handle);
+	if (ctx != NULL)
+		libusb_exit(ctx);
+	return ret;
+}
+
+static uint32_t read_le32(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// インパルス応答のWAVファイル(2ch 32bit float)を読む 戻り値はタップ数(エラーの場合0)
+// taps[ch]はfloatのリトルエンディアンのバイト列のまま(デバイスに送る形式)
+static uint32_t read_ir_wav(const char *path, unsigned char taps[2][ROOM_FIR_MAX_TAPS * 4], uint32_t *rate)
+{
+	unsigned char header[12], chunk[8], fmt[26] = {0};
+	uint32_t num_taps = 0;
+	bool has_fmt = false;
+	FILE *fp = fopen(path, "rb");
+	if (fp == NULL)
+	{
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return 0;
+	}
+	if ((fread(header, 1, 12, fp) != 12) || memcmp(header, "RIFF", 4) || memcmp(header + 8, "WAVE", 4))
+	{
+		fprintf(stderr, "%s: not a WAV file\n", path);
+		goto exit;
+	}
+
+	while (fread(chunk, 1, 8, fp) == 8)
+	{
+		uint32_t size = read_le32(chunk + 4);
+		if (!memcmp(chunk, "fmt ", 4))
+		{
+			uint32_t n = (size < sizeof(fmt)) ? size : sizeof(fmt);
+			if (fread(fmt, 1, n, fp) != n)
+				break;
+			fseek(fp, size - n + (size & 1), SEEK_CUR);
+			has_fmt = true;
+		}
+		else if (!memcmp(chunk, "data", 4))
+		{
+			// WAVE_FORMAT_IEEE_FLOAT(3) または WAVE_FORMAT_EXTENSIBLE(0xfffe)のサブフォーマット
+			uint16_t format = fmt[0] | (fmt[1] << 8);
+			if (format == 0xfffe)
+				format = fmt[24] | (fmt[25] << 8);
+			if (!has_fmt || (format != 3) || ((fmt[2] | (fmt[3] << 8)) != 2) || ((fmt[14] | (fmt[15] << 8)) != 32))
+			{
+				fprintf(stderr, "%s: only 2ch 32bit float is supported\n", path);
+				goto exit;
+			}
+			*rate = read_le32(fmt + 4);
+			num_taps = size / 8;
+			if ((num_taps == 0) || (num_taps > ROOM_FIR_MAX_TAPS))
+			{
+				fprintf(stderr, "%s: %u taps (must be 1..%d)\n", path, num_taps, ROOM_FIR_MAX_TAPS);
+				num_taps = 0;
+				goto exit;
+			}
+			for (uint32_t i = 0; i < num_taps; i++)
+			{
+				unsigned char frame[8];
+				if (fread(frame, 1, 8, fp) != 8)
+				{
+					fprintf(stderr, "%s: data chunk is truncated\n", path);
+					num_taps = 0;
+					goto exit;
+				}
+				memcpy(&taps[0][i * 4], frame, 4);
+				memcpy(&taps[1][i * 4], frame + 4, 4);
+			}
+			goto exit;
+		}
+		else
+		{
+			fseek(fp, size + (size & 1), SEEK_CUR);
+		}
+	}
+	fprintf(stderr, "%s: data chunk not found\n", path);
+
+exit:
+	fclose(fp);
+	return num_taps;
+}
+
+// ルーム補正FIRのインパルス応答を書き込む(argが"off"の場合は無効にする "?"の場合は読み出すだけ)
+static int set_room_fir(const char *arg)
+{
+	static unsigned char taps[2][ROOM_FIR_MAX_TAPS * 4];
+	int ret = 1;
+	libusb_context *ctx = NULL;
+	libusb_device_handle *handle = NULL;
+	uint32_t num_taps = 0;
+	uint32_t rate = 0;
+
+	if ((strcmp(arg, "?") != 0) && (strcmp(arg, "off") != 0))
+	{
+		num_taps = read_ir_wav(arg, taps, &rate);
+		if (num_taps == 0)
+			return 1;
+	}
+
+	int r = libusb_init(&ctx);
+	if (r < 0)
+	{
+		fprintf(stderr, "libusb_init: %s\n", libusb_error_name(r));
+		goto exit;
+	}
+
+	handle = libusb_open_device_with_vid_pid(ctx, VENDOR_ID, PRODUCT_ID);
+	if (handle == NULL)
+	{
+		fprintf(stderr, "device %04x:%04x not found\n", VENDOR_ID, PRODUCT_ID);
+		goto exit;
+	}
+
+	if (strcmp(arg, "?") != 0)
+	{
+		// 16タップずつ書き込んでから反映する(反映はデバイスが出力をフェードアウトして行う)
+		for (uint32_t offset = 0; offset < num_taps; offset += ROOM_FIR_WRITE_MAX_TAPS)
+		{
+			uint32_t n = (num_taps - offset < ROOM_FIR_WRITE_MAX_TAPS) ? num_taps - offset : ROOM_FIR_WRITE_MAX_TAPS;
+			for (int ch = 0; ch < 2; ch++)
+			{
+				r = libusb_control_transfer(handle, LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+											ROOM_FIR_REQ_WRITE, offset, 1 << ch, &taps[ch][offset * 4], n * 4, TIMEOUT_MS);
+				if (r < 0)
+				{
+					// STALL: 前の反映が終わっていない
+					fprintf(stderr, "write taps %u: %s (refused by the device)\n", offset, libusb_error_name(r));
+					goto exit;
+				}
+			}
+		}
+		r = libusb_control_transfer(handle, LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+									ROOM_FIR_REQ_COMMIT, num_taps, rate / 100, NULL, 0, TIMEOUT_MS);
+		if (r < 0)
+		{
+			// STALL: 未対応のサンプルレート、前の反映が終わっていない、または負荷の見積もりが上限を超える
+			fprintf(stderr, "commit %u taps at %uHz: %s (refused by the device)\n", num_taps, rate, libusb_error_name(r));
+			goto exit;
+		}
+	}
+
+	unsigned char info[4];
+	r = libusb_control_transfer(handle, LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+								ROOM_FIR_REQ_GET, 0, 0, info, sizeof(info), TIMEOUT_MS);
+	if (r < (int)sizeof(info))
+	{
+		fprintf(stderr, "get room fir: %s\n", libusb_error_name(r));
+		goto exit;
+	}
+	// 反映は出力のフェードアウト後なので、書き込み直後は前のタップ数が返ることがある
+	printf("room fir: %u taps, latency %u samples\n", info[0] | (info[1] << 8), info[2] | (info[3] << 8));
+	ret = 0;
+
+exit:
+	if (handle != NULL)
+		libusb_close(handle);
+	if (ctx != NULL)
+		libusb_exit(ctx);
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *record_path = NULL;
+	const char *replay_path = NULL;
+	bool csv = false;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "w:r:cp:e:i:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'w':
+			record_path = optarg;
+			break;
+		case 'r':
+			replay_path = optarg;
+			break;
+		case 'c':
+			csv = true;
+			break;
+		case 'p':
+			return select_profile(optarg);
+		case 'e':
+			return set_eq(optarg);
+		case 'i':
+			return set_room_fir(optarg);
+		default:
+			fprintf(stderr, "usage: %s [-c] [-w record.bin | -r record.bin] | -p profile|? | -e eq.txt|? | -i ir.wav|off|?\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (replay_path != NULL)
+		return replay(replay_path, csv);
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+	return capture(record_path, csv);
+}
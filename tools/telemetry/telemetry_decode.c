@@ -0,0 +1,69 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#include "telemetry_decode.h"
+
+bool telemetry_is_valid_packet(const TELEMETRY_PACKET *p)
+{
+	return (p->magic == TELEMETRY_MAGIC) && (p->version == TELEMETRY_VERSION);
+}
+
+void telemetry_print_header(FILE *out, bool csv)
+{
+	if (csv)
+		fprintf(out, "seq,time_us,freq,i2s_freq,sys_clock_khz,feedback_fs,fill_ep,fill_upsr,fb_threshold,dma_using,dma_depth,"
+					 "volume_db,load_core0,load_core1,max_core0_pct,max_core1_pct,underrun,overrun,clip,timer0_lateness_us,timer0_missed,spdif_overrun,flags\n");
+}
+
+void telemetry_print_packet(FILE *out, const TELEMETRY_PACKET *p, bool csv)
+{
+	if (csv)
+	{
+		fprintf(out, "%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%.2f,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,0x%02x\n",
+				p->seq, p->time_us, p->freq, p->i2s_freq, p->sys_clock_khz, p->feedback_fs,
+				p->fill_ep, p->fill_upsr, p->fb_threshold, p->dma_using, p->dma_depth,
+				p->volume / 256.0, p->load_core0, p->load_core1, p->max_core0_pct, p->max_core1_pct,
+				p->underrun, p->overrun, p->clip, p->timer0_lateness_us, p->timer0_missed, p->spdif_overrun, p->flags);
+		return;
+	}
+
+	fprintf(out, "#%-6u %6uHz fb %6uHz | ep %4u upsr %5u/%-5u dma %u/%u | load %3u.%u%%/%3u.%u%%",
+			p->seq, p->freq, p->feedback_fs,
+			p->fill_ep, p->fill_upsr, p->fb_threshold, p->dma_using, p->dma_depth,
+			p->load_core0 / 10, p->load_core0 % 10, p->load_core1 / 10, p->load_core1 % 10);
+	if (p->flags & TELEMETRY_FLAG_PROFILE)
+		fprintf(out, " max %3u%%/%3u%%", p->max_core0_pct, p->max_core1_pct);
+	fprintf(out, " | ur %u or %u clip %u late %uus miss %u spdif-or %u | %6.1fdB %s%s%s%s%s\n",
+			p->underrun, p->overrun, p->clip, p->timer0_lateness_us, p->timer0_missed, p->spdif_overrun, p->volume / 256.0,
+			(p->flags & TELEMETRY_FLAG_HIGH_POWER) ? "HI" : "LO",
+			(p->flags & TELEMETRY_FLAG_OUTPUT_ENABLED) ? " OUT" : "",
+			(p->flags & TELEMETRY_FLAG_SWITCHING) ? " SWITCH" : "",
+			(p->flags & TELEMETRY_FLAG_BIQUAD2_ON_CORE1) ? " BQ2@C1" : "",
+			(p->flags & TELEMETRY_FLAG_MUTE) ? " MUTE" : "");
+}
+
+// 記録したパケット(ddc_telemetry -w)をinから読み、有効なものをoutに表示する 戻り値は表示したパケット数
+// invalidには読み飛ばした(magic・versionが異なる)パケット数を返す
+uint32_t telemetry_replay(FILE *in, FILE *out, bool csv, uint32_t *invalid)
+{
+	TELEMETRY_PACKET packet;
+	uint32_t count = 0;
+
+	*invalid = 0;
+	telemetry_print_header(out, csv);
+	while (fread(&packet, sizeof(packet), 1, in) == 1)
+	{
+		if (!telemetry_is_valid_packet(&packet))
+		{
+			(*invalid)++;
+			continue;
+		}
+		telemetry_print_packet(out, &packet, csv);
+		count++;
+	}
+	return count;
+}
@@ -0,0 +1,23 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef _TELEMETRY_DECODE_H_
+#define _TELEMETRY_DECODE_H_
+
+// テレメトリパケットの表示(libusbに依存しないので、ddc_telemetryとtools/dsp_hostのddc_upsample -Tで共有する)
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "../../src/telemetry_packet.h"
+
+extern bool telemetry_is_valid_packet(const TELEMETRY_PACKET *p);
+extern void telemetry_print_header(FILE *out, bool csv);
+extern void telemetry_print_packet(FILE *out, const TELEMETRY_PACKET *p, bool csv);
+extern uint32_t telemetry_replay(FILE *in, FILE *out, bool csv, uint32_t *invalid);
+
+#endif /* _TELEMETRY_DECODE_H_ */
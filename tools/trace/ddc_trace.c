@@ -0,0 +1,397 @@
+/*
+* Copyright (c) 2025 ArqAlice 
+*
+* Released under the MIT license
+* https://opensource.org/licenses/mit-license.php
+*/
+
+// Pico2 UltraHiRes USB-DDC トレースデコーダ
+// 両コアのトレースイベントを時刻順に並べたタイムラインにする
+//
+// build: cc -O2 -o ddc_trace ddc_trace.c $(pkg-config --cflags --libs libusb-1.0)
+//
+// usage: ddc_trace -r uart.bin            UARTの受信データ(例: cat /dev/ttyUSB0 > uart.bin)をデコードする
+//        ddc_trace -u [-w record.bin]      USB(TELEMETRY_ENABLE)から読み出す Ctrl-Cで終了してタイムラインを出力する
+//                                          -wで受信したイベントをUARTと同じ形式で記録する(-rで読める)
+//        -j trace.json                     Chrome/Perfetto形式でも出力する(開始/終了イベントは区間になる)
+
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <libusb.h>
+#include "../../src/trace_format.h"
+
+#define VENDOR_ID (0x16c0)
+#define PRODUCT_ID (0x27e0)
+#define TELEMETRY_INTERFACE_NUMBER (2)
+#define TELEMETRY_ENDPOINT (0x83)
+#define TIMEOUT_MS (1000)
+
+typedef struct
+{
+	int64_t time_us; // 折り返しを展開した時刻
+	uint32_t raw_time_us;
+	uint8_t core;
+	uint8_t id;
+	uint32_t payload;
+} EVENT;
+
+static const char *event_name[NUM_OF_TRACE_ID] = {
+	"?",
+	"usb_rx",
+	"feedback",
+	"timer0",
+	"core0_begin",
+	"core0_end",
+	"core1_begin",
+	"core1_end",
+	"dma_irq",
+	"underrun",
+	"overrun",
+	"stream_switch",
+	"split_begin",
+	"split_end",
+};
+
+static EVENT *events = NULL;
+static size_t num_events = 0;
+static size_t size_events = 0;
+static uint32_t dropped[2] = {0};
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int sig)
+{
+	(void)sig;
+	stop = 1;
+}
+
+static void add_event(uint8_t core, const TRACE_RECORD *record)
+{
+	if (num_events >= size_events)
+	{
+		size_events = size_events ? size_events * 2 : 4096;
+		events = realloc(events, size_events * sizeof(EVENT));
+		if (events == NULL)
+		{
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+	}
+	EVENT *e = &events[num_events++];
+	e->raw_time_us = record->time_us;
+	e->core = core & 1;
+	e->id = record->event >> 24;
+	e->payload = record->event & TRACE_PAYLOAD_MASK;
+}
+
+static void write_uart_record(FILE *fp, uint8_t core, const TRACE_RECORD *record)
+{
+	uint8_t buf[TRACE_UART_RECORD_SIZE];
+	uint8_t sum = 0;
+	memcpy(&buf[4], record, sizeof(TRACE_RECORD));
+	for (int i = 4; i < TRACE_UART_RECORD_SIZE; i++)
+		sum += buf[i];
+	buf[0] = TRACE_UART_SYNC0;
+	buf[1] = TRACE_UART_SYNC1;
+	buf[2] = core;
+	buf[3] = sum;
+	fwrite(buf, sizeof(buf), 1, fp);
+}
+
+// UARTの受信データから 'T' 'R' コア チェックサム を探してレコードを取り出す(計測結果のテキストが混ざっていてもよい)
+static int read_uart_capture(const char *path)
+{
+	FILE *fp = fopen(path, "rb");
+	if (fp == NULL)
+	{
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return 1;
+	}
+
+	uint8_t buf[TRACE_UART_RECORD_SIZE];
+	size_t filled = 0;
+	uint32_t skipped = 0;
+	int c;
+	while ((c = fgetc(fp)) != EOF)
+	{
+		buf[filled++] = (uint8_t)c;
+		if (filled < TRACE_UART_RECORD_SIZE)
+			continue;
+
+		uint8_t sum = 0;
+		for (int i = 4; i < TRACE_UART_RECORD_SIZE; i++)
+			sum += buf[i];
+		if ((buf[0] == TRACE_UART_SYNC0) && (buf[1] == TRACE_UART_SYNC1) && (buf[2] < 2) && (buf[3] == sum))
+		{
+			TRACE_RECORD record;
+			memcpy(&record, &buf[4], sizeof(record));
+			add_event(buf[2], &record);
+			filled = 0;
+		}
+		else
+		{
+			// 1byteずらして同期を取り直す
+			memmove(buf, buf + 1, --filled);
+			skipped++;
+		}
+	}
+	fclose(fp);
+	if (skipped)
+		fprintf(stderr, "%u bytes skipped\n", skipped);
+	return 0;
+}
+
+// USBのテレメトリインターフェイスからトレースのパケットを読む(テレメトリのパケットは読み飛ばす)
+static int read_usb(const char *record_path)
+{
+	FILE *fp = NULL;
+	if (record_path != NULL)
+	{
+		fp = fopen(record_path, "wb");
+		if (fp == NULL)
+		{
+			fprintf(stderr, "%s: %s\n", record_path, strerror(errno));
+			return 1;
+		}
+	}
+
+	int ret = 1;
+	libusb_context *ctx = NULL;
+	libusb_device_handle *handle = NULL;
+	int r = libusb_init(&ctx);
+	if (r < 0)
+	{
+		fprintf(stderr, "libusb_init: %s\n", libusb_error_name(r));
+		goto exit;
+	}
+
+	handle = libusb_open_device_with_vid_pid(ctx, VENDOR_ID, PRODUCT_ID);
+	if (handle == NULL)
+	{
+		fprintf(stderr, "device %04x:%04x not found\n", VENDOR_ID, PRODUCT_ID);
+		goto exit;
+	}
+
+	libusb_set_auto_detach_kernel_driver(handle, 1);
+	r = libusb_claim_interface(handle, TELEMETRY_INTERFACE_NUMBER);
+	if (r < 0)
+	{
+		fprintf(stderr, "claim interface %d: %s (TELEMETRY_ENABLE of the firmware may be false)\n",
+				TELEMETRY_INTERFACE_NUMBER, libusb_error_name(r));
+		goto exit;
+	}
+
+	fprintf(stderr, "capturing... Ctrl-C to stop\n");
+	while (!stop)
+	{
+		TRACE_PACKET packet;
+		int length = 0;
+		r = libusb_bulk_transfer(handle, TELEMETRY_ENDPOINT, (unsigned char *)&packet, sizeof(packet), &length, TIMEOUT_MS);
+		if (r == LIBUSB_ERROR_TIMEOUT)
+			continue;
+		if (r < 0)
+		{
+			fprintf(stderr, "bulk transfer: %s\n", libusb_error_name(r));
+			break;
+		}
+		if ((length != sizeof(packet)) || (packet.magic != TRACE_PACKET_MAGIC) || (packet.version != TRACE_PACKET_VERSION))
+			continue;
+
+		uint8_t core = packet.core & 1;
+		dropped[core] = packet.dropped;
+		for (int i = 0; (i < packet.count) && (i < TRACE_RECORDS_PER_PACKET); i++)
+		{
+			add_event(core, &packet.record[i]);
+			if (fp != NULL)
+				write_uart_record(fp, core, &packet.record[i]);
+		}
+	}
+	ret = 0;
+	libusb_release_interface(handle, TELEMETRY_INTERFACE_NUMBER);
+
+exit:
+	if (handle != NULL)
+		libusb_close(handle);
+	if (ctx != NULL)
+		libusb_exit(ctx);
+	if (fp != NULL)
+		fclose(fp);
+	return ret;
+}
+
+// 32bitの時刻の折り返しをコア毎に展開する(各コアのイベントは時刻順に届く)
+static void unwrap_time(void)
+{
+	if (num_events == 0)
+		return;
+
+	uint32_t base = events[0].raw_time_us;
+	bool started[2] = {false, false};
+	int64_t last[2] = {0, 0};
+	uint32_t last_raw[2] = {0, 0};
+	for (size_t i = 0; i < num_events; i++)
+	{
+		EVENT *e = &events[i];
+		if (!started[e->core])
+		{
+			last[e->core] = (int32_t)(e->raw_time_us - base);
+			started[e->core] = true;
+		}
+		else
+		{
+			last[e->core] += (int32_t)(e->raw_time_us - last_raw[e->core]);
+		}
+		last_raw[e->core] = e->raw_time_us;
+		e->time_us = last[e->core];
+	}
+}
+
+static int compare_event(const void *a, const void *b)
+{
+	const EVENT *ea = a;
+	const EVENT *eb = b;
+	if (ea->time_us != eb->time_us)
+		return (ea->time_us < eb->time_us) ? -1 : 1;
+	if (ea->core != eb->core)
+		return ea->core - eb->core;
+	return (ea < eb) ? -1 : 1;
+}
+
+static const char *get_event_name(uint8_t id)
+{
+	return (id < NUM_OF_TRACE_ID) ? event_name[id] : "?";
+}
+
+static void print_timeline(void)
+{
+	int64_t origin = num_events ? events[0].time_us : 0;
+	int64_t prev = origin;
+	int64_t begin[2][NUM_OF_TRACE_ID] = {{0}};
+
+	printf("%12s %8s  core  %-14s %10s\n", "time_us", "delta", "event", "payload");
+	for (size_t i = 0; i < num_events; i++)
+	{
+		const EVENT *e = &events[i];
+		uint8_t id = (e->id < NUM_OF_TRACE_ID) ? e->id : 0;
+		printf("%12lld %+8lld  c%u    %-14s %10u", (long long)(e->time_us - origin), (long long)(e->time_us - prev),
+			   e->core, get_event_name(id), e->payload);
+
+		// 終了イベントには区間の長さを付ける
+		if ((id == TRACE_ID_CORE0_END) || (id == TRACE_ID_CORE1_END) || (id == TRACE_ID_SPLIT_END))
+			printf("  (%lld us)", (long long)(e->time_us - begin[e->core][id - 1]));
+		printf("\n");
+
+		begin[e->core][id] = e->time_us;
+		prev = e->time_us;
+	}
+	fprintf(stderr, "%zu events, dropped c0 %u c1 %u\n", num_events, dropped[0], dropped[1]);
+}
+
+// Chrome Trace Event Format (chrome://tracing, ui.perfetto.dev で表示できる)
+static int write_json(const char *path)
+{
+	FILE *fp = fopen(path, "w");
+	if (fp == NULL)
+	{
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return 1;
+	}
+
+	int64_t origin = num_events ? events[0].time_us : 0;
+	fprintf(fp, "{\"traceEvents\":[\n");
+	for (size_t i = 0; i < num_events; i++)
+	{
+		const EVENT *e = &events[i];
+		const char *name = get_event_name(e->id);
+		const char *ph = "i";
+		switch (e->id)
+		{
+		case TRACE_ID_CORE0_BEGIN:
+		case TRACE_ID_CORE0_END:
+			ph = (e->id == TRACE_ID_CORE0_BEGIN) ? "B" : "E";
+			name = "core0_upsampling";
+			break;
+		case TRACE_ID_CORE1_BEGIN:
+		case TRACE_ID_CORE1_END:
+			ph = (e->id == TRACE_ID_CORE1_BEGIN) ? "B" : "E";
+			name = "core1_block";
+			break;
+		case TRACE_ID_SPLIT_BEGIN:
+		case TRACE_ID_SPLIT_END:
+			ph = (e->id == TRACE_ID_SPLIT_BEGIN) ? "B" : "E";
+			name = "split_lch";
+			break;
+		default:
+			break;
+		}
+		fprintf(fp, "{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%lld,\"pid\":0,\"tid\":%u%s,\"args\":{\"payload\":%u}}%s\n",
+				name, ph, (long long)(e->time_us - origin), e->core, (ph[0] == 'i') ? ",\"s\":\"t\"" : "",
+				e->payload, (i + 1 < num_events) ? "," : "");
+	}
+	fprintf(fp, "]}\n");
+	fclose(fp);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *uart_path = NULL;
+	const char *record_path = NULL;
+	const char *json_path = NULL;
+	bool use_usb = false;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "r:uw:j:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'r':
+			uart_path = optarg;
+			break;
+		case 'u':
+			use_usb = true;
+			break;
+		case 'w':
+			record_path = optarg;
+			break;
+		case 'j':
+			json_path = optarg;
+			break;
+		default:
+			uart_path = NULL;
+			use_usb = false;
+			break;
+		}
+	}
+	if ((uart_path == NULL) == (!use_usb))
+	{
+		fprintf(stderr, "usage: %s (-r uart.bin | -u [-w record.bin]) [-j trace.json]\n", argv[0]);
+		return 1;
+	}
+
+	int ret;
+	if (use_usb)
+	{
+		signal(SIGINT, on_signal);
+		signal(SIGTERM, on_signal);
+		ret = read_usb(record_path);
+	}
+	else
+	{
+		ret = read_uart_capture(uart_path);
+	}
+	if (ret != 0)
+		return ret;
+
+	unwrap_time();
+	qsort(events, num_events, sizeof(EVENT), compare_event);
+	print_timeline();
+	if (json_path != NULL)
+		ret = write_json(json_path);
+	free(events);
+	return ret;
+}